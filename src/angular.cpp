@@ -8,7 +8,15 @@
 
 #include "angular.hpp"
 #include "particlestream.hpp"
+#include "bufferpool.hpp"
+#include "energybands.hpp"
+#include "hdfstream.hpp"
+#include "memorybudget.hpp"
+#include "parallel.hpp"
+#include "spheregrid.hpp"
 #include <vector>
+#include <algorithm>
+#include <limits>
 #include <iostream>
 #include <iomanip>
 #include <cmath>
@@ -52,7 +60,11 @@ MsdfCommand_angular::MsdfCommand_angular()
     ("mingamma", po::value<double>(&minGamma),"minimum energy of the particles to plot. A value less than 1.0 means no limiting (default: 0.0)")
     ("maxgamma", po::value<double>(&maxGamma),"maximum energy of the particles to plot. A value less than 1.0 means no limiting (default: 0.0)")
     ("output,o", po::value<std::string>(&outputName),"base name of the output file. A # in the file name will be replaced with the species number. If no # is present, the species number will be appended to the file name.")
-    ("stretch", "stretch the data by the magnitude, i.e. calculate the weighted average or current density");
+    ("stretch", "stretch the data by the magnitude, i.e. calculate the weighted average or current density")
+    ("nside", po::value<int>(&nside),"bin the momentum directions onto an equal-area sphere of 12*nside^2 pixels and write HDF maps")
+    ("polar", po::value<std::string>(&polarAxis),"momentum component along the polar axis of the sphere. Any of px,py,pz (default: 'px')")
+    ("bands", po::value<std::string>(&bandsStr),"gamma values separated by commas that bound the energy bands, or log:<min>:<max>:<count> for logarithmic bands. Replaces mingamma and maxgamma")
+    ("threads,j", po::value<int>(&numThreads),"number of threads used for the sphere maps (default: number of cores)");
 
   option_pos.add("input", 1);
 }
@@ -60,9 +72,8 @@ MsdfCommand_angular::MsdfCommand_angular()
 
 void MsdfCommand_angular::execute(int argc, char **argv)
 {
-  double minGamma2;
-  double maxGamma2;
-  std::vector<pDataGrid1d> plots;
+  // the plots are indexed by species and energy band
+  std::vector<std::vector<pDataGrid1d> > plots;
   
   int maxId = 0;
   int smallId = 0;
@@ -77,7 +88,9 @@ void MsdfCommand_angular::execute(int argc, char **argv)
   limitX = false;
   limitY = false;
 
-  if (vm.count("output")<1) outputName = "phaseplot#.dat";
+  if (vm.count("output")<1) outputName = (vm.count("nside")>0) ? "angular#.h5" : "phaseplot#.dat";
+  if (vm.count("polar")<1) polarAxis = "px";
+  if (vm.count("threads")<1) numThreads = defaultThreadCount();
   if (vm.count("xaxis")<1) xAxis = "px";
   if (vm.count("yaxis")<1) yAxis = "py";
   if (vm.count("chunk")<1) chunkLength = 1024*1024;
@@ -93,54 +106,63 @@ void MsdfCommand_angular::execute(int argc, char **argv)
   limitX = !( (vm.count("xrmin")<1) && (vm.count("xrmax")<1) );
   limitY = !( (vm.count("yrmin")<1) && (vm.count("yrmax")<1) );
 
-  minGamma2 = minGamma*minGamma;
-  maxGamma2 = maxGamma*maxGamma;
+  bool useBands = (vm.count("bands")>0);
+  EnergyBands bands(minGamma, maxGamma);
+  if (useBands) bands.parse(bandsStr);
+  int numBands = bands.size();
 
   std::cerr << "minGamma - 1 " << minGamma-1 << "\n";
   std::cerr << "maxGamma - 1 " << maxGamma-1 << "\n";
   
   xAxisId = makeAxisId(xAxis);
   yAxisId = makeAxisId(yAxis);
+
+  int columns = pc_species | pc_weight
+      | particleColumnsForAxis(xAxisId)
+      | particleColumnsForAxis(yAxisId);
+  if (limitX || limitY) columns |= pc_mesh;
+  if ((minGamma > 1.0) || (maxGamma >= 1.0) || useBands) columns |= pc_momentum;
+
+  weightIt = vm.count("stretch")>0;
+
+  if (vm.count("nside")>0)
+  {
+    executeSphere(vm, columns | pc_momentum);
+    return;
+  }
   
   // set up species arrays and calculate min and max values
   
+  streamFact.setColumns(columns);
   pParticleStream pstream = streamFact.getParticleStream(vm);
-  if (!pstream)
-  {
-    print_help();
-    exit(-1);
-  }
+  if (!pstream) throw GenericException("No input file given");
   pstream->getNextChunks();
 
-  weightIt = vm.count("stretch")>0;
-
   while (! pstream->eos() )
   {
-    GridIt1 sp_it = pstream->species->cbegin();
-    GridIt1 wg_it = pstream->weight->cbegin();
-    GridIt1 px_it = pstream->px->cbegin();
-    GridIt1 py_it = pstream->py->cbegin();
-    GridIt1 pz_it = pstream->pz->cbegin();
-    GridIt2 mesh_it = pstream->mesh->cbegin();
+    const ParticleChunk &chunk = pstream->getChunk();
     
-    while (sp_it != pstream->species->cend())
+    for (int64_t i=0; i<chunk.length(); ++i, ++pos)
     {
 
-      double px = *px_it;
-      double py = *py_it;
-      double pz = *pz_it;
-      double x = *mesh_it;
-      ++mesh_it;
-      double y = *mesh_it;
+      double px = chunk.px()[i];
+      double py = chunk.py()[i];
+      double pz = chunk.pz()[i];
+      double x = chunk.x()[i];
+      double y = (chunk.getRank() > 1) ? chunk.y()[i] : 0.0;
 
-      int id = *sp_it;
+      int id = chunk.species()[i];
       if (id > maxId)
       {
         for (int i=maxId; i<id; ++i)
         {
-          pDataGrid1d pGrid(new DataGrid1d(GridIndex1d(dim+1)));
-          *pGrid = 0.0;
-          plots.push_back(pGrid);
+          plots.push_back(std::vector<pDataGrid1d>(numBands));
+          for (int k=0; k<numBands; ++k)
+          {
+            pDataGrid1d pGrid(new DataGrid1d(GridIndex1d(dim+1)));
+            *pGrid = 0.0;
+            plots.back()[k] = pGrid;
+          }
         }
         maxId = id;
       }
@@ -151,7 +173,8 @@ void MsdfCommand_angular::execute(int argc, char **argv)
       else {
         double mc = 9.10938188e-31*2.99792458e8;
         double gamma2 = 1 + (px*px + py*py + pz*pz)/(mc*mc);
-        if (gamma2 >= minGamma2 && ((maxGamma<1.0) || (gamma2 <= maxGamma2)))
+        int band = bands.find(sqrt(gamma2));
+        if (band >= 0)
 	{
 	  
 	  double X = getValue(0, px, py, pz, x, y);
@@ -161,7 +184,7 @@ void MsdfCommand_angular::execute(int argc, char **argv)
               ( !limitY || ((y > yrmin) && (y < yrmax)) ) )
           {
             double angle = dim*(atan2(Y,X)/(2.0*M_PI) + 0.5);
-            double weight = (*wg_it);
+            double weight = chunk.weight()[i];
 
             if (weightIt)
             {
@@ -174,7 +197,7 @@ void MsdfCommand_angular::execute(int argc, char **argv)
             if (bin<0.0) { bin = 0.0; frac = 0.0; }
             if (bin>=dim) { bin = dim; frac = 1.0; }
 
-            DataGrid1d &grid = *plots[id];
+            DataGrid1d &grid = *plots[id][band];
             grid(bin)    += weight * (1-frac);
             grid(bin+1)  += weight * frac;
           }
@@ -182,13 +205,6 @@ void MsdfCommand_angular::execute(int argc, char **argv)
 	
         maxPos = pos;
       }
-      ++sp_it;
-      ++mesh_it;
-      ++px_it;
-      ++py_it;
-      ++pz_it;
-      ++wg_it;
-      ++pos;
     }
     pstream->getNextChunks();
   }
@@ -196,15 +212,33 @@ void MsdfCommand_angular::execute(int argc, char **argv)
   for (int id=0; id<plots.size(); ++id) {
     std::string outputName = createOutputFile(id);
     std::ofstream output(outputName.c_str());
-    DataGrid1d &grid = *plots[id];
-    
-    grid(0) += grid(dim);
-    grid(dim) = grid(0);
-    
+
+    for (int k=0; k<numBands; ++k)
+    {
+      DataGrid1d &grid = *plots[id][k];
+      grid(0) += grid(dim);
+      grid(dim) = grid(0);
+    }
+
+    if (useBands)
+    {
+      output << "# angle";
+      for (int k=0; k<numBands; ++k)
+        output << " [" << bands.getLower(k) << "," << bands.getUpper(k) << ")";
+      output << std::endl;
+    }
+
     for (int i=0; i<=dim; ++i)
     {
       double angle = M_PI*(2.0*double(i)/double(dim) - 1.0);
-      double r = grid(i);
+      if (useBands)
+      {
+        output << angle;
+        for (int k=0; k<numBands; ++k) output << " " << (*plots[id][k])(i);
+        output << std::endl;
+        continue;
+      }
+      double r = (*plots[id][0])(i);
       double x = r*cos(angle);
       double y = r*sin(angle);
       output << x << " " << y << " " << angle << " " << r << std::endl;
@@ -220,8 +254,140 @@ void MsdfCommand_angular::execute(int argc, char **argv)
 
 }
 
+/*
+ * The pixel and band of each particle are computed in parallel blocks. The
+ * pixels are then divided into ranges and each thread adds the particles
+ * that fall into its own range, so the maps don't depend on the number of
+ * threads.
+ */
+void MsdfCommand_angular::executeSphere(po::variables_map &vm, int columns)
+{
+  SphereGrid sphere(nside);
+  int64_t npix = sphere.getNumPixels();
+
+  EnergyBands bands(minGamma, maxGamma);
+  if (vm.count("bands")>0) bands.parse(bandsStr);
+  int numBands = bands.size();
 
+  int polar;
+  if (polarAxis == "px") polar = 0;
+  else if (polarAxis == "py") polar = 1;
+  else if (polarAxis == "pz") polar = 2;
+  else throw GenericException("Unknown polar axis " + polarAxis);
 
+  streamFact.setColumns(columns);
+  pParticleStream pstream = streamFact.getParticleStream(vm);
+  if (!pstream) throw GenericException("No input file given");
+  double mc = pstream->isRaw() ? 1.0 : 9.10938188e-31*2.99792458e8;
+
+  // the maps are indexed by species and band
+  std::vector<std::vector<DoubleVector> > maps;
+  BudgetReservation reservation;
+  int smallId = 0;
+  BufferPool pool;
+
+  pstream->getNextChunks();
+  while (! pstream->eos() )
+  {
+    const ParticleChunk &chunk = pstream->getChunk();
+    int64_t length = chunk.length();
+
+    for (int64_t i=0; i<length; ++i)
+    {
+      int id = chunk.species()[i];
+      if (id < 1) { ++smallId; continue; }
+      for (int s=maps.size(); s<id; ++s)
+      {
+        reservation.grow(numBands*npix*sizeof(double), "angular sphere maps");
+        maps.push_back(std::vector<DoubleVector>(numBands, DoubleVector(npix, 0.0)));
+      }
+    }
+
+    int64_t *pixel = pool.get<int64_t>(0, length);
+    int *band = pool.get<int>(1, length);
+    double *value = pool.get<double>(2, length);
+
+    const int64_t blockLength = 4096;
+    int numBlocks = (length + blockLength - 1)/blockLength;
+    parallelFor(numBlocks, numThreads, [&](int b)
+    {
+      for (int64_t i=b*blockLength; i<std::min(length, (b+1)*blockLength); ++i)
+      {
+        pixel[i] = -1;
+        if (chunk.species()[i] < 1) continue;
+
+        double p[3] = { chunk.px()[i], chunk.py()[i], chunk.pz()[i] };
+        double p2 = p[0]*p[0] + p[1]*p[1] + p[2]*p[2];
+        double gamma = sqrt(1 + p2/(mc*mc));
+        band[i] = bands.find(gamma);
+        if (band[i] < 0) continue;
+
+        if (limitX || limitY)
+        {
+          double x = chunk.x()[i];
+          double y = (chunk.getRank() > 1) ? chunk.y()[i] : 0.0;
+          if ( (limitX && !((x > xrmin) && (x < xrmax))) ||
+               (limitY && !((y > yrmin) && (y < yrmax))) ) continue;
+        }
+
+        pixel[i] = sphere.direction(p[polar], p[(polar+1)%3], p[(polar+2)%3]);
+        value[i] = chunk.weight()[i];
+        if (weightIt) value[i] *= sqrt(p2);
+      }
+    });
+
+    int numRanges = std::min(int64_t(numThreads), npix);
+    parallelFor(numRanges, numThreads, [&](int r)
+    {
+      int64_t begin = r*npix/numRanges;
+      int64_t end = (r+1)*npix/numRanges;
+      for (int64_t i=0; i<length; ++i)
+      {
+        if ((pixel[i] < begin) || (pixel[i] >= end)) continue;
+        maps[chunk.species()[i]-1][band[i]][pixel[i]] += value[i];
+      }
+    });
+
+    pstream->getNextChunks();
+  }
+
+  GridIndex1d pixels(npix), bandsSize(numBands+1);
+  DataGrid1d theta(pixels), phi(pixels), data(pixels);
+  for (int64_t pix=0; pix<npix; ++pix)
+  {
+    double z, azimuth;
+    sphere.centre(pix, z, azimuth);
+    theta(pix) = acos(z);
+    phi(pix) = azimuth;
+  }
+  DataGrid1d bandEdges(bandsSize);
+  for (int k=0; k<=numBands; ++k) bandEdges(k) = bands.getEdges()[k];
+
+  double area = sphere.getPixelArea();
+  for (size_t id=0; id<maps.size(); ++id)
+  {
+    std::string outputName = createOutputFile(id);
+    HDFostream output(outputName.c_str());
+    output.setBlockName("theta");
+    output << theta;
+    output.setBlockName("phi");
+    output << phi;
+    output.setBlockName("bands");
+    output << bandEdges;
+    for (int k=0; k<numBands; ++k)
+    {
+      for (int64_t pix=0; pix<npix; ++pix) data(pix) = maps[id][k][pix]/area;
+      output.setBlockName("band" + boost::lexical_cast<std::string>(k));
+      output << data;
+    }
+    output.close();
+  }
+
+  std::cout << "Successfully written " << maps.size() << " angular sphere maps" << std::endl;
+
+  if (smallId>0)
+    std::cerr << "WARNING!\n    " << smallId << " species IDs found with values < 1\n";
+}
 
 char MsdfCommand_angular::makeAxisId(std::string axisStr)
 {
@@ -243,7 +409,12 @@ void MsdfCommand_angular::print_help()
   
   std::cout << "\nxrmin, xrmax, yrmin, yrmax define a region in real space to which the particles are limited.\n"
         << "  If neither xrmin nor xrmax are set, no limitations in the x-direction is made\n"
-        << "  and equivalently for yrmin and yrmax\n";
+        << "  and equivalently for yrmin and yrmax\n"
+        << "\nWith --bands the ascii output contains the angle followed by one column per energy band.\n"
+        << "\nWith --nside the momentum directions are binned onto 12*nside^2 pixels of equal solid\n"
+        << "  angle (HEALPix ring scheme, polar axis given by --polar). One HDF file is written per species\n"
+        << "  containing the pixel centres theta and phi, the gamma edges of the bands and one map\n"
+        << "  band<k> per energy band in units of weight per steradian.\n";
 }
 
 std::string MsdfCommand_angular::createOutputFile(int speciesId)
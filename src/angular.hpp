@@ -17,9 +17,6 @@
 class MsdfCommand_angular: public MsdfCommand
 {
   private:
-    typedef DataGrid1d::const_storage_iterator GridIt1;
-    typedef DataGrid2d::const_storage_iterator GridIt2;
-    
     boost::program_options::options_description option_desc;
     boost::program_options::positional_options_description option_pos;
     ParticleStreamFactory streamFact;
@@ -38,6 +35,11 @@ class MsdfCommand_angular: public MsdfCommand
     double maxGamma;
     int dim;
 
+    int nside;
+    std::string polarAxis;
+    std::string bandsStr;
+    int numThreads;
+
     char xAxisId;
     char yAxisId;
 
@@ -47,6 +49,9 @@ class MsdfCommand_angular: public MsdfCommand
     char makeAxisId(std::string axisStr);
     double getValue(int axis, double px, double py, double pz, double x, double y);
 
+    /// Bin the momentum directions onto an equal-area pixelisation of the sphere
+    void executeSphere(boost::program_options::variables_map &vm, int columns);
+
   public:
     MsdfCommand_angular();
     void execute(int argc, char **argv);
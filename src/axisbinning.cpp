@@ -0,0 +1,90 @@
+/*
+ * axisbinning.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "axisbinning.hpp"
+#include "tdigest.hpp"
+#include "common/binaryio.hpp"
+
+#include <algorithm>
+
+bool AxisBinning::parseScale(const std::string &name, Scale &scale)
+{
+  if (name == "lin") scale = linear;
+  else if (name == "log") scale = logarithmic;
+  else if (name == "adaptive") scale = adaptive;
+  else return false;
+  return true;
+}
+
+AxisBinning::AxisBinning()
+  : scale(linear), bins(1), lo(0.0), hi(1.0), logLo(0.0), invWidth(1.0)
+{}
+
+AxisBinning::AxisBinning(Scale scale_, double lo_, double hi_, int bins_)
+  : scale(scale_), bins(bins_), lo(lo_), hi(hi_), logLo(0.0), invWidth(0.0)
+{
+  if (bins < 1)
+    throw msdf::GenericException("An axis needs at least one bin");
+  if (scale == logarithmic)
+  {
+    if (!(lo > 0.0) || !(hi > lo))
+      throw msdf::GenericException("A logarithmic axis needs 0 < min < max");
+    logLo = std::log(lo);
+    invWidth = bins/(std::log(hi) - logLo);
+  }
+  else
+  {
+    scale = linear;
+    invWidth = bins/(hi - lo);
+  }
+}
+
+AxisBinning::AxisBinning(TDigest &sketch, int bins_)
+  : scale(adaptive), bins(bins_), lo(sketch.getMin()), hi(sketch.getMax()), logLo(0.0), invWidth(0.0)
+{
+  if (bins < 1)
+    throw msdf::GenericException("An axis needs at least one bin");
+  edges.push_back(lo);
+  for (int k=1; k<bins; ++k)
+  {
+    double edge = sketch.quantile(double(k)/bins);
+    if (edge > edges.back() && edge < hi) edges.push_back(edge);
+  }
+  if (hi > edges.back()) edges.push_back(hi);
+  else edges.push_back(lo + std::max(1.0, std::fabs(lo)));
+
+  // when all edges have merged the single bin is split, so that interpolating
+  // deposits always find two grid points
+  if ((bins_ > 1) && (edges.size() < 3))
+    edges.insert(edges.begin() + 1, 0.5*(edges[0] + edges[1]));
+  bins = edges.size() - 1;
+}
+
+double AxisBinning::edgePosition(double value) const
+{
+  if (value < edges.front()) return -1.0;
+  int k = int(std::upper_bound(edges.begin(), edges.end(), value) - edges.begin()) - 1;
+  if (k >= bins) k = bins - 1;
+  return k + (value - edges[k])/(edges[k+1] - edges[k]);
+}
+
+double AxisBinning::getEdge(int k) const
+{
+  switch (scale)
+  {
+    case linear: return lo + k/invWidth;
+    case logarithmic: return std::exp(logLo + k/invWidth);
+    default: return edges[k];
+  }
+}
+
+double AxisBinning::getCentre(int k) const
+{
+  if (scale == logarithmic) return std::exp(logLo + (k + 0.5)/invWidth);
+  return 0.5*(getEdge(k) + getEdge(k+1));
+}
@@ -0,0 +1,74 @@
+/*
+ * axisbinning.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef AXISBINNING_H_
+#define AXISBINNING_H_
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+class TDigest;
+
+/**
+ * The bins along one axis of a histogram.
+ *
+ * Bins are equally spaced in the value (linear), in its logarithm (log) or
+ * hold equal weight (adaptive). Adaptive edges are the quantiles of a sketch
+ * of the data, so bins are narrow where the data is dense and wide in the
+ * tails. position() maps a value onto the continuous bin coordinate, which
+ * lies between 0 and size() for values inside the range.
+ */
+class AxisBinning
+{
+  public:
+    enum Scale { linear, logarithmic, adaptive };
+
+    /// Parse lin, log or adaptive
+    static bool parseScale(const std::string &name, Scale &scale);
+
+    AxisBinning();
+
+    /// Linear or logarithmic bins between lo and hi
+    AxisBinning(Scale scale_, double lo, double hi, int bins_);
+
+    /**
+     * Bins with equal weight from the quantiles of a sketch, identical edges
+     * are merged. At least two bins are kept when more than one is requested.
+     */
+    AxisBinning(TDigest &sketch, int bins_);
+
+    double position(double value) const
+    {
+      switch (scale)
+      {
+        case linear: return (value - lo)*invWidth;
+        case logarithmic: return (value > 0.0) ? (std::log(value) - logLo)*invWidth : -1.0;
+        default: return edgePosition(value);
+      }
+    }
+
+    Scale getScale() const { return scale; }
+    int size() const { return bins; }
+    double getEdge(int k) const;
+    double getWidth(int k) const { return getEdge(k+1) - getEdge(k); }
+    /// The centre of a bin, the geometric centre for logarithmic bins
+    double getCentre(int k) const;
+
+  private:
+    Scale scale;
+    int bins;
+    double lo, hi;
+    double logLo;
+    double invWidth;
+    std::vector<double> edges;
+
+    double edgePosition(double value) const;
+};
+
+#endif /* AXISBINNING_H_ */
@@ -0,0 +1,127 @@
+/*
+ * bufferpool.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef BUFFERPOOL_H_
+#define BUFFERPOOL_H_
+
+#include "memorybudget.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+/**
+ * Counts the heap allocations made for chunk storage and stream buffers.
+ *
+ * In the steady state of a particle scan these counters don't change.
+ */
+class AllocationStats
+{
+  public:
+    static void record(size_t bytes)
+    {
+      ++counters().allocations;
+      counters().bytes += bytes;
+    }
+
+    static int64_t getAllocations() { return counters().allocations; }
+    static int64_t getBytes() { return counters().bytes; }
+  private:
+    struct Counters
+    {
+      std::atomic<int64_t> allocations;
+      std::atomic<int64_t> bytes;
+    };
+
+    static Counters &counters()
+    {
+      static Counters c = { {0}, {0} };
+      return c;
+    }
+};
+
+/**
+ * An owning array whose storage is aligned to 64 bytes.
+ *
+ * The storage only grows, so that a steady stream of chunks of the same
+ * size doesn't allocate. The storage is accounted for in the MemoryBudget.
+ */
+template<typename T>
+class AlignedArray : private boost::noncopyable
+{
+  private:
+    T *ptr;
+    int64_t cap;
+  public:
+    static const size_t alignment = 64;
+
+    AlignedArray() : ptr(0), cap(0) {}
+    ~AlignedArray()
+    {
+      std::free(ptr);
+      MemoryBudget::release(cap*sizeof(T));
+    }
+
+    /// Grow the storage to hold at least n values, the content is kept
+    void reserve(int64_t n)
+    {
+      if (n <= cap) return;
+      size_t bytes = (n*sizeof(T) + alignment - 1)/alignment*alignment;
+      MemoryBudget::reserve(bytes - cap*sizeof(T), "particle chunk buffers");
+      T *newPtr = static_cast<T*>(std::aligned_alloc(alignment, bytes));
+      if (newPtr == 0)
+      {
+        MemoryBudget::release(bytes - cap*sizeof(T));
+        throw std::bad_alloc();
+      }
+      AllocationStats::record(bytes);
+      if (cap > 0) std::memcpy(newPtr, ptr, cap*sizeof(T));
+      std::free(ptr);
+      ptr = newPtr;
+      cap = bytes/sizeof(T);
+    }
+
+    T *data() { return ptr; }
+    const T *data() const { return ptr; }
+    int64_t capacity() const { return cap; }
+};
+
+/**
+ * Scratch buffers owned by a stream.
+ *
+ * Each slot holds one buffer that is recycled from chunk to chunk. A buffer
+ * is only reallocated when a larger one is requested, so after the first
+ * chunk reading doesn't touch the heap. The content of a buffer is not kept
+ * across requests.
+ */
+class BufferPool : private boost::noncopyable
+{
+  public:
+    template<typename T>
+    T *get(size_t slot, int64_t count)
+    {
+      return reinterpret_cast<T*>(getBytes(slot, count*sizeof(T)));
+    }
+  private:
+    std::vector<boost::shared_ptr<AlignedArray<char> > > slots;
+
+    char *getBytes(size_t slot, int64_t bytes)
+    {
+      if (slot >= slots.size()) slots.resize(slot + 1);
+      if (!slots[slot]) slots[slot].reset(new AlignedArray<char>());
+      slots[slot]->reserve(bytes);
+      return slots[slot]->data();
+    }
+};
+
+#endif /* BUFFERPOOL_H_ */
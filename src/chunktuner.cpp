@@ -0,0 +1,160 @@
+/*
+ * chunktuner.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "chunktuner.hpp"
+#include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+namespace {
+  /// Chunks shorter than this are dominated by the per-chunk overhead
+  const int64_t minimumLength = 4096;
+
+  /// The relative improvement in throughput needed to accept a new length
+  const double improvementThreshold = 0.05;
+
+  /// Read a cache size such as "1024K" from the sysfs description of a cache
+  int64_t readSysCacheSize(int level)
+  {
+    for (int index=0; index<10; ++index)
+    {
+      std::string dir = "/sys/devices/system/cpu/cpu0/cache/index"
+          + boost::lexical_cast<std::string>(index) + "/";
+      std::ifstream levelFile((dir + "level").c_str());
+      std::ifstream typeFile((dir + "type").c_str());
+      std::ifstream sizeFile((dir + "size").c_str());
+      int cacheLevel;
+      std::string type, size;
+      if (!(levelFile >> cacheLevel) || !(typeFile >> type) || !(sizeFile >> size)) continue;
+      if ((cacheLevel != level) || (type == "Instruction") || size.empty()) continue;
+
+      int64_t factor = 1;
+      char unit = size[size.size()-1];
+      if (unit == 'K') factor = 1024;
+      else if (unit == 'M') factor = 1024*1024;
+      std::istringstream value(size);
+      int64_t bytes;
+      if (value >> bytes) return bytes*factor;
+    }
+    return 0;
+  }
+}
+
+ChunkTuner::ChunkTuner(int64_t cacheBytes, int64_t memoryBytes, int64_t memBudget)
+  : tuning(true), warmupChunks(2), trials(0), direction(1),
+    bestThroughput(0.0), bestLength(0), lastRows(0)
+{
+  cacheBytes = std::max(int64_t(1), cacheBytes);
+  memoryBytes = std::max(int64_t(1), memoryBytes);
+  int64_t budget = (memBudget > 0) ? memBudget : availableMemory()/4;
+
+  maxLength = std::max(minimumMaxLength, budget/memoryBytes);
+  minLength = std::min(maxLength, minimumLength);
+
+  // the command passes over the chunk after it has been read, start with a
+  // chunk that is still in the L2 cache, or in the last level cache if the
+  // L2 cache is too small for a reasonable chunk
+  int64_t cache = cacheSize(2);
+  if (cache/cacheBytes < minimumLength) cache = cacheSize(3)/2;
+  length = std::max(minLength, std::min(maxLength, cache/cacheBytes));
+  bestLength = length;
+}
+
+int64_t ChunkTuner::defaultLength(int64_t cacheBytes, int64_t memoryBytes, int64_t memBudget)
+{
+  return ChunkTuner(cacheBytes, memoryBytes, memBudget).getLength();
+}
+
+void ChunkTuner::finishTuning(int64_t length_)
+{
+  length = length_;
+  tuning = false;
+}
+
+int64_t ChunkTuner::update(int64_t rowsConsumed)
+{
+  if (!tuning) return length;
+
+  // the first two chunks warm up the file cache and the buffers, they are not measured
+  Clock::time_point now = Clock::now();
+  if (warmupChunks > 0)
+  {
+    --warmupChunks;
+    lastTime = now;
+    lastRows = rowsConsumed;
+    return length;
+  }
+
+  int64_t rows = rowsConsumed - lastRows;
+  double seconds = std::chrono::duration<double>(now - lastTime).count();
+  lastTime = now;
+  lastRows = rowsConsumed;
+
+  // a short chunk is the end of the data and not representative
+  if (2*rows < length)
+  {
+    finishTuning(bestLength);
+    return length;
+  }
+  if (seconds <= 0.0) return length;
+
+  double throughput = rows/seconds;
+  ++trials;
+
+  if (throughput > bestThroughput*(1.0 + improvementThreshold))
+  {
+    bestThroughput = throughput;
+    bestLength = length;
+    int64_t next = (direction > 0) ? 2*length : length/2;
+    if ((trials < maxTrials) && (next >= minLength) && (next <= maxLength)) length = next;
+    else finishTuning(bestLength);
+  }
+  else if ((direction > 0) && (trials == 2) && (trials < maxTrials) && (bestLength/2 >= minLength))
+  {
+    // the first doubling didn't pay off, try shorter chunks instead
+    direction = -1;
+    length = bestLength/2;
+  }
+  else
+    finishTuning(bestLength);
+
+  return length;
+}
+
+int64_t ChunkTuner::cacheSize(int level)
+{
+#if defined(_SC_LEVEL2_CACHE_SIZE) && defined(_SC_LEVEL3_CACHE_SIZE)
+  long size = sysconf((level == 2) ? _SC_LEVEL2_CACHE_SIZE : _SC_LEVEL3_CACHE_SIZE);
+  if (size > 0) return size;
+#endif
+  int64_t bytes = readSysCacheSize(level);
+  if (bytes > 0) return bytes;
+  return (level == 2) ? 1024*1024 : 8*1024*1024;
+}
+
+int64_t ChunkTuner::availableMemory()
+{
+  std::ifstream meminfo("/proc/meminfo");
+  std::string key;
+  int64_t kb;
+  while (meminfo >> key >> kb)
+  {
+    if (key == "MemAvailable:") return kb*1024;
+    meminfo.ignore(256, '\n');
+  }
+
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+  long pages = sysconf(_SC_PHYS_PAGES);
+  long pageSize = sysconf(_SC_PAGESIZE);
+  if ((pages > 0) && (pageSize > 0)) return int64_t(pages)*pageSize/2;
+#endif
+  return int64_t(1024)*1024*1024;
+}
@@ -0,0 +1,82 @@
+/*
+ * chunktuner.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef CHUNKTUNER_H_
+#define CHUNKTUNER_H_
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <chrono>
+
+/**
+ * Chooses the number of particles per chunk of a particle stream.
+ *
+ * The initial length makes the buffers of all open columns fill the L2 cache,
+ * so that the command's pass over a chunk doesn't go to main memory. It is
+ * bounded above by the memory budget. During the first chunks the tuner
+ * measures the throughput of the stream, i.e. the source rows consumed per
+ * second of wall time including the work of the command. It doubles the length while the
+ * throughput improves, tries halving if the first doubling doesn't pay off,
+ * and settles on the best length seen.
+ */
+class ChunkTuner
+{
+  public:
+    /**
+     * cacheBytes is the number of bytes per particle touched in the open
+     * columns, memoryBytes the number of bytes per particle held by the
+     * stream. A memBudget of 0 selects a quarter of the available memory.
+     */
+    ChunkTuner(int64_t cacheBytes, int64_t memoryBytes, int64_t memBudget);
+
+    int64_t getLength() const { return length; }
+    bool isTuning() const { return tuning; }
+
+    /**
+     * Record the total number of source rows consumed by the stream so far
+     * and return the length of the next chunk.
+     */
+    int64_t update(int64_t rowsConsumed);
+
+    /// The chunk length that the tuner starts with, for streams that are not tuned
+    static int64_t defaultLength(int64_t cacheBytes, int64_t memoryBytes, int64_t memBudget = 0);
+
+    /// The size of the data cache of the given level in bytes
+    static int64_t cacheSize(int level);
+
+    /// The physical memory available to the process in bytes
+    static int64_t availableMemory();
+
+    /// The maximum number of chunks used for tuning
+    static const int maxTrials = 6;
+
+    /// The number of rows that the tuner allows however small the memory budget is
+    static const int64_t minimumMaxLength = 1024;
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    int64_t minLength;
+    int64_t maxLength;
+    int64_t length;
+
+    bool tuning;
+    int warmupChunks;
+    int trials;
+    int direction;
+    double bestThroughput;
+    int64_t bestLength;
+
+    Clock::time_point lastTime;
+    int64_t lastRows;
+
+    void finishTuning(int64_t length_);
+};
+
+typedef boost::shared_ptr<ChunkTuner> pChunkTuner;
+
+#endif /* CHUNKTUNER_H_ */
@@ -0,0 +1,230 @@
+/*
+ * columnarcache.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "columnarcache.hpp"
+#include "common/binaryio.hpp"
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+
+namespace fs = boost::filesystem;
+
+namespace {
+  const char *manifestMagic = "msdf-columnar";
+  const int manifestVersion = 1;
+
+  std::string manifestName(const std::string &dir)
+  {
+    return (fs::path(dir) / "manifest").string();
+  }
+
+  bool speciesLess(const ColumnarCache::Species &a, const ColumnarCache::Species &b)
+  {
+    return a.id < b.id;
+  }
+}
+
+//===========================================================
+//=================    ColumnarCache    =====================
+//===========================================================
+
+ColumnarCache::ColumnarCache()
+  : rank(0), raw(false), chunkRows(0)
+{
+  for (int c=0; c<numColumns; ++c) precision[c] = 0;
+}
+
+const char *ColumnarCache::columnName(int column)
+{
+  static const char *names[numColumns] = { "x", "y", "z", "px", "py", "pz", "weight" };
+  return names[column];
+}
+
+std::string ColumnarCache::columnFile(const Species &sp, int column) const
+{
+  return (fs::path(dir) / ("s" + boost::lexical_cast<std::string>(sp.id)
+                           + "_" + columnName(column) + ".bin")).string();
+}
+
+bool ColumnarCache::isCacheDir(const std::string &name)
+{
+  if (!fs::is_directory(name) || !fs::exists(manifestName(name))) return false;
+  std::ifstream in(manifestName(name).c_str());
+  std::string magic;
+  in >> magic;
+  return magic == manifestMagic;
+}
+
+void ColumnarCache::readManifest(const std::string &dir_)
+{
+  dir = dir_;
+  std::ifstream in(manifestName(dir).c_str());
+  std::string magic, key;
+  int version, rawFlag;
+  size_t numSpecies;
+
+  in >> magic >> version;
+  if (!in || (magic != manifestMagic) || (version != manifestVersion))
+    throw msdf::GenericException(dir + " is not a columnar particle cache");
+
+  in >> key >> rank >> key >> rawFlag >> key >> chunkRows >> key;
+  raw = (rawFlag != 0);
+  for (int c=0; c<numColumns; ++c) in >> key >> precision[c];
+
+  in >> key >> numSpecies;
+  species.resize(numSpecies);
+  for (size_t s=0; s<numSpecies; ++s)
+  {
+    Species &sp = species[s];
+    in >> key >> sp.id >> sp.count;
+    int64_t chunks = (sp.count + chunkRows - 1)/chunkRows;
+    for (int c=0; c<numColumns; ++c)
+    {
+      if (precision[c] == 0) continue;
+      in >> key;
+      sp.stats[c].minval.resize(chunks);
+      sp.stats[c].maxval.resize(chunks);
+      for (int64_t i=0; i<chunks; ++i) in >> sp.stats[c].minval[i] >> sp.stats[c].maxval[i];
+    }
+  }
+
+  if (!in)
+    throw msdf::GenericException("Error reading manifest of columnar particle cache " + dir);
+}
+
+void ColumnarCache::writeManifest() const
+{
+  std::ofstream out(manifestName(dir).c_str());
+  out << std::setprecision(std::numeric_limits<double>::digits10 + 2);
+  out << manifestMagic << " " << manifestVersion << "\n"
+      << "rank " << rank << "\n"
+      << "raw " << (raw ? 1 : 0) << "\n"
+      << "chunkrows " << chunkRows << "\n"
+      << "precision";
+  for (int c=0; c<numColumns; ++c) out << " " << columnName(c) << " " << precision[c];
+  out << "\nspecies " << species.size() << "\n";
+
+  for (size_t s=0; s<species.size(); ++s)
+  {
+    const Species &sp = species[s];
+    out << "partition " << sp.id << " " << sp.count << "\n";
+    for (int c=0; c<numColumns; ++c)
+    {
+      if (precision[c] == 0) continue;
+      out << columnName(c);
+      for (int64_t i=0; i<sp.stats[c].getZoneCount(); ++i)
+        out << " " << sp.stats[c].minval[i] << " " << sp.stats[c].maxval[i];
+      out << "\n";
+    }
+  }
+
+  if (!out)
+    throw msdf::GenericException("Error writing manifest of columnar particle cache " + dir);
+}
+
+//===========================================================
+//===============    ColumnarCacheWriter    =================
+//===========================================================
+
+ColumnarCacheWriter::ColumnarCacheWriter(const std::string &dir_, int rank_, bool raw_,
+                                         int64_t chunkRows_, const int *precision_)
+{
+  if ((chunkRows_ < 16) || (chunkRows_ % 16 != 0))
+    throw msdf::GenericException("The number of rows per chunk must be a multiple of 16");
+
+  dir = dir_;
+  rank = rank_;
+  raw = raw_;
+  chunkRows = chunkRows_;
+  for (int c=0; c<numColumns; ++c)
+  {
+    bool isMesh = (c <= cc_z);
+    precision[c] = (isMesh && (c >= rank)) ? 0 : precision_[c];
+    if ((precision[c] != 0) && (precision[c] != sizeof(float)) && (precision[c] != sizeof(double)))
+      throw msdf::GenericException("Columnar particle cache only supports float and double columns");
+  }
+
+  fs::create_directories(dir);
+}
+
+size_t ColumnarCacheWriter::findSpecies(int id)
+{
+  for (size_t s=0; s<species.size(); ++s)
+    if (species[s].id == id) return s;
+
+  Species sp;
+  sp.id = id;
+  sp.count = 0;
+  species.push_back(sp);
+
+  std::vector<pOfstream> columnFiles(numColumns);
+  for (int c=0; c<numColumns; ++c)
+  {
+    if (precision[c] == 0) continue;
+    std::string name = columnFile(sp, c);
+    columnFiles[c] = pOfstream(new std::ofstream(name.c_str(), std::ios::binary));
+    if (!*columnFiles[c])
+      throw msdf::GenericException("Could not open " + name + " for writing");
+  }
+  files.push_back(columnFiles);
+  return species.size() - 1;
+}
+
+void ColumnarCacheWriter::append(int id, const double *values)
+{
+  size_t s = findSpecies(id);
+  Species &sp = species[s];
+  int64_t chunk = sp.count/chunkRows;
+  bool newChunk = (sp.count % chunkRows == 0);
+
+  for (int c=0; c<numColumns; ++c)
+  {
+    if (precision[c] == 0) continue;
+
+    double value = values[c];
+    if (precision[c] == sizeof(float))
+    {
+      float f = value;
+      files[s][c]->write((const char*)&f, sizeof(float));
+      value = f;  // the stats describe the stored values
+    }
+    else
+      files[s][c]->write((const char*)&value, sizeof(double));
+
+    ZoneColumn &stats = sp.stats[c];
+    if (newChunk)
+    {
+      stats.minval.push_back(value);
+      stats.maxval.push_back(value);
+    }
+    else
+    {
+      stats.minval[chunk] = std::min(stats.minval[chunk], value);
+      stats.maxval[chunk] = std::max(stats.maxval[chunk], value);
+    }
+  }
+  ++sp.count;
+}
+
+void ColumnarCacheWriter::close()
+{
+  for (size_t s=0; s<files.size(); ++s)
+    for (int c=0; c<numColumns; ++c)
+    {
+      if (!files[s][c]) continue;
+      files[s][c]->close();
+      if (!*files[s][c])
+        throw msdf::GenericException("Error writing " + columnFile(species[s], c));
+    }
+  files.clear();
+
+  std::sort(species.begin(), species.end(), speciesLess);
+  writeManifest();
+}
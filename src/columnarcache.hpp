@@ -0,0 +1,99 @@
+/*
+ * columnarcache.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef COLUMNARCACHE_H_
+#define COLUMNARCACHE_H_
+
+#include "zonemap.hpp"
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * The msdf-native columnar particle cache.
+ *
+ * The cache is a directory holding a text manifest and one file per species
+ * and quantity. Each file is a plain array of float or double values in the
+ * precision of the source. The rows of each species are divided into chunks
+ * of a fixed number of rows, a multiple of 16 so that every chunk starts on
+ * a 64 byte boundary. The manifest holds the minimum and maximum of every
+ * column over each chunk.
+ */
+class ColumnarCache
+{
+  public:
+    enum Column { cc_x = 0, cc_y, cc_z, cc_px, cc_py, cc_pz, cc_weight, numColumns };
+
+    /// One species partition of the cache
+    struct Species
+    {
+      int id;
+      int64_t count;
+      ZoneColumn stats[numColumns];
+    };
+
+    ColumnarCache();
+
+    int getRank() const { return rank; }
+    bool isRaw() const { return raw; }
+    int64_t getChunkRows() const { return chunkRows; }
+
+    /// The bytes per value of a column, 0 if the column is not stored
+    int getPrecision(int column) const { return precision[column]; }
+
+    const std::vector<Species> &getSpecies() const { return species; }
+
+    /// The name of the file holding a column of a species partition
+    std::string columnFile(const Species &sp, int column) const;
+
+    void readManifest(const std::string &dir_);
+
+    static const char *columnName(int column);
+    static bool isCacheDir(const std::string &name);
+  protected:
+    std::string dir;
+    int rank;
+    bool raw;
+    int64_t chunkRows;
+    int precision[numColumns];
+    std::vector<Species> species;
+
+    void writeManifest() const;
+};
+
+/**
+ * Writes a columnar cache in a single streaming pass.
+ *
+ * Rows can be appended for the species in any order. Each species partition
+ * gets its own set of column files, so no temporary storage is needed.
+ */
+class ColumnarCacheWriter : public ColumnarCache
+{
+  public:
+    /**
+     * Create the cache directory. Columns with a precision of 0 are not
+     * stored; mesh columns beyond rank are ignored.
+     */
+    ColumnarCacheWriter(const std::string &dir_, int rank_, bool raw_, int64_t chunkRows_,
+                        const int *precision_);
+
+    /// Append a row with values for all columns to the partition of species id
+    void append(int id, const double *values);
+
+    /// Flush the column files and write the manifest
+    void close();
+  private:
+    typedef boost::shared_ptr<std::ofstream> pOfstream;
+    std::vector<std::vector<pOfstream> > files;
+
+    size_t findSpecies(int id);
+};
+
+#endif /* COLUMNARCACHE_H_ */
@@ -8,8 +8,15 @@
 #include "commands.hpp"
 
 #include "ls.hpp"
+#include "commands/batch.hpp"
 #include "commands/joinslices.hpp"
 #include "commands/tohdf.hpp"
+#include "commands/index.hpp"
+#include "commands/reorder.hpp"
+#include "commands/tocache.hpp"
+#include "commands/phase3d.hpp"
+#include "commands/pmoments.hpp"
+#include "commands/ptop.hpp"
 #include "pcount.hpp"
 #include "penergy.hpp"
 #include "phaseplot.hpp"
@@ -38,6 +45,14 @@ namespace msdf {
     store_command_in_map(map, new McfdCommandInfo_screen);
     store_command_in_map(map, new McfdCommandInfo_angular);
     store_command_in_map(map, new McfdCommandInfo_distfunc);
+    store_command_in_map(map, new McfdCommandInfo_index);
+    store_command_in_map(map, new McfdCommandInfo_reorder);
+    store_command_in_map(map, new McfdCommandInfo_tocache);
+    store_command_in_map(map, new McfdCommandInfo_pmoments);
+    store_command_in_map(map, new McfdCommandInfo_phase3d);
+    store_command_in_map(map, new McfdCommandInfo_ptop);
+    store_command_in_map(map, new McfdCommandInfo_batch);
+    store_command_in_map(map, new McfdCommandInfo_joinslices);
   }
 
   void print_help(CommandMap &map)
@@ -103,6 +118,41 @@ namespace msdf {
     return pMsdfCommand(new McfdCommand_distfunc());
   }
 
+  pMsdfCommand McfdCommandInfo_index::makeCommand()
+  {
+    return pMsdfCommand(new McfdCommand_index());
+  }
+
+  pMsdfCommand McfdCommandInfo_reorder::makeCommand()
+  {
+    return pMsdfCommand(new McfdCommand_reorder());
+  }
+
+  pMsdfCommand McfdCommandInfo_tocache::makeCommand()
+  {
+    return pMsdfCommand(new McfdCommand_tocache());
+  }
+
+  pMsdfCommand McfdCommandInfo_pmoments::makeCommand()
+  {
+    return pMsdfCommand(new McfdCommand_pmoments());
+  }
+
+  pMsdfCommand McfdCommandInfo_phase3d::makeCommand()
+  {
+    return pMsdfCommand(new McfdCommand_phase3d());
+  }
+
+  pMsdfCommand McfdCommandInfo_ptop::makeCommand()
+  {
+    return pMsdfCommand(new McfdCommand_ptop());
+  }
+
+  pMsdfCommand McfdCommandInfo_batch::makeCommand()
+  {
+    return pMsdfCommand(new McfdCommand_batch());
+  }
+
 } // namespace msdf
 
 
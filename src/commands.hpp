@@ -354,6 +354,188 @@ namespace msdf {
       pMsdfCommand makeCommand();
   };
 
+
+  //===========================================================
+  //====================    index command    ==================
+  //===========================================================
+
+  /**
+   * Command factory for the `index` command
+   */
+  class McfdCommandInfo_index : public MsdfCommandFactory
+  {
+    public:
+      std::string name() { return "index"; }
+
+      std::string description()
+      {
+        return "builds the zone map used to skip particle chunks rejected by filters";
+      }
+
+      /**
+       * Create the `index` command
+       *
+       * @return a new instance of McfdCommand_index
+       */
+      pMsdfCommand makeCommand();
+  };
+
+
+  //===========================================================
+  //===================    reorder command    =================
+  //===========================================================
+
+  /**
+   * Command factory for the `reorder` command
+   */
+  class McfdCommandInfo_reorder : public MsdfCommandFactory
+  {
+    public:
+      std::string name() { return "reorder"; }
+
+      std::string description()
+      {
+        return "writes a particle cache sorted by spatial cell for fast region queries";
+      }
+
+      /**
+       * Create the `reorder` command
+       *
+       * @return a new instance of McfdCommand_reorder
+       */
+      pMsdfCommand makeCommand();
+  };
+
+
+  //===========================================================
+  //===================    tocache command    =================
+  //===========================================================
+
+  /**
+   * Command factory for the `tocache` command
+   */
+  class McfdCommandInfo_tocache : public MsdfCommandFactory
+  {
+    public:
+      std::string name() { return "tocache"; }
+
+      std::string description()
+      {
+        return "converts particle data to the columnar particle cache";
+      }
+
+      /**
+       * Create the `tocache` command
+       *
+       * @return a new instance of McfdCommand_tocache
+       */
+      pMsdfCommand makeCommand();
+  };
+
+
+  //===========================================================
+  //==================    pmoments command    =================
+  //===========================================================
+
+  /**
+   * Command factory for the `pmoments` command
+   */
+  class McfdCommandInfo_pmoments : public MsdfCommandFactory
+  {
+    public:
+      std::string name() { return "pmoments"; }
+
+      std::string description()
+      {
+        return "deposits particles onto a grid and writes density, current and temperature of each species";
+      }
+
+      /**
+       * Create the `pmoments` command
+       *
+       * @return a new instance of McfdCommand_pmoments
+       */
+      pMsdfCommand makeCommand();
+  };
+
+
+  //===========================================================
+  //==================    phase3d command    ==================
+  //===========================================================
+
+  /**
+   * Command factory for the `phase3d` command
+   */
+  class McfdCommandInfo_phase3d : public MsdfCommandFactory
+  {
+    public:
+      std::string name() { return "phase3d"; }
+
+      std::string description()
+      {
+        return "creates 3d weighted phase space histograms with sparse or tiled storage";
+      }
+
+      /**
+       * Create the `phase3d` command
+       *
+       * @return a new instance of McfdCommand_phase3d
+       */
+      pMsdfCommand makeCommand();
+  };
+
+
+  //===========================================================
+  //====================    ptop command    ===================
+  //===========================================================
+
+  /**
+   * Command factory for the `ptop` command
+   */
+  class McfdCommandInfo_ptop : public MsdfCommandFactory
+  {
+    public:
+      std::string name() { return "ptop"; }
+
+      std::string description()
+      {
+        return "selects the particles with the largest values of a quantity and writes their records";
+      }
+
+      /**
+       * Create the `ptop` command
+       *
+       * @return a new instance of McfdCommand_ptop
+       */
+      pMsdfCommand makeCommand();
+  };
+
+
+  //===========================================================
+  //===================    batch command    ===================
+  //===========================================================
+
+  /**
+   * Command factory for the `batch` command
+   */
+  class McfdCommandInfo_batch : public MsdfCommandFactory
+  {
+    public:
+      std::string name() { return "batch"; }
+
+      std::string description()
+      {
+        return "runs a command on many dumps in one process and stacks the results along a time axis";
+      }
+
+      /**
+       * Create the `batch` command
+       *
+       * @return a new instance of McfdCommand_batch
+       */
+      pMsdfCommand makeCommand();
+  };
+
 } // namespace msdf
 
 #endif /* MSDF_COMMANDS_H_ */
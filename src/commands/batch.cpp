@@ -0,0 +1,257 @@
+/*
+ * batch.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "batch.hpp"
+#include "../fileglob.hpp"
+#include "../hdfstream.hpp"
+#include "../parallel.hpp"
+#include "../common/binaryio.hpp"
+#include "../common/sdffile.hpp"
+#include <atomic>
+#include <iostream>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+namespace {
+  /// The options of the batch command, all of them take a value
+  const int numBatchOptions = 7;
+  const char *batchOptions[numBatchOptions] = {
+      "--inputs", "--jobs", "-j", "--stack", "--stack-dataset", "--stack-output", "--stack-compression" };
+}
+
+McfdCommand_batch::McfdCommand_batch()
+  : option_desc("Options for the 'batch' command")
+{
+  option_desc.add_options()
+    ("inputs", po::value<std::string>(&inputPattern),"pattern of the input files, for example 'run/*.sdf'. Only the file name may contain the wildcards *, ? and [...]")
+    ("jobs,j", po::value<int>(&jobs),"number of dumps processed at the same time (default: 1)")
+    ("stack", po::value<std::string>(&stackPattern),"name of the HDF output of each dump that is stacked along a time axis, with % in place of the dump name")
+    ("stack-dataset", po::value<std::string>(&stackDataset),"name of the data set that is stacked (default: 'data')")
+    ("stack-output", po::value<std::string>(&stackOutput),"name of the HDF file holding the stacked data set and the time of each dump (default: stack.h5)")
+    ("stack-compression", po::value<int>(),"deflate level of the stacked data set between 0 (none) and 9 (default: 4)");
+}
+
+void McfdCommand_batch::splitArguments(int argc, char **argv, std::vector<std::string> &batchArgs,
+    std::vector<std::string> &commandArgs)
+{
+  for (int i=2; i<argc; ++i)
+  {
+    std::string arg(argv[i]);
+    bool isBatch = false;
+    bool hasValue = false;
+    for (int k=0; k<numBatchOptions; ++k)
+    {
+      std::string name(batchOptions[k]);
+      if (arg == name) isBatch = true;
+      else if (boost::starts_with(arg, name + "=")) isBatch = hasValue = true;
+      else if ((name == "-j") && boost::starts_with(arg, name) && (arg.size() > 2)) isBatch = hasValue = true;
+    }
+
+    if (!isBatch)
+    {
+      commandArgs.push_back(arg);
+      continue;
+    }
+
+    batchArgs.push_back(arg);
+    if (!hasValue && (i+1 < argc)) batchArgs.push_back(argv[++i]);
+  }
+}
+
+std::string McfdCommand_batch::substitute(const std::string &arg, const std::string &dump)
+{
+  return boost::replace_all_copy(arg, "%", fs::path(dump).stem().string());
+}
+
+void McfdCommand_batch::execute(int argc, char **argv)
+{
+  if ((argc < 2) || (argv[1][0] == '-'))
+  {
+    print_help();
+    exit(-1);
+  }
+
+  std::string commandName(argv[1]);
+  CommandMap commands;
+  register_commands(commands);
+  if ((commands.count(commandName) == 0) || (commandName == "batch"))
+    throw GenericException("Unknown command " + commandName + " for batch");
+
+  std::vector<std::string> batchArgs, commandArgs;
+  splitArguments(argc, argv, batchArgs, commandArgs);
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(batchArgs).options(option_desc).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("inputs")<1)
+  {
+    print_help();
+    exit(-1);
+  }
+  if (vm.count("jobs")<1) jobs = 1;
+  if (vm.count("stack-dataset")<1) stackDataset = "data";
+  if (vm.count("stack-output")<1) stackOutput = "stack.h5";
+
+  std::vector<std::string> dumps = expandGlob(inputPattern);
+  if (dumps.empty()) throw GenericException("No input files match " + inputPattern);
+
+  // without a % all dumps would write to the same files, so they are processed one at a time
+  bool perDump = false;
+  for (size_t i=0; i<commandArgs.size(); ++i)
+    if (commandArgs[i].find('%') != std::string::npos) perDump = true;
+  if (!perDump && (jobs > 1))
+  {
+    std::cerr << "WARNING!\n    No % in the arguments of " << commandName
+        << ", the dumps are processed one at a time and write to the same output files\n";
+    jobs = 1;
+  }
+
+  // the worker threads take the next dump when they have finished one
+  int numDumps = dumps.size();
+  std::vector<std::string> errors(numDumps);
+  std::atomic<int> nextDump(0);
+  int workers = std::max(1, std::min(jobs, numDumps));
+
+  parallelFor(workers, workers, [&](int)
+  {
+    for (int d = nextDump++; d < numDumps; d = nextDump++)
+    {
+      std::vector<std::string> args;
+      args.push_back(commandName);
+      for (size_t i=0; i<commandArgs.size(); ++i) args.push_back(substitute(commandArgs[i], dumps[d]));
+      args.push_back(dumps[d]);
+
+      std::vector<char*> cargs(args.size());
+      for (size_t i=0; i<args.size(); ++i) cargs[i] = &args[i][0];
+
+      try
+      {
+        pMsdfCommand command = commands[commandName]->makeCommand();
+        command->execute(cargs.size(), &cargs[0]);
+      }
+      catch (BlockNotFoundException &ex)
+      {
+        errors[d] = "Block '" + ex.getName() + "' not found";
+      }
+      catch (GenericException &ex)
+      {
+        errors[d] = ex.getMessage();
+      }
+      catch (std::exception &ex)
+      {
+        errors[d] = ex.what();
+      }
+    }
+  });
+
+  int failed = 0;
+  for (int d=0; d<numDumps; ++d)
+  {
+    if (errors[d].empty()) continue;
+    std::cerr << "ERROR in " << dumps[d] << ":\n    " << errors[d] << "\n";
+    ++failed;
+  }
+  if (failed > 0)
+    throw GenericException(boost::lexical_cast<std::string>(failed) + " of "
+        + boost::lexical_cast<std::string>(numDumps) + " dumps failed");
+
+  std::cout << "Successfully processed " << numDumps << " dumps" << std::endl;
+
+  if (vm.count("stack")>0)
+  {
+    compression = (vm.count("stack-compression")>0) ? vm["stack-compression"].as<int>() : 4;
+    stack(dumps);
+  }
+}
+
+/*
+ * Writes the data sets of the dumps as slices of one chunked data set of
+ * rank one higher, in the order of the dumps, together with their times.
+ */
+void McfdCommand_batch::stack(const std::vector<std::string> &dumps)
+{
+  int nt = dumps.size();
+  GridIndex1d size(nt);
+  DataGrid1d times(size);
+  DataGrid1d steps(size);
+
+  HDFostream output(stackOutput.c_str());
+  std::vector<hsize_t> sliceDims;
+  std::vector<double> data;
+
+  for (int d=0; d<nt; ++d)
+  {
+    std::string name = substitute(stackPattern, dumps[d]);
+    if (!fs::exists(name)) throw GenericException("Stacked output " + name + " not found");
+
+    std::vector<hsize_t> dims;
+    HDFistream input(name.c_str());
+    input.setBlockName(stackDataset);
+    input.readArray(data, dims);
+    input.close();
+
+    int rank = dims.size() + 1;
+    std::vector<hsize_t> blockDims(1, 1), offset(rank, 0);
+    blockDims.insert(blockDims.end(), dims.begin(), dims.end());
+    offset[0] = d;
+
+    if (d == 0)
+    {
+      sliceDims = dims;
+      std::vector<hsize_t> stackDims(blockDims);
+      stackDims[0] = nt;
+      output.setBlockName(stackDataset);
+      output.beginBlocks(rank, &stackDims[0], &blockDims[0], compression);
+    }
+    else if (dims != sliceDims)
+      throw GenericException("The data set " + stackDataset + " in " + name + " differs in shape from the first dump");
+
+    output.writeBlock(rank, &data[0], &blockDims[0], &offset[0], &blockDims[0]);
+
+    // the time axis is the simulation time of SDF dumps and the dump number otherwise
+    times(d) = steps(d) = d;
+    if (fs::path(dumps[d]).extension() == ".sdf")
+    {
+      std::string dumpName = dumps[d];
+      SdfFile file(dumpName);
+      times(d) = file.getHeader()->getTime();
+      steps(d) = file.getHeader()->getStep();
+    }
+  }
+  output.endBlocks();
+
+  output.setBlockName("time");
+  output << times;
+  output.setBlockName("step");
+  output << steps;
+  output.close();
+
+  std::cout << "Stacked " << nt << " dumps of " << stackDataset << " into " << stackOutput << std::endl;
+}
+
+void McfdCommand_batch::print_help()
+{
+  std::cout << "\n  Manipulate sdf files: runs a command on many dumps in one process\n\n  Usage:\n"
+        << "    msdf batch <command> --inputs <pattern> [options] [command options]\n\n"
+        << "  All options that are not listed below are passed to the command, and the name of\n"
+        << "  each dump is appended as its input. A % in the command options is replaced by the\n"
+        << "  dump name without its extension, for example -o 'movie/%_phase#.h5'. The short\n"
+        << "  option -j belongs to the batch command, use --threads for the threads of the\n"
+        << "  command. A memory budget given to the command is shared by all dumps that are\n"
+        << "  processed at the same time.\n\n"
+        << "  With --stack the data set of the given output of each dump is written as one slice\n"
+        << "  of a data set with a leading time axis, in the order of the dump names. The data\n"
+        << "  sets time and step hold the simulation time and step of the dumps.\n\n";
+
+  std::cout << option_desc;
+}
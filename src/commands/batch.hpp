@@ -0,0 +1,53 @@
+/*
+ * batch.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <boost/program_options.hpp>
+#include "../commands.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace msdf;
+
+/**
+ * Runs another command on many dumps inside one process.
+ *
+ * The dumps matching a pattern are processed by a number of worker threads,
+ * each dump by its own instance of the command. A % in the arguments of the
+ * command is replaced by the name of the dump. A data set of the outputs can
+ * afterwards be stacked along a time axis into one HDF file.
+ */
+class McfdCommand_batch : public MsdfCommand
+{
+  private:
+    boost::program_options::options_description option_desc;
+
+    std::string inputPattern;
+    int jobs;
+    std::string stackPattern;
+    std::string stackDataset;
+    std::string stackOutput;
+    int compression;
+
+    /// Split the arguments into those of the batch command and those of the command run
+    void splitArguments(int argc, char **argv, std::vector<std::string> &batchArgs,
+        std::vector<std::string> &commandArgs);
+
+    std::string substitute(const std::string &arg, const std::string &dump);
+    void stack(const std::vector<std::string> &dumps);
+
+  public:
+    McfdCommand_batch();
+    void execute(int argc, char **argv);
+    void print_help();
+};
+
+#endif /* BATCH_H_ */
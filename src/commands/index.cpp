@@ -0,0 +1,105 @@
+/*
+ * index.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "index.hpp"
+#include "../sdfdatatypes.hpp"
+#include "../zonemap.hpp"
+#include "../common/sdffile.hpp"
+#include <iostream>
+#include <vector>
+
+namespace po = boost::program_options;
+
+McfdCommand_index::McfdCommand_index()
+  : option_desc("Options for the 'index' command")
+{
+  option_desc.add_options()
+      ("input,i", po::value<std::string>(&inputName),"name of the sdf file")
+      ("output,o", po::value<std::string>(&outputName),"name of the zone map file (default: <input>.zmap)")
+      ("zone,z", po::value<int64_t>(&zoneLength),"number of particles per zone (default: 65536)")
+      ("chunk,c", po::value<int64_t>(&chunkLength),"chunk size used in buffered reading");
+
+  option_pos.add("input", 1);
+}
+
+void McfdCommand_index::execute(int argc, char **argv)
+{
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).
+            options(option_desc).positional(option_pos).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("input")<1) throw GenericException("No input file given");
+
+  if (vm.count("output")<1) outputName = ZoneMap::sidecarName(inputName);
+  if (vm.count("zone")<1) zoneLength = 65536;
+  if (vm.count("chunk")<1) chunkLength = 1024*1024;
+
+  pSdfFile file(new SdfFile(inputName));
+  ZoneMap zoneMap(zoneLength);
+  zoneMap.setSource(inputName);
+
+  pSdfBlockHeaderList blocks = file->getBlockHeaderList();
+  for (SdfBlockHeaderList::iterator it = blocks->begin(); it != blocks->end(); ++it)
+  {
+    pSdfBlockHeader block = *it;
+    if (block->getBlockType() == sdf_point_mesh)
+    {
+      std::cout << "Indexing point mesh " << block->getName() << "\n";
+      SdfMeshStream stream(file->getStream(), file->getHeader(), *block, chunkLength);
+      int rank = stream.getRank();
+      int64_t length = stream.getLength();
+
+      std::vector<ZoneColumn*> columns(rank);
+      for (int r=0; r<rank; ++r)
+        columns[r] = &zoneMap.addColumn(ZoneMap::meshColumnName(block->getName(), r), length);
+
+      BufferPool pool;
+      double *rows[3];
+      for (int r=0; r<rank; ++r) rows[r] = pool.get<double>(r, chunkLength);
+      int64_t first = 0;
+      while (first < length)
+      {
+        int64_t count = stream.getMeshChunk(rows, 0, chunkLength);
+        for (int r=0; r<rank; ++r) zoneMap.accumulate(*columns[r], first, rows[r], count);
+        first += count;
+      }
+    }
+    else if (block->getBlockType() == sdf_point_variable)
+    {
+      std::cout << "Indexing point variable " << block->getName() << "\n";
+      SdfMeshVariableStream stream(file->getStream(), file->getHeader(), *block, chunkLength);
+      int64_t length = stream.getLength();
+      ZoneColumn &column = zoneMap.addColumn(block->getName(), length);
+
+      BufferPool pool;
+      double *values = pool.get<double>(0, chunkLength);
+      int64_t first = 0;
+      while (first < length)
+      {
+        int64_t count = stream.getMeshChunk(values, 0, chunkLength);
+        zoneMap.accumulate(column, first, values, count);
+        first += count;
+      }
+    }
+  }
+
+  zoneMap.write(outputName);
+  std::cout << "Zone map written to " << outputName << "\n";
+}
+
+void McfdCommand_index::print_help()
+{
+  std::cout << "\n  Manipulate sdf files: build the zone map of the particle blocks\n\n  Usage:\n"
+        << "    msdf index [options] <input>\n\n"
+        << "  where <input> is the name of the sdf file. The zone map stores the minimum and\n"
+        << "  maximum of each particle block over zones of a fixed number of particles. Particle\n"
+        << "  commands read it from <input>.zmap and skip zones rejected by their filters.\n\n";
+
+  std::cout << option_desc;
+}
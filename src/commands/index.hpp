@@ -0,0 +1,39 @@
+/*
+ * index.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef INDEX_H_
+#define INDEX_H_
+
+#include <boost/program_options.hpp>
+#include "../commands.hpp"
+
+using namespace msdf;
+
+/**
+ * Builds the zone map sidecar of an SDF file.
+ *
+ * All point mesh and point variable blocks are read in a single streaming
+ * pass and the minimum and maximum of every zone of rows is recorded.
+ */
+class McfdCommand_index : public MsdfCommand
+{
+  private:
+    boost::program_options::options_description option_desc;
+    boost::program_options::positional_options_description option_pos;
+
+    std::string inputName;
+    std::string outputName;
+    int64_t zoneLength;
+    int64_t chunkLength;
+  public:
+    McfdCommand_index();
+    void execute(int argc, char **argv);
+    void print_help();
+};
+
+#endif /* INDEX_H_ */
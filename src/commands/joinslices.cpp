@@ -1,5 +1,5 @@
 /*
- * tohdf.cpp
+ * joinslices.cpp
  *
  *  Created on: 8 Oct 2010
  *      Author: Holger Schmitz
@@ -9,25 +9,30 @@
 
 #include "joinslices.hpp"
 #include "../hdfstream.hpp"
-#include <boost/format.hpp>
-#include <boost/filesystem.hpp>
-#include <fstream>
+#include "../parallel.hpp"
+#include "../sdfblock.hpp"
+#include "../common/binaryio.hpp"
+#include <algorithm>
 #include <iostream>
-#include <iomanip>
 
 namespace po = boost::program_options;
-namespace fs = boost::filesystem;
+
+namespace {
+  /// The number of values aimed for in one chunk of the output dataset
+  const int64_t chunkValues = 1 << 17;
+}
 
 McfdCommand_joinslices::McfdCommand_joinslices()
   : option_desc("Options for the 'joinslices' command")
 {
   option_desc.add_options()
-      ("output,o", po::value<std::string>(&outputName),"name of the hdf file")
-      ("meta,m", po::value<std::string>(&metaName),"if specified, the name of the file to which to write the meta data");
+      ("output,o", po::value<std::string>(&outputName),"name of the hdf file (default: joined.h5)")
+      ("threads,j", po::value<int>(&numThreads),"number of files read at the same time (default: number of cores)")
+      ("compression", po::value<int>(&compression),"deflate level of the HDF data sets between 0 (none) and 9 (default: 4)");
 
   meshData.setProgramOptions(option_desc, option_pos);
 
-  option_pos.add("output", 3);
+  option_pos.add("output", 1);
 }
 
 void McfdCommand_joinslices::execute(int argc, char **argv)
@@ -38,110 +43,168 @@ void McfdCommand_joinslices::execute(int argc, char **argv)
             options(option_desc).positional(option_pos).run(), vm);
   po::notify(vm);
 
-  if (!meshData.isValid(vm))
-  {
-    print_help();
-    exit(-1);
-  }
+  if (!meshData.isValid(vm)) throw GenericException("No input file or block given");
 
-  if (vm.count("output")<1)
-  {
-    this->constructOutputFileName();
-  }
+  if (vm.count("output")<1) outputName = "joined.h5";
+  if (vm.count("threads")<1) numThreads = defaultThreadCount();
+  if (vm.count("compression")<1) compression = 4;
+  if (numThreads < 1) numThreads = 1;
 
-  writeMeta = (vm.count("meta")>0);
+  meshData.init();
+  const std::list<std::string> &inputs = meshData.getInputNames();
+  if (inputs.empty())
+    throw GenericException("No files match " + meshData.getInputNamePattern());
 
-  meshData.readData(vm);
+  std::vector<std::string> dumps(inputs.begin(), inputs.end());
+  int nt = dumps.size();
 
-  if (vm.count("text")<1)
-    this->writeMeshVariable();
-  else
-    this->writeMeshVariableText();
+  GridIndex1d size(nt);
+  DataGrid1d times(size), steps(size);
 
-  if (writeMeta)
-  {
-    std::ofstream meta(metaName.c_str(), std::ofstream::app);
-    meta << outputName << " " << meshData.getBlockName() << " " << meshData.getMin(0) << " " << meshData.getMax(0) << "\n";
-    meta.close();
-  }
+  HDFostream output(outputName.c_str());
+  const std::list<std::string> &blocks = meshData.getBlockNames();
+  for (std::list<std::string>::const_iterator it = blocks.begin(); it != blocks.end(); ++it)
+    joinBlock(output, *it, dumps, times, steps);
+
+  output.setBlockName("time");
+  output << times;
+  output.setBlockName("step");
+  output << steps;
+  output.close();
 
+  std::cout << "Joined slices of " << nt << " dumps into " << outputName << std::endl;
 }
 
-void McfdCommand_joinslices::writeMeshVariable()
+MeshSlice McfdCommand_joinslices::openSlice(SdfFile &file, const std::string &fileName, const std::string &blockName)
 {
-  HDFostream output(outputName.c_str());
-  output.setBlockName(meshData.getBlockName());
+  pSdfBlockHeader block = file.getBlockHeader(blockName);
+  if (block->getBlockType() != sdf_plain_variable)
+    throw GenericException("Block " + blockName + " in " + fileName + " is not a plain mesh variable!");
 
-  switch (meshData.getRank())
+  int precision;
+  switch (block->getDataType())
   {
-    case 1:
-      output << *(meshData.get1dMesh(0));
-      break;
-    case 2:
-      output << *(meshData.get2dMesh(0));
+    case sdf_real4:
+      precision = 4;
       break;
-    case 3:
-      output << *(meshData.get3dMesh(0));
+    case sdf_real8:
+      precision = 8;
       break;
+    default:
+      throw GenericException("Block " + blockName + " in " + fileName + " has an unsupported data type!");
   }
 
-  output.close();
-}
+  int rank = block->getNDims();
+  if ((rank < 1) || (rank > 3))
+    throw GenericException("Block " + blockName + " in " + fileName + " has a rank other than 1, 2 or 3!");
+
+  // the meta data of a plain variable start with the multiplier, the units,
+  // the mesh id and the number of points in each dimension
+  pIstream stream = file.getStream();
+  stream->seekg(block->getMetaDataOffset());
+
+  double mult;
+  std::string units, meshId;
+  detail::readValue(*stream, mult);
+  detail::readString(*stream, units, 32);
+  detail::readString(*stream, meshId, 32);
+
+  int64_t meshDims[3] = {1, 1, 1};
+  for (int i=0; i<rank; ++i)
+  {
+    int32_t n;
+    detail::readValue(*stream, n);
+    meshDims[i] = n;
+  }
+  if (!(*stream)) throw GenericException("Could not read the dimensions of " + blockName + " in " + fileName);
 
+  int slice[3];
+  meshData.getSlice(slice);
+  return MeshSlice(fileName, block->getDataLocation(), precision, rank, meshDims, slice);
+}
 
-void McfdCommand_joinslices::writeMeshVariableText()
+void McfdCommand_joinslices::joinBlock(HDFostream &output, const std::string &blockName,
+    const std::vector<std::string> &dumps, DataGrid1d &times, DataGrid1d &steps)
 {
-  std::ofstream output(outputName.c_str());
+  int nt = dumps.size();
+
+  std::string firstName = dumps[0];
+  SdfFile firstFile(firstName);
+  MeshSlice first = openSlice(firstFile, firstName, blockName);
+  const std::vector<int64_t> sliceDims = first.getDims();
+  int64_t length = first.getLength();
+
+  // the output has the time as its slowest dimension
+  int rank = sliceDims.size() + 1;
+  std::vector<hsize_t> dims(sliceDims.begin(), sliceDims.end());
+  std::vector<hsize_t> chunkDims(rank);
+  chunkDims[0] = std::max<int64_t>(1, std::min<int64_t>(nt, chunkValues/length));
+  for (int i=1; i<rank; ++i) chunkDims[i] = dims[i-1];
+
+  output.setBlockName(blockName);
+  output.beginExtendible(rank, dims.data(), &chunkDims[0], compression);
 
-  switch (meshData.getRank())
+  int window = std::min(nt, 2*numThreads);
+  std::vector<double> buffer(window*length);
+
+  for (int start=0; start<nt; start += window)
   {
-    case 1:
-    {
-      DataGrid1d &m = *(meshData.get1dMesh(0));
-      GridIndex1d l = m.getLo(), h = m.getHi();
-      for (int i=l[0]; i<=h[0]; ++i)
-        output << i << " " << m(i) << std::endl;
-    }
-    break;
-    case 2:
-    {
-      DataGrid2d &m = *(meshData.get2dMesh(0));
-      GridIndex2d l = m.getLo(), h = m.getHi();
+    int count = std::min(window, nt - start);
+    std::vector<std::string> errors(count);
 
-      for (int i=l[0]; i<=h[0]; ++i)
+    parallelFor(count, numThreads, [&](int f)
+    {
+      std::string name = dumps[start + f];
+      try
       {
-        for (int j=l[1]; j<=h[1]; ++j)
-          output << i << " " << j << " " << m(i,j) << std::endl;
-        output << std::endl;
+        SdfFile file(name);
+        MeshSlice slice = openSlice(file, name, blockName);
+        if (slice.getDims() != sliceDims)
+          throw GenericException("The slice of " + blockName + " in " + name + " differs in shape from the first dump");
+
+        slice.read(&buffer[f*length]);
+        times(start + f) = file.getHeader()->getTime();
+        steps(start + f) = file.getHeader()->getStep();
       }
-    }
-    break;
-    case 3:
-    {
-      DataGrid3d &m = *(meshData.get3dMesh(0));
-      GridIndex3d l = m.getLo(), h = m.getHi();
+      catch (BlockNotFoundException &ex)
+      {
+        errors[f] = "Block '" + ex.getName() + "' not found in " + name;
+      }
+      catch (GenericException &ex)
+      {
+        errors[f] = ex.getMessage();
+      }
+      catch (std::exception &ex)
+      {
+        errors[f] = std::string(ex.what()) + " in " + name;
+      }
+    });
 
-      for (int i=l[0]; i<=h[0]; ++i)
+    for (int f=0; f<count; ++f)
+      if (!errors[f].empty())
       {
-        for (int j=l[1]; j<=h[1]; ++j)
-          for (int k=l[2]; k<=h[2]; ++k)
-          output << i << " " << j << " " << k << " " << m(i,j,k) << std::endl;
-        output << std::endl;
+        output.endBlocks();
+        throw GenericException(errors[f]);
       }
-    }
-    break;
+
+    output.appendBlock(&buffer[0], count);
   }
+  output.endBlocks();
 
-  output.close();
+  std::cerr << "  joined " << blockName << "\n";
 }
 
 void McfdCommand_joinslices::print_help()
 {
-  std::cout << "\n  Manipulate cfd files: convert cfd block to HDF5 format\n\n  Usage:\n"
-        << "    mcfd toh5 [options] <block> <input> [<output>]\n\n"
-        << "  where <block> is the name of the data block in the cfd file,\n"
-        << "  <input> is the name of the cfd file,\n"
-        << "  and <output> is the name of the hdf file to write.\n\n";
+  std::cout << "\n  Manipulate sdf files: stack slices of mesh variables of many dumps into an HDF5 file\n\n  Usage:\n"
+        << "    msdf joinslices [options] <block> <input> [<output>]\n\n"
+        << "  where <block> is a comma separated list of data blocks in the sdf files,\n"
+        << "  <input> is a pattern of the sdf files, for example 'run/*.sdf',\n"
+        << "  and <output> is the name of the hdf file to write.\n\n"
+        << "  Only the slice given by the -x, -y and -z options is read from each file.\n"
+        << "  Each block is written to a dataset with the dump as its first dimension,\n"
+        << "  followed by the remaining z, y and x dimensions of the slice. The time and\n"
+        << "  step of the dumps are written to the datasets 'time' and 'step'.\n\n";
 
   std::cout << option_desc;
 }
@@ -1,5 +1,5 @@
 /*
- * tohdf.h
+ * joinslices.hpp
  *
  *  Created on: 8 Oct 2010
  *      Author: Holger Schmitz
@@ -13,9 +13,21 @@
 #include <boost/program_options.hpp>
 #include "../commands.hpp"
 #include "../dataio.hpp"
+#include "../meshslice.hpp"
+#include "../common/sdffile.hpp"
 
-class CfdMeshVariable;
+#include <string>
+#include <vector>
 
+class HDFostream;
+
+/**
+ * Stacks a slice of mesh variables from many SDF files along a time axis.
+ *
+ * Only the values of the slice are read from each file. The files are read
+ * in parallel, a window of a few files per thread at a time, and the window
+ * is appended in file order to an extendible dataset in the HDF file.
+ */
 class McfdCommand_joinslices : public MsdfCommand
 {
   private:
@@ -23,15 +35,17 @@ class McfdCommand_joinslices : public MsdfCommand
     boost::program_options::positional_options_description option_pos;
 
     std::string outputName;
-    std::string metaName;
+    int numThreads;
+    int compression;
 
-    bool writeMeta;
+    MultiMeshData meshData;
 
-    MeshData meshData;
+    /// The slice of a block in an SDF file
+    MeshSlice openSlice(msdf::SdfFile &file, const std::string &fileName, const std::string &blockName);
 
-    void writeMeshVariable();
-    void writeMeshVariableText();
-    void constructOutputFileName() { throw msdf::GenericException("Not implemented yet!"); }
+    /// Append the slices of a block in all dumps to a dataset of the output
+    void joinBlock(HDFostream &output, const std::string &blockName, const std::vector<std::string> &dumps,
+        DataGrid1d &times, DataGrid1d &steps);
   public:
     McfdCommand_joinslices();
     void execute(int argc, char **argv);
@@ -0,0 +1,292 @@
+/*
+ * phase3d.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "phase3d.hpp"
+#include "../axisbinning.hpp"
+#include "../bufferpool.hpp"
+#include "../hdfstream.hpp"
+#include "../histogram3d.hpp"
+#include "../parallel.hpp"
+#include "../particleaxes.hpp"
+#include "../tdigest.hpp"
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <boost/tokenizer.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+
+namespace po = boost::program_options;
+
+namespace {
+  const char *axisLabels[3] = { "x", "y", "z" };
+}
+
+void McfdCommand_phase3d::parseNumberList(std::string s, std::vector<double> &v)
+{
+  typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
+  boost::char_separator<char> sep(",");
+
+  tokenizer tokens(s, sep);
+  for (tokenizer::iterator tok_iter = tokens.begin(); tok_iter != tokens.end(); ++tok_iter)
+  {
+    try {
+      v.push_back(boost::lexical_cast<double>(*tok_iter));
+    }
+    catch (boost::bad_lexical_cast &)
+    {
+      throw GenericException("Could not convert '" + *tok_iter + "' in list " + s);
+    }
+  }
+}
+
+McfdCommand_phase3d::McfdCommand_phase3d()
+  : option_desc("Options for the 'phase3d' command")
+{
+  streamFact.addMesh().addSpecies().addMomentum().addWeight().setProgramOptions(option_desc);
+
+  const char *defaults[3] = { "x", "px", "py" };
+  for (int d=0; d<3; ++d)
+  {
+    std::string a = axisLabels[d];
+    option_desc.add_options()
+      ((a + "axis").c_str(), po::value<std::string>(&axisNames[d]),
+          ("variable on the " + a + "-axis. Any of x,y,px,py,pz,E,Ex,Ey,Ez,v,vx,vy,vz,theta,theta2,pxt,pyt,pzt (default: '" + defaults[d] + "')").c_str())
+      ((a + "dim").c_str(), po::value<int>(&dims[d]), ("number of bins in the " + a + "-direction (default: 256)").c_str())
+      ((a + "rmin").c_str(), po::value<std::string>(&rminStr[d]), ("minimum of the " + a + "-range for each species separated by commas (default: data minimum)").c_str())
+      ((a + "rmax").c_str(), po::value<std::string>(&rmaxStr[d]), ("maximum of the " + a + "-range for each species separated by commas (default: data maximum)").c_str())
+      ((a + "scale").c_str(), po::value<std::string>(&scaleNames[d]), ("spacing of the bins in the " + a + "-direction, one of lin, log or adaptive (default: 'lin')").c_str());
+  }
+
+  option_desc.add_options()
+    ("moment", po::value<std::string>(&moment),"specifies the moment to be integrated. Any of 1,x,y,px,py,pz,E,Ex,Ey,Ez,v,vx,vy,vz,theta,theta2,pxt,pyt,pzt (default: '1')")
+    ("mingamma", po::value<double>(&minGamma),"minimum energy of the particles to plot (default: 0.0)")
+    ("maxgamma", po::value<double>(&maxGamma),"maximum energy of the particles to plot (default: 0.0 no restriction)")
+    ("posPx", "If specified, only consider particles with positive px")
+    ("storage", po::value<std::string>(&storageName),"storage of the histograms, one of tiled or sparse (default: 'tiled')")
+    ("compression", po::value<int>(&compression),"deflate level of the HDF data sets between 0 (none) and 9 (default: 4)")
+    ("threads,j", po::value<int>(&numThreads),"number of threads used to fill the histograms (default: number of cores)")
+    ("output,o", po::value<std::string>(&outputName),"base name of the output file. A # in the file name will be replaced with the species number. If no # is present, the species number will be appended to the file name.");
+
+  option_pos.add("input", 1);
+}
+
+void McfdCommand_phase3d::execute(int argc, char **argv)
+{
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).
+            options(option_desc).positional(option_pos).run(), vm);
+  po::notify(vm);
+
+  const char *defaults[3] = { "x", "px", "py" };
+  if (vm.count("output")<1) outputName = "phase3d#.h5";
+  if (vm.count("moment")<1) moment = "1";
+  if (vm.count("mingamma")<1) minGamma = 0.0;
+  if (vm.count("maxgamma")<1) maxGamma = 0.0;
+  if (vm.count("storage")<1) storageName = "tiled";
+  if (vm.count("compression")<1) compression = 4;
+  if (vm.count("threads")<1) numThreads = defaultThreadCount();
+
+  Histogram3d::Storage storage;
+  if (!Histogram3d::parseStorage(storageName, storage))
+    throw GenericException("Unknown histogram storage " + storageName);
+
+  // the ranges are indexed by axis and species, the last value applies to the remaining species
+  std::vector<double> rmin[3], rmax[3];
+  AxisBinning::Scale scales[3];
+  bool rangePass = false;
+  int columns = pc_species | pc_weight;
+  for (int d=0; d<3; ++d)
+  {
+    std::string a = axisLabels[d];
+    if (vm.count(a + "axis")<1) axisNames[d] = defaults[d];
+    if (vm.count(a + "dim")<1) dims[d] = 256;
+    if (vm.count(a + "scale")<1) scaleNames[d] = "lin";
+    if (vm.count(a + "rmin")>0) parseNumberList(rminStr[d], rmin[d]);
+    if (vm.count(a + "rmax")>0) parseNumberList(rmaxStr[d], rmax[d]);
+    if (!AxisBinning::parseScale(scaleNames[d], scales[d]))
+      throw GenericException("Unknown scale " + scaleNames[d]);
+
+    rangePass = rangePass || rmin[d].empty() || rmax[d].empty() || (scales[d] == AxisBinning::adaptive);
+    axisIds[d] = makeAxisId(axisNames[d]);
+    columns |= particleColumnsForAxis(axisIds[d]);
+  }
+  momentId = makeAxisId(moment, true);
+
+  pParticleFilter filter(new ParticleFilter());
+  filter->setPositivePx(vm.count("posPx")>0);
+  streamFact.setFilter(filter);
+
+  // the range of each species and axis, with the smallest positive value for logarithmic bins
+  std::vector<double> mins[3], maxs[3], minPositive[3];
+  std::vector<TDigest> sketches[3];
+  int smallId = 0;
+
+  if (rangePass)
+  {
+    streamFact.setColumns(columns);
+    pParticleStream pstream = streamFact.getParticleStream(vm);
+    if (!pstream) throw GenericException("No input file given");
+    int rank = pstream->getRank();
+    pstream->getNextChunks();
+    while (! pstream->eos() )
+    {
+      const ParticleChunk &chunk = pstream->getChunk();
+      for (int64_t i=0; i<chunk.length(); ++i)
+      {
+        int id = chunk.species()[i] - 1;
+        if (id < 0) continue;
+        if (id >= int(mins[0].size()))
+          for (int d=0; d<3; ++d)
+          {
+            mins[d].resize(id+1, HUGE_VAL);
+            maxs[d].resize(id+1, -HUGE_VAL);
+            minPositive[d].resize(id+1, HUGE_VAL);
+            if (scales[d] == AxisBinning::adaptive) sketches[d].resize(id+1);
+          }
+
+        double y = (rank>1) ? chunk.y()[i] : 0.0;
+        for (int d=0; d<3; ++d)
+        {
+          double value = ParticleAxes::value(axisIds[d], chunk.px()[i], chunk.py()[i], chunk.pz()[i], chunk.x()[i], y);
+          mins[d][id] = std::min(mins[d][id], value);
+          maxs[d][id] = std::max(maxs[d][id], value);
+          if (value > 0.0) minPositive[d][id] = std::min(minPositive[d][id], value);
+          if (scales[d] == AxisBinning::adaptive) sketches[d][id].add(value, chunk.weight()[i]);
+        }
+      }
+      pstream->getNextChunks();
+    }
+  }
+
+  // the bins and histograms of each species are created when the species is first seen
+  std::vector<pHistogram3d> histograms;
+  std::vector<AxisBinning> binning[3];
+  auto addSpecies = [&](size_t id)
+  {
+    for (int d=0; d<3; ++d)
+    {
+      bool seen = (id < mins[d].size()) && (maxs[d][id] >= mins[d][id]);
+      if ((scales[d] == AxisBinning::adaptive) && seen && (sketches[d][id].getWeight() > 0.0))
+      {
+        binning[d].push_back(AxisBinning(sketches[d][id], dims[d]));
+        continue;
+      }
+
+      double lo = !rmin[d].empty() ? rmin[d][std::min(id, rmin[d].size()-1)] : (seen ? mins[d][id] : 0.0);
+      double hi = !rmax[d].empty() ? rmax[d][std::min(id, rmax[d].size()-1)] : (seen ? maxs[d][id] : 1.0);
+      AxisBinning::Scale scale = (scales[d] == AxisBinning::adaptive) ? AxisBinning::linear : scales[d];
+      if ((scale == AxisBinning::logarithmic) && !(lo > 0.0) && seen) lo = minPositive[d][id];
+      if (!(hi > lo)) hi = lo + 1.0;
+      binning[d].push_back(AxisBinning(scale, lo, hi, dims[d]));
+    }
+    histograms.push_back(pHistogram3d(new Histogram3d(storage, binning[0][id].size(), binning[1][id].size(), binning[2][id].size())));
+  };
+
+  filter->setGammaLimits(minGamma, maxGamma);
+  streamFact.setColumns(columns | particleColumnsForAxis(momentId));
+  pParticleStream pstream = streamFact.getParticleStream(vm);
+  if (!pstream) throw GenericException("No input file given");
+  int rank = pstream->getRank();
+  BufferPool pool;
+
+  pstream->getNextChunks();
+  while (! pstream->eos() )
+  {
+    const ParticleChunk &chunk = pstream->getChunk();
+    int64_t length = chunk.length();
+
+    std::vector<int64_t> speciesCount(histograms.size(), 0);
+    for (int64_t i=0; i<length; ++i)
+    {
+      int id = chunk.species()[i];
+      if (id < 1) { ++smallId; continue; }
+      while (int(histograms.size()) < id) addSpecies(histograms.size());
+      speciesCount.resize(histograms.size(), 0);
+      ++speciesCount[id-1];
+    }
+
+    // gather the bin coordinates of each species and deposit them
+    for (size_t id=0; id<histograms.size(); ++id)
+    {
+      int64_t count = speciesCount[id];
+      if (count == 0) continue;
+
+      double *pos[3];
+      for (int d=0; d<3; ++d) pos[d] = pool.get<double>(d, count);
+      double *value = pool.get<double>(3, count);
+
+      int64_t k = 0;
+      for (int64_t i=0; i<length; ++i)
+      {
+        if (chunk.species()[i] != int(id)+1) continue;
+        double px = chunk.px()[i];
+        double py = chunk.py()[i];
+        double pz = chunk.pz()[i];
+        double x = chunk.x()[i];
+        double y = (rank>1) ? chunk.y()[i] : 0.0;
+        for (int d=0; d<3; ++d) pos[d][k] = binning[d][id].position(ParticleAxes::value(axisIds[d], px, py, pz, x, y));
+        value[k] = ParticleAxes::value(momentId, px, py, pz, x, y)*chunk.weight()[i];
+        ++k;
+      }
+      histograms[id]->deposit(count, pos, value, numThreads);
+    }
+
+    pstream->getNextChunks();
+  }
+
+  for (size_t id=0; id<histograms.size(); ++id)
+  {
+    std::string outputName = createOutputFile(id);
+    HDFostream output(outputName.c_str());
+    histograms[id]->write(output, compression);
+    for (int d=0; d<3; ++d)
+    {
+      GridIndex1d size(binning[d][id].size()+1);
+      DataGrid1d edges(size);
+      for (int k=0; k<=binning[d][id].size(); ++k) edges(k) = binning[d][id].getEdge(k);
+      output.setBlockName(std::string(axisLabels[d]) + "edges");
+      output << edges;
+    }
+    output.close();
+
+    std::cerr << "Species " << id << ": " << histograms[id]->getStoredCount()
+        << (storage == Histogram3d::tiled ? " bricks" : " bins") << " stored\n";
+  }
+
+  std::cout << "Successfully written " << histograms.size() << " 3d phase space plots" << std::endl;
+
+  if (smallId>0)
+    std::cerr << "WARNING!\n    " << smallId << " species IDs found with values < 1\n";
+}
+
+char McfdCommand_phase3d::makeAxisId(std::string axisStr, bool allowUnity)
+{
+  int id = ParticleAxes::parseId(axisStr, allowUnity);
+  if (id >= 0) return id;
+  return allowUnity ? ParticleAxes::unity : 0;
+}
+
+void McfdCommand_phase3d::print_help()
+{
+  std::cout << "\n  Manipulate sdf files: creates a 3d phase space histogram for each species and stores it in hdf5 format\n\n  Usage:\n"
+        << "    msdf phase3d [options] <input>\n\n"
+        << "  where <input> is the name of the sdf/raw file. The histogram is written to the data set\n"
+        << "  data, the bin edges of the axes to xedges, yedges and zedges. Particles outside of the\n"
+        << "  plot range are not counted.\n\n";
+
+  std::cout << option_desc;
+}
+
+std::string McfdCommand_phase3d::createOutputFile(int speciesId)
+{
+  std::string speciesIdStr = boost::lexical_cast<std::string>(speciesId);
+  std::string result = boost::replace_first_copy(outputName,"#",speciesIdStr);
+  if (result == outputName) result = outputName + speciesIdStr;
+  return result;
+}
@@ -0,0 +1,58 @@
+/*
+ * phase3d.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef PHASE3D_H_
+#define PHASE3D_H_
+
+#include <boost/program_options.hpp>
+#include "../commands.hpp"
+#include "../particlestream.hpp"
+
+using namespace msdf;
+
+/**
+ * Creates three dimensional histograms such as (x, px, py) or (px, py, pz)
+ * for each species.
+ *
+ * The histograms are stored in bricks or sparse maps, filled on several
+ * threads and written as chunked, compressed HDF data sets together with
+ * the bin edges of each axis.
+ */
+class McfdCommand_phase3d : public MsdfCommand
+{
+  private:
+    boost::program_options::options_description option_desc;
+    boost::program_options::positional_options_description option_pos;
+    ParticleStreamFactory streamFact;
+
+    std::string outputName;
+    std::string axisNames[3];
+    std::string moment;
+    std::string rminStr[3], rmaxStr[3];
+    std::string scaleNames[3];
+    std::string storageName;
+    int dims[3];
+    double minGamma;
+    double maxGamma;
+    int compression;
+    int numThreads;
+
+    char axisIds[3];
+    char momentId;
+
+    std::string createOutputFile(int speciesId);
+    char makeAxisId(std::string axisStr, bool allowUnity=false);
+    void parseNumberList(std::string s, std::vector<double> &v);
+
+  public:
+    McfdCommand_phase3d();
+    void execute(int argc, char **argv);
+    void print_help();
+};
+
+#endif /* PHASE3D_H_ */
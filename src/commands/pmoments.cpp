@@ -0,0 +1,248 @@
+/*
+ * pmoments.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "pmoments.hpp"
+#include "../bufferpool.hpp"
+#include "../hdfstream.hpp"
+#include "../parallel.hpp"
+#include <iostream>
+#include <vector>
+#include <boost/tokenizer.hpp>
+#include <boost/lexical_cast.hpp>
+
+namespace po = boost::program_options;
+
+namespace {
+  /// The names of the data sets written for each species, the species number is appended
+  const int numQuantities = 13;
+  const char *quantityNames[numQuantities] = {
+      "density", "px", "py", "pz", "jx", "jy", "jz",
+      "Txx", "Txy", "Txz", "Tyy", "Tyz", "Tzz" };
+
+  /// The value of quantity q in a cell
+  double cellValue(int q, const CellMoments &cell, double volume, double mass, double charge)
+  {
+    if (q == 0) return cell.weight/volume;
+    if (q < 4) return mass*cell.mean[q-1];
+    if (q < 7) return charge*cell.vsum[q-4]/volume;
+    return mass*cell.cov[q-7]/(cell.weight*kB);
+  }
+}
+
+void McfdCommand_pmoments::parseNumberList(std::string s, std::vector<double> &v)
+{
+  typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
+  boost::char_separator<char> sep(",");
+
+  tokenizer tokens(s, sep);
+  int spId=0;
+  for (tokenizer::iterator tok_iter = tokens.begin();
+      tok_iter != tokens.end(); ++tok_iter, ++spId)
+  {
+    if (int(v.size()) <= spId) v.resize(spId+1, 1.0);
+    try {
+      v[spId] *= boost::lexical_cast<double>(*tok_iter);
+    }
+    catch (boost::bad_lexical_cast &)
+    {
+      std::cerr << "ERROR: Could not convert argument " << spId+1 << " in list: '"<< *tok_iter << "'\n";
+    }
+  }
+}
+
+McfdCommand_pmoments::McfdCommand_pmoments()
+  : option_desc("Options for the 'pmoments' command")
+{
+  streamFact.addMesh().addSpecies().addMomentum().addWeight().setProgramOptions(option_desc);
+
+  option_desc.add_options()
+    ("dims", po::value<std::string>(&dimsStr),"number of grid cells in each direction separated by commas, the number of values sets the dimension of the grid")
+    ("gmin", po::value<std::string>(&gminStr),"lower bounds of the grid in each direction separated by commas")
+    ("gmax", po::value<std::string>(&gmaxStr),"upper bounds of the grid in each direction separated by commas")
+    ("shape", po::value<std::string>(&shapeName),"shape function of the particles, one of ngp, cic or tsc (default: cic)")
+    ("mf", po::value<std::string>(&mfString),"list of mass factors S (SI), e (electron) or p (proton) separated by commas (default: S)")
+    ("mass,m", po::value<std::string>(&massString),"list of masses in units of the mass factors separated by commas (default: 1.0)")
+    ("charge", po::value<std::string>(&chargeString),"list of charges in units of the elementary charge separated by commas (default: 1.0)")
+    ("threads,j", po::value<int>(&numThreads),"number of threads used to deposit the particles (default: number of cores)")
+    ("output,o", po::value<std::string>(&outputName),"name of the HDF output file (default: pmoments.h5)");
+
+  option_pos.add("input", 1);
+}
+
+void McfdCommand_pmoments::execute(int argc, char **argv)
+{
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).
+            options(option_desc).positional(option_pos).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("output")<1) outputName = "pmoments.h5";
+  if (vm.count("shape")<1) shapeName = "cic";
+  if (vm.count("threads")<1) numThreads = defaultThreadCount();
+
+  MomentGrid::Shape shape;
+  if (!MomentGrid::parseShape(shapeName, shape))
+    throw GenericException("Unknown shape function " + shapeName);
+
+  std::vector<double> dimsList, gmin, gmax;
+  if (vm.count("dims")>0) parseNumberList(dimsStr, dimsList);
+  if (vm.count("gmin")>0) parseNumberList(gminStr, gmin);
+  if (vm.count("gmax")>0) parseNumberList(gmaxStr, gmax);
+
+  int rank = dimsList.size();
+  if ((rank < 1) || (rank > 3) || (int(gmin.size()) != rank) || (int(gmax.size()) != rank))
+    throw GenericException("--dims, --gmin and --gmax need the same number of values, between one and three");
+
+  int dims[3];
+  double lo[3], hi[3];
+  for (int d=0; d<rank; ++d)
+  {
+    dims[d] = int(dimsList[d]);
+    lo[d] = gmin[d];
+    hi[d] = gmax[d];
+    if ((dims[d] < 1) || !(hi[d] > lo[d]))
+      throw GenericException("Empty grid in direction " + boost::lexical_cast<std::string>(d));
+  }
+
+  std::vector<double> masses;
+  typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
+  boost::char_separator<char> sep(",");
+  if (vm.count("mf")>0)
+  {
+    tokenizer mfTokens(mfString, sep);
+    for (tokenizer::iterator tok_iter = mfTokens.begin(); tok_iter != mfTokens.end(); ++tok_iter)
+    {
+      if (*tok_iter == "e") masses.push_back(massEl);
+      else
+      if (*tok_iter == "p") masses.push_back(massProton);
+      else masses.push_back(1.0);
+    }
+  }
+  if (vm.count("mass")>0) parseNumberList(massString, masses);
+
+  std::vector<double> charges;
+  if (vm.count("charge")>0) parseNumberList(chargeString, charges);
+
+  streamFact.setColumns(pc_species | pc_mesh | pc_momentum | pc_weight);
+  pParticleStream pstream = streamFact.getParticleStream(vm);
+  if (!pstream) throw GenericException("No input file given");
+  if (pstream->getRank() < rank)
+    throw GenericException("The grid has more dimensions than the particle data");
+
+  std::vector<pMomentGrid> grids;
+  int smallId = 0;
+  BufferPool pool;
+
+  pstream->getNextChunks();
+  while (! pstream->eos() )
+  {
+    const ParticleChunk &chunk = pstream->getChunk();
+    int64_t length = chunk.length();
+
+    std::vector<int64_t> speciesCount(grids.size(), 0);
+    for (int64_t i=0; i<length; ++i)
+    {
+      int id = chunk.species()[i];
+      if (id < 1) { ++smallId; continue; }
+      if (id > int(grids.size()))
+      {
+        for (int s=grids.size(); s<id; ++s)
+          grids.push_back(pMomentGrid(new MomentGrid(rank, dims, lo, hi, shape)));
+        speciesCount.resize(id, 0);
+      }
+      ++speciesCount[id-1];
+    }
+    if (masses.size() < grids.size()) masses.resize(grids.size(), 1.0);
+
+    // gather the particles of each species and deposit them
+    for (size_t id=0; id<grids.size(); ++id)
+    {
+      int64_t count = speciesCount[id];
+      if (count == 0) continue;
+
+      double *position[3];
+      double *u[3];
+      for (int d=0; d<rank; ++d) position[d] = pool.get<double>(d, count);
+      for (int d=0; d<3; ++d) u[d] = pool.get<double>(3+d, count);
+      double *weight = pool.get<double>(6, count);
+
+      double factor = pstream->isRaw() ? 2.99792458e8 : 1.0/masses[id];
+      int64_t k = 0;
+      for (int64_t i=0; i<length; ++i)
+      {
+        if (chunk.species()[i] != int(id)+1) continue;
+        for (int d=0; d<rank; ++d) position[d][k] = chunk.position(d)[i];
+        u[0][k] = chunk.px()[i]*factor;
+        u[1][k] = chunk.py()[i]*factor;
+        u[2][k] = chunk.pz()[i]*factor;
+        weight[k] = chunk.weight()[i];
+        ++k;
+      }
+      grids[id]->deposit(count, position, u, weight, numThreads);
+    }
+
+    pstream->getNextChunks();
+  }
+
+  if (smallId>0)
+    std::cerr << "WARNING!\n    " << smallId << " species IDs found with values < 1\n";
+
+  HDFostream output(outputName.c_str());
+  for (size_t id=0; id<grids.size(); ++id)
+  {
+    grids[id]->reduce();
+    double charge = (id < charges.size()) ? charges[id] : 1.0;
+    charge *= chargeEl;
+    switch (rank)
+    {
+      case 1: writeSpecies<1>(output, *grids[id], id+1, masses[id], charge); break;
+      case 2: writeSpecies<2>(output, *grids[id], id+1, masses[id], charge); break;
+      case 3: writeSpecies<3>(output, *grids[id], id+1, masses[id], charge); break;
+    }
+  }
+  output.close();
+
+  std::cout << "Successfully written the moments of " << grids.size() << " species to " << outputName << std::endl;
+}
+
+template<int Rank>
+void McfdCommand_pmoments::writeSpecies(HDFostream &output, const MomentGrid &grid, int id, double mass, double charge)
+{
+  typedef schnek::Grid<double, Rank, MsdfGridChecker> GridType;
+  typename GridType::IndexType size, pos;
+  for (int d=0; d<Rank; ++d) size[d] = grid.getDim(d);
+  GridType data(size);
+
+  double volume = grid.getCellVolume();
+  std::string suffix = boost::lexical_cast<std::string>(id);
+  for (int q=0; q<numQuantities; ++q)
+  {
+    int index[3] = { 0, 0, 0 };
+    for (index[0]=0; index[0]<grid.getDim(0); ++index[0])
+      for (index[1]=0; index[1]<grid.getDim(1); ++index[1])
+        for (index[2]=0; index[2]<grid.getDim(2); ++index[2])
+        {
+          const CellMoments *cell = grid.getCell(index);
+          for (int d=0; d<Rank; ++d) pos[d] = index[d];
+          data[pos] = (cell && (cell->weight > 0.0)) ? cellValue(q, *cell, volume, mass, charge) : 0.0;
+        }
+    output.setBlockName(std::string(quantityNames[q]) + suffix);
+    output << data;
+  }
+}
+
+void McfdCommand_pmoments::print_help()
+{
+  std::cout << "\n  Manipulate sdf files: deposit particles onto a grid and compute the moments of each species\n\n  Usage:\n"
+        << "    msdf pmoments [options] <input>\n\n"
+        << "  where <input> is the name of the sdf/raw file. For each species n the data sets\n"
+        << "  density<n>, px<n>, py<n>, pz<n>, jx<n>, jy<n>, jz<n> and the temperature tensor\n"
+        << "  Txx<n>, Txy<n>, Txz<n>, Tyy<n>, Tyz<n>, Tzz<n> are written to the output file.\n\n";
+
+  std::cout << option_desc;
+}
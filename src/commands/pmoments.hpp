@@ -0,0 +1,54 @@
+/*
+ * pmoments.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef PMOMENTS_H_
+#define PMOMENTS_H_
+
+#include <boost/program_options.hpp>
+#include "../commands.hpp"
+#include "../particlestream.hpp"
+#include "../momentgrid.hpp"
+
+class HDFostream;
+
+using namespace msdf;
+
+/**
+ * Deposits the particles onto a spatial grid and writes the number density,
+ * mean momentum, current density and temperature tensor of each species.
+ *
+ * All quantities are accumulated in a single streaming pass and written as
+ * data sets of one HDF file.
+ */
+class McfdCommand_pmoments : public MsdfCommand
+{
+  private:
+    boost::program_options::options_description option_desc;
+    boost::program_options::positional_options_description option_pos;
+    ParticleStreamFactory streamFact;
+
+    std::string outputName;
+    std::string dimsStr;
+    std::string gminStr, gmaxStr;
+    std::string shapeName;
+    std::string mfString;
+    std::string massString;
+    std::string chargeString;
+    int numThreads;
+
+    void parseNumberList(std::string s, std::vector<double> &v);
+
+    template<int Rank>
+    void writeSpecies(HDFostream &output, const MomentGrid &grid, int id, double mass, double charge);
+  public:
+    McfdCommand_pmoments();
+    void execute(int argc, char **argv);
+    void print_help();
+};
+
+#endif /* PMOMENTS_H_ */
@@ -0,0 +1,234 @@
+/*
+ * ptop.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "ptop.hpp"
+#include "../hdfstream.hpp"
+#include "../parallel.hpp"
+#include "../particleaxes.hpp"
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <vector>
+#include <boost/lexical_cast.hpp>
+
+namespace po = boost::program_options;
+
+McfdCommand_ptop::McfdCommand_ptop()
+  : option_desc("Options for the 'ptop' command")
+{
+  streamFact.addMesh().addSpecies().addMomentum().addWeight().setProgramOptions(option_desc);
+
+  option_desc.add_options()
+    ("key", po::value<std::string>(&keyName),"quantity by which the particles are selected. Any of x,y,px,py,pz,E,Ex,Ey,Ez,v,vx,vy,vz,theta,theta2,pxt,pyt,pzt (default: 'E')")
+    ("count,n", po::value<int64_t>(&count),"number of particles to select (default: 1000)")
+    ("abs", "select by the absolute value of the key")
+    ("smallest", "select the particles with the smallest instead of the largest values")
+    ("per-species", "select count particles of each species instead of count particles in total")
+    ("mingamma", po::value<double>(&minGamma),"minimum energy of the particles to consider (default: 0.0)")
+    ("maxgamma", po::value<double>(&maxGamma),"maximum energy of the particles to consider (default: 0.0 no restriction)")
+    ("posPx", "If specified, only consider particles with positive px")
+    ("threads,j", po::value<int>(&numThreads),"number of threads used to select the particles (default: number of cores)")
+    ("output,o", po::value<std::string>(&outputName),"name of the output file (default: ptop.h5 or ptop.out with --text)")
+    ("text,t","write output in ascii text format for gnuplot instead of hdf5");
+
+  option_pos.add("input", 1);
+}
+
+void McfdCommand_ptop::execute(int argc, char **argv)
+{
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).
+            options(option_desc).positional(option_pos).run(), vm);
+  po::notify(vm);
+
+  bool text = vm.count("text")>0;
+  if (vm.count("output")<1) outputName = text ? "ptop.out" : "ptop.h5";
+  if (vm.count("key")<1) keyName = "E";
+  if (vm.count("count")<1) count = 1000;
+  if (vm.count("mingamma")<1) minGamma = 0.0;
+  if (vm.count("maxgamma")<1) maxGamma = 0.0;
+  if (vm.count("threads")<1) numThreads = defaultThreadCount();
+
+  if (count < 0) throw GenericException("The particle count must not be negative");
+  numThreads = std::max(1, numThreads);
+
+  bool useAbs = vm.count("abs")>0;
+  bool perSpecies = vm.count("per-species")>0;
+  // the heaps keep the largest keys, the smallest values are selected by negating them
+  double sign = (vm.count("smallest")>0) ? -1.0 : 1.0;
+  keyId = makeAxisId(keyName);
+
+  pParticleFilter filter(new ParticleFilter());
+  filter->setGammaLimits(minGamma, maxGamma);
+  filter->setPositivePx(vm.count("posPx")>0);
+  streamFact.setFilter(filter);
+  streamFact.setColumns(pc_all);
+
+  pParticleStream pstream = streamFact.getParticleStream(vm);
+  if (!pstream) throw GenericException("No input file given");
+  int rank = pstream->getRank();
+
+  // heaps[slice][group], each slice of a chunk is handled by one thread
+  std::vector<std::vector<pTopK> > heaps(numThreads);
+  int64_t streamIndex = 0;
+  int smallId = 0;
+
+  pstream->getNextChunks();
+  while (! pstream->eos() )
+  {
+    const ParticleChunk &chunk = pstream->getChunk();
+    int64_t length = chunk.length();
+
+    size_t numGroups = heaps[0].size();
+    for (int64_t i=0; i<length; ++i)
+    {
+      int id = chunk.species()[i];
+      if (id < 1) { ++smallId; continue; }
+      numGroups = std::max(numGroups, perSpecies ? size_t(id) : size_t(1));
+    }
+    // the heaps reserve their budget here, pushing records on the worker threads can't throw
+    if (numGroups > heaps[0].size())
+      MemoryBudget::require(count*numThreads*int64_t(numGroups - heaps[0].size())*sizeof(TopKRecord),
+          "the top-k heaps of " + boost::lexical_cast<std::string>(numThreads) + " threads");
+    for (int s=0; s<numThreads; ++s)
+      while (heaps[s].size() < numGroups) heaps[s].push_back(pTopK(new TopK(count)));
+
+    parallelFor(numThreads, numThreads, [&](int s)
+    {
+      int64_t begin = length*s/numThreads;
+      int64_t end = length*(s+1)/numThreads;
+      std::vector<pTopK> &sliceHeaps = heaps[s];
+      for (int64_t i=begin; i<end; ++i)
+      {
+        int id = chunk.species()[i];
+        if (id < 1) continue;
+        TopK &top = *sliceHeaps[perSpecies ? id-1 : 0];
+
+        double x = chunk.x()[i];
+        double y = (rank>1) ? chunk.y()[i] : 0.0;
+        double value = ParticleAxes::value(keyId, chunk.px()[i], chunk.py()[i], chunk.pz()[i], x, y);
+        if (useAbs) value = fabs(value);
+        double key = sign*value;
+        if (top.rejects(key)) continue;
+
+        TopKRecord record;
+        record.key = key;
+        record.index = streamIndex + i;
+        record.species = id;
+        record.pos[0] = x;
+        record.pos[1] = y;
+        record.pos[2] = (rank>2) ? chunk.z()[i] : 0.0;
+        record.p[0] = chunk.px()[i];
+        record.p[1] = chunk.py()[i];
+        record.p[2] = chunk.pz()[i];
+        record.weight = chunk.weight()[i];
+        top.push(record);
+      }
+    });
+
+    streamIndex += length;
+    pstream->getNextChunks();
+  }
+
+  std::vector<TopKRecord> records;
+  size_t numGroups = heaps[0].size();
+  for (size_t g=0; g<numGroups; ++g)
+  {
+    TopK merged(count);
+    for (int s=0; s<numThreads; ++s) merged.merge(*heaps[s][g]);
+    std::vector<TopKRecord> groupRecords = merged.sorted();
+    records.insert(records.end(), groupRecords.begin(), groupRecords.end());
+  }
+  heaps.clear();
+
+  if (text) writeText(records, rank, sign);
+  else writeHdf(records, rank, sign);
+
+  std::cout << "Successfully written " << records.size() << " particles" << std::endl;
+
+  if (smallId>0)
+    std::cerr << "WARNING!\n    " << smallId << " species IDs found with values < 1\n";
+}
+
+void McfdCommand_ptop::writeText(const std::vector<TopKRecord> &records, int rank, double sign)
+{
+  const char *posNames[3] = { "x", "y", "z" };
+  std::ofstream output(outputName.c_str());
+  if (!output) throw GenericException("Could not open output file " + outputName);
+
+  output << "# " << keyName << " species";
+  for (int d=0; d<rank; ++d) output << " " << posNames[d];
+  output << " px py pz weight index\n";
+
+  for (size_t i=0; i<records.size(); ++i)
+  {
+    const TopKRecord &r = records[i];
+    output << sign*r.key << " " << r.species;
+    for (int d=0; d<rank; ++d) output << " " << r.pos[d];
+    output << " " << r.p[0] << " " << r.p[1] << " " << r.p[2]
+           << " " << r.weight << " " << r.index << "\n";
+  }
+  output.close();
+}
+
+void McfdCommand_ptop::writeHdf(const std::vector<TopKRecord> &records, int rank, double sign)
+{
+  const int numColumns = 10;
+  const char *columnNames[numColumns] = { "key", "species", "x", "y", "z", "px", "py", "pz", "weight", "index" };
+
+  // schnek grids can't be empty, an empty selection is written with a single zero
+  GridIndex1d size(std::max(size_t(1), records.size()));
+  DataGrid1d column(size);
+
+  HDFostream output(outputName.c_str());
+  for (int c=0; c<numColumns; ++c)
+  {
+    if ((c>=2) && (c<5) && (c-2 >= rank)) continue;
+    column = 0.0;
+    for (size_t i=0; i<records.size(); ++i)
+    {
+      const TopKRecord &r = records[i];
+      switch (c)
+      {
+        case 0: column(i) = sign*r.key; break;
+        case 1: column(i) = r.species; break;
+        case 2:
+        case 3:
+        case 4: column(i) = r.pos[c-2]; break;
+        case 5:
+        case 6:
+        case 7: column(i) = r.p[c-5]; break;
+        case 8: column(i) = r.weight; break;
+        default: column(i) = r.index; break;
+      }
+    }
+    output.setBlockName(columnNames[c]);
+    output << column;
+  }
+  output.close();
+}
+
+char McfdCommand_ptop::makeAxisId(std::string axisStr)
+{
+  int id = ParticleAxes::parseId(axisStr);
+  if (id < 0) throw GenericException("Unknown key " + axisStr);
+  return id;
+}
+
+void McfdCommand_ptop::print_help()
+{
+  std::cout << "\n  Manipulate sdf files: selects the particles with the largest values of a quantity and writes their records\n\n  Usage:\n"
+        << "    msdf ptop [options] <input>\n\n"
+        << "  where <input> is the name of the sdf/raw file. The HDF output contains one data set for each\n"
+        << "  column, key, species, x, y, z (up to the rank of the mesh), px, py, pz, weight and index, where\n"
+        << "  index is the position of the particle in the stream. The particles are sorted by their key,\n"
+        << "  and by species first with --per-species. Equal keys are ordered by index, so the selection\n"
+        << "  doesn't depend on the number of threads.\n\n";
+
+  std::cout << option_desc;
+}
@@ -0,0 +1,53 @@
+/*
+ * ptop.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef PTOP_H_
+#define PTOP_H_
+
+#include <boost/program_options.hpp>
+#include "../commands.hpp"
+#include "../particlestream.hpp"
+#include "../topk.hpp"
+
+using namespace msdf;
+
+/**
+ * Extracts the particles with the largest (or smallest) value of a quantity
+ * such as the energy or |py|, and writes their full records.
+ *
+ * Each thread keeps bounded heaps over its share of every chunk. The heaps
+ * are merged at the end, so only the selected particles are ever stored.
+ */
+class McfdCommand_ptop : public MsdfCommand
+{
+  private:
+    boost::program_options::options_description option_desc;
+    boost::program_options::positional_options_description option_pos;
+    ParticleStreamFactory streamFact;
+
+    std::string outputName;
+    std::string keyName;
+    int64_t count;
+    double minGamma;
+    double maxGamma;
+    int numThreads;
+
+    char keyId;
+
+    char makeAxisId(std::string axisStr);
+
+    void writeText(const std::vector<TopKRecord> &records, int rank, double sign);
+    void writeHdf(const std::vector<TopKRecord> &records, int rank, double sign);
+
+  public:
+    McfdCommand_ptop();
+    void execute(int argc, char **argv);
+    void print_help();
+};
+
+#endif /* PTOP_H_ */
@@ -0,0 +1,276 @@
+/*
+ * reorder.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "reorder.hpp"
+#include "../particlecache.hpp"
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <queue>
+#include <vector>
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+namespace {
+
+  /// One particle during sorting: the cell key followed by the cache columns
+  struct CacheRecord
+  {
+    uint64_t key;
+    double values[8];
+  };
+
+  bool recordLess(const CacheRecord &a, const CacheRecord &b)
+  {
+    return a.key < b.key;
+  }
+
+  /// Sort the records and write them to a new run file
+  void writeRun(std::vector<CacheRecord> &records, const std::string &outputName,
+                std::vector<std::string> &runNames, std::vector<int64_t> &runLengths)
+  {
+    std::stable_sort(records.begin(), records.end(), recordLess);
+    runNames.push_back(outputName + ".run" + boost::lexical_cast<std::string>(runNames.size()));
+    runLengths.push_back(records.size());
+
+    std::ofstream run(runNames.back().c_str(), std::ios::binary);
+    run.write((const char*)&records[0], records.size()*sizeof(CacheRecord));
+    if (!run) throw msdf::GenericException("Error writing sorted run " + runNames.back());
+    records.clear();
+  }
+
+  /// Sequential reader of a sorted run with a bounded buffer
+  class RunReader
+  {
+    private:
+      boost::shared_ptr<std::ifstream> in;
+      std::vector<CacheRecord> buffer;
+      size_t bufferLength;
+      size_t pos;
+      int64_t remaining;
+    public:
+      RunReader(const std::string &fileName, int64_t length, size_t bufferLength_)
+        : in(new std::ifstream(fileName.c_str(), std::ios::binary)),
+          bufferLength(std::max(size_t(1), bufferLength_)), pos(0), remaining(length)
+      {}
+
+      bool empty() const { return (pos >= buffer.size()) && (remaining == 0); }
+
+      const CacheRecord &front()
+      {
+        if (pos >= buffer.size())
+        {
+          int64_t count = std::min(int64_t(bufferLength), remaining);
+          buffer.resize(count);
+          in->read((char*)&buffer[0], count*sizeof(CacheRecord));
+          if (!*in) throw msdf::GenericException("Error reading sorted run");
+          remaining -= count;
+          pos = 0;
+        }
+        return buffer[pos];
+      }
+
+      void pop() { ++pos; }
+  };
+
+  /// Merge queue entry, ties are resolved by run index to keep the sort stable
+  struct MergeEntry
+  {
+    uint64_t key;
+    size_t run;
+    bool operator<(const MergeEntry &e) const
+    {
+      return (key > e.key) || ((key == e.key) && (run > e.run));
+    }
+  };
+}
+
+McfdCommand_reorder::McfdCommand_reorder()
+  : option_desc("Options for the 'reorder' command")
+{
+  option_desc.add_options()
+      ("output,o", po::value<std::string>(&outputName),"name of the cache file (default: <input>.pcache)")
+      ("bits,b", po::value<int>(&bits),"number of bits of the cell index in each dimension (default: 8)")
+      ("mem-budget,m", po::value<int64_t>(&memBudget),"memory used for sorting in MB (default: 256)");
+
+  streamFact.addSpecies().addMesh().addMomentum().addWeight().setProgramOptions(option_desc);
+
+  option_pos.add("input", 1);
+}
+
+void McfdCommand_reorder::execute(int argc, char **argv)
+{
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).
+            options(option_desc).positional(option_pos).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("input")<1) throw GenericException("No input file given");
+
+  std::string inputName = vm["input"].as<std::string>();
+  if (vm.count("output")<1) outputName = inputName + ".pcache";
+  if (vm.count("bits")<1) bits = 8;
+  if (vm.count("mem-budget")<1) memBudget = 256;
+
+  // first pass: the extent of the particle positions defines the cells
+  streamFact.setColumns(pc_mesh);
+  pParticleStream pstream = streamFact.getParticleStream(vm);
+  int rank = pstream->getRank();
+  double lo[3], hi[3];
+  for (int d=0; d<rank; ++d)
+  {
+    lo[d] = HUGE_VAL;
+    hi[d] = -HUGE_VAL;
+  }
+
+  pstream->getNextChunks();
+  while (! pstream->eos() )
+  {
+    const ParticleChunk &chunk = pstream->getChunk();
+    for (int d=0; d<rank; ++d)
+    {
+      ArraySpan<const double> pos = chunk.position(d);
+      for (int64_t i=0; i<pos.size(); ++i)
+      {
+        lo[d] = std::min(lo[d], pos[i]);
+        hi[d] = std::max(hi[d], pos[i]);
+      }
+    }
+    pstream->getNextChunks();
+  }
+
+  ParticleCache cache;
+  cache.init(rank, bits, lo, hi, pstream->isRaw());
+
+  // second pass: write runs sorted by cell key, each fits in the memory budget
+  int numColumns = cache.getNumColumns();
+  size_t runLength = std::max(int64_t(1), memBudget*1024*1024/int64_t(sizeof(CacheRecord)));
+  std::vector<CacheRecord> records;
+  records.reserve(runLength);
+  std::vector<std::string> runNames;
+  std::vector<int64_t> runLengths;
+  std::map<uint64_t, int64_t> cellCounts;
+  int64_t total = 0;
+  int numSpecies = 0;
+  bool smallId = false;
+
+  streamFact.setColumns(pc_all);
+  pstream = streamFact.getParticleStream(vm);
+  pstream->getNextChunks();
+  while (! pstream->eos() )
+  {
+    const ParticleChunk &chunk = pstream->getChunk();
+    int64_t count = chunk.length();
+
+    for (int64_t i=0; i<count; ++i)
+    {
+      CacheRecord rec;
+      for (int d=0; d<rank; ++d) rec.values[d] = chunk.position(d)[i];
+      rec.values[rank + ParticleCache::col_species] = chunk.species()[i];
+      rec.values[rank + ParticleCache::col_px] = chunk.px()[i];
+      rec.values[rank + ParticleCache::col_py] = chunk.py()[i];
+      rec.values[rank + ParticleCache::col_pz] = chunk.pz()[i];
+      rec.values[rank + ParticleCache::col_weight] = chunk.weight()[i];
+      rec.key = cache.cellKey(rec.values);
+
+      int id = int(rec.values[rank + ParticleCache::col_species]);
+      if (id < 1) smallId = true;
+      numSpecies = std::max(numSpecies, id);
+
+      ++cellCounts[rec.key];
+      records.push_back(rec);
+      ++total;
+      if (records.size() >= runLength) writeRun(records, outputName, runNames, runLengths);
+    }
+    pstream->getNextChunks();
+  }
+  if (!records.empty()) writeRun(records, outputName, runNames, runLengths);
+  std::vector<CacheRecord>().swap(records);
+
+  // the cell index follows from the number of particles in each cell
+  std::vector<ParticleCache::Cell> cells;
+  int64_t first = 0;
+  for (std::map<uint64_t, int64_t>::iterator it = cellCounts.begin(); it != cellCounts.end(); ++it)
+  {
+    ParticleCache::Cell cell;
+    cell.key = it->first;
+    cell.first = first;
+    cells.push_back(cell);
+    first += it->second;
+  }
+
+  std::cout << "Sorting " << total << " particles into " << cells.size()
+      << " cells using " << runNames.size() << " runs\n";
+
+  std::ofstream output(outputName.c_str(), std::ios::binary);
+  cache.writeHeader(output, total, smallId ? 0 : numSpecies, cells);
+
+  // third pass: merge the runs and write the columns
+  size_t bufferLength = runLength/(runNames.size() + 1);
+  std::vector<boost::shared_ptr<RunReader> > runs;
+  std::priority_queue<MergeEntry> queue;
+  for (size_t r=0; r<runNames.size(); ++r)
+  {
+    runs.push_back(boost::shared_ptr<RunReader>(new RunReader(runNames[r], runLengths[r], bufferLength)));
+    MergeEntry entry = { runs[r]->front().key, r };
+    queue.push(entry);
+  }
+
+  std::vector<std::vector<double> > columnBuffers(numColumns);
+  for (int c=0; c<numColumns; ++c) columnBuffers[c].reserve(bufferLength);
+  int64_t written = 0;
+
+  while (!queue.empty())
+  {
+    MergeEntry entry = queue.top();
+    queue.pop();
+    const CacheRecord &rec = runs[entry.run]->front();
+    for (int c=0; c<numColumns; ++c) columnBuffers[c].push_back(rec.values[c]);
+    runs[entry.run]->pop();
+    if (!runs[entry.run]->empty())
+    {
+      MergeEntry next = { runs[entry.run]->front().key, entry.run };
+      queue.push(next);
+    }
+
+    if (queue.empty() || (columnBuffers[0].size() >= bufferLength))
+    {
+      int64_t count = columnBuffers[0].size();
+      for (int c=0; c<numColumns; ++c)
+      {
+        output.seekp(cache.columnOffset(c, written));
+        output.write((const char*)&columnBuffers[c][0], count*sizeof(double));
+        columnBuffers[c].clear();
+      }
+      written += count;
+    }
+  }
+
+  output.close();
+  if (!output) throw msdf::GenericException("Error writing particle cache " + outputName);
+
+  for (size_t r=0; r<runNames.size(); ++r) fs::remove(runNames[r]);
+
+  std::cout << "Particle cache written to " << outputName << "\n";
+}
+
+void McfdCommand_reorder::print_help()
+{
+  std::cout << "\n  Manipulate sdf files: write a spatially sorted particle cache\n\n  Usage:\n"
+        << "    msdf reorder [options] <input>\n\n"
+        << "  where <input> is the name of the sdf file. The particles are sorted by the\n"
+        << "  Morton key of their cell. Particle commands accept the cache as input and only\n"
+        << "  read the cells inside the spatial limits given by --xsmin, --xsmax, --ysmin, --ysmax.\n\n";
+
+  std::cout << option_desc;
+}
@@ -0,0 +1,39 @@
+/*
+ * reorder.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef REORDER_H_
+#define REORDER_H_
+
+#include <boost/program_options.hpp>
+#include "../commands.hpp"
+#include "../particlestream.hpp"
+
+/**
+ * Writes the particles of a dump into a cache file sorted by Morton cell key.
+ *
+ * The particles are sorted with an external merge sort whose runs are limited
+ * by the memory budget. The resulting cache can be used as input to all
+ * particle commands.
+ */
+class McfdCommand_reorder : public MsdfCommand
+{
+  private:
+    boost::program_options::options_description option_desc;
+    boost::program_options::positional_options_description option_pos;
+    ParticleStreamFactory streamFact;
+
+    std::string outputName;
+    int bits;
+    int64_t memBudget;
+  public:
+    McfdCommand_reorder();
+    void execute(int argc, char **argv);
+    void print_help();
+};
+
+#endif /* REORDER_H_ */
@@ -0,0 +1,95 @@
+/*
+ * tocache.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "tocache.hpp"
+#include "../columnarcache.hpp"
+#include <iostream>
+
+namespace po = boost::program_options;
+
+McfdCommand_tocache::McfdCommand_tocache()
+  : option_desc("Options for the 'tocache' command")
+{
+  option_desc.add_options()
+      ("output,o", po::value<std::string>(&outputName),"name of the cache directory (default: <input>.msdfc)")
+      ("chunk-rows", po::value<int64_t>(&chunkRows),"number of particles per stored chunk, a multiple of 16 (default: 65536)")
+      ("float", "store all columns in single precision");
+
+  streamFact.addSpecies().addMesh().addMomentum().addWeight().setProgramOptions(option_desc);
+
+  option_pos.add("input", 1);
+}
+
+void McfdCommand_tocache::execute(int argc, char **argv)
+{
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).
+            options(option_desc).positional(option_pos).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("input")<1) throw GenericException("No input file given");
+
+  if (vm.count("output")<1) outputName = vm["input"].as<std::string>() + ".msdfc";
+  if (vm.count("chunk-rows")<1) chunkRows = 65536;
+
+  pParticleStream pstream = streamFact.getParticleStream(vm);
+  int rank = pstream->getRank();
+
+  // keep the precision of the source unless single precision is requested
+  int flags[ColumnarCache::numColumns] = { pc_mesh, pc_mesh, pc_mesh, pc_px, pc_py, pc_pz, pc_weight };
+  int precision[ColumnarCache::numColumns];
+  for (int c=0; c<ColumnarCache::numColumns; ++c)
+    precision[c] = (vm.count("float")>0) ? sizeof(float) : pstream->getPrecision(flags[c]);
+
+  ColumnarCacheWriter writer(outputName, rank, pstream->isRaw(), chunkRows, precision);
+
+  int64_t total = 0;
+  int64_t smallId = 0;
+  double values[ColumnarCache::numColumns] = { 0.0 };
+
+  pstream->getNextChunks();
+  while (! pstream->eos() )
+  {
+    const ParticleChunk &chunk = pstream->getChunk();
+    int64_t count = chunk.length();
+
+    for (int64_t i=0; i<count; ++i)
+    {
+      int id = chunk.species()[i];
+      if (id < 1)
+      {
+        ++smallId;
+        continue;
+      }
+      // the cache columns are in the order of the chunk components
+      for (int c=0; c<ColumnarCache::numColumns; ++c)
+        if ((c > ColumnarCache::cc_z) || (c < rank)) values[c] = chunk.component(c)[i];
+      writer.append(id, values);
+    }
+    total += count;
+    pstream->getNextChunks();
+  }
+
+  writer.close();
+
+  if (smallId>0)
+    std::cerr << "WARNING!\n    " << smallId << " particles with species IDs < 1 have not been stored\n";
+
+  std::cout << "Converted " << total - smallId << " particles of "
+      << writer.getSpecies().size() << " species to " << outputName << "\n";
+}
+
+void McfdCommand_tocache::print_help()
+{
+  std::cout << "\n  Manipulate sdf files: convert particle data to the columnar particle cache\n\n  Usage:\n"
+        << "    msdf tocache [options] <input>\n\n"
+        << "  where <input> is the name of the sdf file, or the base name of raw files with -r.\n"
+        << "  The cache directory can be passed as input to all particle commands.\n\n";
+
+  std::cout << option_desc;
+}
@@ -0,0 +1,35 @@
+/*
+ * tocache.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef TOCACHE_H_
+#define TOCACHE_H_
+
+#include <boost/program_options.hpp>
+#include "../commands.hpp"
+#include "../particlestream.hpp"
+
+/**
+ * Converts SDF or raw particle data into the columnar particle cache in a
+ * single streaming pass.
+ */
+class McfdCommand_tocache : public MsdfCommand
+{
+  private:
+    boost::program_options::options_description option_desc;
+    boost::program_options::positional_options_description option_pos;
+    ParticleStreamFactory streamFact;
+
+    std::string outputName;
+    int64_t chunkRows;
+  public:
+    McfdCommand_tocache();
+    void execute(int argc, char **argv);
+    void print_help();
+};
+
+#endif /* TOCACHE_H_ */
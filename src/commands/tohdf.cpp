@@ -40,11 +40,7 @@ void McfdCommand_tohdf::execute(int argc, char **argv)
             options(option_desc).positional(option_pos).run(), vm);
   po::notify(vm);
 
-  if (!meshData.isValid(vm))
-  {
-    print_help();
-    exit(-1);
-  }
+  if (!meshData.isValid(vm)) throw GenericException("No input file or block given");
 
   if (vm.count("output")<1)
   {
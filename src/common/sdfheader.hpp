@@ -56,6 +56,16 @@ namespace msdf {
        */
       int32_t getNumBlocks() {return num_blocks; }
 
+      /**
+       * Get the simulation step at which the file was written
+       */
+      int32_t getStep() {return step; }
+
+      /**
+       * Get the simulation time at which the file was written
+       */
+      double getTime() {return time; }
+
     private:
       int32_t endianness;
       int32_t sdf_version;
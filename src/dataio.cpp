@@ -7,6 +7,7 @@
  */
 
 #include "dataio.hpp"
+#include "fileglob.hpp"
 
 #include <boost/make_shared.hpp>
 
@@ -151,7 +152,7 @@ void MultiMeshData::setProgramOptions(boost::program_options::options_descriptio
       ;
 
   option_pos.add("block", 1);
-  option_pos.add("input", 2);
+  option_pos.add("input", 1);
 }
 
 bool MultiMeshData::isValid(po::variables_map &vm)
@@ -174,6 +175,8 @@ void MultiMeshData::init()
     pos = nextPos+1;
   }
 
+  std::vector<std::string> files = expandGlob(inputNamePattern);
+  inputNames.assign(files.begin(), files.end());
 }
 
 void MultiMeshData::readData(
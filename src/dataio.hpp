@@ -109,6 +109,13 @@ class MultiMeshData
         std::string theBlockName
     );
 
+    const std::list<std::string> &getBlockNames() const { return blockNames; }
+    const std::list<std::string> &getInputNames() const { return inputNames; }
+    const std::string &getInputNamePattern() const { return inputNamePattern; }
+
+    /// The x, y and z indices at which the data is sliced, -1 for the axes that are kept
+    void getSlice(int slice[3]) const { slice[0] = xSlice; slice[1] = ySlice; slice[2] = zSlice; }
+
     int getRank() { return impl->getRank(); }
     int getCount() { return impl->getCount(); }
     pDataGrid1d get1dMesh(int i) { return impl->get1dMesh(i); }
@@ -8,6 +8,11 @@
 
 #include "distfunc.hpp"
 #include "particlestream.hpp"
+#include "axisbinning.hpp"
+#include "energybands.hpp"
+#include "particleaxes.hpp"
+#include "particlesampler.hpp"
+#include "tdigest.hpp"
 #include <vector>
 #include <iostream>
 #include <iomanip>
@@ -20,54 +25,22 @@
 
 namespace po = boost::program_options;
 
-inline double McfdCommand_distfunc::getValue(int axis, double px, double py, double pz, double x, double y)
+void McfdCommand_distfunc::parseNumberList(std::string s, std::vector<double> &v)
 {
-  int id;
+  typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
+  boost::char_separator<char> sep(",");
 
-  switch (axis)
+  tokenizer tokens(s, sep);
+  for (tokenizer::iterator tok_iter = tokens.begin(); tok_iter != tokens.end(); ++tok_iter)
   {
-    case 0: id = axisId;
-      break;
-    case 1: id = momentId;
-      break;
-  }
-
-  switch (id)
-  {
-    case 0: return x;
-    case 1: return y;
-    case 2: return px;
-    case 3: return py;
-    case 4: return pz;
-    case  5:
-    {
-      double p2 = px*px + py*py + pz*pz;
-      return p2/(sqrt(1+p2) + 1);
-    }
-    case  6: return px*px/(sqrt(1+px*px) + 1);
-    case  7: return py*py/(sqrt(1+py*py) + 1);
-    case  8: return pz*pz/(sqrt(1+pz*pz) + 1);
-    case  9:
-    {
-      double p2 = px*px + py*py + pz*pz;
-      return sqrt(p2)/sqrt(1+p2);
+    try {
+      v.push_back(boost::lexical_cast<double>(*tok_iter));
     }
-    case 10: return px/sqrt(1+px*px + py*py + pz*pz);
-    case 11: return py/sqrt(1+py*py + py*py + pz*pz);
-    case 12: return pz/sqrt(1+pz*pz + py*py + pz*pz);
-    case 13: return atan2(py,px);
-    case 14:
+    catch (boost::bad_lexical_cast &)
     {
-      double theta = atan2(py,px);
-      return theta*theta;
+      throw GenericException("Could not convert '" + *tok_iter + "' in list " + s);
     }
-    case 15: return sqrt(py*py+pz*pz);
-    case 16: return sqrt(px*px+pz*pz);
-    case 17: return sqrt(px*px+py*py);
-    case  100: return 1;
-    default: return x;
   }
-  
 }
 
 McfdCommand_distfunc::McfdCommand_distfunc()
@@ -76,20 +49,23 @@ McfdCommand_distfunc::McfdCommand_distfunc()
   streamFact.addMesh().addSpecies().addMomentum().addWeight().setProgramOptions(option_desc);
 
   option_desc.add_options()
-    ("axis",   po::value<std::string>(&axis),"specifies the variable to be plotted on the x-axis. Any of x,y,px,py,pz,E,Ex,Ey,Ez,v,vx,vy,vz,theta,theta2,pxt,pyt,pzt (default: 'px')")
-    ("moment", po::value<std::string>(&moment),"specifies the moment to be integrated. Any of 1,x,y,px,py,pz,E,Ex,Ey,Ez,v,vx,vy,vz,theta,theta2,pxt,pyt,pzt (default: '1')")
+    ("axis",   po::value<std::string>(&axis),"list of variables separated by commas, one distribution is computed for each in the same pass. Any of x,y,px,py,pz,E,Ex,Ey,Ez,v,vx,vy,vz,theta,theta2,pxt,pyt,pzt (default: 'px')")
+    ("moment", po::value<std::string>(&moment),"list of moments to be integrated, one for each axis. Any of 1,x,y,px,py,pz,E,Ex,Ey,Ez,v,vx,vy,vz,theta,theta2,pxt,pyt,pzt (default: '1')")
     ("xrmin", po::value<double>(&xrmin),"minimum of the x-range from which to consider particles (default: 0.0)")
     ("xrmax", po::value<double>(&xrmax),"maximum of the x-range from which to consider particles (default: 0.0)")
     ("yrmin", po::value<double>(&yrmin),"minimum of the y-range from which to consider particles (default: 0.0)")
     ("yrmax", po::value<double>(&yrmax),"maximum of the y-range from which to consider particles (default: 0.0)")
-    ("dmin", po::value<double>(&dmin),"minimum of the data range (default: 0.0)")
-    ("dmax", po::value<double>(&dmax),"maximum of the data range (default: 1.0)")
+    ("dmin", po::value<std::string>(&dminStr),"list of minima of the data range, one for each axis (default: 0.0)")
+    ("dmax", po::value<std::string>(&dmaxStr),"list of maxima of the data range, one for each axis (default: 1.0)")
     ("dim", po::value<int>(&dim),"dimensions of the output data grid or number of bins (default: 1000)")
+    ("scale", po::value<std::string>(&scaleName),"spacing of the bins, one of lin, log or adaptive. Log bins are spaced logarithmically between dmin and dmax, adaptive bins hold equal weight (default: 'lin')")
     ("east","if specified, only consider particles moving 'east', i.e. in the positive x direction")
     ("mingamma", po::value<double>(&minGamma),"minimum energy of the particles to plot (default: 0.0)")
     ("maxgamma", po::value<double>(&maxGamma),"maximum energy of the particles to plot (default: 0.0)")
+    ("bands", po::value<std::string>(&bandsStr),"gamma values separated by commas that bound energy bands, or log:<min>:<max>:<count> for logarithmic bands. One column is written per band. Replaces mingamma and maxgamma")
+    ("bootstrap", po::value<int>(&bootstrap),"number of Poisson bootstrap replicates. If non-zero, each value column is followed by a column with its standard error (default: 0)")
     ("lfactor", po::value<double>(&lfactor),"factor to multiply the lower energy particle weights by (default: 0.0). If this value is non-zero, mingamma does not act as a cut-off but as the boundary between a low-gamma and a high-gamma region of phase space.")
-    ("output,o", po::value<std::string>(&outputName),"base name of the output file. A # in the file name will be replaced with the species number. If no # is present, the species number will be appended to the file name.");
+    ("output,o", po::value<std::string>(&outputName),"base name of the output file. A # in the file name will be replaced with the species number. If no # is present, the species number will be appended to the file name. With more than one axis, a @ will be replaced with the axis name, or _<axis> is appended.");
 
   option_pos.add("input", 1);
 }
@@ -97,9 +73,10 @@ McfdCommand_distfunc::McfdCommand_distfunc()
 
 void McfdCommand_distfunc::execute(int argc, char **argv)
 {
-  double minGamma2;
-  double maxGamma2;
-  std::vector<pDataGrid1d> plots;
+  // the plots are indexed by species, axis and energy band
+  std::vector<std::vector<std::vector<pDataGrid1d> > > plots;
+  // the bootstrap replicates of each plot, bin*bootstrap + replicate
+  std::vector<std::vector<std::vector<std::vector<double> > > > replicates;
   
   int maxId = 0;
   int smallId = 0;
@@ -124,13 +101,16 @@ void McfdCommand_distfunc::execute(int argc, char **argv)
   if (vm.count("mingamma")<1) minGamma = 0.0;
   if (vm.count("maxgamma")<1) maxGamma = 0.0;
   if (vm.count("dim")<1) dim = 1000;
+  if (vm.count("scale")<1) scaleName = "lin";
+  if (vm.count("bootstrap")<1) bootstrap = 0;
+  if (bootstrap < 0) throw GenericException("The number of bootstrap replicates must not be negative");
   
   if (vm.count("xrmin")<1) xrmin = 0.0;
   if (vm.count("xrmax")<1) xrmax = 0.0;
   if (vm.count("yrmin")<1) yrmin = 0.0;
   if (vm.count("yrmax")<1) yrmax = 0.0;
-  if (vm.count("dmin")<1) dmin = 0.0;
-  if (vm.count("dmax")<1) dmax = 1.0;
+  if (vm.count("dmin")<1) dminStr = "0.0";
+  if (vm.count("dmax")<1) dmaxStr = "1.0";
   
   bool includeLowGamma = (vm.count("lfactor")>0);
   bool east = (vm.count("east")>0);
@@ -138,121 +118,218 @@ void McfdCommand_distfunc::execute(int argc, char **argv)
   limitX = !( (vm.count("xrmin")<1) && (vm.count("xrmax")<1) );
   limitY = !( (vm.count("yrmin")<1) && (vm.count("yrmax")<1) );
 
-  minGamma2 = minGamma*minGamma;
-  maxGamma2 = maxGamma*maxGamma;
-  
-  axisId = makeAxisId(axis);
-  momentId = makeAxisId(moment, true);
-  
-  // set up species arrays and calculate min and max values
-
-  pParticleStream pstream = streamFact.getParticleStream(vm);
-  if (!pstream)
+  bool useBands = (vm.count("bands")>0);
+  EnergyBands bands(minGamma, maxGamma);
+  if (useBands) bands.parse(bandsStr);
+  int numBands = bands.size();
+  if (useBands && includeLowGamma)
+    throw GenericException("--lfactor can't be combined with --bands");
+
+  // one distribution for each axis, the last moment and range apply to the remaining axes
+  std::vector<std::string> momentNames;
+  std::vector<double> dmins, dmaxs;
+  boost::split(axisNames, axis, boost::is_any_of(","));
+  boost::split(momentNames, moment, boost::is_any_of(","));
+  parseNumberList(dminStr, dmins);
+  parseNumberList(dmaxStr, dmaxs);
+  if (dmins.empty() || dmaxs.empty())
+    throw GenericException("--dmin and --dmax need at least one value");
+
+  int numAxes = axisNames.size();
+  axisIds.resize(numAxes);
+  momentIds.resize(numAxes);
+  dmins.resize(numAxes, dmins.back());
+  dmaxs.resize(numAxes, dmaxs.back());
+
+  int columns = pc_species | pc_weight;
+  for (int a=0; a<numAxes; ++a)
   {
-    print_help();
-    exit(-1);
+    axisIds[a] = makeAxisId(axisNames[a]);
+    momentIds[a] = makeAxisId(momentNames[std::min(a, int(momentNames.size())-1)], true);
+    columns |= particleColumnsForAxis(axisIds[a]) | particleColumnsForAxis(momentIds[a]);
   }
-  pstream->getNextChunks();
-
-  int i=0;
-  while (! pstream->eos() )
+  if (limitX || limitY) columns |= pc_mesh;
+  if (east) columns |= pc_px;
+  if ((minGamma > 1.0) || (maxGamma > 1.0) || useBands) columns |= pc_momentum;
+  
+  AxisBinning::Scale scale;
+  if (!AxisBinning::parseScale(scaleName, scale))
+    throw GenericException("Unknown scale " + scaleName);
+  bool adaptive = (scale == AxisBinning::adaptive);
+  std::vector<AxisBinning> fixedBinning(numAxes);
+  if (!adaptive)
+    for (int a=0; a<numAxes; ++a) fixedBinning[a] = AxisBinning(scale, dmins[a], dmaxs[a], dim);
+
+  // the bins of each species and axis, adaptive bins are found from a sketch in a first pass
+  std::vector<std::vector<AxisBinning> > binning;
+  std::vector<std::vector<TDigest> > sketches;
+
+  streamFact.setColumns(columns);
+  std::vector<int> multiplicity(bootstrap);
+  for (int pass = adaptive ? 0 : 1; pass<2; ++pass)
   {
-    GridIt1 sp_it = pstream->species->cbegin();
-    GridIt1 wg_it = pstream->weight->cbegin();
-    GridIt1 px_it = pstream->px->cbegin();
-    GridIt1 py_it = pstream->py->cbegin();
-    GridIt1 pz_it = pstream->pz->cbegin();
-    GridIt2 mesh_it = pstream->mesh->cbegin();
-    std::cout << "New Block!\n";
-
-    while (sp_it != pstream->species->cend())
+    // the bootstrap multiplicities are a function of the position in the stream
+    int64_t row = 0;
+    pParticleStream pstream = streamFact.getParticleStream(vm);
+    if (!pstream) throw GenericException("No input file given");
+    pstream->getNextChunks();
+
+    while (! pstream->eos() )
     {
+      const ParticleChunk &chunk = pstream->getChunk();
+      std::cout << "New Block!\n";
 
-      double px = *px_it;
-      double py = *py_it;
-      double pz = *pz_it;
-      double x = *mesh_it;
-      ++mesh_it;
-      double y = *mesh_it;
-    //  std::cout << i++ << ":  x=" << x << std::endl;
-      if (px<xmin) xmin=px;
-      if (px>xmax) xmax=px;
-
-      int id = *sp_it;
-      if (id > maxId)
+      for (int64_t i=0; i<chunk.length(); ++i, ++pos, ++row)
       {
-        for (int i=maxId; i<id; ++i)
-        {
-          pDataGrid1d pGrid(new DataGrid1d(GridIndex1d(dim)));
-          *pGrid = 0;
-          plots.push_back(pGrid);
-        }
-        maxId = id;
-      }
-
-      id = id-1; // get in line with C indexing
 
-      if (id < 0) ++smallId;
-      else {
-        double gamma2 = 1 + px*px + py*py + pz*pz;
-        bool plotValue = includeLowGamma;
-        double weightFactor = lfactor;
+        double px = chunk.px()[i];
+        double py = chunk.py()[i];
+        double pz = chunk.pz()[i];
+        double x = chunk.x()[i];
+        double y = (chunk.getRank() > 1) ? chunk.y()[i] : 0.0;
+        if (px<xmin) xmin=px;
+        if (px>xmax) xmax=px;
 
-        if ((gamma2 >= minGamma2) && ((maxGamma2<=1) || (gamma2 <= maxGamma2)))
+        int id = chunk.species()[i];
+        if (id > maxId)
         {
-          plotValue = true;
-          weightFactor = 1.0;
+          for (int i=maxId; i<id; ++i)
+          {
+            plots.push_back(std::vector<std::vector<pDataGrid1d> >(numAxes, std::vector<pDataGrid1d>(numBands)));
+            for (int a=0; a<numAxes; ++a)
+              for (int k=0; k<numBands; ++k)
+              {
+                pDataGrid1d pGrid(new DataGrid1d(GridIndex1d(dim)));
+                *pGrid = 0;
+                plots.back()[a][k] = pGrid;
+              }
+            replicates.push_back(std::vector<std::vector<std::vector<double> > >(numAxes,
+                std::vector<std::vector<double> >(numBands, std::vector<double>(dim*bootstrap, 0.0))));
+            binning.push_back(fixedBinning);
+            sketches.push_back(std::vector<TDigest>(adaptive ? numAxes : 0));
+          }
+          maxId = id;
         }
 
-        if ( plotValue &&
-            ( !east || (px>0)) &&
-            ( !limitX || ((x > xrmin) && (x < xrmax)) ) &&
-            ( !limitY || ((y > yrmin) && (y < yrmax)) ) )
-        {
-          double X = getValue(0,px, py, pz, x, y);
-          double Mom = getValue(1, px, py, pz, x, y);
+        id = id-1; // get in line with C indexing
 
-          double data = dim * (X - dmin)/(dmax-dmin);
-          double weight = weightFactor * (*wg_it);
+        if (id < 0) ++smallId;
+        else {
+          // gamma is shared by the band selection and all axes
+          double p2 = px*px + py*py + pz*pz;
+          double gamma = sqrt(1 + p2);
+          int band = bands.find(gamma);
+          bool plotValue = includeLowGamma;
+          double weightFactor = lfactor;
 
-          int bin = int(data);
-          double frac = data - bin;
-          if ((bin>=0.0) && (bin<dim))
+          if (band >= 0)
           {
-            DataGrid1d &grid = *plots[id];
-            grid(bin) += Mom*weight;
+            plotValue = true;
+            weightFactor = 1.0;
           }
+          else band = 0;
+
+          if ( plotValue &&
+              ( !east || (px>0)) &&
+              ( !limitX || ((x > xrmin) && (x < xrmax)) ) &&
+              ( !limitY || ((y > yrmin) && (y < yrmax)) ) )
+          {
+            double weight = weightFactor * chunk.weight()[i];
+            if (pass == 1)
+              for (int b=0; b<bootstrap; ++b) multiplicity[b] = ParticleSampler::poissonWeight(1, row, b);
+
+            for (int a=0; a<numAxes; ++a)
+            {
+              double X = ParticleAxes::value(axisIds[a], px, py, pz, x, y, p2, gamma);
+
+              if (pass == 0)
+              {
+                sketches[id][a].add(X, weight);
+                continue;
+              }
+
+              double Mom = ParticleAxes::value(momentIds[a], px, py, pz, x, y, p2, gamma);
+              double data = binning[id][a].position(X);
+
+              int bin = int(data);
+              if ((data >= 0.0) && (bin < binning[id][a].size()))
+              {
+                DataGrid1d &grid = *plots[id][a][band];
+                grid(bin) += Mom*weight;
+                if (bootstrap > 0)
+                {
+                  double *rep = &replicates[id][a][band][bin*bootstrap];
+                  for (int b=0; b<bootstrap; ++b) rep[b] += multiplicity[b]*Mom*weight;
+                }
+              }
+            }
+          }
+
+          maxPos = pos;
         }
-	
-        maxPos = pos;
       }
-      ++sp_it;
-      ++mesh_it;
-      ++px_it;
-      ++py_it;
-      ++pz_it;
-      ++wg_it;
-      ++pos;
+      pstream->getNextChunks();
     }
-    pstream->getNextChunks();
-  }
 
-  for (int id=0; id<plots.size(); ++id) {
-    std::string outputName = createOutputFile(id);
-    std::ofstream output(outputName.c_str());
-    DataGrid1d &grid = *plots[id];
-    
-    for (int i=0; i<dim; ++i)
+    if (pass == 0)
     {
-      double val = dmin + i*(dmax-dmin)/double(dim);
-      output << val << " " << grid(i) << std::endl;
+      for (size_t id=0; id<sketches.size(); ++id)
+        for (int a=0; a<numAxes; ++a)
+          if (sketches[id][a].getWeight() > 0.0) binning[id][a] = AxisBinning(sketches[id][a], dim);
+      smallId = 0;
     }
-
-    output.close();
   }
 
-  std::cout << "Successfully written " << plots.size() << " phase space plots" << std::endl;
-  std::cout << "xmin " << xmin << " xmax " << xmax << std::endl;
+  for (int id=0; id<plots.size(); ++id)
+    for (int a=0; a<numAxes; ++a)
+    {
+      std::string outputName = createOutputFile(id, a);
+      std::ofstream output(outputName.c_str());
+
+      if (useBands || (bootstrap > 0))
+      {
+        output << "# " << axisNames[a];
+        for (int k=0; k<numBands; ++k)
+        {
+          if (useBands) output << " [" << bands.getLower(k) << "," << bands.getUpper(k) << ")";
+          else output << " value";
+          if (bootstrap > 0) output << " error";
+        }
+        output << std::endl;
+      }
+
+      // non-linear bins are written at their centres and divided by their widths
+      const AxisBinning &axisBins = binning[id][a];
+      bool linear = (scale == AxisBinning::linear);
+      double dmin = dmins[a], dmax = dmaxs[a];
+      for (int i=0; i<axisBins.size(); ++i)
+      {
+        double val = linear ? dmin + i*(dmax-dmin)/double(dim) : axisBins.getCentre(i);
+        double norm = linear ? 1.0 : 1.0/axisBins.getWidth(i);
+        output << val;
+        for (int k=0; k<numBands; ++k)
+        {
+          output << " " << (*plots[id][a][k])(i)*norm;
+          if (bootstrap > 0)
+          {
+            // the standard deviation of the replicates estimates the standard error
+            const double *rep = &replicates[id][a][k][i*bootstrap];
+            double mean = 0.0, var = 0.0;
+            for (int b=0; b<bootstrap; ++b) mean += rep[b];
+            mean /= bootstrap;
+            for (int b=0; b<bootstrap; ++b) var += (rep[b] - mean)*(rep[b] - mean);
+            output << " " << sqrt(var/std::max(1, bootstrap-1))*norm;
+          }
+        }
+        output << std::endl;
+      }
+
+      output.close();
+    }
+
+  std::cout << "Successfully written " << plots.size()*numAxes << " distribution functions" << std::endl;
+  if (columns & pc_px)
+    std::cout << "xmin " << xmin << " xmax " << xmax << std::endl;
 
   if (smallId>0)
     std::cerr << "WARNING!\n    " << smallId << " species IDs found with values < 1\n";
@@ -261,28 +338,9 @@ void McfdCommand_distfunc::execute(int argc, char **argv)
 
 char McfdCommand_distfunc::makeAxisId(std::string axisStr, bool allowUnity)
 {
-  if ((axisStr == "1") && allowUnity) return 100;
-  if (axisStr == "x") return 0;
-  if (axisStr == "y") return 1;
-  if (axisStr == "px") return 2;
-  if (axisStr == "py") return 3;
-  if (axisStr == "pz") return 4;
-  if (axisStr == "E") return 5;
-  if (axisStr == "Ex") return 6;
-  if (axisStr == "Ey") return 7;
-  if (axisStr == "Ez") return 8;
-  if (axisStr == "v") return 9;
-  if (axisStr == "vx") return 10;
-  if (axisStr == "vy") return 11;
-  if (axisStr == "vz") return 12;
-  if (axisStr == "theta") return 13;
-  if (axisStr == "theta2") return 14;
-  if (axisStr == "pxt") return 15;
-  if (axisStr == "pyt") return 16;
-  if (axisStr == "pzt") return 17;
-
-  if (allowUnity) return 100;
-  else return 0;
+  int id = ParticleAxes::parseId(axisStr, allowUnity);
+  if (id >= 0) return id;
+  return allowUnity ? ParticleAxes::unity : 0;
 }
 
 void McfdCommand_distfunc::print_help()
@@ -295,13 +353,22 @@ void McfdCommand_distfunc::print_help()
   
   std::cout << "\nxrmin, xrmax, yrmin, yrmax define a region in real space to which the particles are limited.\n"
         << "  If neither xrmin nor xrmax are set, no limitations in the x-direction is made\n"
-        << "  and equivalently for yrmin and yrmax\n";
+        << "  and equivalently for yrmin and yrmax\n"
+        << "\nWith log or adaptive bins the first column holds the bin centres and the data is\n"
+        << "  divided by the bin widths. Adaptive bins need an extra pass over the data.\n"
+        << "\nWith --bootstrap the errors are estimated from replicates in which every particle is\n"
+        << "  counted a Poisson distributed number of times. Combined with --sample they give the\n"
+        << "  uncertainty of a quick look.\n";
 }
 
-std::string McfdCommand_distfunc::createOutputFile(int speciesId)
+std::string McfdCommand_distfunc::createOutputFile(int speciesId, int axisIndex)
 {
   std::string speciesIdStr = boost::lexical_cast<std::string>(speciesId);
   std::string result = boost::replace_first_copy(outputName,"#",speciesIdStr);
   if (result == outputName) result = outputName + speciesIdStr;
-  return result;
+  if (axisNames.size() < 2) return result;
+
+  std::string withAxis = boost::replace_first_copy(result,"@",axisNames[axisIndex]);
+  if (withAxis == result) withAxis = result + "_" + axisNames[axisIndex];
+  return withAxis;
 }
@@ -17,9 +17,6 @@
 class McfdCommand_distfunc: public MsdfCommand
 {
   private:
-    typedef DataGrid1d::const_storage_iterator GridIt1;
-    typedef DataGrid2d::const_storage_iterator GridIt2;
-    
     boost::program_options::options_description option_desc;
     boost::program_options::positional_options_description option_pos;
     ParticleStreamFactory streamFact;
@@ -30,7 +27,7 @@ class McfdCommand_distfunc: public MsdfCommand
 
     double xrmin, xrmax;
     double yrmin, yrmax;
-    double dmin, dmax;
+    std::string dminStr, dmaxStr;
     bool limitX;
     bool limitY;
 
@@ -38,12 +35,16 @@ class McfdCommand_distfunc: public MsdfCommand
     double maxGamma;
     double lfactor;
     int dim;
+    std::string bandsStr;
+    std::string scaleName;
+    int bootstrap;
 
-    char axisId, momentId;
+    std::vector<std::string> axisNames;
+    std::vector<char> axisIds, momentIds;
 
-    std::string createOutputFile(int speciesId);
+    std::string createOutputFile(int speciesId, int axisIndex);
     char makeAxisId(std::string axisStr, bool allowUnity=false);
-    double getValue(int axis, double px, double py, double pz, double x, double y);
+    void parseNumberList(std::string s, std::vector<double> &v);
 
   public:
     McfdCommand_distfunc();
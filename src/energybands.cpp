@@ -0,0 +1,64 @@
+/*
+ * energybands.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "energybands.hpp"
+#include "common/binaryio.hpp"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+EnergyBands::EnergyBands(double minGamma, double maxGamma)
+{
+  edges.push_back(minGamma);
+  edges.push_back((maxGamma < 1.0) ? std::numeric_limits<double>::infinity() : maxGamma);
+}
+
+void EnergyBands::parse(const std::string &spec)
+{
+  std::vector<std::string> tokens;
+  std::vector<double> values;
+  bool logRange = boost::starts_with(spec, "log:");
+  boost::split(tokens, logRange ? spec.substr(4) : spec, boost::is_any_of(logRange ? ":" : ","));
+
+  for (size_t i=0; i<tokens.size(); ++i)
+  {
+    try {
+      values.push_back(boost::lexical_cast<double>(boost::trim_copy(tokens[i])));
+    }
+    catch (boost::bad_lexical_cast &)
+    {
+      throw msdf::GenericException("Could not convert '" + tokens[i] + "' in the energy bands " + spec);
+    }
+  }
+
+  if (logRange)
+  {
+    if ((values.size() != 3) || !(values[0] > 0.0) || !(values[1] > values[0]) || (values[2] < 1))
+      throw msdf::GenericException("The energy bands " + spec + " need log:<min>:<max>:<count> with 0 < min < max");
+    int count = int(values[2]);
+    double ratio = std::log(values[1]/values[0]);
+    edges.resize(count + 1);
+    for (int k=0; k<=count; ++k) edges[k] = values[0]*std::exp(ratio*k/count);
+    edges[count] = values[1];
+    return;
+  }
+
+  if ((values.size() < 2) || (std::adjacent_find(values.begin(), values.end(), std::greater_equal<double>()) != values.end()))
+    throw msdf::GenericException("The energy bands " + spec + " need at least two increasing gamma values");
+  edges = values;
+}
+
+int EnergyBands::find(double gamma) const
+{
+  if (gamma == edges.back()) return size() - 1;
+  int k = int(std::upper_bound(edges.begin(), edges.end(), gamma) - edges.begin()) - 1;
+  return (k < size()) ? k : -1;
+}
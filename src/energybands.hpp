@@ -0,0 +1,45 @@
+/*
+ * energybands.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef ENERGYBANDS_H_
+#define ENERGYBANDS_H_
+
+#include <string>
+#include <vector>
+
+/**
+ * Contiguous bands of the Lorentz factor gamma.
+ *
+ * The bands are given by increasing edges. A particle belongs to band k if
+ * edge k <= gamma < edge k+1; the last edge belongs to the last band.
+ */
+class EnergyBands
+{
+  public:
+    /// A single band from minGamma to maxGamma, a maxGamma below 1 means no upper limit
+    EnergyBands(double minGamma = 0.0, double maxGamma = 0.0);
+
+    /**
+     * Set the bands from a list of gamma values separated by commas, or from
+     * log:<min>:<max>:<count> for count logarithmically spaced bands.
+     */
+    void parse(const std::string &spec);
+
+    int size() const { return edges.size() - 1; }
+    const std::vector<double> &getEdges() const { return edges; }
+    double getLower(int k) const { return edges[k]; }
+    double getUpper(int k) const { return edges[k+1]; }
+
+    /// The band containing gamma or -1 if gamma lies outside of all bands
+    int find(double gamma) const;
+
+  private:
+    std::vector<double> edges;
+};
+
+#endif /* ENERGYBANDS_H_ */
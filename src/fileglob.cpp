@@ -0,0 +1,130 @@
+/*
+ * fileglob.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "fileglob.hpp"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+
+namespace {
+  /// Match the character class starting at pattern[p] and set p to the position after it
+  bool matchClass(const std::string &pattern, size_t &p, char c, bool &valid)
+  {
+    size_t i = p + 1;
+    bool negate = (i < pattern.size()) && ((pattern[i] == '!') || (pattern[i] == '^'));
+    if (negate) ++i;
+
+    bool found = false;
+    bool first = true;
+    for (; i<pattern.size(); ++i)
+    {
+      if ((pattern[i] == ']') && !first) break;
+      first = false;
+      if ((i+2 < pattern.size()) && (pattern[i+1] == '-') && (pattern[i+2] != ']'))
+      {
+        if ((pattern[i] <= c) && (c <= pattern[i+2])) found = true;
+        i += 2;
+      }
+      else if (pattern[i] == c) found = true;
+    }
+
+    // an unterminated class is an ordinary character
+    valid = (i < pattern.size());
+    if (valid) p = i + 1;
+    return found != negate;
+  }
+}
+
+bool globMatch(const std::string &pattern, const std::string &name)
+{
+  size_t p = 0, n = 0;
+  // the position after the last * and the name position it is matched up to
+  size_t starP = std::string::npos, starN = 0;
+
+  while (n < name.size())
+  {
+    if (p < pattern.size())
+    {
+      char c = pattern[p];
+      if (c == '*')
+      {
+        starP = ++p;
+        starN = n;
+        continue;
+      }
+      if (c == '?')
+      {
+        ++p;
+        ++n;
+        continue;
+      }
+      if (c == '[')
+      {
+        bool valid;
+        size_t next = p;
+        bool match = matchClass(pattern, next, name[n], valid);
+        if (valid && match)
+        {
+          p = next;
+          ++n;
+          continue;
+        }
+        if (!valid && (name[n] == '['))
+        {
+          ++p;
+          ++n;
+          continue;
+        }
+      }
+      else if (c == name[n])
+      {
+        ++p;
+        ++n;
+        continue;
+      }
+    }
+
+    // backtrack and let the last * consume one more character
+    if (starP == std::string::npos) return false;
+    p = starP;
+    n = ++starN;
+  }
+
+  while ((p < pattern.size()) && (pattern[p] == '*')) ++p;
+  return p == pattern.size();
+}
+
+std::vector<std::string> expandGlob(const std::string &pattern)
+{
+  std::vector<std::string> result;
+  fs::path path(pattern);
+  std::string filePattern = path.filename().string();
+
+  if (filePattern.find_first_of("*?[") == std::string::npos)
+  {
+    if (fs::exists(path)) result.push_back(pattern);
+    return result;
+  }
+
+  fs::path dir = path.parent_path();
+  if (dir.empty()) dir = ".";
+  if (!fs::is_directory(dir)) return result;
+
+  for (fs::directory_iterator it(dir), end; it != end; ++it)
+  {
+    if (fs::is_directory(it->status())) continue;
+    std::string entry = it->path().filename().string();
+    if (globMatch(filePattern, entry))
+      result.push_back(path.parent_path().empty() ? entry : (path.parent_path() / entry).string());
+  }
+
+  std::sort(result.begin(), result.end());
+  return result;
+}
@@ -0,0 +1,28 @@
+/*
+ * fileglob.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef FILEGLOB_H_
+#define FILEGLOB_H_
+
+#include <string>
+#include <vector>
+
+/**
+ * Match a file name against a shell pattern with the wildcards *, ? and
+ * character classes such as [0-9] or [!a].
+ */
+bool globMatch(const std::string &pattern, const std::string &name);
+
+/**
+ * The files matching a pattern, sorted by name. Only the last component of
+ * the path may contain wildcards. A pattern without wildcards is returned as
+ * it is if the file exists.
+ */
+std::vector<std::string> expandGlob(const std::string &pattern);
+
+#endif /* FILEGLOB_H_ */
@@ -2,6 +2,8 @@
 
 #include "common/binaryio.hpp"
 
+#include <algorithm>
+
 HDFstream::HDFstream()
   : file_id(-1),
     status(0),
@@ -36,8 +38,15 @@ HDFstream::~HDFstream()
   close();
 }
 
+std::recursive_mutex &HDFstream::libraryMutex()
+{
+  static std::recursive_mutex mutex;
+  return mutex;
+}
+
 void HDFstream::close()
 {
+  std::lock_guard<std::recursive_mutex> lock(libraryMutex());
   if (file_id >= 0) {
     H5Fclose (file_id);
   }
@@ -88,6 +97,7 @@ int HDFistream::open(const char* fname)
 {
   close();
 
+  std::lock_guard<std::recursive_mutex> lock(libraryMutex());
   if (active)
     file_id = H5Fopen (fname, H5F_ACC_RDONLY, H5P_DEFAULT);
 
@@ -95,19 +105,43 @@ int HDFistream::open(const char* fname)
   return 1;
 }
 
+void HDFistream::readArray(std::vector<double> &data, std::vector<hsize_t> &dims)
+{
+  if (!active) return;
+  std::lock_guard<std::recursive_mutex> lock(libraryMutex());
+
+  std::string dset_name = getNextBlockName();
+  hid_t dataset = H5Dopen(file_id, dset_name.c_str(), H5P_DEFAULT);
+  if (dataset < 0) throw msdf::GenericException("Could not open HDF dataset " + dset_name);
+
+  hid_t sid = H5Dget_space(dataset);
+  int rank = H5Sget_simple_extent_ndims(sid);
+  dims.resize(std::max(rank, 0));
+  if (rank > 0) H5Sget_simple_extent_dims(sid, &dims[0], NULL);
+  H5Sclose(sid);
+
+  hsize_t size = 1;
+  for (int i=0; i<rank; ++i) size *= dims[i];
+  data.resize(size);
+
+  herr_t ret = (size > 0) ? H5Dread(dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &data[0]) : 0;
+  H5Dclose(dataset);
+  if ((rank < 0) || (ret < 0)) throw msdf::GenericException("Problems reading HDF dataset " + dset_name);
+}
+
 
 // ----------------------------------------------------------------------
 
 HDFostream::HDFostream()
-   : HDFstream()
+   : HDFstream(), blockDataset(-1)
 {}
 
 HDFostream::HDFostream(const HDFostream& hdf)
-  : HDFstream(hdf)
+  : HDFstream(hdf), blockDataset(-1)
 {}
 
 HDFostream::HDFostream(const char* fname)
-   : HDFstream()
+   : HDFstream(), blockDataset(-1)
 {
   open(fname);
 }
@@ -116,12 +150,111 @@ int HDFostream::open(const char* fname)
 {
   sets_count = 0;
   
+  std::lock_guard<std::recursive_mutex> lock(libraryMutex());
   if (active)
     file_id = H5Fcreate (fname, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
 
   return file_id;
 }
 
+void HDFostream::beginBlocks(int rank, const hsize_t *dims, const hsize_t *chunkDims, int compression)
+{
+  if (!active) return;
+  createBlockDataset(rank, dims, NULL, chunkDims, compression);
+}
+
+void HDFostream::beginExtendible(int rank, const hsize_t *dims, const hsize_t *chunkDims, int compression)
+{
+  if (!active) return;
+  if (!chunkDims) throw msdf::GenericException("Extendible HDF datasets need chunk dimensions!");
+
+  std::vector<hsize_t> start(rank, 0), maxDims(rank, H5S_UNLIMITED);
+  for (int i=1; i<rank; ++i) start[i] = maxDims[i] = dims[i-1];
+  createBlockDataset(rank, &start[0], &maxDims[0], chunkDims, compression);
+}
+
+void HDFostream::createBlockDataset(int rank, const hsize_t *dims, const hsize_t *maxDims,
+    const hsize_t *chunkDims, int compression)
+{
+  std::lock_guard<std::recursive_mutex> lock(libraryMutex());
+
+  std::string dset_name = getNextBlockName();
+  hid_t sid = H5Screate_simple(rank, dims, maxDims);
+
+  // fill the dataset with zeros when its storage is allocated, for a
+  // chunked dataset storage is only allocated for the chunks written
+  hid_t plist = H5Pcreate(H5P_DATASET_CREATE);
+  if (chunkDims)
+  {
+    H5Pset_chunk(plist, rank, chunkDims);
+    if (compression > 0)
+    {
+      H5Pset_shuffle(plist);
+      H5Pset_deflate(plist, compression);
+    }
+  }
+  double zero = 0.0;
+  H5Pset_fill_value(plist, H5T_NATIVE_DOUBLE, &zero);
+  H5Pset_fill_time(plist, H5D_FILL_TIME_ALLOC);
+
+  blockDataset = H5Dcreate(file_id, dset_name.c_str(), H5T_NATIVE_DOUBLE, sid,
+      H5P_DEFAULT, plist, H5P_DEFAULT);
+  H5Pclose(plist);
+  H5Sclose(sid);
+  if (blockDataset < 0) throw msdf::GenericException("Problems creating HDF dataset!");
+}
+
+void HDFostream::writeBlock(int rank, const double *data, const hsize_t *blockDims,
+    const hsize_t *offset, const hsize_t *count)
+{
+  if (!active) return;
+  std::lock_guard<std::recursive_mutex> lock(libraryMutex());
+
+  hsize_t memStart[H5S_MAX_RANK] = {0};
+  hid_t memSpace = H5Screate_simple(rank, blockDims, NULL);
+  H5Sselect_hyperslab(memSpace, H5S_SELECT_SET, memStart, NULL, count, NULL);
+
+  hid_t fileSpace = H5Dget_space(blockDataset);
+  H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, NULL, count, NULL);
+
+  herr_t ret = H5Dwrite(blockDataset, H5T_NATIVE_DOUBLE, memSpace, fileSpace, H5P_DEFAULT, data);
+  H5Sclose(fileSpace);
+  H5Sclose(memSpace);
+  if (ret < 0) throw msdf::GenericException("Problems writing data to HDF file!");
+}
+
+void HDFostream::appendBlock(const double *data, hsize_t count)
+{
+  if (!active) return;
+  std::lock_guard<std::recursive_mutex> lock(libraryMutex());
+
+  hid_t fileSpace = H5Dget_space(blockDataset);
+  int rank = H5Sget_simple_extent_ndims(fileSpace);
+  hsize_t dims[H5S_MAX_RANK];
+  H5Sget_simple_extent_dims(fileSpace, dims, NULL);
+  H5Sclose(fileSpace);
+
+  hsize_t offset[H5S_MAX_RANK] = {0};
+  hsize_t blockDims[H5S_MAX_RANK];
+  offset[0] = dims[0];
+  blockDims[0] = count;
+  for (int i=1; i<rank; ++i) blockDims[i] = dims[i];
+  dims[0] += count;
+
+  if (H5Dset_extent(blockDataset, dims) < 0) throw msdf::GenericException("Problems extending HDF dataset!");
+  writeBlock(rank, data, blockDims, offset, blockDims);
+}
+
+void HDFostream::endBlocks()
+{
+  if (!active || (blockDataset < 0)) return;
+  std::lock_guard<std::recursive_mutex> lock(libraryMutex());
+
+  herr_t ret = H5Dclose(blockDataset);
+  blockDataset = -1;
+  if (ret < 0) throw msdf::GenericException("Problems closing HDF dataset!");
+}
+
 // ----------------------------------------------------------------------
 
 template<>
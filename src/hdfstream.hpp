@@ -18,6 +18,8 @@
 #include <hdf5.h>
 
 #include <iostream>
+#include <mutex>
+#include <vector>
 
 
   /** @file hdfstream.h
@@ -75,6 +77,13 @@ class HDFstream {
     HDFstream& operator = (const HDFstream&);
     
     void setActive(bool active_) { active = active_; activeModified = true; }
+
+    /**
+     * The lock held during calls into the HDF5 library. The library is not
+     * thread safe unless it was built for it, and the batch command runs
+     * several commands at the same time.
+     */
+    static std::recursive_mutex &libraryMutex();
     
   protected:
     std::string getNextBlockName();
@@ -101,6 +110,9 @@ class HDFistream : public HDFstream {
     /// stream input operator for a schnek::Matrix 
     template<typename TYPE, size_t RANK, template<size_t> class Checking>
     HDFistream& operator>>(schnek::Grid<TYPE, RANK, Checking>& grid);
+
+    /// read the next dataset as doubles in row major order, the rank is the size of dims
+    void readArray(std::vector<double> &data, std::vector<hsize_t> &dims);
 };
 
 //HDFistream
@@ -124,6 +136,50 @@ class HDFostream : public HDFstream {
     /// stream output operator for a matrix
     template<typename TYPE, size_t RANK, template<size_t> class Checking>
     HDFostream& operator<< (const schnek::Grid<TYPE, RANK, Checking>& grid);
+
+    /**
+     * create the next dataset as a 2d array of doubles that is written block by block,
+     * values not written are zero. A chunked dataset only stores the chunks that are written.
+     */
+    void beginBlocks(const hsize_t dims[2], const hsize_t *chunkDims = 0)
+    {
+      beginBlocks(2, dims, chunkDims);
+    }
+
+    /**
+     * create the next dataset as an array of doubles with the given rank that is written
+     * block by block. Chunks are compressed with the deflate level compression, zero
+     * means no compression. Compression needs chunkDims.
+     */
+    void beginBlocks(int rank, const hsize_t *dims, const hsize_t *chunkDims, int compression = 0);
+
+    /// write the first count values in each direction of a block of blockDims values at offset
+    void writeBlock(const double *data, const hsize_t blockDims[2], const hsize_t offset[2], const hsize_t count[2])
+    {
+      writeBlock(2, data, blockDims, offset, count);
+    }
+
+    /// write a block of a dataset created with the given rank
+    void writeBlock(int rank, const double *data, const hsize_t *blockDims, const hsize_t *offset, const hsize_t *count);
+
+    /**
+     * create the next dataset with an unlimited first dimension that starts out
+     * empty and grows with every appendBlock. dims holds the rank-1 remaining
+     * dimensions and chunkDims the chunk size in all rank dimensions.
+     */
+    void beginExtendible(int rank, const hsize_t *dims, const hsize_t *chunkDims, int compression = 0);
+
+    /// append count rows of the first dimension to the dataset created by beginExtendible
+    void appendBlock(const double *data, hsize_t count);
+
+    /// close the dataset created by beginBlocks or beginExtendible
+    void endBlocks();
+  private:
+    /// the dataset written by writeBlock and appendBlock
+    hid_t blockDataset;
+
+    void createBlockDataset(int rank, const hsize_t *dims, const hsize_t *maxDims,
+        const hsize_t *chunkDims, int compression);
 };
 
 template<typename TYPE>
@@ -6,6 +6,7 @@ template<typename TYPE, size_t RANK, template<size_t> class Checking>
 HDFistream& HDFistream::operator>>(schnek::Grid<TYPE, RANK, Checking>& grid)
 {
   if (!active) return *this;
+  std::lock_guard<std::recursive_mutex> lock(libraryMutex());
 
   std::string dset_name = getNextBlockName();
 
@@ -45,6 +46,7 @@ template<typename TYPE, size_t RANK, template<size_t> class Checking>
 HDFostream& HDFostream::operator<< (const schnek::Grid<TYPE, RANK, Checking>& grid)
 {
   if (!active) return *this;
+  std::lock_guard<std::recursive_mutex> lock(libraryMutex());
 
   std::string dset_name = getNextBlockName();
   
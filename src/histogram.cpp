@@ -0,0 +1,236 @@
+/*
+ * histogram.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "histogram.hpp"
+#include "hdfstream.hpp"
+
+#include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <iostream>
+
+namespace {
+  const int64_t blockBytes = Histogram2d::blockSize*Histogram2d::blockSize*sizeof(double);
+
+  bool isZero(const double *block)
+  {
+    for (int k=0; k<Histogram2d::blockSize*Histogram2d::blockSize; ++k)
+      if (block[k] != 0.0) return false;
+    return true;
+  }
+}
+
+//===========================================================
+//=================    Histogram2d    =================
+//===========================================================
+
+pHistogram2d Histogram2d::create(Storage storage, int xdim, int ydim)
+{
+  if (storage == tiled) return pHistogram2d(new TiledHistogram2d(xdim, ydim));
+  if (storage == sparse) return pHistogram2d(new SparseHistogram2d(xdim, ydim));
+  return pHistogram2d(new DenseHistogram2d(xdim, ydim));
+}
+
+int64_t Histogram2d::initialBytes(Storage storage, int xdim, int ydim)
+{
+  if (storage == dense) return int64_t(xdim)*ydim*sizeof(double);
+  if (storage == sparse) return 0;
+
+  int64_t tilesX = (xdim + TiledHistogram2d::tileSize - 1)/TiledHistogram2d::tileSize;
+  int64_t tilesY = (ydim + TiledHistogram2d::tileSize - 1)/TiledHistogram2d::tileSize;
+  return tilesX*tilesY*sizeof(DoubleVector);
+}
+
+bool Histogram2d::parseStorage(const std::string &name, Storage &storage)
+{
+  if (name == "dense") storage = dense;
+  else if (name == "tiled") storage = tiled;
+  else if (name == "sparse") storage = sparse;
+  else if (name == "auto") return false;
+  else throw msdf::GenericException("Unknown histogram storage '" + name + "'");
+  return true;
+}
+
+Histogram2d::Storage Histogram2d::chooseStorage(int count, int xdim, int ydim, int64_t maxEntries)
+{
+  int64_t denseBytes = count*initialBytes(dense, xdim, ydim);
+  if (denseBytes <= MemoryBudget::getAvailable()/4*3) return dense;
+
+  // in the worst case every deposited bin lies in a tile or entry of its own
+  int64_t tiledBytes = count*initialBytes(tiled, xdim, ydim)
+      + std::min(denseBytes, maxEntries*blockBytes);
+  int64_t sparseBytes = maxEntries*SparseHistogram2d::entryBytes;
+  Storage storage = (sparseBytes < tiledBytes) ? sparse : tiled;
+  int64_t worstBytes = std::min(sparseBytes, tiledBytes);
+
+  // tiles are only allocated when they are touched, at least one per histogram
+  if (storage == tiled)
+    MemoryBudget::require(count*(initialBytes(tiled, xdim, ydim) + blockBytes), "the tile index of "
+        + boost::lexical_cast<std::string>(count) + " histograms of "
+        + boost::lexical_cast<std::string>(xdim) + "x" + boost::lexical_cast<std::string>(ydim)
+        + " bins (dense storage: " + MemoryBudget::formatBytes(denseBytes) + ")");
+
+  std::cerr << "Dense histograms need " << MemoryBudget::formatBytes(denseBytes)
+      << ", using " << ((storage == tiled) ? "tiled" : "sparse") << " storage (at most "
+      << MemoryBudget::formatBytes(worstBytes) << ")\n";
+  if (worstBytes > MemoryBudget::getAvailable())
+    std::cerr << "WARNING!\n    The histograms may exceed the memory budget of "
+        << MemoryBudget::formatBytes(MemoryBudget::getLimit()) << "\n";
+  return storage;
+}
+
+void Histogram2d::beginBlocks(HDFostream &output, bool chunked) const
+{
+  hsize_t dims[2] = { hsize_t(xdim), hsize_t(ydim) };
+  hsize_t chunkDims[2] = { std::min(hsize_t(blockSize), dims[0]),
+                           std::min(hsize_t(blockSize), dims[1]) };
+  output.beginBlocks(dims, chunked ? chunkDims : 0);
+}
+
+void Histogram2d::writeBlock(HDFostream &output, const double *block, int i, int j) const
+{
+  hsize_t blockDims[2] = { blockSize, blockSize };
+  hsize_t offset[2] = { hsize_t(i), hsize_t(j) };
+  hsize_t count[2] = { hsize_t(std::min(blockSize, xdim - i)),
+                       hsize_t(std::min(blockSize, ydim - j)) };
+  output.writeBlock(block, blockDims, offset, count);
+}
+
+//===========================================================
+//=================    DenseHistogram2d    =================
+//===========================================================
+
+DenseHistogram2d::DenseHistogram2d(int xdim, int ydim)
+  : Histogram2d(xdim, ydim),
+    reservation(initialBytes(dense, xdim, ydim), "dense histograms"),
+    grid(GridIndex2d(xdim,ydim))
+{
+  grid = 0;
+}
+
+void DenseHistogram2d::write(HDFostream &output, bool chunked) const
+{
+  if (!chunked)
+  {
+    output << grid;
+    return;
+  }
+
+  DoubleVector block(blockSize*blockSize);
+  beginBlocks(output, true);
+  for (int i0=0; i0<xdim; i0+=blockSize)
+    for (int j0=0; j0<ydim; j0+=blockSize)
+    {
+      std::fill(block.begin(), block.end(), 0.0);
+      for (int i=i0; i<std::min(i0+blockSize, xdim); ++i)
+        for (int j=j0; j<std::min(j0+blockSize, ydim); ++j)
+          block[(i-i0)*blockSize + j-j0] = grid(i,j);
+      if (!isZero(&block[0])) writeBlock(output, &block[0], i0, j0);
+    }
+  output.endBlocks();
+}
+
+//===========================================================
+//=================    TiledHistogram2d    =================
+//===========================================================
+
+TiledHistogram2d::TiledHistogram2d(int xdim, int ydim)
+  : Histogram2d(xdim, ydim),
+    reservation(initialBytes(tiled, xdim, ydim), "the tile index of the histograms"),
+    tilesX((xdim + tileSize - 1)/tileSize),
+    tilesY((ydim + tileSize - 1)/tileSize),
+    tileCount(0),
+    tiles(int64_t(tilesX)*tilesY)
+{}
+
+void TiledHistogram2d::allocateTile(DoubleVector &tile)
+{
+  reservation.grow(blockBytes, "histogram tiles");
+  tile.assign(tileSize*tileSize, 0.0);
+  ++tileCount;
+}
+
+double TiledHistogram2d::get(int i, int j) const
+{
+  const DoubleVector &tile = tiles[(i/tileSize)*tilesY + j/tileSize];
+  if (tile.empty()) return 0.0;
+  return tile[(i%tileSize)*tileSize + j%tileSize];
+}
+
+void TiledHistogram2d::write(HDFostream &output, bool chunked) const
+{
+  beginBlocks(output, chunked);
+  for (int tx=0; tx<tilesX; ++tx)
+    for (int ty=0; ty<tilesY; ++ty)
+    {
+      const DoubleVector &tile = tiles[int64_t(tx)*tilesY + ty];
+      if (!tile.empty()) writeBlock(output, &tile[0], tx*tileSize, ty*tileSize);
+    }
+  output.endBlocks();
+}
+
+//===========================================================
+//=================    SparseHistogram2d    =================
+//===========================================================
+
+SparseHistogram2d::SparseHistogram2d(int xdim, int ydim)
+  : Histogram2d(xdim, ydim),
+    reservedEntries(0)
+{}
+
+void SparseHistogram2d::reserveEntries()
+{
+  const int64_t entriesPerReservation = 4096;
+  reservation.grow(entriesPerReservation*entryBytes, "sparse histogram bins");
+  reservedEntries += entriesPerReservation;
+}
+
+double SparseHistogram2d::get(int i, int j) const
+{
+  std::unordered_map<int64_t, double>::const_iterator it = bins.find(int64_t(i)*ydim + j);
+  return (it == bins.end()) ? 0.0 : it->second;
+}
+
+void SparseHistogram2d::write(HDFostream &output, bool chunked) const
+{
+  // sort the bins by block so that each block is assembled once
+  struct Entry { int64_t block; int64_t bin; double value; };
+  int blocksY = (ydim + blockSize - 1)/blockSize;
+  BudgetReservation sortReservation(bins.size()*sizeof(Entry), "sorting the sparse histogram bins");
+  std::vector<Entry> entries;
+  entries.reserve(bins.size());
+  for (std::unordered_map<int64_t, double>::const_iterator it = bins.begin(); it != bins.end(); ++it)
+  {
+    int i = it->first / ydim;
+    int j = it->first % ydim;
+    Entry e = { int64_t(i/blockSize)*blocksY + j/blockSize, it->first, it->second };
+    entries.push_back(e);
+  }
+  std::sort(entries.begin(), entries.end(),
+      [](const Entry &a, const Entry &b) { return a.block < b.block; });
+
+  DoubleVector block(blockSize*blockSize, 0.0);
+  beginBlocks(output, chunked);
+  for (size_t first=0; first<entries.size(); )
+  {
+    size_t last = first;
+    for (; (last<entries.size()) && (entries[last].block == entries[first].block); ++last)
+    {
+      int i = entries[last].bin / ydim;
+      int j = entries[last].bin % ydim;
+      block[(i%blockSize)*blockSize + j%blockSize] = entries[last].value;
+    }
+
+    int i0 = int(entries[first].block / blocksY)*blockSize;
+    int j0 = int(entries[first].block % blocksY)*blockSize;
+    writeBlock(output, &block[0], i0, j0);
+
+    std::fill(block.begin(), block.end(), 0.0);
+    first = last;
+  }
+  output.endBlocks();
+}
@@ -0,0 +1,171 @@
+/*
+ * histogram.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+#include "msdf.hpp"
+#include "memorybudget.hpp"
+
+#include <boost/shared_ptr.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class HDFostream;
+
+/**
+ * A two dimensional histogram that is accumulated bin by bin and written to
+ * an HDF file as a data set of xdim*ydim values.
+ *
+ * The storage is accounted for in the MemoryBudget.
+ */
+class Histogram2d
+{
+  public:
+    enum Storage { dense, tiled, sparse };
+
+    /// The side length of the square blocks in which histograms are written
+    static const int blockSize = 64;
+
+    Histogram2d(int xdim_, int ydim_) : xdim(xdim_), ydim(ydim_) {}
+    virtual ~Histogram2d() {}
+
+    int getXDim() const { return xdim; }
+    int getYDim() const { return ydim; }
+
+    virtual void add(int i, int j, double value) = 0;
+    virtual double get(int i, int j) const = 0;
+
+    /**
+     * Write the histogram as the next data set of the HDF file. A chunked
+     * data set is divided into chunks of blockSize*blockSize values and only
+     * the chunks that contain non-zero values are stored.
+     */
+    virtual void write(HDFostream &output, bool chunked) const = 0;
+
+    /// The bytes held by the histogram
+    virtual int64_t getBytes() const = 0;
+
+    /// Create a histogram with all bins set to zero
+    static boost::shared_ptr<Histogram2d> create(Storage storage, int xdim, int ydim);
+
+    /**
+     * Choose the storage of count histograms into which at most maxEntries
+     * bins are deposited in total. Dense storage is used if it fits into
+     * three quarters of the available memory budget, the rest is left for
+     * the particle chunks. Otherwise the storage with the smaller worst case
+     * is chosen. Throws if even the smallest storage can't fit.
+     */
+    static Storage chooseStorage(int count, int xdim, int ydim, int64_t maxEntries);
+
+    /// Parse the name of a storage, "auto" is returned as false
+    static bool parseStorage(const std::string &name, Storage &storage);
+
+    /// The bytes that a histogram with the given storage holds before the first value is added
+    static int64_t initialBytes(Storage storage, int xdim, int ydim);
+  protected:
+    int xdim, ydim;
+
+    /// Start a data set that is written block by block, values not written are zero
+    void beginBlocks(HDFostream &output, bool chunked) const;
+    /// Write one block of blockSize*blockSize values whose first bin is (i,j)
+    void writeBlock(HDFostream &output, const double *block, int i, int j) const;
+};
+
+typedef boost::shared_ptr<Histogram2d> pHistogram2d;
+
+/**
+ * A histogram that holds all bins in one grid.
+ */
+class DenseHistogram2d : public Histogram2d
+{
+  private:
+    BudgetReservation reservation;
+    DataGrid2d grid;
+  public:
+    DenseHistogram2d(int xdim, int ydim);
+
+    void add(int i, int j, double value) { grid(i,j) += value; }
+    double get(int i, int j) const { return grid(i,j); }
+    void write(HDFostream &output, bool chunked) const;
+    int64_t getBytes() const { return reservation.getBytes(); }
+};
+
+/**
+ * A histogram that is divided into square tiles which are allocated when a
+ * value is first added to them.
+ *
+ * Phase space plots at high resolution are mostly empty, so most tiles are
+ * never allocated. Tiles that were not touched are written as zeros.
+ */
+class TiledHistogram2d : public Histogram2d
+{
+  public:
+    /// The number of bins along each side of a tile
+    static const int tileSize = blockSize;
+
+    TiledHistogram2d(int xdim, int ydim);
+
+    void add(int i, int j, double value)
+    {
+      DoubleVector &tile = tiles[(i/tileSize)*tilesY + j/tileSize];
+      if (tile.empty()) allocateTile(tile);
+      tile[(i%tileSize)*tileSize + j%tileSize] += value;
+    }
+
+    double get(int i, int j) const;
+    void write(HDFostream &output, bool chunked) const;
+    int64_t getBytes() const { return reservation.getBytes(); }
+
+    /// The number of tiles that have been allocated
+    int64_t getTileCount() const { return tileCount; }
+  private:
+    BudgetReservation reservation;
+    int tilesX, tilesY;
+    int64_t tileCount;
+    std::vector<DoubleVector> tiles;
+
+    void allocateTile(DoubleVector &tile);
+};
+
+/**
+ * A histogram that keeps the non-zero bins in a hash map.
+ *
+ * Each bin costs several times the memory of a dense bin, so this is only
+ * worth it when few bins are touched, e.g. for few particles on a fine grid.
+ */
+class SparseHistogram2d : public Histogram2d
+{
+  public:
+    /// The estimated bytes of one entry of the hash map, including its bucket
+    static const int64_t entryBytes = 48;
+
+    SparseHistogram2d(int xdim, int ydim);
+
+    void add(int i, int j, double value)
+    {
+      bins[int64_t(i)*ydim + j] += value;
+      if (int64_t(bins.size()) > reservedEntries) reserveEntries();
+    }
+
+    double get(int i, int j) const;
+    void write(HDFostream &output, bool chunked) const;
+    int64_t getBytes() const { return reservation.getBytes(); }
+
+    /// The number of bins that have been touched
+    int64_t getEntryCount() const { return bins.size(); }
+  private:
+    BudgetReservation reservation;
+    int64_t reservedEntries;
+    std::unordered_map<int64_t, double> bins;
+
+    void reserveEntries();
+};
+
+#endif /* HISTOGRAM_H_ */
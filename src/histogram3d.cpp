@@ -0,0 +1,244 @@
+/*
+ * histogram3d.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "histogram3d.hpp"
+#include "hdfstream.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  const int brickCells = Histogram3d::brickSize*Histogram3d::brickSize*Histogram3d::brickSize;
+
+  bool isZero(const double *brick)
+  {
+    for (int k=0; k<brickCells; ++k)
+      if (brick[k] != 0.0) return false;
+    return true;
+  }
+}
+
+Histogram3d::Histogram3d(Storage storage_, int xdim, int ydim, int zdim)
+  : storage(storage_), reservedEntries(0)
+{
+  dims[0] = xdim;
+  dims[1] = ydim;
+  dims[2] = zdim;
+  for (int d=0; d<3; ++d)
+  {
+    if (dims[d] < 2) throw msdf::GenericException("A 3d histogram needs at least two bins in each direction");
+    bricks[d] = (dims[d] + brickSize - 1)/brickSize;
+  }
+
+  if (storage == tiled)
+  {
+    int64_t count = int64_t(bricks[0])*bricks[1]*bricks[2];
+    reservation.grow(count*sizeof(DoubleVector), "the brick index of the 3d histograms");
+    brickData.resize(count);
+  }
+  else rows.resize(bricks[0]);
+}
+
+bool Histogram3d::parseStorage(const std::string &name, Storage &storage)
+{
+  if (name == "tiled") storage = tiled;
+  else if (name == "sparse") storage = sparse;
+  else return false;
+  return true;
+}
+
+bool Histogram3d::locate(const double *const *pos, int64_t i, int *bin, double *frac) const
+{
+  for (int d=0; d<3; ++d)
+  {
+    double p = pos[d][i];
+    if (!((p >= 0.0) && (p <= dims[d]))) return false;
+    bin[d] = int(p);
+    frac[d] = p - bin[d];
+    if (bin[d] >= dims[d]-1) { bin[d] = dims[d]-2; frac[d] = 1.0; }
+  }
+  return true;
+}
+
+void Histogram3d::deposit(int64_t count, const double *const *pos, const double *value, int numThreads)
+{
+  // sort the particles by the brick rows they touch, keeping the stream order in each row
+  rowBegin.assign(bricks[0] + 1, 0);
+  for (int64_t i=0; i<count; ++i)
+  {
+    int bin[3];
+    double frac[3];
+    if (!locate(pos, i, bin, frac)) continue;
+    int first = bin[0]/brickSize, last = (bin[0]+1)/brickSize;
+    ++rowBegin[first+1];
+    if (last != first) ++rowBegin[last+1];
+
+    if (storage != tiled) continue;
+    for (int a=0; a<2; ++a)
+      for (int b=0; b<2; ++b)
+        for (int c=0; c<2; ++c)
+        {
+          DoubleVector &brick = brickData[brickIndex(bin[0]+a, bin[1]+b, bin[2]+c)];
+          if (brick.empty())
+          {
+            reservation.grow(brickCells*sizeof(double), "3d histogram bricks");
+            brick.assign(brickCells, 0.0);
+          }
+        }
+  }
+  for (int r=0; r<bricks[0]; ++r) rowBegin[r+1] += rowBegin[r];
+
+  rowParticles.resize(rowBegin[bricks[0]]);
+  std::vector<int64_t> fill(rowBegin.begin(), rowBegin.end()-1);
+  for (int64_t i=0; i<count; ++i)
+  {
+    int bin[3];
+    double frac[3];
+    if (!locate(pos, i, bin, frac)) continue;
+    int first = bin[0]/brickSize, last = (bin[0]+1)/brickSize;
+    rowParticles[fill[first]++] = i;
+    if (last != first) rowParticles[fill[last]++] = i;
+  }
+
+  parallelFor(bricks[0], numThreads, [&](int r)
+  {
+    for (int64_t p=rowBegin[r]; p<rowBegin[r+1]; ++p)
+    {
+      int64_t i = rowParticles[p];
+      int bin[3];
+      double frac[3];
+      locate(pos, i, bin, frac);
+      addToRow(r, bin, frac, value[i]);
+    }
+  });
+
+  if (storage == sparse)
+  {
+    int64_t entries = 0;
+    for (int r=0; r<bricks[0]; ++r) entries += rows[r].size();
+    if (entries > reservedEntries)
+    {
+      reservation.grow((entries - reservedEntries)*entryBytes, "sparse 3d histogram bins");
+      reservedEntries = entries;
+    }
+  }
+}
+
+void Histogram3d::addToRow(int row, const int *bin, const double *frac, double value)
+{
+  double wx[2] = { 1.0 - frac[0], frac[0] };
+  double wy[2] = { 1.0 - frac[1], frac[1] };
+  double wz[2] = { 1.0 - frac[2], frac[2] };
+
+  for (int a=0; a<2; ++a)
+  {
+    int i = bin[0] + a;
+    if (i/brickSize != row) continue;
+    for (int b=0; b<2; ++b)
+      for (int c=0; c<2; ++c)
+      {
+        int j = bin[1] + b;
+        int k = bin[2] + c;
+        double w = value*wx[a]*wy[b]*wz[c];
+        if (storage == tiled)
+        {
+          DoubleVector &brick = brickData[brickIndex(i, j, k)];
+          brick[((i%brickSize)*brickSize + j%brickSize)*brickSize + k%brickSize] += w;
+        }
+        else if (w != 0.0) rows[row][(int64_t(i)*dims[1] + j)*dims[2] + k] += w;
+      }
+  }
+}
+
+double Histogram3d::get(int i, int j, int k) const
+{
+  if (storage == tiled)
+  {
+    const DoubleVector &brick = brickData[brickIndex(i, j, k)];
+    if (brick.empty()) return 0.0;
+    return brick[((i%brickSize)*brickSize + j%brickSize)*brickSize + k%brickSize];
+  }
+  const std::unordered_map<int64_t, double> &row = rows[i/brickSize];
+  std::unordered_map<int64_t, double>::const_iterator it = row.find((int64_t(i)*dims[1] + j)*dims[2] + k);
+  return (it == row.end()) ? 0.0 : it->second;
+}
+
+int64_t Histogram3d::getStoredCount() const
+{
+  int64_t stored = 0;
+  if (storage == tiled)
+    for (size_t b=0; b<brickData.size(); ++b) stored += brickData[b].empty() ? 0 : 1;
+  else
+    for (size_t r=0; r<rows.size(); ++r) stored += rows[r].size();
+  return stored;
+}
+
+void Histogram3d::write(HDFostream &output, int compression) const
+{
+  hsize_t fileDims[3], chunkDims[3];
+  hsize_t blockDims[3] = { brickSize, brickSize, brickSize };
+  for (int d=0; d<3; ++d)
+  {
+    fileDims[d] = dims[d];
+    chunkDims[d] = std::min(hsize_t(brickSize), fileDims[d]);
+  }
+  output.beginBlocks(3, fileDims, chunkDims, compression);
+
+  auto writeBrick = [&](const double *brick, int64_t b)
+  {
+    int origin[3] = { int(b/(int64_t(bricks[1])*bricks[2]))*brickSize,
+                      int((b/bricks[2]) % bricks[1])*brickSize,
+                      int(b % bricks[2])*brickSize };
+    hsize_t offset[3], count[3];
+    for (int d=0; d<3; ++d)
+    {
+      offset[d] = origin[d];
+      count[d] = std::min(brickSize, dims[d] - origin[d]);
+    }
+    output.writeBlock(3, brick, blockDims, offset, count);
+  };
+
+  if (storage == tiled)
+  {
+    for (size_t b=0; b<brickData.size(); ++b)
+      if (!brickData[b].empty() && !isZero(&brickData[b][0])) writeBrick(&brickData[b][0], b);
+    output.endBlocks();
+    return;
+  }
+
+  // assemble the bricks of each row from its bins sorted by brick
+  struct Entry { int64_t brick; int offset; double value; };
+  DoubleVector brick(brickCells, 0.0);
+  std::vector<Entry> entries;
+  for (int r=0; r<bricks[0]; ++r)
+  {
+    entries.clear();
+    for (std::unordered_map<int64_t, double>::const_iterator it = rows[r].begin(); it != rows[r].end(); ++it)
+    {
+      int k = it->first % dims[2];
+      int j = (it->first/dims[2]) % dims[1];
+      int i = it->first/(int64_t(dims[1])*dims[2]);
+      Entry e = { brickIndex(i, j, k), ((i%brickSize)*brickSize + j%brickSize)*brickSize + k%brickSize, it->second };
+      entries.push_back(e);
+    }
+    std::sort(entries.begin(), entries.end(),
+        [](const Entry &a, const Entry &b) { return a.brick < b.brick; });
+
+    for (size_t first=0; first<entries.size(); )
+    {
+      size_t last = first;
+      for (; (last<entries.size()) && (entries[last].brick == entries[first].brick); ++last)
+        brick[entries[last].offset] = entries[last].value;
+      writeBrick(&brick[0], entries[first].brick);
+      std::fill(brick.begin(), brick.end(), 0.0);
+      first = last;
+    }
+  }
+  output.endBlocks();
+}
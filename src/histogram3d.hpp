@@ -0,0 +1,98 @@
+/*
+ * histogram3d.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef HISTOGRAM3D_H_
+#define HISTOGRAM3D_H_
+
+#include "msdf.hpp"
+#include "memorybudget.hpp"
+
+#include <boost/shared_ptr.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class HDFostream;
+
+/**
+ * A three dimensional histogram that is divided into cubic bricks.
+ *
+ * With tiled storage a brick is allocated when a value is first added to it,
+ * with sparse storage the non-zero bins are kept in one hash map per row of
+ * bricks along x. Phase space histograms in three dimensions are mostly
+ * empty, so only a small fraction of the bins is ever stored. The storage is
+ * accounted for in the MemoryBudget.
+ */
+class Histogram3d
+{
+  public:
+    enum Storage { tiled, sparse };
+
+    /// The number of bins along each side of a brick, also the chunk size of the HDF data set
+    static const int brickSize = 16;
+
+    /// The estimated bytes of one entry of a sparse hash map, including its bucket
+    static const int64_t entryBytes = 48;
+
+    Histogram3d(Storage storage_, int xdim, int ydim, int zdim);
+
+    /// Parse tiled or sparse
+    static bool parseStorage(const std::string &name, Storage &storage);
+
+    int getDim(int d) const { return dims[d]; }
+
+    /**
+     * Deposit count particles at the continuous bin coordinates pos[d][i]
+     * onto the eight surrounding bins with linear weights. Particles outside
+     * of [0,dim] in any direction are skipped.
+     *
+     * Bricks are allocated before the threads start. Each thread then owns
+     * whole rows of bricks along x, so no bin has more than one writer and the
+     * result doesn't depend on the number of threads.
+     */
+    void deposit(int64_t count, const double *const *pos, const double *value, int numThreads);
+
+    double get(int i, int j, int k) const;
+
+    /**
+     * Write the histogram as the next data set of the HDF file. The data set
+     * is chunked into bricks and only non-empty bricks are stored, deflated
+     * with the given level if compression is positive.
+     */
+    void write(HDFostream &output, int compression) const;
+
+    int64_t getBytes() const { return reservation.getBytes(); }
+
+    /// The number of allocated bricks or the number of stored bins
+    int64_t getStoredCount() const;
+  private:
+    Storage storage;
+    int dims[3];
+    int bricks[3];
+    BudgetReservation reservation;
+    int64_t reservedEntries;
+
+    /// The bricks of tiled storage
+    std::vector<DoubleVector> brickData;
+    /// The bins of sparse storage, one map for each row of bricks along x
+    std::vector<std::unordered_map<int64_t, double> > rows;
+
+    /// Scratch space sorting the particles by brick row
+    std::vector<int64_t> rowBegin, rowParticles;
+
+    bool locate(const double *const *pos, int64_t i, int *bin, double *frac) const;
+    void addToRow(int row, const int *bin, const double *frac, double value);
+    int64_t brickIndex(int i, int j, int k) const
+    {
+      return (int64_t(i/brickSize)*bricks[1] + j/brickSize)*bricks[2] + k/brickSize;
+    }
+};
+
+typedef boost::shared_ptr<Histogram3d> pHistogram3d;
+
+#endif /* HISTOGRAM3D_H_ */
@@ -31,11 +31,7 @@ void McfdCommand_ls::execute(int argc, char **argv)
             options(option_desc).positional(option_pos).run(), vm);
   po::notify(vm);
 
-  if (vm.count("file")<1)
-  {
-    print_help();
-    exit(-1);
-  }
+  if (vm.count("file")<1) throw GenericException("No input file given");
 
   pIstream iStream( new std::fstream(fileName.c_str()) );
 
@@ -0,0 +1,129 @@
+/*
+ * memorybudget.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef MEMORYBUDGET_H_
+#define MEMORYBUDGET_H_
+
+#include "common/binaryio.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+
+/**
+ * Accounts for the large allocations of a command against the budget given
+ * with --mem-budget.
+ *
+ * Chunk buffers, stream buffers and accumulators reserve their bytes before
+ * allocating and release them when they are freed. Without a limit the
+ * bytes are counted but any reservation succeeds. Commands query the
+ * available memory to choose their storage and call require() before they
+ * start work that can't fit, so that they fail early with an estimate
+ * instead of being killed half way through.
+ */
+class MemoryBudget
+{
+  public:
+    /// Set the limit in bytes, 0 removes the limit
+    static void setLimit(int64_t bytes) { counters().limit = bytes; }
+    static int64_t getLimit() { return counters().limit; }
+    static bool isLimited() { return counters().limit > 0; }
+
+    static int64_t getUsed() { return counters().used; }
+    static int64_t getPeak() { return counters().peak; }
+
+    /// The bytes that can still be reserved
+    static int64_t getAvailable()
+    {
+      if (!isLimited()) return std::numeric_limits<int64_t>::max();
+      return std::max(int64_t(0), getLimit() - getUsed());
+    }
+
+    /// Throw if the given number of bytes can't be reserved
+    static void require(int64_t bytes, const std::string &purpose)
+    {
+      if (bytes > getAvailable()) throw msdf::GenericException(exceededMessage(bytes, purpose));
+    }
+
+    /// Account for an allocation, throws if it exceeds the limit
+    static void reserve(int64_t bytes, const char *purpose)
+    {
+      Counters &c = counters();
+      int64_t used = c.used += bytes;
+      if ((c.limit > 0) && (used > c.limit))
+      {
+        c.used -= bytes;
+        throw msdf::GenericException(exceededMessage(bytes, purpose));
+      }
+      int64_t peak = c.peak;
+      while ((used > peak) && !c.peak.compare_exchange_weak(peak, used)) {}
+    }
+
+    static void release(int64_t bytes) { counters().used -= bytes; }
+
+    /// A number of bytes in human readable units
+    static std::string formatBytes(int64_t bytes)
+    {
+      std::ostringstream str;
+      if (bytes < 1024) str << bytes << " bytes";
+      else if (bytes < 1024*1024) str << std::fixed << std::setprecision(1) << bytes/1024.0 << " KB";
+      else if (bytes < int64_t(1024)*1024*1024)
+        str << std::fixed << std::setprecision(1) << bytes/(1024.0*1024.0) << " MB";
+      else str << std::fixed << std::setprecision(2) << bytes/(1024.0*1024.0*1024.0) << " GB";
+      return str.str();
+    }
+  private:
+    struct Counters
+    {
+      std::atomic<int64_t> limit;
+      std::atomic<int64_t> used;
+      std::atomic<int64_t> peak;
+    };
+
+    static Counters &counters()
+    {
+      static Counters c = { {0}, {0}, {0} };
+      return c;
+    }
+
+    static std::string exceededMessage(int64_t bytes, const std::string &purpose)
+    {
+      return "Memory budget of " + formatBytes(getLimit()) + " exceeded: "
+          + purpose + " need " + formatBytes(bytes) + " but only "
+          + formatBytes(getAvailable()) + " are available ("
+          + formatBytes(getUsed()) + " in use). Increase --mem-budget or reduce the size of the task.";
+    }
+};
+
+/**
+ * Holds a reservation in the memory budget for the lifetime of an object.
+ */
+class BudgetReservation : private boost::noncopyable
+{
+  private:
+    int64_t bytes;
+  public:
+    BudgetReservation() : bytes(0) {}
+    BudgetReservation(int64_t bytes_, const char *purpose) : bytes(0) { grow(bytes_, purpose); }
+    ~BudgetReservation() { MemoryBudget::release(bytes); }
+
+    void grow(int64_t more, const char *purpose)
+    {
+      MemoryBudget::reserve(more, purpose);
+      bytes += more;
+    }
+
+    int64_t getBytes() const { return bytes; }
+};
+
+#endif /* MEMORYBUDGET_H_ */
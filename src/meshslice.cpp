@@ -0,0 +1,100 @@
+/*
+ * meshslice.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "meshslice.hpp"
+#include "common/binaryio.hpp"
+
+#include <fstream>
+
+MeshSlice::MeshSlice(const std::string &fileName_, int64_t dataOffset_, int precision_,
+    int rank, const int64_t meshDims_[3], const int slice_[3])
+  : fileName(fileName_), dataOffset(dataOffset_), precision(precision_)
+{
+  if ((precision != 4) && (precision != 8))
+    throw msdf::GenericException("Only single and double precision meshes can be sliced!");
+
+  const char *axes = "xyz";
+  for (int i=0; i<3; ++i)
+  {
+    // axes beyond the rank of the mesh have a single point
+    meshDims[i] = (i < rank) ? meshDims_[i] : 1;
+    slice[i] = (i < rank) ? slice_[i] : 0;
+    if ((i >= rank) && (slice_[i] > 0))
+      throw msdf::GenericException(std::string("The mesh in ") + fileName + " has no " + axes[i] + " axis to slice!");
+    if (slice[i] >= meshDims[i])
+      throw msdf::GenericException(std::string("The ") + axes[i] + " index of the slice lies outside of the mesh in "
+          + fileName);
+  }
+
+  for (int i=2; i>=0; --i)
+    if (slice[i] < 0) dims.push_back(meshDims[i]);
+}
+
+int64_t MeshSlice::getLength() const
+{
+  int64_t length = 1;
+  for (size_t i=0; i<dims.size(); ++i) length *= dims[i];
+  return length;
+}
+
+void MeshSlice::read(double *data) const
+{
+  std::ifstream in(fileName.c_str(), std::ifstream::binary);
+  if (!in) throw msdf::GenericException("Could not open file " + fileName);
+  readSlice(in, dataOffset, precision, meshDims, slice, data);
+}
+
+void MeshSlice::readSlice(std::istream &in, int64_t dataOffset, int precision,
+    const int64_t meshDims[3], const int slice[3], double *data)
+{
+  const int64_t nx = meshDims[0], ny = meshDims[1], nz = meshDims[2];
+
+  // the number of consecutive values in the file that belong to the slice
+  int64_t run;
+  if (slice[0] >= 0) run = 1;
+  else if (slice[1] >= 0) run = nx;
+  else if (slice[2] >= 0) run = nx*ny;
+  else run = nx*ny*nz;
+
+  // reading a short row costs as much as seeking to a single value in it
+  bool wholeRows = (slice[0] >= 0) && (nx*precision <= rowReadBytes);
+
+  int64_t jlo = (slice[1] >= 0) ? slice[1] : 0;
+  int64_t jhi = (slice[1] >= 0) ? slice[1] + 1 : ((run >= nx*ny) ? 1 : ny);
+  int64_t klo = (slice[2] >= 0) ? slice[2] : 0;
+  int64_t khi = (slice[2] >= 0) ? slice[2] + 1 : ((run >= nx*ny*nz) ? 1 : nz);
+  int64_t xoffset = (slice[0] >= 0) ? slice[0] : 0;
+
+  int64_t readLength = wholeRows ? nx : run;
+  std::vector<char> buffer(readLength*precision);
+  const float *fbuffer = reinterpret_cast<const float*>(&buffer[0]);
+  const double *dbuffer = reinterpret_cast<const double*>(&buffer[0]);
+
+  for (int64_t k=klo; k<khi; ++k)
+    for (int64_t j=jlo; j<jhi; ++j)
+    {
+      int64_t row = (k*ny + j)*nx;
+      int64_t first = wholeRows ? row : row + xoffset;
+      in.seekg(dataOffset + first*precision);
+      in.read(&buffer[0], readLength*precision);
+      if (!in) throw msdf::GenericException("Unexpected end of file while reading a slice");
+
+      if (wholeRows)
+      {
+        *data++ = (precision == 4) ? fbuffer[xoffset] : dbuffer[xoffset];
+      }
+      else if (precision == 4)
+      {
+        for (int64_t i=0; i<run; ++i) *data++ = fbuffer[i];
+      }
+      else
+      {
+        for (int64_t i=0; i<run; ++i) *data++ = dbuffer[i];
+      }
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ * meshslice.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef MESHSLICE_H_
+#define MESHSLICE_H_
+
+#include <stdint.h>
+#include <istream>
+#include <string>
+#include <vector>
+
+/**
+ * A plane or line cut out of a mesh stored in a file, such as a plain mesh
+ * variable of an SDF file.
+ *
+ * Only the values of the slice are read. Their file offsets follow from the
+ * mesh dimensions, the x index runs fastest in the file. The dimensions of the
+ * slice are ordered slowest first, like the grids written by the toh5 command,
+ * and the axes that are sliced are dropped.
+ */
+class MeshSlice
+{
+  public:
+    /// Rows with at most this many bytes are read whole rather than value by value
+    static const int64_t rowReadBytes = 4096;
+
+    /**
+     * A slice of a mesh of the given rank, dimensions (x first) and precision
+     * whose values start at dataOffset in fileName. The entries of slice are
+     * the indices at which the x, y and z axes are cut, or -1 to keep the axis.
+     */
+    MeshSlice(const std::string &fileName_, int64_t dataOffset_, int precision_,
+        int rank, const int64_t meshDims_[3], const int slice_[3]);
+
+    /// The rank of the slice
+    int getRank() const { return dims.size(); }
+
+    /// The dimensions of the slice, slowest first
+    const std::vector<int64_t> &getDims() const { return dims; }
+
+    /// The number of values in the slice
+    int64_t getLength() const;
+
+    /// Read the slice into data, which must hold getLength() values
+    void read(double *data) const;
+
+    /**
+     * Read the slice of a mesh with the given dimensions (x first, missing
+     * dimensions are one) and precision whose values start at dataOffset.
+     */
+    static void readSlice(std::istream &in, int64_t dataOffset, int precision,
+        const int64_t meshDims[3], const int slice[3], double *data);
+  private:
+    std::string fileName;
+    int64_t dataOffset;
+    int precision;
+    int64_t meshDims[3];
+    int slice[3];
+    std::vector<int64_t> dims;
+};
+
+#endif /* MESHSLICE_H_ */
@@ -0,0 +1,255 @@
+/*
+ * momentgrid.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "momentgrid.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  /// The components of the covariance stored in CellMoments::cov
+  const int covA[6] = { 0, 0, 0, 1, 1, 2 };
+  const int covB[6] = { 0, 1, 2, 1, 2, 2 };
+
+  const double clight = 2.99792458e8;
+
+  /// The number of cells along each side of a tile, excluding the guard cells
+  int tileLength(int rank)
+  {
+    switch (rank)
+    {
+      case 1: return 1024;
+      case 2: return 32;
+      default: return 16;
+    }
+  }
+}
+
+void CellMoments::merge(const CellMoments &other)
+{
+  if (!(other.weight > 0.0)) return;
+  double W = weight + other.weight;
+  double f = weight*other.weight/W;
+  double delta[3];
+  for (int a=0; a<3; ++a) delta[a] = other.mean[a] - mean[a];
+  for (int k=0; k<6; ++k) cov[k] += other.cov[k] + delta[covA[k]]*delta[covB[k]]*f;
+  for (int a=0; a<3; ++a)
+  {
+    mean[a] += delta[a]*other.weight/W;
+    vsum[a] += other.vsum[a];
+  }
+  weight = W;
+}
+
+bool MomentGrid::parseShape(const std::string &name, Shape &shape)
+{
+  if (name == "ngp") shape = ngp;
+  else if (name == "cic") shape = cic;
+  else if (name == "tsc") shape = tsc;
+  else return false;
+  return true;
+}
+
+int64_t MomentGrid::tileBytes(int rank)
+{
+  int64_t cells = 1;
+  for (int d=0; d<rank; ++d) cells *= tileLength(rank) + 2;
+  return cells*sizeof(CellMoments);
+}
+
+MomentGrid::MomentGrid(int rank_, const int *dims_, const double *lo_, const double *hi_, Shape shape_)
+  : rank(rank_), shape(shape_)
+{
+  int64_t total = 1;
+  for (int d=0; d<3; ++d)
+  {
+    bool active = (d < rank);
+    dims[d] = active ? dims_[d] : 1;
+    lo[d] = active ? lo_[d] : 0.0;
+    dx[d] = active ? (hi_[d] - lo_[d])/dims_[d] : 1.0;
+    tileSize[d] = active ? tileLength(rank) : 1;
+    tileCells[d] = active ? tileSize[d] + 2 : 1;
+    numTiles[d] = (dims[d] + tileSize[d] - 1)/tileSize[d];
+    total *= numTiles[d];
+  }
+  tiles.resize(total);
+}
+
+double MomentGrid::getCellVolume() const
+{
+  double volume = 1.0;
+  for (int d=0; d<rank; ++d) volume *= dx[d];
+  return volume;
+}
+
+void MomentGrid::allocateTile(std::vector<CellMoments> &tile)
+{
+  reservation.grow(tileBytes(rank), "moment grid tiles");
+  tile.assign(int64_t(tileCells[0])*tileCells[1]*tileCells[2], CellMoments());
+}
+
+void MomentGrid::deposit(int64_t count, const double *const *position,
+    const double *const *u, const double *weight, int numThreads)
+{
+  // sort the particles by tile, keeping the order of the stream within a tile
+  order.clear();
+  for (int64_t i=0; i<count; ++i)
+  {
+    if (!(weight[i] > 0.0)) continue;
+    int tile[3] = { 0, 0, 0 };
+    bool inside = true;
+    for (int d=0; d<rank; ++d)
+    {
+      double xi = (position[d][i] - lo[d])/dx[d];
+      if (!((xi >= 0.0) && (xi < dims[d]))) { inside = false; break; }
+      tile[d] = std::min(int(xi), dims[d]-1)/tileSize[d];
+    }
+    if (inside) order.push_back(std::make_pair(tileIndex(tile), i));
+  }
+  std::sort(order.begin(), order.end());
+
+  sorted.resize(order.size());
+  groupTile.clear();
+  groupBegin.clear();
+  for (size_t k=0; k<order.size(); ++k)
+  {
+    sorted[k] = order[k].second;
+    if ((k == 0) || (order[k].first != order[k-1].first))
+    {
+      groupTile.push_back(order[k].first);
+      groupBegin.push_back(k);
+      if (tiles[order[k].first].empty()) allocateTile(tiles[order[k].first]);
+    }
+  }
+  groupBegin.push_back(order.size());
+
+  const int64_t *first = sorted.data();
+  parallelFor(groupTile.size(), numThreads, [&](int g)
+  {
+    depositTile(groupTile[g], first + groupBegin[g], first + groupBegin[g+1], position, u, weight);
+  });
+}
+
+void MomentGrid::depositTile(int64_t t, const int64_t *begin, const int64_t *end,
+    const double *const *position, const double *const *u, const double *weight)
+{
+  std::vector<CellMoments> &tile = tiles[t];
+  int tileId[3] = { int(t/(int64_t(numTiles[1])*numTiles[2])), int((t/numTiles[2]) % numTiles[1]), int(t % numTiles[2]) };
+  int origin[3];
+  for (int d=0; d<3; ++d) origin[d] = (d < rank) ? tileId[d]*tileSize[d] - 1 : 0;
+
+  for (const int64_t *p=begin; p<end; ++p)
+  {
+    int64_t i = *p;
+    int start[3] = { 0, 0, 0 };
+    int width[3] = { 1, 1, 1 };
+    double s[3][3] = { { 1.0 }, { 1.0 }, { 1.0 } };
+
+    for (int d=0; d<rank; ++d)
+    {
+      double xi = (position[d][i] - lo[d])/dx[d];
+      int cell = std::min(int(xi), dims[d]-1);
+      switch (shape)
+      {
+        case ngp:
+          start[d] = cell;
+          break;
+        case cic:
+        {
+          double xs = xi - 0.5;
+          start[d] = int(std::floor(xs));
+          double f = xs - start[d];
+          width[d] = 2;
+          s[d][0] = 1.0 - f;
+          s[d][1] = f;
+          break;
+        }
+        case tsc:
+        {
+          double delta = xi - (cell + 0.5);
+          start[d] = cell - 1;
+          width[d] = 3;
+          s[d][0] = 0.5*(0.5 - delta)*(0.5 - delta);
+          s[d][1] = 0.75 - delta*delta;
+          s[d][2] = 0.5*(0.5 + delta)*(0.5 + delta);
+          break;
+        }
+      }
+      start[d] -= origin[d];
+    }
+
+    double ui[3] = { u[0][i], u[1][i], u[2][i] };
+    double gamma = std::sqrt(1.0 + (ui[0]*ui[0] + ui[1]*ui[1] + ui[2]*ui[2])/(clight*clight));
+    double vi[3] = { ui[0]/gamma, ui[1]/gamma, ui[2]/gamma };
+
+    for (int a=0; a<width[0]; ++a)
+      for (int b=0; b<width[1]; ++b)
+        for (int c=0; c<width[2]; ++c)
+        {
+          int64_t index = (int64_t(start[0] + a)*tileCells[1] + start[1] + b)*tileCells[2] + start[2] + c;
+          tile[index].add(ui, vi, weight[i]*s[0][a]*s[1][b]*s[2][c]);
+        }
+  }
+}
+
+void MomentGrid::reduce()
+{
+  for (size_t t=0; t<tiles.size(); ++t)
+  {
+    if (tiles[t].empty()) continue;
+    int tileId[3] = { int(t/(int64_t(numTiles[1])*numTiles[2])), int((t/numTiles[2]) % numTiles[1]), int(t % numTiles[2]) };
+
+    int local[3];
+    for (local[0]=0; local[0]<tileCells[0]; ++local[0])
+      for (local[1]=0; local[1]<tileCells[1]; ++local[1])
+        for (local[2]=0; local[2]<tileCells[2]; ++local[2])
+        {
+          bool guard = false;
+          bool inside = true;
+          int global[3] = { 0, 0, 0 };
+          for (int d=0; d<rank; ++d)
+          {
+            guard = guard || (local[d] == 0) || (local[d] == tileCells[d]-1);
+            global[d] = tileId[d]*tileSize[d] - 1 + local[d];
+            inside = inside && (global[d] >= 0) && (global[d] < dims[d]);
+          }
+          if (!guard) continue;
+
+          CellMoments &cell = tiles[t][(int64_t(local[0])*tileCells[1] + local[1])*tileCells[2] + local[2]];
+          if (inside && (cell.weight > 0.0))
+          {
+            int owner[3];
+            int ownerLocal[3] = { 0, 0, 0 };
+            for (int d=0; d<3; ++d)
+            {
+              owner[d] = global[d]/tileSize[d];
+              if (d < rank) ownerLocal[d] = global[d] - owner[d]*tileSize[d] + 1;
+            }
+            std::vector<CellMoments> &ownerTile = tiles[tileIndex(owner)];
+            if (ownerTile.empty()) allocateTile(ownerTile);
+            ownerTile[(int64_t(ownerLocal[0])*tileCells[1] + ownerLocal[1])*tileCells[2] + ownerLocal[2]].merge(cell);
+          }
+          cell = CellMoments();
+        }
+  }
+}
+
+const CellMoments *MomentGrid::getCell(const int *index) const
+{
+  int tile[3] = { 0, 0, 0 };
+  int local[3] = { 0, 0, 0 };
+  for (int d=0; d<rank; ++d)
+  {
+    tile[d] = index[d]/tileSize[d];
+    local[d] = index[d] - tile[d]*tileSize[d] + 1;
+  }
+  const std::vector<CellMoments> &cells = tiles[tileIndex(tile)];
+  if (cells.empty()) return 0;
+  return &cells[(int64_t(local[0])*tileCells[1] + local[1])*tileCells[2] + local[2]];
+}
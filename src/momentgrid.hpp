@@ -0,0 +1,133 @@
+/*
+ * momentgrid.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef MOMENTGRID_H_
+#define MOMENTGRID_H_
+
+#include "memorybudget.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * The moments of the particles deposited into one cell, weighted with the
+ * particle weight times the shape function.
+ *
+ * The mean and the covariance of the velocity u = gamma*v are accumulated
+ * with Welford's update, so the temperature keeps its precision in cold
+ * drifting plasmas. The covariance is stored as xx, xy, xz, yy, yz, zz.
+ */
+struct CellMoments
+{
+  double weight;
+  double mean[3];
+  double cov[6];
+  /// The weighted sum of the velocities v
+  double vsum[3];
+
+  void add(const double *u, const double *v, double w)
+  {
+    double delta[3];
+    weight += w;
+    for (int a=0; a<3; ++a)
+    {
+      delta[a] = u[a] - mean[a];
+      mean[a] += delta[a]*w/weight;
+      vsum[a] += w*v[a];
+    }
+    cov[0] += w*delta[0]*(u[0] - mean[0]);
+    cov[1] += w*delta[0]*(u[1] - mean[1]);
+    cov[2] += w*delta[0]*(u[2] - mean[2]);
+    cov[3] += w*delta[1]*(u[1] - mean[1]);
+    cov[4] += w*delta[1]*(u[2] - mean[2]);
+    cov[5] += w*delta[2]*(u[2] - mean[2]);
+  }
+
+  /// Add the moments of another cell with Chan's formula
+  void merge(const CellMoments &other);
+};
+
+/**
+ * Deposits particles onto a regular grid of cells in one to three dimensions
+ * and accumulates the moments of each cell.
+ *
+ * The grid is divided into tiles, each with a guard layer of one cell on
+ * every side. The particles of a chunk are sorted by the tile of their
+ * nearest cell and the tiles are filled on separate threads. Within a tile
+ * the particles are deposited in the order of the stream, so the result
+ * doesn't depend on the number of threads. reduce() adds the guard cells to
+ * the cells of the neighbouring tiles. Tiles are allocated when the first
+ * particle falls into them and are accounted for in the MemoryBudget.
+ */
+class MomentGrid
+{
+  public:
+    enum Shape { ngp, cic, tsc };
+
+    /// Parse the name of a shape function
+    static bool parseShape(const std::string &name, Shape &shape);
+
+    /// The bytes of one tile of a grid of the given rank
+    static int64_t tileBytes(int rank);
+
+    /// lo and hi are the bounds of the grid, dims the number of cells in each of the rank directions
+    MomentGrid(int rank, const int *dims, const double *lo, const double *hi, Shape shape);
+
+    /**
+     * Deposit count particles. position[d] holds the positions in direction d
+     * for d<rank, u the velocities gamma*v in m/s.
+     */
+    void deposit(int64_t count, const double *const *position,
+        const double *const *u, const double *weight, int numThreads);
+
+    /// Add the guard cells to the cells they belong to, call once after the last deposit
+    void reduce();
+
+    int getRank() const { return rank; }
+    int getDim(int d) const { return dims[d]; }
+    double getCellVolume() const;
+
+    /// The moments of a cell, or 0 if no particle contributed to it
+    const CellMoments *getCell(const int *index) const;
+
+    int64_t getBytes() const { return reservation.getBytes(); }
+  private:
+    int rank;
+    Shape shape;
+    int dims[3];
+    double lo[3];
+    double dx[3];
+    int tileSize[3];
+    int tileCells[3];
+    int numTiles[3];
+    BudgetReservation reservation;
+    std::vector<std::vector<CellMoments> > tiles;
+
+    /// Scratch space of deposit, kept to avoid allocations for every chunk
+    std::vector<std::pair<int64_t, int64_t> > order;
+    std::vector<int64_t> sorted;
+    std::vector<int64_t> groupTile;
+    std::vector<size_t> groupBegin;
+
+    int64_t tileIndex(const int *tile) const
+    {
+      return (int64_t(tile[0])*numTiles[1] + tile[1])*numTiles[2] + tile[2];
+    }
+
+    void allocateTile(std::vector<CellMoments> &tile);
+    /// Deposit the particles with the given indices into tile t
+    void depositTile(int64_t t, const int64_t *begin, const int64_t *end,
+        const double *const *position, const double *const *u, const double *weight);
+};
+
+typedef boost::shared_ptr<MomentGrid> pMomentGrid;
+
+#endif /* MOMENTGRID_H_ */
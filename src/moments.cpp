@@ -0,0 +1,59 @@
+/*
+ * moments.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "moments.hpp"
+
+MomentAccumulator::MomentAccumulator(bool compensated_)
+  : compensated(compensated_)
+{
+  reset();
+}
+
+void MomentAccumulator::reset()
+{
+  count = 0;
+  weight = weightC = 0.0;
+  for (int d=0; d<3; ++d)
+    mean[d] = meanC[d] = m2[d] = m2C[d] = 0.0;
+}
+
+void MomentAccumulator::merge(const MomentAccumulator &other)
+{
+  count += other.count;
+  double wa = getWeight();
+  double wb = other.getWeight();
+  if (!(wb > 0.0)) return;
+
+  if (compensated) sum(weight, weightC, wb);
+  else weight += wb;
+  double W = getWeight();
+
+  for (int d=0; d<3; ++d)
+  {
+    double delta = other.getMean(d) - getMean(d);
+    double m2b = other.m2[d] + other.m2C[d];
+    if (compensated)
+    {
+      sum(mean[d], meanC[d], delta*wb/W);
+      sum(m2[d], m2C[d], m2b);
+      sum(m2[d], m2C[d], delta*delta*wa*wb/W);
+    }
+    else
+    {
+      mean[d] += delta*wb/W;
+      m2[d] += m2b + delta*delta*wa*wb/W;
+    }
+  }
+}
+
+double MomentAccumulator::getVariance(int d) const
+{
+  double W = getWeight();
+  if (!(W > 0.0)) return 0.0;
+  return (m2[d] + m2C[d])/W;
+}
@@ -0,0 +1,89 @@
+/*
+ * moments.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef MOMENTS_H_
+#define MOMENTS_H_
+
+#include <boost/cstdint.hpp>
+
+/**
+ * Weighted mean and variance of a three component quantity, accumulated with
+ * Welford's update and merged with Chan's formula.
+ *
+ * The variance is accumulated about the running mean, so it keeps its
+ * precision for a narrow distribution with a large drift. Accumulators of
+ * separate parts of the data can be merged. The result of a merge depends on
+ * the order, a deterministic reduction has to merge in a fixed order.
+ *
+ * With compensation the sums are accumulated with Neumaier's compensated
+ * summation, at roughly twice the cost per value.
+ */
+class MomentAccumulator
+{
+  public:
+    MomentAccumulator(bool compensated_ = false);
+
+    void add(double x, double y, double z, double w)
+    {
+      ++count;
+      if (!(w > 0.0)) return;
+      double value[3] = { x, y, z };
+      if (compensated)
+      {
+        sum(weight, weightC, w);
+        double W = weight + weightC;
+        for (int d=0; d<3; ++d)
+        {
+          double delta = value[d] - (mean[d] + meanC[d]);
+          double step = delta*w/W;
+          sum(mean[d], meanC[d], step);
+          sum(m2[d], m2C[d], w*delta*(delta - step));
+        }
+      }
+      else
+      {
+        weight += w;
+        for (int d=0; d<3; ++d)
+        {
+          double delta = value[d] - mean[d];
+          mean[d] += delta*w/weight;
+          m2[d] += w*delta*(value[d] - mean[d]);
+        }
+      }
+    }
+
+    /// Add the values of another accumulator
+    void merge(const MomentAccumulator &other);
+
+    /// Remove all values
+    void reset();
+
+    double getWeight() const { return weight + weightC; }
+    int64_t getCount() const { return count; }
+    double getMean(int d) const { return mean[d] + meanC[d]; }
+
+    /// The weighted variance about the mean, normalised by the total weight
+    double getVariance(int d) const;
+  private:
+    bool compensated;
+    int64_t count;
+    double weight, weightC;
+    double mean[3], meanC[3];
+    double m2[3], m2C[3];
+
+    /// Neumaier's compensated addition of value to s with compensation c
+    static void sum(double &s, double &c, double value)
+    {
+      double t = s + value;
+      if (((s<0) ? -s : s) >= ((value<0) ? -value : value)) c += (s - t) + value;
+      else c += (value - t) + s;
+      s = t;
+    }
+};
+
+#endif /* MOMENTS_H_ */
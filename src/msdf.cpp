@@ -42,15 +42,18 @@ int main(int argc, char **argv)
   catch (BlockNotFoundException &ex)
   {
     std::cerr << "ERROR!\n" << "Block '"<< ex.getName() << "' not found\n";
+    return -1;
   }
   catch (BlockTypeUnsupportedException &ex)
   {
     std::cerr << "ERROR!\n" << "Block type '"<< ex.getBlockType()
         << "' unsupported in block '"<< ex.getBlockName() <<"'\n";
+    return -1;
   }
   catch (GenericException &ex)
   {
     std::cerr << "ERROR!\n" << ex.getMessage() <<"\n";
+    return -1;
   }
-
+  return 0;
 }
@@ -59,6 +59,8 @@ typedef boost::shared_ptr<DoubleVector> pDoubleVector;
 static const double massEl = 9.10938188e-31;
 /// The proton mass in SI units
 static const double massProton = 1.67262158e-27;
+/// The elementary charge in SI units
+static const double chargeEl = 1.602176462e-19;
 /// The Boltzmann constant in SI units
 static const double kB = 1.3806503e-23;
 
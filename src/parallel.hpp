@@ -0,0 +1,39 @@
+/*
+ * parallel.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+/// The number of threads used when the user doesn't choose one
+inline int defaultThreadCount()
+{
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/**
+ * Call f(s) for s=0..n-1 on up to numThreads threads.
+ *
+ * Thread t handles the indices t, t+numThreads, ... The calling thread takes
+ * part, so no thread is started for n<2 or numThreads<2. f must not throw.
+ */
+template<class Function>
+void parallelFor(int n, int numThreads, Function f)
+{
+  int threads = std::min(n, numThreads);
+  std::vector<std::thread> workers;
+  for (int t=1; t<threads; ++t)
+    workers.emplace_back([&f, t, n, threads]() { for (int s=t; s<n; s+=threads) f(s); });
+  for (int s=0; s<n; s+=std::max(1, threads)) f(s);
+  for (size_t t=0; t<workers.size(); ++t) workers[t].join();
+}
+
+#endif /* PARALLEL_H_ */
@@ -0,0 +1,24 @@
+/*
+ * particleaxes.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "particleaxes.hpp"
+
+const int ParticleAxes::unity;
+
+int ParticleAxes::parseId(const std::string &name, bool allowUnity)
+{
+  static const char *names[] = {
+      "x", "y", "px", "py", "pz", "E", "Ex", "Ey", "Ez", "v", "vx", "vy", "vz",
+      "theta", "theta2", "pxt", "pyt", "pzt" };
+  const int numNames = sizeof(names)/sizeof(names[0]);
+
+  if ((name == "1") && allowUnity) return unity;
+  for (int id=0; id<numNames; ++id)
+    if (name == names[id]) return id;
+  return -1;
+}
@@ -0,0 +1,79 @@
+/*
+ * particleaxes.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef PARTICLEAXES_H_
+#define PARTICLEAXES_H_
+
+#include <cmath>
+#include <string>
+
+/**
+ * The catalogue of particle quantities that can be put on the axes of the
+ * particle commands or used as their moments.
+ *
+ * The ids are 0=x, 1=y, 2=px, 3=py, 4=pz, 5=E, 6=Ex, 7=Ey, 8=Ez, 9=v,
+ * 10=vx, 11=vy, 12=vz, 13=theta, 14=theta2, 15=pxt, 16=pyt, 17=pzt and
+ * 100 for unity. Energies and velocities are in units of mc^2 and c.
+ */
+class ParticleAxes
+{
+  public:
+    /// The id of unity, only available for moments
+    static const int unity = 100;
+
+    /// The id of a quantity, or -1 if the name is unknown. "1" is unity when allowUnity is set
+    static int parseId(const std::string &name, bool allowUnity = false);
+
+    /// The value of a quantity when p2 = px^2+py^2+pz^2 and gamma = sqrt(1+p2) are known
+    static double value(int id, double px, double py, double pz, double x, double y, double p2, double gamma)
+    {
+      switch (id)
+      {
+        case  0: return x;
+        case  1: return y;
+        case  2: return px;
+        case  3: return py;
+        case  4: return pz;
+        // Using the identity
+        // (gamma-1) = (gamma^2-1) / (gamma+1) = p^2  / (gamma+1)
+        // to avoid rounding errors for small velocities
+        case  5: return p2/(gamma + 1);
+        case  6: return px*px/(std::sqrt(1+px*px) + 1);
+        case  7: return py*py/(std::sqrt(1+py*py) + 1);
+        case  8: return pz*pz/(std::sqrt(1+pz*pz) + 1);
+        case  9: return std::sqrt(p2)/gamma;
+        case 10: return px/gamma;
+        case 11: return py/gamma;
+        case 12: return pz/gamma;
+        case 13: return std::atan2(py,px);
+        case 14:
+        {
+          double theta = std::atan2(py,px);
+          return theta*theta;
+        }
+        case 15: return std::sqrt(py*py+pz*pz);
+        case 16: return std::sqrt(px*px+pz*pz);
+        case 17: return std::sqrt(px*px+py*py);
+        case unity: return 1;
+        default: return x;
+      }
+    }
+
+    /// The value of a quantity, p2 and gamma are only computed for the ids that need them
+    static double value(int id, double px, double py, double pz, double x, double y)
+    {
+      if ((id == 5) || ((id >= 9) && (id <= 12)))
+      {
+        double p2 = px*px + py*py + pz*pz;
+        return value(id, px, py, pz, x, y, p2, std::sqrt(1+p2));
+      }
+      return value(id, px, py, pz, x, y, 0.0, 1.0);
+    }
+};
+
+#endif /* PARTICLEAXES_H_ */
@@ -0,0 +1,185 @@
+/*
+ * particlecache.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "particlecache.hpp"
+#include "common/binaryio.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace {
+  const char cacheMagic[8] = { 'M', 'S', 'D', 'F', 'P', 'C', 'C', 'H' };
+  const int32_t cacheVersion = 1;
+
+  template<typename T>
+  inline void writeValue(std::ostream &out, const T &data)
+  {
+    out.write((const char*)&data, sizeof(T));
+  }
+}
+
+ParticleCache::ParticleCache()
+  : rank(0), bits(0), raw(false), count(0), numSpecies(0), dataOffset(0)
+{
+  for (int d=0; d<3; ++d) lo[d] = hi[d] = 0.0;
+}
+
+void ParticleCache::init(int rank_, int bits_, const double *lo_, const double *hi_, bool raw_)
+{
+  if ((rank_ < 1) || (rank_ > 3))
+    throw msdf::GenericException("Particle cache supports 1 to 3 dimensions");
+  if ((bits_ < 1) || (rank_*bits_ > 63))
+    throw msdf::GenericException("Invalid number of cell bits for the particle cache");
+
+  rank = rank_;
+  bits = bits_;
+  raw = raw_;
+  for (int d=0; d<rank; ++d)
+  {
+    lo[d] = lo_[d];
+    hi[d] = hi_[d];
+  }
+}
+
+void ParticleCache::cellCoords(const double *pos, uint32_t *coords) const
+{
+  int64_t cellsPerDim = int64_t(1) << bits;
+  for (int d=0; d<rank; ++d)
+  {
+    double width = hi[d] - lo[d];
+    double c = (width > 0.0) ? std::floor((pos[d] - lo[d])*cellsPerDim/width) : 0.0;
+    // clamp before converting, the position may be infinite
+    coords[d] = uint32_t(std::max(0.0, std::min(double(cellsPerDim - 1), c)));
+  }
+}
+
+uint64_t ParticleCache::cellKey(const double *pos) const
+{
+  uint32_t coords[3];
+  cellCoords(pos, coords);
+  uint64_t key = 0;
+  for (int b=0; b<bits; ++b)
+    for (int d=0; d<rank; ++d)
+      key |= uint64_t((coords[d] >> b) & 1) << (b*rank + d);
+  return key;
+}
+
+void ParticleCache::decodeKey(uint64_t key, uint32_t *coords) const
+{
+  for (int d=0; d<rank; ++d) coords[d] = 0;
+  for (int b=0; b<bits; ++b)
+    for (int d=0; d<rank; ++d)
+      coords[d] |= uint32_t((key >> (b*rank + d)) & 1) << b;
+}
+
+void ParticleCache::findRanges(const double *boxLo, const double *boxHi,
+                               std::vector<std::pair<int64_t, int64_t> > &ranges) const
+{
+  uint32_t cLo[3], cHi[3], coords[3];
+  cellCoords(boxLo, cLo);
+  cellCoords(boxHi, cHi);
+
+  ranges.clear();
+  for (size_t i=0; i<cells.size(); ++i)
+  {
+    decodeKey(cells[i].key, coords);
+    bool inside = true;
+    for (int d=0; d<rank; ++d)
+      inside = inside && (coords[d] >= cLo[d]) && (coords[d] <= cHi[d]);
+    if (!inside) continue;
+
+    int64_t first = cells[i].first;
+    int64_t end = (i+1 < cells.size()) ? cells[i+1].first : count;
+    if (!ranges.empty() && (ranges.back().second == first)) ranges.back().second = end;
+    else ranges.push_back(std::make_pair(first, end));
+  }
+}
+
+int64_t ParticleCache::headerLength() const
+{
+  int64_t length = sizeof(cacheMagic) + 4*sizeof(int32_t) + sizeof(int64_t)
+      + sizeof(int32_t) + 6*sizeof(double) + sizeof(int64_t)
+      + cells.size()*(sizeof(uint64_t) + sizeof(int64_t));
+  // align the column data to 64 bytes
+  return (length + 63)/64*64;
+}
+
+void ParticleCache::writeHeader(std::ostream &out, int64_t count_, int numSpecies_,
+                                const std::vector<Cell> &cells_)
+{
+  count = count_;
+  numSpecies = numSpecies_;
+  cells = cells_;
+  dataOffset = headerLength();
+
+  out.seekp(0);
+  out.write(cacheMagic, sizeof(cacheMagic));
+  writeValue(out, cacheVersion);
+  writeValue(out, int32_t(rank));
+  writeValue(out, int32_t(bits));
+  writeValue(out, int32_t(raw ? 1 : 0));
+  writeValue(out, count);
+  writeValue(out, int32_t(numSpecies));
+  for (int d=0; d<3; ++d) writeValue(out, lo[d]);
+  for (int d=0; d<3; ++d) writeValue(out, hi[d]);
+  writeValue(out, int64_t(cells.size()));
+  for (size_t i=0; i<cells.size(); ++i)
+  {
+    writeValue(out, cells[i].key);
+    writeValue(out, cells[i].first);
+  }
+
+  int64_t pos = out.tellp();
+  for (; pos<dataOffset; ++pos) out.put(0);
+}
+
+void ParticleCache::readHeader(std::istream &in)
+{
+  char magic[8];
+  int32_t version = 0;
+  in.read(magic, sizeof(magic));
+  msdf::detail::readValue(in, version);
+  if (!in || (std::memcmp(magic, cacheMagic, sizeof(magic)) != 0) || (version != cacheVersion))
+    throw msdf::GenericException("Input is not a particle cache");
+
+  int32_t rank_, bits_, raw_, numSpecies_;
+  int64_t numCells;
+  msdf::detail::readValue(in, rank_);
+  msdf::detail::readValue(in, bits_);
+  msdf::detail::readValue(in, raw_);
+  msdf::detail::readValue(in, count);
+  msdf::detail::readValue(in, numSpecies_);
+  for (int d=0; d<3; ++d) msdf::detail::readValue(in, lo[d]);
+  for (int d=0; d<3; ++d) msdf::detail::readValue(in, hi[d]);
+  msdf::detail::readValue(in, numCells);
+
+  rank = rank_;
+  bits = bits_;
+  raw = (raw_ != 0);
+  numSpecies = numSpecies_;
+
+  cells.resize(numCells);
+  for (int64_t i=0; i<numCells; ++i)
+  {
+    msdf::detail::readValue(in, cells[i].key);
+    msdf::detail::readValue(in, cells[i].first);
+  }
+  if (!in)
+    throw msdf::GenericException("Error reading particle cache header");
+
+  dataOffset = headerLength();
+}
+
+bool ParticleCache::isCacheFile(const std::string &fileName)
+{
+  std::ifstream in(fileName.c_str(), std::ios::binary);
+  char magic[8];
+  in.read(magic, sizeof(magic));
+  return in && (std::memcmp(magic, cacheMagic, sizeof(magic)) == 0);
+}
@@ -0,0 +1,101 @@
+/*
+ * particlecache.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef PARTICLECACHE_H_
+#define PARTICLECACHE_H_
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <string>
+#include <vector>
+#include <iostream>
+
+/**
+ * Spatially sorted particle cache written by the 'reorder' command.
+ *
+ * The particles are sorted by the Morton key of the cell they lie in. The
+ * cell index stores the first row of every non-empty cell, so that the
+ * particles inside a box can be read with a few contiguous reads.
+ *
+ * File layout: the header, the cell index as (key, first row) pairs and
+ * the columns x, [y, [z]], species, px, py, pz, weight as contiguous
+ * arrays of doubles.
+ */
+class ParticleCache
+{
+  public:
+    /// One entry of the cell index
+    struct Cell
+    {
+      uint64_t key;
+      int64_t first;
+    };
+
+    /// The columns following the mesh dimensions
+    enum { col_species = 0, col_px, col_py, col_pz, col_weight, numValueColumns };
+
+    ParticleCache();
+
+    /// Set up the geometry of a new cache
+    void init(int rank_, int bits_, const double *lo_, const double *hi_, bool raw_);
+
+    int getRank() const { return rank; }
+    int getBits() const { return bits; }
+    bool isRaw() const { return raw; }
+    int64_t getCount() const { return count; }
+    int getNumSpecies() const { return numSpecies; }
+    int getNumColumns() const { return rank + numValueColumns; }
+
+    const std::vector<Cell> &getCells() const { return cells; }
+
+    /// The Morton key of the cell containing the position pos
+    uint64_t cellKey(const double *pos) const;
+
+    /// The integer cell coordinates of a position, clamped to the grid
+    void cellCoords(const double *pos, uint32_t *coords) const;
+
+    /// The integer cell coordinates encoded in a Morton key
+    void decodeKey(uint64_t key, uint32_t *coords) const;
+
+    /**
+     * Compute the row ranges [first, end) of all cells that intersect the box
+     * boxLo to boxHi. Adjacent ranges are merged.
+     */
+    void findRanges(const double *boxLo, const double *boxHi,
+                    std::vector<std::pair<int64_t, int64_t> > &ranges) const;
+
+    /// The file offset of row of column
+    int64_t columnOffset(int column, int64_t row) const
+    {
+      return dataOffset + (int64_t(column)*count + row)*int64_t(sizeof(double));
+    }
+
+    /// Write header and cell index, the column data follows at columnOffset
+    void writeHeader(std::ostream &out, int64_t count_, int numSpecies_,
+                     const std::vector<Cell> &cells_);
+
+    void readHeader(std::istream &in);
+
+    static bool isCacheFile(const std::string &fileName);
+  private:
+    int rank;
+    int bits;
+    bool raw;
+    int64_t count;
+    int numSpecies;
+    double lo[3];
+    double hi[3];
+    std::vector<Cell> cells;
+    int64_t dataOffset;
+
+    int64_t headerLength() const;
+};
+
+typedef boost::shared_ptr<ParticleCache> pParticleCache;
+
+#endif /* PARTICLECACHE_H_ */
@@ -0,0 +1,140 @@
+/*
+ * particlechunk.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef PARTICLECHUNK_H_
+#define PARTICLECHUNK_H_
+
+#include "bufferpool.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <algorithm>
+
+/**
+ * A non-owning view of a contiguous array
+ */
+template<typename T>
+class ArraySpan
+{
+  private:
+    T *ptr;
+    int64_t n;
+  public:
+    ArraySpan() : ptr(0), n(0) {}
+    ArraySpan(T *ptr_, int64_t n_) : ptr(ptr_), n(n_) {}
+
+    T *data() const { return ptr; }
+    int64_t size() const { return n; }
+    bool empty() const { return n == 0; }
+
+    T &operator[](int64_t i) const { return ptr[i]; }
+    T *begin() const { return ptr; }
+    T *end() const { return ptr + n; }
+};
+
+/**
+ * A chunk of particles in structure-of-arrays layout.
+ *
+ * Every position and momentum component, the weight and the species id are
+ * stored in separate contiguous arrays that start on 64 byte boundaries.
+ * Position components beyond the rank of the data are kept at length but
+ * should not be used. Each particle also carries its row in the source,
+ * counted before any filter, which identifies it across passes.
+ */
+class ParticleChunk : private boost::noncopyable
+{
+  public:
+    enum Component { X = 0, Y, Z, PX, PY, PZ, WEIGHT, numComponents };
+
+    ParticleChunk() : len(0), rank(2) {}
+
+    int64_t length() const { return len; }
+    int getRank() const { return rank; }
+    void setRank(int rank_) { rank = rank_; }
+
+    /// Allocate storage for length particles without changing the length
+    void reserve(int64_t length)
+    {
+      for (int c=0; c<numComponents; ++c) components[c].reserve(length);
+      speciesIds.reserve(length);
+      rowIds.reserve(length);
+    }
+
+    /// Set the number of particles, the first values of all arrays are kept
+    void resize(int64_t length)
+    {
+      reserve(length);
+      len = length;
+    }
+
+    ArraySpan<double> component(int c) { return ArraySpan<double>(components[c].data(), len); }
+    ArraySpan<const double> component(int c) const
+    {
+      return ArraySpan<const double>(components[c].data(), len);
+    }
+
+    /// The position along dimension dim, 0 <= dim < rank
+    ArraySpan<double> position(int dim) { return component(X + dim); }
+    ArraySpan<const double> position(int dim) const { return component(X + dim); }
+
+    ArraySpan<double> x() { return component(X); }
+    ArraySpan<double> y() { return component(Y); }
+    ArraySpan<double> z() { return component(Z); }
+    ArraySpan<double> px() { return component(PX); }
+    ArraySpan<double> py() { return component(PY); }
+    ArraySpan<double> pz() { return component(PZ); }
+    ArraySpan<double> weight() { return component(WEIGHT); }
+    ArraySpan<int32_t> species() { return ArraySpan<int32_t>(speciesIds.data(), len); }
+    ArraySpan<int64_t> rows() { return ArraySpan<int64_t>(rowIds.data(), len); }
+
+    ArraySpan<const double> x() const { return component(X); }
+    ArraySpan<const double> y() const { return component(Y); }
+    ArraySpan<const double> z() const { return component(Z); }
+    ArraySpan<const double> px() const { return component(PX); }
+    ArraySpan<const double> py() const { return component(PY); }
+    ArraySpan<const double> pz() const { return component(PZ); }
+    ArraySpan<const double> weight() const { return component(WEIGHT); }
+    ArraySpan<const int32_t> species() const
+    {
+      return ArraySpan<const int32_t>(speciesIds.data(), len);
+    }
+    ArraySpan<const int64_t> rows() const { return ArraySpan<const int64_t>(rowIds.data(), len); }
+
+    /// Set all values of a component
+    void fill(int c, double value)
+    {
+      std::fill(components[c].data(), components[c].data() + len, value);
+    }
+
+    void fillSpecies(int32_t id)
+    {
+      std::fill(speciesIds.data(), speciesIds.data() + len, id);
+    }
+
+    /// Number the source rows consecutively from first
+    void fillRows(int64_t first)
+    {
+      for (int64_t i=0; i<len; ++i) rowIds.data()[i] = first + i;
+    }
+
+    /// Copy row from to row to, used to compact the chunk in place
+    void moveRow(int64_t from, int64_t to)
+    {
+      for (int c=0; c<numComponents; ++c) components[c].data()[to] = components[c].data()[from];
+      speciesIds.data()[to] = speciesIds.data()[from];
+      rowIds.data()[to] = rowIds.data()[from];
+    }
+  private:
+    AlignedArray<double> components[numComponents];
+    AlignedArray<int32_t> speciesIds;
+    AlignedArray<int64_t> rowIds;
+    int64_t len;
+    int rank;
+};
+
+#endif /* PARTICLECHUNK_H_ */
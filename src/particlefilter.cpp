@@ -0,0 +1,163 @@
+/*
+ * particlefilter.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "particlefilter.hpp"
+#include <algorithm>
+#include <cmath>
+
+int particleColumnsForAxis(int axisId)
+{
+  switch (axisId)
+  {
+    case  0:
+    case  1: return pc_mesh;
+    case  2:
+    case  6: return pc_px;
+    case  3:
+    case  7: return pc_py;
+    case  4:
+    case  8: return pc_pz;
+    case 13:
+    case 14:
+    case 17: return pc_px | pc_py;
+    case 15: return pc_py | pc_pz;
+    case 16: return pc_px | pc_pz;
+    case 100: return pc_none;
+    default: return pc_momentum;
+  }
+}
+
+//===========================================================
+//=================    ParticleFilter    ====================
+//===========================================================
+
+ParticleFilter::ParticleFilter()
+  : minGamma2(0.0),
+    maxGamma2(0.0),
+    limitMinGamma(false),
+    limitMaxGamma(false),
+    positivePx(false)
+{}
+
+void ParticleFilter::setSpatialLimits(const std::vector<double> &xsmin_, const std::vector<double> &xsmax_,
+                                      const std::vector<double> &ysmin_, const std::vector<double> &ysmax_)
+{
+  xsmin = xsmin_;
+  xsmax = xsmax_;
+  ysmin = ysmin_;
+  ysmax = ysmax_;
+}
+
+void ParticleFilter::setGammaLimits(double minGamma, double maxGamma)
+{
+  // gamma is always at least 1, so smaller limits don't restrict anything
+  limitMinGamma = (minGamma > 1.0);
+  limitMaxGamma = (maxGamma >= 1.0);
+  minGamma2 = minGamma*minGamma;
+  maxGamma2 = maxGamma*maxGamma;
+}
+
+bool ParticleFilter::isActive() const
+{
+  return getColumns() != pc_none;
+}
+
+bool ParticleFilter::getSpatialBox(int numSpecies, int rank, double *boxLo, double *boxHi) const
+{
+  const std::vector<double> *limits[2][2] = { { &xsmin, &xsmax }, { &ysmin, &ysmax } };
+  bool restricted = false;
+
+  for (int d=0; d<rank; ++d)
+  {
+    boxLo[d] = -HUGE_VAL;
+    boxHi[d] = HUGE_VAL;
+    // species without a limit, or ids less than 1, are not restricted
+    if ((d > 1) || (numSpecies < 1)) continue;
+
+    const std::vector<double> &lower = *limits[d][0];
+    const std::vector<double> &upper = *limits[d][1];
+    if (lower.size() >= size_t(numSpecies))
+    {
+      boxLo[d] = *std::min_element(lower.begin(), lower.begin() + numSpecies);
+      restricted = true;
+    }
+    if (upper.size() >= size_t(numSpecies))
+    {
+      boxHi[d] = *std::max_element(upper.begin(), upper.begin() + numSpecies);
+      restricted = true;
+    }
+  }
+  return restricted;
+}
+
+int ParticleFilter::getColumns() const
+{
+  int columns = pc_none;
+  if (!xsmin.empty() || !xsmax.empty() || !ysmin.empty() || !ysmax.empty())
+    columns |= pc_mesh;
+  if (positivePx) columns |= pc_px;
+  if (limitMinGamma || limitMaxGamma) columns |= pc_momentum;
+  return columns;
+}
+
+namespace {
+  /// The smallest and largest square of a value in [vmin, vmax]
+  void squareBounds(double vmin, double vmax, double &sqmin, double &sqmax)
+  {
+    sqmax = std::max(vmin*vmin, vmax*vmax);
+    if ((vmin <= 0.0) && (vmax >= 0.0)) sqmin = 0.0;
+    else sqmin = std::min(vmin*vmin, vmax*vmax);
+  }
+}
+
+bool ParticleFilter::mayAccept(int id, int rank, const ParticleBounds &bounds) const
+{
+  if (id < 0) return true;
+  size_t sid = id;
+  if (bounds.columns & pc_mesh)
+  {
+    if ((sid < xsmin.size()) && !(bounds.xmax > xsmin[sid])) return false;
+    if ((sid < xsmax.size()) && !(bounds.xmin < xsmax[sid])) return false;
+    if (rank > 1)
+    {
+      if ((sid < ysmin.size()) && !(bounds.ymax > ysmin[sid])) return false;
+      if ((sid < ysmax.size()) && !(bounds.ymin < ysmax[sid])) return false;
+    }
+  }
+  if (positivePx && (bounds.columns & pc_px) && !(bounds.pxmax > 0)) return false;
+  if ((limitMinGamma || limitMaxGamma) && ((bounds.columns & pc_momentum) == pc_momentum))
+  {
+    // gamma2 is evaluated in the same order as in accept() so that rounding
+    // cannot move a particle outside the bounds
+    double px2min, px2max, py2min, py2max, pz2min, pz2max;
+    squareBounds(bounds.pxmin, bounds.pxmax, px2min, px2max);
+    squareBounds(bounds.pymin, bounds.pymax, py2min, py2max);
+    squareBounds(bounds.pzmin, bounds.pzmax, pz2min, pz2max);
+    if (limitMinGamma && (1 + px2max + py2max + pz2max < minGamma2)) return false;
+    if (limitMaxGamma && (1 + px2min + py2min + pz2min > maxGamma2)) return false;
+  }
+  return true;
+}
+
+void ParticleFilter::select(int id, int64_t count, int rank, const double *x, const double *y,
+                            const double *px, const double *py, const double *pz,
+                            std::vector<int64_t> &selection) const
+{
+  selection.clear();
+  for (int64_t i=0; i<count; ++i)
+  {
+    if (accept(id,
+               x ? x[i] : 0.0,
+               (y && (rank > 1)) ? y[i] : 0.0,
+               rank,
+               px ? px[i] : 0.0,
+               py ? py[i] : 0.0,
+               pz ? pz[i] : 0.0))
+      selection.push_back(i);
+  }
+}
@@ -0,0 +1,139 @@
+/*
+ * particlefilter.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef PARTICLEFILTER_H_
+#define PARTICLEFILTER_H_
+
+#include <stdint.h>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+/**
+ * Bit flags for the particle columns that a command needs to read.
+ *
+ * Commands combine these flags from their axes and filters and pass them to
+ * ParticleStreamFactory::setColumns so that only the required blocks are opened.
+ */
+enum ParticleColumn
+{
+  pc_none     = 0,
+  pc_mesh     = 1,
+  pc_species  = 2,
+  pc_px       = 4,
+  pc_py       = 8,
+  pc_pz       = 16,
+  pc_weight   = 32,
+  pc_momentum = pc_px | pc_py | pc_pz,
+  pc_all      = pc_mesh | pc_species | pc_momentum | pc_weight
+};
+
+/**
+ * Returns the columns needed to evaluate an axis or moment id.
+ *
+ * The ids follow the axis catalogue of ParticleAxes (0=x, 1=y, 2=px, ...,
+ * 17=pzt, 100=unity).
+ */
+int particleColumnsForAxis(int axisId);
+
+/**
+ * Bounds of the filter columns over a range of particles.
+ *
+ * Only the bounds of the columns contained in the ParticleColumn flags of
+ * columns are known; the others are ignored.
+ */
+struct ParticleBounds
+{
+    int columns;
+    double xmin, xmax;
+    double ymin, ymax;
+    double pxmin, pxmax;
+    double pymin, pymax;
+    double pzmin, pzmax;
+
+    ParticleBounds() : columns(pc_none) {}
+};
+
+/**
+ * Cheap per-particle predicates that are evaluated inside the ParticleStream.
+ *
+ * The spatial limits are given per species, the energy and direction limits
+ * apply to all species. The stream evaluates the predicates on the columns
+ * they depend on before reading the remaining columns, and only passes the
+ * selected particles on to the command.
+ */
+class ParticleFilter
+{
+  private:
+    std::vector<double> xsmin, xsmax;
+    std::vector<double> ysmin, ysmax;
+    double minGamma2;
+    double maxGamma2;
+    bool limitMinGamma;
+    bool limitMaxGamma;
+    bool positivePx;
+  public:
+    ParticleFilter();
+
+    void setSpatialLimits(const std::vector<double> &xsmin_, const std::vector<double> &xsmax_,
+                          const std::vector<double> &ysmin_, const std::vector<double> &ysmax_);
+
+    /// Set the energy window, a maxGamma less than 1.0 means no upper limit
+    void setGammaLimits(double minGamma, double maxGamma);
+    void setPositivePx(bool positivePx_) { positivePx = positivePx_; }
+
+    bool isActive() const;
+
+    /**
+     * Compute a box that contains all particles of species 1 to numSpecies
+     * accepted by the spatial limits. Unlimited directions are set to +-HUGE_VAL.
+     * Returns false if the spatial limits don't restrict the box.
+     */
+    bool getSpatialBox(int numSpecies, int rank, double *boxLo, double *boxHi) const;
+
+    /// The columns the predicates depend on as ParticleColumn flags
+    int getColumns() const;
+
+    /// Test a single particle, id is the zero based species index
+    bool accept(int id, double x, double y, int rank, double px, double py, double pz) const
+    {
+      if (id < 0) return true;
+      size_t sid = id;
+      if ((sid < xsmin.size()) && !(x > xsmin[sid])) return false;
+      if ((sid < xsmax.size()) && !(x < xsmax[sid])) return false;
+      if (rank > 1)
+      {
+        if ((sid < ysmin.size()) && !(y > ysmin[sid])) return false;
+        if ((sid < ysmax.size()) && !(y < ysmax[sid])) return false;
+      }
+      if (positivePx && !(px > 0)) return false;
+      if (limitMinGamma || limitMaxGamma)
+      {
+        double gamma2 = 1 + px*px + py*py + pz*pz;
+        if (limitMinGamma && (gamma2 < minGamma2)) return false;
+        if (limitMaxGamma && (gamma2 > maxGamma2)) return false;
+      }
+      return true;
+    }
+
+    /**
+     * Test whether any particle of species id within the bounds can be
+     * accepted. Returns true unless the bounds exclude all particles.
+     */
+    bool mayAccept(int id, int rank, const ParticleBounds &bounds) const;
+
+    /**
+     * Compute the indices of the accepted particles in a chunk of count particles
+     * of species id. Arrays of columns that the filter does not depend on may be null.
+     */
+    void select(int id, int64_t count, int rank, const double *x, const double *y,
+                const double *px, const double *py, const double *pz,
+                std::vector<int64_t> &selection) const;
+};
+typedef boost::shared_ptr<ParticleFilter> pParticleFilter;
+
+#endif /* PARTICLEFILTER_H_ */
@@ -0,0 +1,59 @@
+/*
+ * particlesampler.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "particlesampler.hpp"
+#include "particlechunk.hpp"
+#include "common/binaryio.hpp"
+
+#include <cmath>
+
+ParticleSampler::ParticleSampler(double fraction_, int64_t stretch_, uint64_t seed_)
+  : fraction(fraction_), stretch(stretch_), seed(seed_)
+{
+  if (!(fraction > 0.0) || (fraction > 1.0))
+    throw msdf::GenericException("The sample fraction must lie in (0,1]");
+}
+
+int ParticleSampler::poissonWeight(uint64_t seed, uint64_t key, int replicate)
+{
+  double u = uniform(mix(seed + uint64_t(replicate)), key);
+
+  // invert the cumulative distribution of Poisson(1)
+  int k = 0;
+  double p = exp(-1.0);
+  double cdf = p;
+  while ((u > cdf) && (k < 20))
+  {
+    ++k;
+    p /= k;
+    cdf += p;
+  }
+  return k;
+}
+
+int64_t ParticleSampler::sample(const ParticleChunk &source, ParticleChunk &sample, bool sourceSampled) const
+{
+  int64_t length = source.length();
+  sample.resize(length);
+
+  double factor = getWeightFactor();
+  ArraySpan<const int64_t> rows = source.rows();
+  int64_t kept = 0;
+  for (int64_t i=0; i<length; ++i)
+  {
+    if (!sourceSampled && !keepRow(rows[i])) continue;
+    for (int c=0; c<ParticleChunk::numComponents; ++c)
+      sample.component(c)[kept] = source.component(c)[i];
+    sample.species()[kept] = source.species()[i];
+    sample.rows()[kept] = rows[i];
+    sample.weight()[kept] *= factor;
+    ++kept;
+  }
+  sample.resize(kept);
+  return kept;
+}
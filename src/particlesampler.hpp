@@ -0,0 +1,84 @@
+/*
+ * particlesampler.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef PARTICLESAMPLER_H_
+#define PARTICLESAMPLER_H_
+
+#include <boost/shared_ptr.hpp>
+#include <stdint.h>
+
+class ParticleChunk;
+
+/**
+ * Random decisions for subsampling the particle stream.
+ *
+ * All decisions are computed from a hash of the seed and the row of a
+ * particle (or of a stretch of rows) in the source, counted before any
+ * filter, not from a running random number generator. The sample therefore
+ * doesn't depend on the chunk length, and every pass over the same input
+ * selects the same particles, even when the passes filter differently.
+ */
+class ParticleSampler
+{
+  public:
+    /**
+     * Sample a fraction of the particles. With a positive stretch, SDF
+     * streams keep or skip whole stretches of that many rows; otherwise each
+     * particle is kept independently.
+     */
+    ParticleSampler(double fraction_, int64_t stretch_, uint64_t seed_);
+
+    double getFraction() const { return fraction; }
+    int64_t getStretch() const { return stretch; }
+    uint64_t getSeed() const { return seed; }
+
+    /// The factor by which the weights of the sampled particles are multiplied
+    double getWeightFactor() const { return 1.0/fraction; }
+
+    bool keepRow(int64_t row) const { return uniform(seed, row) < fraction; }
+    bool keepStretch(int64_t stretchIndex) const { return uniform(~seed, stretchIndex) < fraction; }
+
+    /**
+     * Copy the rows of source that are kept into sample and multiply their
+     * weights by the weight factor. With sourceSampled the rows have already
+     * been sampled by the source and all of them are kept. Returns the number
+     * of rows kept.
+     */
+    int64_t sample(const ParticleChunk &source, ParticleChunk &sample, bool sourceSampled = false) const;
+
+    /// A uniform number in [0,1) that only depends on seed and key
+    static double uniform(uint64_t seed, uint64_t key)
+    {
+      return (mix(mix(seed) ^ key) >> 11)*(1.0/9007199254740992.0);
+    }
+
+    /**
+     * The multiplicity of a particle in bootstrap replicate b. The values
+     * are Poisson distributed with mean 1, which approximates resampling
+     * with replacement for large samples.
+     */
+    static int poissonWeight(uint64_t seed, uint64_t key, int replicate);
+
+  private:
+    double fraction;
+    int64_t stretch;
+    uint64_t seed;
+
+    /// The SplitMix64 finaliser
+    static uint64_t mix(uint64_t x)
+    {
+      x += 0x9e3779b97f4a7c15ULL;
+      x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9ULL;
+      x = (x ^ (x >> 27))*0x94d049bb133111ebULL;
+      return x ^ (x >> 31);
+    }
+};
+
+typedef boost::shared_ptr<ParticleSampler> pParticleSampler;
+
+#endif /* PARTICLESAMPLER_H_ */
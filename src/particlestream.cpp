@@ -8,34 +8,96 @@
 
 #include "particlestream.hpp"
 #include "common/binaryio.hpp"
+#include "parallel.hpp"
 #include <ios>
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 #include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/regex.hpp>
+#include <boost/interprocess/file_mapping.hpp>
 
 namespace fs = boost::filesystem;
 namespace po = boost::program_options;
 
+//===========================================================
+//==================    ParticleStream    ===================
+//===========================================================
+
+ParticleStream::ParticleStream()
+    : reportAllocations(false),
+      allocationsAtStart(AllocationStats::getAllocations()),
+      bytesAtStart(AllocationStats::getBytes())
+{}
+
+ParticleStream::~ParticleStream()
+{
+  if (reportAllocations)
+    std::cerr << "Particle stream made " << AllocationStats::getAllocations() - allocationsAtStart
+        << " buffer allocations (" << AllocationStats::getBytes() - bytesAtStart << " bytes)\n";
+}
+
+void ParticleStream::setChunkTuner(pChunkTuner tuner_)
+{
+  tuner = tuner_;
+  if (tuner) setChunkLength(tuner->getLength());
+}
+
+void ParticleStream::tuneChunkLength(int64_t rowsConsumed)
+{
+  if (tuner && tuner->isTuning()) setChunkLength(tuner->update(rowsConsumed));
+}
+
 //===========================================================
 //=================    SdfParticleStream    =================
 //===========================================================
 
+SdfParticleStream::SdfParticleStream(pSdfFile file_, int64_t chunkLength_)
+    : filledLength(0),
+      file(file_),
+      chunkLength(chunkLength_),
+      particleCount(-1),
+      activeCount(0),
+      rank(2)
+{}
+
+void SdfParticleStream::addLengthSource(int64_t length)
+{
+  if (particleCount < 0) particleCount = length;
+  else if (particleCount != length)
+    throw msdf::GenericException("Particle blocks in ParticleStream have different lengths");
+}
+
 void SdfParticleStream::addMesh(std::string blockname)
 {
   if (meshStream.get() == 0)
   {
+    meshBlock = blockname;
     pSdfBlockHeader block = file->getBlockHeader(blockname);
     meshStream = pSdfMeshStream(
         new SdfMeshStream(file->getStream(), file->getHeader(), *block, chunkLength)
     );
-    mesh = pDataGrid2d(new DataGrid2d());
+    rank = meshStream->getRank();
+    particles.setRank(rank);
+    stage.setRank(rank);
+    addLengthSource(meshStream->getLength());
   }
 }
 
 void SdfParticleStream::addSpecies(std::string blockname)
 {
-  this->addMesh(blockname);
-  species = pDataGrid1d(new DataGrid1d());
+  // SDF files store one species per set of blocks, so the species column is
+  // synthesised. Only the metadata of the block is read to obtain the length.
+  pSdfBlockHeader block = file->getBlockHeader(blockname);
+  if (block->getBlockType() == sdf_point_mesh)
+    addLengthSource(
+        SdfMeshStream(file->getStream(), file->getHeader(), *block, chunkLength).getLength()
+    );
+  else
+    addLengthSource(
+        SdfMeshVariableStream(file->getStream(), file->getHeader(), *block, chunkLength).getLength()
+    );
 }
 
 void SdfParticleStream::addWeight(std::string blockname)
@@ -44,234 +106,485 @@ void SdfParticleStream::addWeight(std::string blockname)
   weightStream = pSdfMeshVariableStream(
       new SdfMeshVariableStream(file->getStream(), file->getHeader(), *block, chunkLength)
   );
-  weight = pDataGrid1d(new DataGrid1d());
+  addLengthSource(weightStream->getLength());
 }
 
 void SdfParticleStream::addPx(std::string blockname)
 {
+  pxBlock = blockname;
   pSdfBlockHeader block = file->getBlockHeader(blockname);
   pxStream = pSdfMeshVariableStream(
       new SdfMeshVariableStream(file->getStream(), file->getHeader(), *block, chunkLength)
   );
-  px = pDataGrid1d(new DataGrid1d());
+  addLengthSource(pxStream->getLength());
 }
 
 void SdfParticleStream::addPy(std::string blockname)
 {
+  pyBlock = blockname;
   pSdfBlockHeader block = file->getBlockHeader(blockname);
   pyStream = pSdfMeshVariableStream(
       new SdfMeshVariableStream(file->getStream(), file->getHeader(), *block, chunkLength)
   );
-  py = pDataGrid1d(new DataGrid1d());
+  addLengthSource(pyStream->getLength());
 }
 
 void SdfParticleStream::addPz(std::string blockname)
 {
+  pzBlock = blockname;
   pSdfBlockHeader block = file->getBlockHeader(blockname);
   pzStream = pSdfMeshVariableStream(
       new SdfMeshVariableStream(file->getStream(), file->getHeader(), *block, chunkLength)
   );
-  pz = pDataGrid1d(new DataGrid1d());
+  addLengthSource(pzStream->getLength());
 }
 
-bool SdfParticleStream::eos()
+void SdfParticleStream::setZoneMap(pZoneMap zoneMap_)
 {
-  if (meshStream) return meshStream->eos();
-  else return getValidVarStream()->eos();
-}
+  zoneMap = zoneMap_;
+  zones = ParticleZones();
+  if (!zoneMap || (particleCount < 0)) return;
+
+  int64_t zoneLength = zoneMap->getZoneLength();
+  int64_t zoneCount = (particleCount + zoneLength - 1)/zoneLength;
+
+  // Columns that are missing from the zone map or don't match the block are
+  // not used for skipping zones
+  std::string names[5];
+  const ZoneColumn **targets[5] = { &zones.x, &zones.y, &zones.px, &zones.py, &zones.pz };
+  if (meshStream)
+  {
+    names[0] = ZoneMap::meshColumnName(meshBlock, 0);
+    if (rank > 1) names[1] = ZoneMap::meshColumnName(meshBlock, 1);
+  }
+  if (pxStream) names[2] = pxBlock;
+  if (pyStream) names[3] = pyBlock;
+  if (pzStream) names[4] = pzBlock;
 
-pSdfMeshVariableStream SdfParticleStream::getValidVarStream()
-{
-  if (weightStream) return weightStream;
-  if (pxStream) return pxStream;
-  if (pyStream) return pyStream;
-  if (pzStream) return pzStream;
+  for (int c=0; c<5; ++c)
+  {
+    if (names[c].empty() || !zoneMap->hasColumn(names[c])) continue;
+    const ZoneColumn &column = zoneMap->getColumn(names[c]);
+    if (column.getZoneCount() == zoneCount) *targets[c] = &column;
+  }
 
-  throw msdf::GenericException("No particle block specified in ParticleStream");
+  // both mesh dimensions are needed to bound the positions
+  if ((rank > 1) && !(zones.x && zones.y)) zones.x = zones.y = 0;
 }
 
-void SdfParticleStream::getNextChunks()
+int SdfParticleStream::getPrecision(int column)
 {
-  if (eos()) return;
-  if (meshStream) meshStream->getMeshChunk(mesh);
-  if (weightStream) weightStream->getMeshChunk(weight);
-  if (pxStream) pxStream->getMeshChunk(px);
-  if (pyStream) pyStream->getMeshChunk(py);
-  if (pzStream) pzStream->getMeshChunk(pz);
-  if (species) {
-    species->resize(GridIndex1d(mesh->getDims()[1]));
-    (*species) = 1.0;
+  switch (column)
+  {
+    case pc_mesh: if (meshStream) return meshStream->getPrecision(); break;
+    case pc_px: if (pxStream) return pxStream->getPrecision(); break;
+    case pc_py: if (pyStream) return pyStream->getPrecision(); break;
+    case pc_pz: if (pzStream) return pzStream->getPrecision(); break;
+    case pc_weight: if (weightStream) return weightStream->getPrecision(); break;
   }
+  return sizeof(double);
 }
 
-//===========================================================
-//=================    RawParticleStream    =================
-//===========================================================
+bool SdfParticleStream::eos()
+{
+  if (particleCount < 0)
+    throw msdf::GenericException("No particle block specified in ParticleStream");
+  return activeCount > particleCount;
+}
 
+void SdfParticleStream::fillPrunedColumns(int64_t chsize)
+{
+  // Columns that have not been opened are presented as zeros and the species
+  // as 1. The arrays of the chunk keep their content when the chunk is resized,
+  // so only rows that have never been filled need to be written.
+  if (chsize <= filledLength) return;
 
-RawParticleStream::RawParticleStream(std::string file_, int64_t dataLength_)
-    : file(file_),
-      dataLength(dataLength_),
-      end_reached(false)
+  bool pruned[ParticleChunk::numComponents] = {
+      !meshStream, !meshStream || (rank < 2), !meshStream || (rank < 3),
+      !pxStream, !pyStream, !pzStream, !weightStream };
+
+  for (int c=0; c<ParticleChunk::numComponents; ++c)
+    if (pruned[c])
+      std::fill(particles.component(c).begin() + filledLength, particles.component(c).begin() + chsize, 0.0);
+  std::fill(particles.species().begin() + filledLength, particles.species().begin() + chsize, 1);
+
+  filledLength = chsize;
+}
+
+void SdfParticleStream::readMesh(ParticleChunk &target, int64_t first, int64_t count)
 {
-//  stream.open((file + ".000").c_str());
+  double *rows[3] = { target.x().data(), target.y().data(), target.z().data() };
+  meshStream->getMeshChunk(rows, first, count);
+}
 
-//  readHeader();
-  initStream();
+namespace {
+  /// Copy the selected rows of src, which starts at row offset of the chunk, into dst
+  void gatherRows(const double *src, int64_t offset,
+                  const std::vector<int64_t> &selection, double *dst)
+  {
+    int64_t count = selection.size();
+    for (int64_t i=0; i<count; ++i) dst[i] = src[selection[i] - offset];
+  }
+}
 
-  mesh = pDataGrid2d(new DataGrid2d());
-  species = pDataGrid1d(new DataGrid1d());
-  px = pDataGrid1d(new DataGrid1d());
-  py = pDataGrid1d(new DataGrid1d());
-  pz = pDataGrid1d(new DataGrid1d());
-  weight = pDataGrid1d(new DataGrid1d());
-  buffer.resize(GridIndex1d(6*dataLength));
-  speciesBuffer.resize(GridIndex1d(dataLength));
+bool SdfParticleStream::findCandidateRows(int64_t chunkStart, int64_t chsize, int64_t &first, int64_t &count)
+{
+  first = 0;
+  count = chsize;
+  if (!zoneMap) return true;
+  return zoneMap->findCandidateRows(zones, *filter, rank, chunkStart, chsize, first, count);
 }
 
-bool RawParticleStream::eos()
+void SdfParticleStream::skipChunks()
 {
-  return end_reached;
+  if (meshStream) meshStream->skipChunk();
+  if (pxStream) pxStream->skipChunk();
+  if (pyStream) pyStream->skipChunk();
+  if (pzStream) pzStream->skipChunk();
+  if (weightStream) weightStream->skipChunk();
 }
 
-void RawParticleStream::getNextChunks()
+void SdfParticleStream::setStreamChunkLength(int64_t length)
 {
-  if (chunk_size == 0) {
-    end_reached = true;
-    return;
-  }
-  float *data = (float*)buffer.getRawData();
-  char *ch = (char*)data;
-  int pos = 0;
+  if (meshStream) meshStream->setChunkLength(length);
+  if (weightStream) weightStream->setChunkLength(length);
+  if (pxStream) pxStream->setChunkLength(length);
+  if (pyStream) pyStream->setChunkLength(length);
+  if (pzStream) pzStream->setChunkLength(length);
+}
 
-  int64_t data_remainder = dataLength;
+/*
+ * The number of rows of the next chunk. With a stretch sampler the stretches
+ * that are not selected are skipped first, and the chunk ends at the end of
+ * the current stretch. The streams are set to the size of the chunk so that
+ * they stay aligned with the stretches.
+ */
+int64_t SdfParticleStream::nextChunkSize()
+{
+  if (!sampler || (sampler->getStretch() <= 0))
+    return std::min(chunkLength, particleCount - activeCount);
 
-  while (chunk_remainder <= data_remainder)
+  int64_t stretch = sampler->getStretch();
+  while ((activeCount < particleCount) && !sampler->keepStretch(activeCount/stretch))
   {
-    stream.read(ch, 6*chunk_remainder*sizeof(float));
-    for (int i=0; i<chunk_remainder; ++i) speciesBuffer(pos+i) = species_count;
-    data_remainder -= chunk_remainder;
-    ch += 6*chunk_remainder*sizeof(float);
-    pos += chunk_remainder;
+    int64_t skip = std::min((activeCount/stretch + 1)*stretch, particleCount) - activeCount;
+    setStreamChunkLength(skip);
+    skipChunks();
+    activeCount += skip;
+  }
 
-    advanceChunk();
+  int64_t stretchEnd = (activeCount/stretch + 1)*stretch;
+  int64_t chsize = std::min(std::min(chunkLength, stretchEnd - activeCount), particleCount - activeCount);
+  if (chsize > 0) setStreamChunkLength(chsize);
+  return chsize;
+}
 
-    if (chunk_size==0) break;
-  }
+/*
+ * Reads the columns the filter depends on first and evaluates the predicates.
+ * Chunks without any selected particles are skipped in the remaining streams.
+ * Otherwise only the range of rows spanned by the selection is read from the
+ * remaining streams, and the selected rows are gathered into the output grids.
+ */
+void SdfParticleStream::getNextFilteredChunks()
+{
+  int filterColumns = filter->getColumns();
 
-  if ((data_remainder != 0) && (chunk_size != 0))
-  {
-    stream.read(ch, 6*data_remainder*sizeof(float));
-    for (int i=0; i<data_remainder; ++i) speciesBuffer(pos+i) = species_count;
+  if (((filterColumns & pc_mesh) && !meshStream) ||
+      ((filterColumns & pc_px) && !pxStream) ||
+      ((filterColumns & pc_py) && !pyStream) ||
+      ((filterColumns & pc_pz) && !pzStream))
+    throw msdf::GenericException("ParticleStream is missing a block required by the particle filter");
 
-    chunk_remainder -= data_remainder;
-    data_remainder = 0;
-  }
+  // the number of selected particles varies, allocate for a full chunk up front
+  int64_t maxChunk = std::min(chunkLength, particleCount);
+  stage.reserve(maxChunk);
+  particles.reserve(maxChunk);
+  selection.reserve(maxChunk);
 
-  int dataRead =  dataLength - data_remainder;
-  if (species->getDims()[0] != dataRead)
+  while (true)
   {
-    mesh->resize(GridIndex2d(2,dataRead));
-    weight->resize(GridIndex1d(dataRead));
-    px->resize(GridIndex1d(dataRead));
-    py->resize(GridIndex1d(dataRead));
-    pz->resize(GridIndex1d(dataRead));
-    species->resize(GridIndex1d(dataRead));
-  }
+    if (eos()) return;
 
-  int bufPos = 0;
-  char *ch_it = ch;
-  for (int i=0; i<dataRead; ++i)
-  {
-    (*mesh)(0,i) = buffer(bufPos);
-    (*mesh)(1,i) = buffer(bufPos+1);
+    int64_t chsize = nextChunkSize();
+    if (chsize <= 0)
+    {
+      activeCount = particleCount + 1;
+      return;
+    }
+    int64_t chunkStart = activeCount;
+    activeCount += chsize;
 
-    (*px)(i) = buffer(bufPos+2);
-    (*py)(i) = buffer(bufPos+3);
-    (*pz)(i) = buffer(bufPos+4);
+    // only the rows of zones that may contain accepted particles are read
+    int64_t zoneFirst, zoneCount;
+    if (!findCandidateRows(chunkStart, chsize, zoneFirst, zoneCount))
+    {
+      skipChunks();
+      continue;
+    }
+
+    stage.resize(zoneCount);
+    if (filterColumns & pc_mesh) readMesh(stage, zoneFirst, zoneCount);
+    if (filterColumns & pc_px) pxStream->getMeshChunk(stage.px().data(), zoneFirst, zoneCount);
+    if (filterColumns & pc_py) pyStream->getMeshChunk(stage.py().data(), zoneFirst, zoneCount);
+    if (filterColumns & pc_pz) pzStream->getMeshChunk(stage.pz().data(), zoneFirst, zoneCount);
+
+    filter->select(0, zoneCount, rank,
+                   (filterColumns & pc_mesh) ? stage.x().data() : 0,
+                   (filterColumns & pc_mesh) ? stage.y().data() : 0,
+                   (filterColumns & pc_px) ? stage.px().data() : 0,
+                   (filterColumns & pc_py) ? stage.py().data() : 0,
+                   (filterColumns & pc_pz) ? stage.pz().data() : 0,
+                   selection);
+
+    if (selection.empty())
+    {
+      if (meshStream && !(filterColumns & pc_mesh)) meshStream->skipChunk();
+      if (pxStream && !(filterColumns & pc_px)) pxStream->skipChunk();
+      if (pyStream && !(filterColumns & pc_py)) pyStream->skipChunk();
+      if (pzStream && !(filterColumns & pc_pz)) pzStream->skipChunk();
+      if (weightStream) weightStream->skipChunk();
+      continue;
+    }
+
+    // make the selection relative to the start of the chunk
+    if (zoneFirst > 0)
+      for (size_t i=0; i<selection.size(); ++i) selection[i] += zoneFirst;
+
+    // the span of the selection lies within the rows already staged
+    int64_t first = selection.front();
+    int64_t count = selection.back() - first + 1;
+    particles.resize(selection.size());
+    ArraySpan<int64_t> rows = particles.rows();
+    for (size_t i=0; i<selection.size(); ++i) rows[i] = chunkStart + selection[i];
+
+    if (meshStream)
+    {
+      int64_t offset = zoneFirst;
+      if (!(filterColumns & pc_mesh))
+      {
+        readMesh(stage, first, count);
+        offset = first;
+      }
+      for (int d=0; d<rank; ++d)
+        gatherRows(stage.position(d).data(), offset, selection, particles.position(d).data());
+    }
 
-    (*weight)(i) = buffer(bufPos+5);
+    pSdfMeshVariableStream varStreams[4] = { pxStream, pyStream, pzStream, weightStream };
+    int components[4] = { ParticleChunk::PX, ParticleChunk::PY, ParticleChunk::PZ, ParticleChunk::WEIGHT };
+    int flags[4] = { pc_px, pc_py, pc_pz, pc_weight };
 
-    (*species)(i) = speciesBuffer(i);
+    for (int c=0; c<4; ++c)
+    {
+      if (!varStreams[c]) continue;
+      double *staged = stage.component(components[c]).data();
+      int64_t offset = zoneFirst;
+      if (!(filterColumns & flags[c]))
+      {
+        varStreams[c]->getMeshChunk(staged, first, count);
+        offset = first;
+      }
+      gatherRows(staged, offset, selection, particles.component(components[c]).data());
+    }
 
-    bufPos = bufPos + 6;
+    fillPrunedColumns(selection.size());
+    return;
   }
 }
 
-void RawParticleStream::readHeader()
+void SdfParticleStream::setChunkLength(int64_t length)
 {
-  msdf::detail::readValue(stream,count_i);
-  msdf::detail::readValue(stream,rank);
-  msdf::detail::readValue(stream,n_species);
-  msdf::detail::readValue(stream,chunk);
+  chunkLength = length;
+  setStreamChunkLength(length);
+}
+
+void SdfParticleStream::getNextChunks()
+{
+  if (!eos()) tuneChunkLength(activeCount);
+
+  if (filter && filter->isActive())
+  {
+    getNextFilteredChunks();
+    return;
+  }
 
-  msdf::detail::readValue(stream,x_min);
-  msdf::detail::readValue(stream,x_max);
-  msdf::detail::readValue(stream,y_min);
-  msdf::detail::readValue(stream,y_max);
+  if (eos()) return;
 
-  species_count = 0;
-  chunk_size = 0;
+  int64_t chsize = nextChunkSize();
+  if (chsize <= 0)
+  {
+    activeCount = particleCount + 1;
+    return;
+  }
 
-  while ((chunk_size == 0) && (species_count < n_species)) readSpeciesHeader();
+  particles.resize(chsize);
+  particles.fillRows(activeCount);
+  if (meshStream) readMesh(particles, 0, chsize);
+  if (weightStream) weightStream->getMeshChunk(particles.weight().data(), 0, chsize);
+  if (pxStream) pxStream->getMeshChunk(particles.px().data(), 0, chsize);
+  if (pyStream) pyStream->getMeshChunk(particles.py().data(), 0, chsize);
+  if (pzStream) pzStream->getMeshChunk(particles.pz().data(), 0, chsize);
+  fillPrunedColumns(chsize);
+
+  activeCount += chsize;
 }
 
-void RawParticleStream::readSpeciesHeader()
+//===========================================================
+//=================    RawParticleStream    =================
+//===========================================================
+
+
+RawParticleStream::RawParticleStream(std::string file_, int64_t dataLength_, int numThreads_)
+    : file(file_),
+      dataLength(dataLength_),
+      numThreads(std::max(1, numThreads_)),
+      activeSegment(0),
+      segmentRow(0),
+      rowsRead(0),
+      end_reached(false)
 {
-//  std::cout << "readSpeciesHeader = " << species_count << "\n";
-  ++species_count;
-  msdf::detail::readValue(stream,npleft);
-  msdf::detail::readValue(stream,spcharge);
-  msdf::detail::readValue(stream,spmass);
+  initStream();
+
+  buffer.resize(6*dataLength);
+  speciesBuffer.resize(dataLength);
+}
 
-//  std::cout << "readSpeciesHeader = " << npleft<< " : " << spcharge << ":" << spmass << "\n";
+bool RawParticleStream::eos()
+{
+  return end_reached;
+}
 
-  readChunkHeader();
+void RawParticleStream::setChunkLength(int64_t length)
+{
+  dataLength = length;
+  buffer.resize(6*dataLength);
+  speciesBuffer.resize(dataLength);
 }
 
-void RawParticleStream::readChunkHeader()
+/*
+ * Reads the planned parts of the segments into the buffer. Each thread keeps
+ * a file handle and only reopens it when its next read is in another piece.
+ */
+void RawParticleStream::readRecords()
 {
-  msdf::detail::readValue(stream,chunk_size);
-  chunk_remainder = chunk_size;
-//  std::cout << "readChunkHeader = " << chunk_size << "\n";
+  int threads = std::min(int(reads.size()), numThreads);
+  streams.resize(numThreads);
+  openPieces.resize(numThreads, -1);
+  std::vector<int> failed(threads, 0);
+
+  parallelFor(threads, threads, [&](int t)
+  {
+    for (size_t r=t; r<reads.size(); r+=threads)
+    {
+      const Read &read = reads[r];
+      const RawSegment &segment = index.getSegments()[read.segment];
+      if (openPieces[t] != segment.piece)
+      {
+        streams[t].reset(new std::ifstream(index.getPiece(segment.piece).c_str(), std::ios::binary));
+        openPieces[t] = segment.piece;
+      }
+
+      std::ifstream &stream = *streams[t];
+      stream.seekg(segment.offset + read.first*RawIndex::recordBytes);
+      stream.read((char*)&buffer[6*read.dest], read.count*RawIndex::recordBytes);
+      if (!stream)
+      {
+        failed[t] = 1;
+        openPieces[t] = -1;
+        return;
+      }
+      std::fill(speciesBuffer.begin() + read.dest, speciesBuffer.begin() + read.dest + read.count, segment.species);
+    }
+  });
+
+  for (int t=0; t<threads; ++t)
+    if (failed[t]) throw msdf::GenericException("Could not read the particle records of raw file " + file);
 }
 
-void RawParticleStream::advanceChunk()
+void RawParticleStream::getNextChunks()
 {
-//  std::cout << "advanceChunk = " << chunk << " : " << chunk_size << ":" << species_count <<"\n";
-  if (chunk_size == chunk)
+  if (end_reached) return;
+  tuneChunkLength(rowsRead);
+
+  // split the chunk into parts of segments of roughly equal size
+  const std::vector<RawSegment> &segments = index.getSegments();
+  int64_t maxRead = std::max(int64_t(4096), (dataLength + numThreads - 1)/numThreads);
+  int64_t dataRead = 0;
+  reads.clear();
+  while ((dataRead < dataLength) && (activeSegment < segments.size()))
   {
-    readChunkHeader();
+    Read read;
+    read.segment = activeSegment;
+    read.first = segmentRow;
+    read.count = std::min(std::min(segments[activeSegment].count - segmentRow, dataLength - dataRead), maxRead);
+    read.dest = dataRead;
+    reads.push_back(read);
+
+    dataRead += read.count;
+    segmentRow += read.count;
+    if (segmentRow == segments[activeSegment].count)
+    {
+      ++activeSegment;
+      segmentRow = 0;
+    }
   }
-  else
+
+  if (dataRead == 0)
   {
-    chunk_size=0;
-    chunk_remainder=0;
+    end_reached = true;
+    return;
   }
 
-  while ((chunk_size == 0) && ((fname_iter != filenames.end()) || (species_count < n_species)) )
+  readRecords();
+  particles.resize(dataRead);
+  particles.fillRows(rowsRead);
+  rowsRead += dataRead;
+
+  if (filter && filter->isActive())
   {
-//    std::cout << "advanceChunk A\n";
-    while ((chunk_size == 0) && (species_count < n_species)) readSpeciesHeader();
-    if ((chunk_size == 0) && (fname_iter != filenames.end())) advanceStream();
+    // compact the accepted records to the front of the buffer
+    ArraySpan<int64_t> rows = particles.rows();
+    int64_t accepted = 0;
+    for (int64_t i=0; i<dataRead; ++i)
+    {
+      float *rec = &buffer[6*i];
+      if (filter->accept(speciesBuffer[i] - 1, rec[0], rec[1], 2, rec[2], rec[3], rec[4]))
+      {
+        if (accepted != i)
+        {
+          for (int k=0; k<6; ++k) buffer[6*accepted + k] = rec[k];
+          speciesBuffer[accepted] = speciesBuffer[i];
+          rows[accepted] = rows[i];
+        }
+        ++accepted;
+      }
+    }
+    dataRead = accepted;
   }
 
-  if (chunk_size <0) exit(-1);
+  // the records are interleaved in the file, the chunk holds one array per component
+  particles.resize(dataRead);
+  std::copy(speciesBuffer.begin(), speciesBuffer.begin() + dataRead, particles.species().begin());
+
+  const int64_t block = 65536;
+  int numBlocks = (dataRead + block - 1)/block;
+  parallelFor(numBlocks, numThreads, [&](int b)
+  {
+    int64_t first = b*block;
+    double *dst[6] = {
+        particles.x().data() + first, particles.y().data() + first,
+        particles.px().data() + first, particles.py().data() + first,
+        particles.pz().data() + first, particles.weight().data() + first };
+    deinterleaveRecords(&buffer[6*first], std::min(block, dataRead - first), dst);
+  });
 }
 
 void RawParticleStream::initStream()
 {
-  int maxFNode = 0;
-  int maxNode = 0;
-
   std::string filename = fs::path(file).filename().string();
   fs::path dir(file);
   dir.remove_filename();
   if (dir.empty()) dir /= ".";
 
-//  std::cerr << "filename = " << filename << "\n";
-//
-//  std::cerr << "dir = " << dir.string() << "\n";
   if ( !fs::exists( dir ) ) {
     end_reached = true;
     return;
@@ -279,14 +592,13 @@ void RawParticleStream::initStream()
 
   boost::regex fileRegex(filename + "\\.(\\d*)");
   boost::smatch regexMatch;
-
+  std::map<int, std::string> filenames;
 
   fs::directory_iterator end_itr; // default construction yields past-the-end
   for ( fs::directory_iterator itr( dir );
         itr != end_itr;
         ++itr )
   {
-//    std::cerr << itr->path() << "\n";
     if ( is_directory(itr->status()) ) continue;
     std::string entry = itr->path().filename().string();
     if(boost::regex_match(entry, regexMatch, fileRegex, boost::match_extra))
@@ -294,51 +606,505 @@ void RawParticleStream::initStream()
       std::istringstream sstr(regexMatch[1]);
       int nnum;
       sstr >> nnum;
-      if (maxFNode<nnum) maxFNode = nnum;
       filenames[nnum] = itr->path().string();
     }
+  }
+
+  // the pieces are streamed in the order of their numbers
+  std::vector<std::string> pieces;
+  for (std::map<int, std::string>::iterator it=filenames.begin(); it!=filenames.end(); ++it)
+    pieces.push_back(it->second);
+
+  index = RawIndex(pieces, numThreads);
+  std::cerr << "Indexed " << index.getNumPieces() << " raw files with "
+      << index.getTotalRows() << " particles\n";
+}
+
+
+//===========================================================
+//=================    CacheParticleStream    ===============
+//===========================================================
+
+CacheParticleStream::CacheParticleStream(std::string file_, int64_t chunkLength_, int columns_)
+    : stream(file_.c_str(), std::ios::binary),
+      chunkLength(chunkLength_),
+      columns(columns_),
+      activeRange(0),
+      activeRow(0),
+      rowsRead(0),
+      rangesReady(false),
+      end_reached(false)
+{
+  cache.readHeader(stream);
+  particles.setRank(cache.getRank());
+  stage.resize(cache.getNumColumns());
+}
+
+bool CacheParticleStream::eos()
+{
+  return end_reached;
+}
+
+/*
+ * The filter is only known after construction, so the ranges of rows are
+ * determined when the first chunk is requested.
+ */
+void CacheParticleStream::initRanges()
+{
+  rangesReady = true;
+  double boxLo[3], boxHi[3];
+
+  if (filter && filter->getSpatialBox(cache.getNumSpecies(), cache.getRank(), boxLo, boxHi))
+    cache.findRanges(boxLo, boxHi, ranges);
+  else if (cache.getCount() > 0)
+    ranges.push_back(std::make_pair(int64_t(0), cache.getCount()));
+
+  if (filter) columns |= filter->getColumns();
+}
+
+void CacheParticleStream::getNextChunks()
+{
+  if (!rangesReady) initRanges();
+  tuneChunkLength(rowsRead);
+
+  int rank = cache.getRank();
+  int flags[ParticleCache::numValueColumns] = { pc_species, pc_px, pc_py, pc_pz, pc_weight };
+  bool filtered = filter && filter->isActive();
+
+  while (true)
+  {
+    if (activeRange >= ranges.size())
+    {
+      end_reached = true;
+      return;
+    }
+
+    // collect the segments of the ranges that make up the next chunk
+    segments.clear();
+    int64_t chsize = 0;
+    while ((chsize < chunkLength) && (activeRange < ranges.size()))
+    {
+      int64_t first = std::max(activeRow, ranges[activeRange].first);
+      int64_t count = std::min(chunkLength - chsize, ranges[activeRange].second - first);
+      segments.push_back(std::make_pair(first, count));
+      chsize += count;
+      rowsRead += count;
+      activeRow = first + count;
+      if (activeRow >= ranges[activeRange].second) ++activeRange;
+    }
 
+    for (int c=0; c<cache.getNumColumns(); ++c)
+    {
+      bool needed = (c < rank) ? (columns & pc_mesh) : (columns & flags[c - rank]);
+      std::vector<double> &column = stage[c];
+      if (!needed)
+      {
+        // species are 1 for pruned columns, as in the SDF stream
+        column.assign(chsize, (c == rank + ParticleCache::col_species) ? 1.0 : 0.0);
+        continue;
+      }
+      column.resize(chsize);
+      int64_t pos = 0;
+      for (size_t s=0; s<segments.size(); ++s)
+      {
+        stream.seekg(cache.columnOffset(c, segments[s].first));
+        stream.read((char*)&column[pos], segments[s].second*sizeof(double));
+        pos += segments[s].second;
+      }
+    }
+    if (!stream)
+      throw msdf::GenericException("Error reading particle cache");
+
+    accepted.clear();
+    for (int64_t i=0; i<chsize; ++i)
+    {
+      if (!filtered ||
+          filter->accept(int(stage[rank + ParticleCache::col_species][i]) - 1,
+                         stage[0][i], (rank > 1) ? stage[1][i] : 0.0, rank,
+                         stage[rank + ParticleCache::col_px][i],
+                         stage[rank + ParticleCache::col_py][i],
+                         stage[rank + ParticleCache::col_pz][i]))
+        accepted.push_back(i);
+    }
+    if (accepted.empty()) continue;
+
+    int64_t count = accepted.size();
+    particles.resize(count);
+    for (int d=0; d<rank; ++d)
+      gatherRows(&stage[d][0], 0, accepted, particles.position(d).data());
+
+    int components[ParticleCache::numValueColumns] =
+      { -1, ParticleChunk::PX, ParticleChunk::PY, ParticleChunk::PZ, ParticleChunk::WEIGHT };
+    for (int c=ParticleCache::col_px; c<ParticleCache::numValueColumns; ++c)
+      gatherRows(&stage[rank + c][0], 0, accepted, particles.component(components[c]).data());
+
+    const std::vector<double> &ids = stage[rank + ParticleCache::col_species];
+    ArraySpan<int32_t> species = particles.species();
+    for (int64_t i=0; i<count; ++i) species[i] = int32_t(ids[accepted[i]]);
+
+    // the rows of the cache, the staged rows are the segments one after another
+    ArraySpan<int64_t> rows = particles.rows();
+    size_t s = 0;
+    int64_t segmentStart = 0;
+    for (int64_t i=0; i<count; ++i)
+    {
+      while (accepted[i] >= segmentStart + segments[s].second) segmentStart += segments[s++].second;
+      rows[i] = segments[s].first + accepted[i] - segmentStart;
+    }
+    return;
   }
-  fname_iter = filenames.begin();
-  advanceStream();
 }
 
+//===========================================================
+//===============    ColumnarParticleStream    ==============
+//===========================================================
 
-void RawParticleStream::openStream()
+ColumnarParticleStream::ColumnarParticleStream(std::string dir, int64_t chunkLength_, int columns_)
+    : chunkLength(chunkLength_),
+      columns(columns_),
+      initialised(false),
+      end_reached(false),
+      activeSpecies(0),
+      activeChunk(0),
+      rowsRead(0),
+      mapped(false)
 {
-  std::string fname = fname_iter->second;
+  cache.readManifest(dir);
+  for (int c=0; c<ColumnarCache::numColumns; ++c) base[c] = 0;
+  particles.setRank(cache.getRank());
+}
 
-  if (stream.is_open()) stream.close();
-  std::cerr << "Reading file " << fname << "\n";
-  stream.open(fname.c_str());
+bool ColumnarParticleStream::eos()
+{
+  return end_reached;
 }
 
-void RawParticleStream::advanceStream()
+int ColumnarParticleStream::getPrecision(int column)
 {
-  if (fname_iter != filenames.end())
+  switch (column)
   {
-    openStream();
-    readHeader();
+    case pc_mesh: return cache.getPrecision(ColumnarCache::cc_x);
+    case pc_px: return cache.getPrecision(ColumnarCache::cc_px);
+    case pc_py: return cache.getPrecision(ColumnarCache::cc_py);
+    case pc_pz: return cache.getPrecision(ColumnarCache::cc_pz);
+    case pc_weight: return cache.getPrecision(ColumnarCache::cc_weight);
   }
-  else
+  return sizeof(double);
+}
+
+void ColumnarParticleStream::mapSpecies()
+{
+  namespace bip = boost::interprocess;
+  const ColumnarCache::Species &sp = cache.getSpecies()[activeSpecies];
+  int flags[ColumnarCache::numColumns] = { pc_mesh, pc_mesh, pc_mesh, pc_px, pc_py, pc_pz, pc_weight };
+
+  for (int c=0; c<ColumnarCache::numColumns; ++c)
+  {
+    regions[c].reset();
+    base[c] = 0;
+    if ((cache.getPrecision(c) == 0) || !(columns & flags[c]) || (sp.count == 0)) continue;
+
+    bip::file_mapping file(cache.columnFile(sp, c).c_str(), bip::read_only);
+    regions[c] = boost::shared_ptr<bip::mapped_region>(new bip::mapped_region(file, bip::read_only));
+    if (int64_t(regions[c]->get_size()) < sp.count*cache.getPrecision(c))
+      throw msdf::GenericException("Column file " + cache.columnFile(sp, c) + " is too short");
+    base[c] = static_cast<const char*>(regions[c]->get_address());
+  }
+  mapped = true;
+}
+
+bool ColumnarParticleStream::chunkMayMatch(const ColumnarCache::Species &sp, int64_t chunk) const
+{
+  ParticleBounds bounds;
+  if (cache.getPrecision(ColumnarCache::cc_x) != 0)
   {
-    chunk_size=0;
-    chunk_remainder=0;
+    bounds.columns |= pc_mesh;
+    bounds.xmin = sp.stats[ColumnarCache::cc_x].minval[chunk];
+    bounds.xmax = sp.stats[ColumnarCache::cc_x].maxval[chunk];
+    if (cache.getRank() > 1)
+    {
+      bounds.ymin = sp.stats[ColumnarCache::cc_y].minval[chunk];
+      bounds.ymax = sp.stats[ColumnarCache::cc_y].maxval[chunk];
+    }
   }
-  ++fname_iter;
+
+  int momentumColumns[3] = { ColumnarCache::cc_px, ColumnarCache::cc_py, ColumnarCache::cc_pz };
+  int momentumFlags[3] = { pc_px, pc_py, pc_pz };
+  double *mins[3] = { &bounds.pxmin, &bounds.pymin, &bounds.pzmin };
+  double *maxs[3] = { &bounds.pxmax, &bounds.pymax, &bounds.pzmax };
+  for (int m=0; m<3; ++m)
+  {
+    int c = momentumColumns[m];
+    if (cache.getPrecision(c) == 0) continue;
+    bounds.columns |= momentumFlags[m];
+    *mins[m] = sp.stats[c].minval[chunk];
+    *maxs[m] = sp.stats[c].maxval[chunk];
+  }
+
+  return filter->mayAccept(sp.id - 1, cache.getRank(), bounds);
 }
 
+void ColumnarParticleStream::getNextChunks()
+{
+  if (!initialised)
+  {
+    if (filter) columns |= filter->getColumns();
+    initialised = true;
+  }
+  tuneChunkLength(rowsRead);
+
+  int rank = cache.getRank();
+  bool filtered = filter && filter->isActive();
+  const std::vector<ColumnarCache::Species> &speciesList = cache.getSpecies();
+  int64_t chunkRows = cache.getChunkRows();
+
+  while (true)
+  {
+    if (activeSpecies >= speciesList.size())
+    {
+      end_reached = true;
+      return;
+    }
+
+    const ColumnarCache::Species &sp = speciesList[activeSpecies];
+    if (!mapped) mapSpecies();
+    int64_t numChunks = (sp.count + chunkRows - 1)/chunkRows;
+
+    // select the rows of the stored chunks that make up the next chunk
+    selection.clear();
+    while ((activeChunk < numChunks) && (selection.empty() || (int64_t(selection.size()) + chunkRows <= chunkLength)))
+    {
+      int64_t chunk = activeChunk++;
+      int64_t first = chunk*chunkRows;
+      int64_t end = std::min(first + chunkRows, sp.count);
+      rowsRead += end - first;
+      if (filtered && !chunkMayMatch(sp, chunk)) continue;
+
+      for (int64_t row=first; row<end; ++row)
+      {
+        if (filtered &&
+            !filter->accept(sp.id - 1,
+                            base[ColumnarCache::cc_x] ? value(ColumnarCache::cc_x, row) : 0.0,
+                            ((rank > 1) && base[ColumnarCache::cc_y]) ? value(ColumnarCache::cc_y, row) : 0.0,
+                            rank,
+                            base[ColumnarCache::cc_px] ? value(ColumnarCache::cc_px, row) : 0.0,
+                            base[ColumnarCache::cc_py] ? value(ColumnarCache::cc_py, row) : 0.0,
+                            base[ColumnarCache::cc_pz] ? value(ColumnarCache::cc_pz, row) : 0.0))
+          continue;
+        selection.push_back(row);
+      }
+    }
+
+    int64_t count = selection.size();
+    if (count > 0)
+    {
+      // the cache columns are in the order of the chunk components
+      particles.resize(count);
+      particles.fillSpecies(sp.id);
+
+      // the rows are counted through the species one after another
+      int64_t speciesFirst = 0;
+      for (size_t k=0; k<activeSpecies; ++k) speciesFirst += speciesList[k].count;
+      ArraySpan<int64_t> rows = particles.rows();
+      for (int64_t i=0; i<count; ++i) rows[i] = speciesFirst + selection[i];
+
+      for (int c=0; c<ColumnarCache::numColumns; ++c)
+      {
+        if ((c <= ColumnarCache::cc_z) && (c >= rank)) continue;
+        if (base[c])
+        {
+          ArraySpan<double> out = particles.component(c);
+          for (int64_t i=0; i<count; ++i) out[i] = value(c, selection[i]);
+        }
+        else particles.fill(c, 0.0);
+      }
+    }
+
+    if (activeChunk >= numChunks)
+    {
+      ++activeSpecies;
+      activeChunk = 0;
+      mapped = false;
+    }
+
+    if (count > 0) return;
+  }
+}
+
+//===========================================================
+//===============    SampledParticleStream    ===============
+//===========================================================
+
+SampledParticleStream::SampledParticleStream(pParticleStream source_, pParticleSampler sampler_, bool sourceSamples_)
+    : source(source_),
+      sampler(sampler_),
+      sourceSamples(sourceSamples_),
+      rowsRead(0),
+      sampleSize(0),
+      seed(sampler_->getSeed()),
+      chunkLength(ChunkTuner::defaultLength(sizeof(double), sizeof(double))),
+      reservoirFilled(false),
+      nextRecord(0),
+      reservoirFactor(1.0),
+      end_reached(false)
+{
+  particles.setRank(source->getRank());
+}
+
+SampledParticleStream::SampledParticleStream(pParticleStream source_, int64_t sampleSize_, uint64_t seed_)
+    : source(source_),
+      sourceSamples(false),
+      rowsRead(0),
+      sampleSize(sampleSize_),
+      seed(seed_),
+      chunkLength(ChunkTuner::defaultLength(sizeof(double), sizeof(double))),
+      reservoirFilled(false),
+      nextRecord(0),
+      reservoirFactor(1.0),
+      end_reached(false)
+{
+  if (sampleSize < 1) throw msdf::GenericException("The sample size must be positive");
+  particles.setRank(source->getRank());
+}
+
+bool SampledParticleStream::eos()
+{
+  if (sampler) return source->eos();
+  return end_reached;
+}
+
+void SampledParticleStream::setChunkLength(int64_t length)
+{
+  chunkLength = length;
+  source->setChunkLength(length);
+}
+
+/*
+ * Keeps the sampleSize particles with the largest random keys. The keys are
+ * hashes of the row, so this is a uniform sample without replacement that
+ * doesn't depend on the chunk lengths of the source.
+ */
+void SampledParticleStream::fillReservoir()
+{
+  TopK reservoir(sampleSize);
+  int rank = source->getRank();
+
+  source->getNextChunks();
+  while (!source->eos())
+  {
+    const ParticleChunk &chunk = source->getChunk();
+    for (int64_t i=0; i<chunk.length(); ++i)
+    {
+      int64_t row = chunk.rows()[i];
+      double key = ParticleSampler::uniform(seed, row);
+      if (reservoir.rejects(key)) continue;
+
+      TopKRecord record;
+      record.key = key;
+      record.index = row;
+      record.species = chunk.species()[i];
+      for (int d=0; d<3; ++d) record.pos[d] = (d < rank) ? chunk.position(d)[i] : 0.0;
+      record.p[0] = chunk.px()[i];
+      record.p[1] = chunk.py()[i];
+      record.p[2] = chunk.pz()[i];
+      record.weight = chunk.weight()[i];
+      reservoir.push(record);
+    }
+    rowsRead += chunk.length();
+    source->getNextChunks();
+  }
+
+  records = reservoir.sorted();
+  std::sort(records.begin(), records.end(),
+      [](const TopKRecord &a, const TopKRecord &b) { return a.index < b.index; });
+  if (!records.empty()) reservoirFactor = double(rowsRead)/double(records.size());
+  reservoirFilled = true;
+}
+
+void SampledParticleStream::getNextChunks()
+{
+  if (!sampler)
+  {
+    if (!reservoirFilled) fillReservoir();
+    int64_t count = std::min(int64_t(records.size() - nextRecord), std::max(int64_t(1), chunkLength));
+    if (count <= 0)
+    {
+      end_reached = true;
+      return;
+    }
+
+    int rank = particles.getRank();
+    particles.resize(count);
+    for (int64_t i=0; i<count; ++i)
+    {
+      const TopKRecord &record = records[nextRecord + i];
+      particles.species()[i] = record.species;
+      for (int d=0; d<rank; ++d) particles.position(d)[i] = record.pos[d];
+      particles.px()[i] = record.p[0];
+      particles.py()[i] = record.p[1];
+      particles.pz()[i] = record.p[2];
+      particles.weight()[i] = record.weight*reservoirFactor;
+      particles.rows()[i] = record.index;
+    }
+    nextRecord += count;
+    return;
+  }
+
+  while (true)
+  {
+    source->getNextChunks();
+    if (source->eos()) return;
+
+    const ParticleChunk &chunk = source->getChunk();
+    rowsRead += chunk.length();
+    if (sampler->sample(chunk, particles, sourceSamples) > 0) return;
+  }
+}
 
 //===========================================================
 //=================    ParticleStreamFactory    =================
 //===========================================================
 
+namespace {
+  /**
+   * The number of bytes per particle that a stream touches for the given
+   * columns: the double values in the chunk and the source values that need
+   * to be converted.
+   */
+  int64_t chunkColumnBytes(ParticleStream &pstream, int columns)
+  {
+    int64_t bytes = 0;
+    int flags[5] = { pc_mesh, pc_px, pc_py, pc_pz, pc_weight };
+    for (int c=0; c<5; ++c)
+    {
+      if (!(columns & flags[c])) continue;
+      int precision = pstream.getPrecision(flags[c]);
+      int64_t valueBytes = sizeof(double) + ((precision < int(sizeof(double))) ? precision : 0);
+      bytes += (flags[c] == pc_mesh) ? pstream.getRank()*valueBytes : valueBytes;
+    }
+    if (columns & pc_species) bytes += sizeof(int32_t);
+    return std::max(bytes, int64_t(sizeof(double)));
+  }
+}
+
 void ParticleStreamFactory::setProgramOptions(po::options_description &option_desc)
 {
   option_desc.add_options()
       ("input,i", po::value<std::string>(&inputName),"name of the cfd file")
-      ("chunk,c", po::value<int64_t>(&chunkLength),"chunk size used in buffered reading. Set this for optimising speed and memory usage.")
-      ("raw,r", "read data from raw RGE files instead of SDF files");
+      ("chunk,c", po::value<int64_t>(&chunkLength),"chunk size used in buffered reading (default: tuned from the cache sizes, the memory budget and the observed throughput)")
+      ("raw,r", "read data from raw RGE files instead of SDF files")
+      ("zonemap", po::value<std::string>(&zoneMapName),"name of the zone map written by the 'index' command (default: <input>.zmap if it exists)")
+      ("alloc-stats", "report the buffer allocations made by the particle stream")
+      ("sample", po::value<double>(&sampleFraction),"only use a random fraction of the particles, their weights are divided by the fraction")
+      ("sample-size", po::value<int64_t>(&sampleSize),"only use a uniform random sample of this many particles, reweighted by the number of particles read")
+      ("sample-stretch", po::value<int64_t>(&sampleStretch),"with --sample, SDF input keeps or skips whole stretches of this many particles without reading the skipped ones, 0 samples single particles (default: 4096)")
+      ("sample-seed", po::value<int64_t>(&sampleSeed),"seed of the random sample (default: 1)")
+      ("io-threads", po::value<int>(&ioThreads),"number of threads reading the pieces of raw RGE files (default: number of cores, at most 8)");
+
+  // commands with their own memory budget share the option
+  if (!option_desc.find_nothrow("mem-budget", false))
+    option_desc.add_options()
+      ("mem-budget", po::value<int64_t>(),"memory budget of the command in MB, particle chunks use at most a quarter of it (default: no limit, chunks use at most a quarter of the available memory)");
 
   if (species)
     option_desc.add_options()
@@ -368,30 +1134,98 @@ pParticleStream ParticleStreamFactory::getParticleStream(po::variables_map &vm)
   if (vm.count("pz")<1) pzName = "Pz";
   if (vm.count("mesh")<1) meshName = "Particles";
   if (vm.count("weight")<1) weightName = "Weight";
-  if (vm.count("chunk")<1) chunkLength = 1024*1024;
+  if (vm.count("io-threads")<1) ioThreads = std::min(8, defaultThreadCount());
+
+  if (vm.count("mem-budget")>0) MemoryBudget::setLimit(vm["mem-budget"].as<int64_t>()*1024*1024);
+
+  // a provisional length, the tuner replaces it once the stream is open
+  bool tuneChunks = (vm.count("chunk")<1);
+  if (tuneChunks) chunkLength = ChunkTuner::defaultLength(sizeof(double), sizeof(double));
 
   pParticleStream pstream;
+  SdfParticleStream *sdfStream = 0;
 
-  if (vm.count("raw")<1)
+  if ((vm.count("raw")<1) && ColumnarCache::isCacheDir(inputName))
+  {
+    int columns = this->columns;
+    if (filter) columns |= filter->getColumns();
+    pstream = pParticleStream(new ColumnarParticleStream(inputName, chunkLength, columns));
+  }
+  else if ((vm.count("raw")<1) && ParticleCache::isCacheFile(inputName))
+  {
+    int columns = this->columns;
+    if (filter) columns |= filter->getColumns();
+    pstream = pParticleStream(new CacheParticleStream(inputName, chunkLength, columns));
+  }
+  else if (vm.count("raw")<1)
   {
     std::cerr << "Making SDF stream!\n";
     pSdfFile file(new SdfFile(inputName));
-    SdfParticleStream *sdfStream = new SdfParticleStream(file, chunkLength);
-    if (species) sdfStream->addSpecies(speciesName);
+    sdfStream = new SdfParticleStream(file, chunkLength);
+    int columns = this->columns;
+    if (filter) columns |= filter->getColumns();
     if (momentum)
     {
-      sdfStream->addPx(pxName);
-      sdfStream->addPy(pyName);
-      sdfStream->addPz(pzName);
+      if (columns & pc_px) sdfStream->addPx(pxName);
+      if (columns & pc_py) sdfStream->addPy(pyName);
+      if (columns & pc_pz) sdfStream->addPz(pzName);
+    }
+    if (mesh && (columns & pc_mesh)) sdfStream->addMesh(meshName);
+    if (weight && (columns & pc_weight)) sdfStream->addWeight(weightName);
+    if (species && (columns & pc_species))
+      sdfStream->addSpecies(vm.count("species")>0 ? speciesName : meshName);
+
+    // the zone map is only useful for skipping data rejected by the filter
+    if (filter && filter->isActive())
+    {
+      if (vm.count("zonemap")<1) zoneMapName = ZoneMap::sidecarName(inputName);
+      else if (!fs::exists(zoneMapName))
+        throw msdf::GenericException("Zone map " + zoneMapName + " not found");
+      sdfStream->setZoneMap(ZoneMap::read(zoneMapName, inputName));
     }
-    if (mesh) sdfStream->addMesh(meshName);
-    if (weight) sdfStream->addWeight(weightName);
 
     pstream = pParticleStream(sdfStream);
   }
   else
   {
-    pstream = pParticleStream(new RawParticleStream(inputName, chunkLength));
+    pstream = pParticleStream(new RawParticleStream(inputName, chunkLength, ioThreads));
+  }
+
+  pstream->setFilter(filter);
+  pstream->setReportAllocations(vm.count("alloc-stats")>0);
+
+  int columns = this->columns;
+  if (filter) columns |= filter->getColumns();
+  int64_t cacheBytes = chunkColumnBytes(*pstream, columns);
+  // the chunk and the staging chunk of filtered streams hold all components
+  int64_t memoryBytes = cacheBytes + 2*(ParticleChunk::numComponents*sizeof(double) + sizeof(int32_t) + sizeof(int64_t));
+
+  // fail before reading if not even the smallest chunks fit into the budget
+  int64_t minRows = tuneChunks ? ChunkTuner::minimumMaxLength : chunkLength;
+  MemoryBudget::require(minRows*memoryBytes, "particle chunks of "
+      + boost::lexical_cast<std::string>(minRows) + " rows");
+
+  if (tuneChunks)
+  {
+    int64_t memBudget = MemoryBudget::isLimited() ? MemoryBudget::getAvailable()/4 : 0;
+    pstream->setChunkTuner(pChunkTuner(new ChunkTuner(cacheBytes, memoryBytes, memBudget)));
+  }
+
+  if ((vm.count("sample")>0) && (vm.count("sample-size")>0))
+    throw msdf::GenericException("Only one of --sample and --sample-size can be given");
+
+  uint64_t seed = (vm.count("sample-seed")>0) ? sampleSeed : 1;
+  if (vm.count("sample-size")>0)
+    pstream = pParticleStream(new SampledParticleStream(pstream, sampleSize, seed));
+  else if (vm.count("sample")>0)
+  {
+    int64_t stretch = (vm.count("sample-stretch")>0) ? sampleStretch : 4096;
+    pParticleSampler sampler(new ParticleSampler(sampleFraction, stretch, seed));
+
+    // SDF streams skip the stretches that are not sampled, the other sources are read in full
+    bool sourceSamples = sdfStream && (stretch > 0);
+    if (sourceSamples) sdfStream->setSampler(sampler);
+    pstream = pParticleStream(new SampledParticleStream(pstream, sampler, sourceSamples));
   }
 
   return pstream;
@@ -10,49 +10,112 @@
 #define PARTICLESTREAM_H_
 
 #include "sdfdatatypes.hpp"
+#include "particlefilter.hpp"
+#include "zonemap.hpp"
+#include "particlecache.hpp"
+#include "columnarcache.hpp"
+#include "particlechunk.hpp"
+#include "chunktuner.hpp"
+#include "particlesampler.hpp"
+#include "rawindex.hpp"
+#include "topk.hpp"
 #include "common/sdffile.hpp"
 #include <fstream>
 #include <map>
+#include <vector>
 #include <boost/program_options.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 
 using namespace msdf;
 
 class ParticleStream
 {
   public:
+    ParticleStream();
+    virtual ~ParticleStream();
     virtual bool eos()=0;
     virtual void getNextChunks()=0;
     virtual bool isRaw() = 0;
 
-  public: // Dirty programming style, but we don't mind.
-    pDataGrid2d mesh;
-    pDataGrid1d species;
-    pDataGrid1d px;
-    pDataGrid1d py;
-    pDataGrid1d pz;
-    pDataGrid1d weight;
+    /// The number of bytes per value in which a column is stored in the source
+    virtual int getPrecision(int column) = 0;
     virtual int getRank() = 0;
+    void setFilter(pParticleFilter filter_) { filter = filter_; }
+
+    /// Print the number of heap allocations made while the stream was alive on destruction
+    void setReportAllocations(bool report) { reportAllocations = report; }
+
+    /// Set the number of source rows read per chunk
+    virtual void setChunkLength(int64_t length) = 0;
+
+    /**
+     * Let the tuner choose the chunk length during the first chunks. Must be
+     * called before the first chunk is read.
+     */
+    void setChunkTuner(pChunkTuner tuner_);
+
+    /// The particles of the current chunk
+    const ParticleChunk &getChunk() const { return particles; }
+  protected:
+    pParticleFilter filter;
+    ParticleChunk particles;
+
+    /// Update the chunk length from the tuner, rowsConsumed counts all source rows read so far
+    void tuneChunkLength(int64_t rowsConsumed);
+  private:
+    pChunkTuner tuner;
+    bool reportAllocations;
+    int64_t allocationsAtStart;
+    int64_t bytesAtStart;
 };
 typedef boost::shared_ptr<ParticleStream> pParticleStream;
 
 class SdfParticleStream : public ParticleStream
 {
   private:
-    pSdfMeshVariableStream getValidVarStream();
+    void addLengthSource(int64_t length);
+    void fillPrunedColumns(int64_t chsize);
+    void readMesh(ParticleChunk &target, int64_t first, int64_t count);
+    void getNextFilteredChunks();
+    void skipChunks();
+    void setStreamChunkLength(int64_t length);
+    int64_t nextChunkSize();
+    bool findCandidateRows(int64_t chunkStart, int64_t chsize, int64_t &first, int64_t &count);
+
+    std::vector<int64_t> selection;
+    ParticleChunk stage;
+    int64_t filledLength;
 
     pSdfFile file;
     int64_t chunkLength;
+    int64_t particleCount;
+    int64_t activeCount;
+    int rank;
 
     pSdfMeshStream meshStream;
     pSdfMeshVariableStream weightStream;
     pSdfMeshVariableStream pxStream;
     pSdfMeshVariableStream pyStream;
     pSdfMeshVariableStream pzStream;
+
+    pZoneMap zoneMap;
+    pParticleSampler sampler;
+    std::string meshBlock, pxBlock, pyBlock, pzBlock;
+    ParticleZones zones;
   public:
-    SdfParticleStream(pSdfFile file_, int64_t chunkLength_)
-        : file(file_),
-          chunkLength(chunkLength_)
-    {}
+    SdfParticleStream(pSdfFile file_, int64_t chunkLength_);
+
+    /**
+     * Use the zone map to skip zones that cannot contain particles accepted
+     * by the filter. Must be called after the blocks have been added.
+     */
+    void setZoneMap(pZoneMap zoneMap_);
+
+    /**
+     * Only read the stretches of rows selected by the sampler. The remaining
+     * stretches are skipped without reading them.
+     */
+    void setSampler(pParticleSampler sampler_) { sampler = sampler_; }
 
     void addMesh(std::string blockname);
     void addSpecies(std::string blockname);
@@ -63,49 +126,181 @@ class SdfParticleStream : public ParticleStream
 
     bool eos();
     void getNextChunks();
+    void setChunkLength(int64_t length);
     bool isRaw() { return false; }
-    int getRank() { return meshStream->getRank(); }
+    int getPrecision(int column);
+    int getRank() { return rank; }
 };
 
+/**
+ * Reads the pieces file.000, file.001, ... of a raw RGE file.
+ *
+ * The headers of all pieces are scanned into a RawIndex when the stream is
+ * opened. Each chunk is then split into reads of roughly equal size that are
+ * served concurrently, each thread with its own file handle, and the
+ * interleaved records are converted into the component arrays of the chunk.
+ * The particles are handed out in the order of the pieces.
+ */
 class RawParticleStream : public ParticleStream
 {
   public:
-    RawParticleStream(std::string file_, int64_t dataLength_);
+    RawParticleStream(std::string file_, int64_t dataLength_, int numThreads_);
     bool eos();
     void getNextChunks();
+    void setChunkLength(int64_t length);
     bool isRaw() { return true; }
+    int getPrecision(int) { return sizeof(float); }
     int getRank() { return 2; }
   private:
-    void readHeader();
-    void readSpeciesHeader();
-    void readChunkHeader();
-    void advanceChunk();
+    /// A part of a segment that is read into the buffer at row dest
+    struct Read
+    {
+        size_t segment;
+        int64_t first;
+        int64_t count;
+        int64_t dest;
+    };
+
     void initStream();
-    void openStream();
-    void advanceStream();
+    void readRecords();
 
     std::string file;
     int64_t dataLength;
+    int numThreads;
+
+    RawIndex index;
+    size_t activeSegment;
+    int64_t segmentRow;
+    int64_t rowsRead;
 
+    std::vector<Read> reads;
+    std::vector<boost::shared_ptr<std::ifstream> > streams;
+    std::vector<int> openPieces;
+
+    std::vector<float> buffer;
+    std::vector<int32_t> speciesBuffer;
+    bool end_reached;
+};
+
+/**
+ * Reads particles from a spatially sorted cache written by the 'reorder'
+ * command.
+ *
+ * If the filter has spatial limits, only the rows of the cells intersecting
+ * the limits are read. The filter is then applied to the individual particles.
+ */
+class CacheParticleStream : public ParticleStream
+{
+  public:
+    CacheParticleStream(std::string file_, int64_t chunkLength_, int columns_);
+    bool eos();
+    void getNextChunks();
+    void setChunkLength(int64_t length) { chunkLength = length; }
+    bool isRaw() { return cache.isRaw(); }
+    int getPrecision(int) { return sizeof(double); }
+    int getRank() { return cache.getRank(); }
+  private:
+    void initRanges();
+
+    ParticleCache cache;
     std::ifstream stream;
+    int64_t chunkLength;
+    int columns;
 
-    int32_t count_i, rank, n_species, chunk;
-    double x_min, x_max, y_min, y_max;
-    int32_t npleft;
-    double spcharge, spmass;
+    std::vector<std::pair<int64_t, int64_t> > ranges;
+    size_t activeRange;
+    int64_t activeRow;
+    int64_t rowsRead;
+    bool rangesReady;
+    bool end_reached;
+
+    std::vector<std::vector<double> > stage;
+    std::vector<std::pair<int64_t, int64_t> > segments;
+    std::vector<int64_t> accepted;
+};
 
-    int32_t chunk_size;
-    int32_t chunk_remainder;
+/**
+ * Reads particles from a columnar cache written by the 'tocache' command.
+ *
+ * The column files of one species partition at a time are memory mapped and
+ * the values are gathered directly from the mapping. Chunks whose statistics
+ * exclude all particles accepted by the filter are skipped.
+ */
+class ColumnarParticleStream : public ParticleStream
+{
+  public:
+    ColumnarParticleStream(std::string dir, int64_t chunkLength_, int columns_);
+    bool eos();
+    void getNextChunks();
+    void setChunkLength(int64_t length) { chunkLength = length; }
+    bool isRaw() { return cache.isRaw(); }
+    int getPrecision(int column);
+    int getRank() { return cache.getRank(); }
+  private:
+    void mapSpecies();
+    bool chunkMayMatch(const ColumnarCache::Species &sp, int64_t chunk) const;
 
-    int32_t species_count;
+    /// The value of a column at a row of the mapped species partition
+    double value(int column, int64_t row) const
+    {
+      if (cache.getPrecision(column) == sizeof(float))
+        return reinterpret_cast<const float*>(base[column])[row];
+      return reinterpret_cast<const double*>(base[column])[row];
+    }
 
-    schnek::Grid<float, 1, MsdfGridChecker> buffer;
-    DataGrid1d speciesBuffer;
+    ColumnarCache cache;
+    int64_t chunkLength;
+    int columns;
+    bool initialised;
     bool end_reached;
 
-    std::map<int, std::string> filenames;
-    std::map<int, std::string>::iterator fname_iter;
+    size_t activeSpecies;
+    int64_t activeChunk;
+    int64_t rowsRead;
+    bool mapped;
+    boost::shared_ptr<boost::interprocess::mapped_region> regions[ColumnarCache::numColumns];
+    const char *base[ColumnarCache::numColumns];
 
+    std::vector<int64_t> selection;
+};
+
+/**
+ * Subsamples the particles of another stream for quick looks at large inputs.
+ *
+ * With a sample fraction f each particle is kept with probability f and its
+ * weight is multiplied by 1/f, so weighted sums remain unbiased. If the source
+ * already skips stretches of rows chosen by the sampler, the weights are only
+ * rescaled. With a sample size the whole source is read and a uniform sample
+ * of that many particles is kept, reweighted by the number of particles read
+ * over the sample size, and handed out in stream order.
+ */
+class SampledParticleStream : public ParticleStream
+{
+  public:
+    SampledParticleStream(pParticleStream source_, pParticleSampler sampler_, bool sourceSamples_);
+    SampledParticleStream(pParticleStream source_, int64_t sampleSize_, uint64_t seed_);
+    bool eos();
+    void getNextChunks();
+    void setChunkLength(int64_t length);
+    bool isRaw() { return source->isRaw(); }
+    int getPrecision(int column) { return source->getPrecision(column); }
+    int getRank() { return source->getRank(); }
+  private:
+    void fillReservoir();
+
+    pParticleStream source;
+    pParticleSampler sampler;
+    bool sourceSamples;
+    int64_t rowsRead;
+
+    int64_t sampleSize;
+    uint64_t seed;
+    int64_t chunkLength;
+    bool reservoirFilled;
+    std::vector<TopKRecord> records;
+    size_t nextRecord;
+    double reservoirFactor;
+    bool end_reached;
 };
 
 class ParticleStreamFactory
@@ -126,11 +321,20 @@ class ParticleStreamFactory
     std::string pxName;
     std::string pyName;
     std::string pzName;
+    std::string zoneMapName;
 
     int64_t chunkLength;
+    int columns;
+    pParticleFilter filter;
+
+    double sampleFraction;
+    int64_t sampleSize;
+    int64_t sampleStretch;
+    int64_t sampleSeed;
+    int ioThreads;
   public:
     ParticleStreamFactory()
-      : species(false), momentum(false), mesh(false), weight(false) {}
+      : species(false), momentum(false), mesh(false), weight(false), columns(pc_all) {}
     void setProgramOptions(boost::program_options::options_description &option_desc);
     pParticleStream getParticleStream(boost::program_options::variables_map &vm);
 
@@ -138,6 +342,23 @@ class ParticleStreamFactory
     ParticleStreamFactory& addMesh() { mesh = true; return *this; }
     ParticleStreamFactory& addMomentum() { momentum = true; return *this; }
     ParticleStreamFactory& addWeight() { weight = true; return *this; }
+
+    /**
+     * Restrict the columns read by the next call to getParticleStream.
+     *
+     * Only blocks that have been added and are contained in the bit mask of
+     * ParticleColumn flags are opened. The remaining columns of the stream are
+     * filled with zeros and cost no I/O.
+     */
+    ParticleStreamFactory& setColumns(int columns_) { columns = columns_; return *this; }
+
+    /**
+     * Set the filter evaluated by the streams created by getParticleStream.
+     *
+     * The columns the filter depends on are read in addition to the ones set
+     * with setColumns.
+     */
+    ParticleStreamFactory& setFilter(pParticleFilter filter_) { filter = filter_; return *this; }
 };
 
 
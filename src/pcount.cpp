@@ -32,11 +32,7 @@ void McfdCommand_pcount::execute(int argc, char **argv)
 
   pParticleStream pstream = streamFact.getParticleStream(vm);
 
-  if (!pstream)
-  {
-    print_help();
-    exit(-1);
-  }
+  if (!pstream) throw GenericException("No input file given");
 
   int maxId = 0;
   int smallId = 0;
@@ -47,11 +43,8 @@ void McfdCommand_pcount::execute(int argc, char **argv)
   pstream->getNextChunks();
   while (! pstream->eos() )
   {
-    for (
-        DataGrid1d::const_storage_iterator it = pstream->species->cbegin();
-        it != pstream->species->cend();
-        ++it, ++pos
-        )
+    ArraySpan<const int32_t> species = pstream->getChunk().species();
+    for (const int32_t *it = species.begin(); it != species.end(); ++it, ++pos)
     {
       int id = *it;
       if (id > maxId)
@@ -8,16 +8,29 @@
 
 #include "penergy.hpp"
 #include "particlestream.hpp"
+#include "common/binaryio.hpp"
+#include "moments.hpp"
+#include "parallel.hpp"
 #include <vector>
 #include <iostream>
 #include <iomanip>
 #include <cmath>
+#include <fstream>
 #include <boost/tokenizer.hpp>
 #include <boost/lexical_cast.hpp>
 
 
 namespace po = boost::program_options;
 
+namespace {
+  /// The quantities of which the quantiles are sketched
+  const int numSketches = 5;
+  const char *sketchNames[numSketches] = { "gamma", "|U|", "U_x", "U_y", "U_z" };
+
+  /// The number of particles accumulated separately before merging
+  const int64_t sliceLength = 4096;
+}
+
 
 void McfdCommand_penergy::parseNumberList(std::string s, std::vector<double> &v)
 {
@@ -55,6 +68,12 @@ McfdCommand_penergy::McfdCommand_penergy()
     ("mf", po::value<std::string>(&mfString),"list of mass factors S (SI), e (electron) or p (proton) separated by commas (default: S)")
     ("mass,m", po::value<std::string>(&massString),"list of masses in units of the mass factors separated by commas (default: 1.0)")
     ("mingamma", po::value<double>(&minGamma),"minimum energy of the particles to plot (default: 0.0)")
+    ("quantiles,q", po::value<std::string>(&quantilesStr),"list of quantiles of gamma, |U| and the velocity components to report per species, separated by commas, e.g. 0.5,0.9,0.99")
+    ("compression", po::value<double>(&compression),"compression of the quantile sketches, larger values are more accurate (default: 100)")
+    ("sketch-out", po::value<std::string>(&sketchOutName),"write the quantile sketches to a file, so that they can be merged with those of other files")
+    ("sketch-in", po::value<std::string>(&sketchInStr),"list of sketch files written with --sketch-out to merge into the quantiles, separated by commas")
+    ("threads,j", po::value<int>(&numThreads),"number of threads used to accumulate the moments (default: number of cores)")
+    ("compensated", "accumulate the moments with compensated summation")
     ("batch,b", "create output for batch processing of data.");
 
   option_pos.add("input", 1);
@@ -69,16 +88,14 @@ void McfdCommand_penergy::execute(int argc, char **argv)
   po::notify(vm);
 
   if (vm.count("mingamma")<1) minGamma = 0.0;
+  if (vm.count("compression")<1) compression = 100.0;
+  if (vm.count("threads")<1) numThreads = defaultThreadCount();
+  bool compensated = (vm.count("compensated")>0);
   bool batch = (vm.count("batch")>0);
 
-  double minGamma2 = minGamma*minGamma;
-
-  pParticleStream pstream = streamFact.getParticleStream(vm);
-  if (!pstream)
-  {
-    print_help();
-    exit(-1);
-  }
+  std::vector<double> quantiles;
+  if (vm.count("quantiles")>0) parseNumberList(quantilesStr, quantiles);
+  bool useSketches = !quantiles.empty() || (vm.count("sketch-out")>0);
 
   int maxId = 0;
   int smallId = 0;
@@ -86,16 +103,8 @@ void McfdCommand_penergy::execute(int argc, char **argv)
   long pos = 0;
 
 
-  std::vector<double> speciesPx;
-  std::vector<double> speciesPy;
-  std::vector<double> speciesPz;
-  std::vector<double> speciesPx2;
-  std::vector<double> speciesPy2;
-  std::vector<double> speciesPz2;
-  std::vector<double> speciesNumber;
-  std::vector<double> speciesCount;
+  std::vector<std::vector<TDigest> > sketches;
 
-  pstream->getNextChunks();
   std::vector<double> masses;
 
   typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
@@ -156,98 +165,128 @@ void McfdCommand_penergy::execute(int argc, char **argv)
     parseNumberList(ysmaxStr, ysmax);
   }
 
+  // positions are only read if the filter needs them for the spatial limits
+  pParticleFilter filter(new ParticleFilter());
+  filter->setSpatialLimits(xsmin, xsmax, ysmin, ysmax);
+  filter->setGammaLimits(minGamma, 0.0);
+
+  streamFact.setColumns(pc_species | pc_momentum | pc_weight).setFilter(filter);
+  pParticleStream pstream = streamFact.getParticleStream(vm);
+  if (!pstream) throw GenericException("No input file given");
+
+  // velocity of particle i of the chunk in m/s
+  auto velocity = [&](const ParticleChunk &chunk, int64_t i, int id, double *u)
+  {
+    u[0] = chunk.px()[i];
+    u[1] = chunk.py()[i];
+    u[2] = chunk.pz()[i];
+    double factor = pstream->isRaw() ? 2.99792458e8 : 1.0/masses[id];
+    for (int d=0; d<3; ++d) u[d] *= factor;
+  };
+
+  // Every slice of sliceLength particles is accumulated on its own and the
+  // slices are merged in order, so the result doesn't depend on the number
+  // of threads or the chunk length. The slice that is cut by the end of a
+  // chunk is continued in the next chunk. The sketches are filled the same way.
+  typedef std::vector<std::vector<TDigest> > SketchSet;
+  std::vector<MomentAccumulator> moments;
+  std::vector<MomentAccumulator> openSlice;
+  SketchSet openSketches;
+
+  pstream->getNextChunks();
 
   while (! pstream->eos() )
   {
-    GridIt1 sp_it = pstream->species->cbegin();
-    GridIt1 wg_it = pstream->weight->cbegin();
-    GridIt1 px_it = pstream->px->cbegin();
-    GridIt1 py_it = pstream->py->cbegin();
-    GridIt1 pz_it = pstream->pz->cbegin();
-    GridIt2 mesh_it = pstream->mesh->cbegin();
-
-    while (sp_it != pstream->species->cend())
+    const ParticleChunk &chunk = pstream->getChunk();
+    int64_t length = chunk.length();
+
+    for (int64_t i=0; i<length; ++i)
     {
-      int id = *sp_it;
+      int id = chunk.species()[i];
       if (id > maxId)
       {
-        // I know the 0 is redundant, but I'm paranoid!
-        speciesPx.resize(id,0);
-        speciesPy.resize(id,0);
-        speciesPz.resize(id,0);
-        speciesPx2.resize(id,0);
-        speciesPy2.resize(id,0);
-        speciesPz2.resize(id,0);
-        speciesNumber.resize(id,0);
-        speciesCount.resize(id,0);
+        moments.resize(id, MomentAccumulator(compensated));
+        openSlice.resize(id, MomentAccumulator(compensated));
+        if (useSketches)
+        {
+          sketches.resize(id, std::vector<TDigest>(numSketches, TDigest(compression)));
+          openSketches.resize(id, std::vector<TDigest>(numSketches, TDigest(compression)));
+        }
         maxId = id;
       }
-      if (masses.size() < id) masses.resize(id, 1.0);
-
-      id = id-1; // get in line with C indexing
-
-      if (id < 0) ++smallId;
-      else {
-        double mass = masses[id];
-    	double weight = *wg_it;
-    	double px = *px_it;
-    	double py = *py_it;
-    	double pz = *pz_it;
-        double x = *mesh_it;
-        ++mesh_it;
-        double y = *mesh_it;
-
-
-        if (( (id >= xsmin.size()) || (x>xsmin[id]) ) &&
-            ( (id >= xsmax.size()) || (x<xsmax[id]) ) &&
-            ( (id >= ysmin.size()) || (y>ysmin[id]) ) &&
-            ( (id >= ysmax.size()) || (y<ysmax[id]) ) )
-        {
+      if (id < 1) ++smallId;
+      else maxPos = pos + i;
+    }
+    if (masses.size() < maxId) masses.resize(maxId, 1.0);
 
-          double gamma2 = 1 + px*px + py*py + pz*pz;
-          if (gamma2 >= minGamma2)
-          {
-            if (!pstream->isRaw())
-            {
-              px /= mass;
-              py /= mass;
-              pz /= mass;
-            }
-            else
-            {
-              px *= 2.99792458e8;
-              py *= 2.99792458e8;
-              pz *= 2.99792458e8;
-            }
-
-    //    	std::cout << px << " " << py << " " << pz << " " << weight << "\n";
-
-            speciesNumber[id] = speciesNumber[id] + weight;
-            speciesCount[id] = speciesCount[id] + 1;
-
-            speciesPx[id] = speciesPx[id] + px*weight;
-            speciesPy[id] = speciesPy[id] + py*weight;
-            speciesPz[id] = speciesPz[id] + pz*weight;
-
-            speciesPx2[id] = speciesPx2[id] + px*px*weight;
-            speciesPy2[id] = speciesPy2[id] + py*py*weight;
-            speciesPz2[id] = speciesPz2[id] + pz*pz*weight;
-
-            maxPos = pos;
-          }
-        }
+    std::vector<int64_t> bounds(1, 0);
+    for (int64_t next = sliceLength - pos % sliceLength; next < length; next += sliceLength)
+      bounds.push_back(next);
+    bounds.push_back(length);
+    int numSlices = bounds.size() - 1;
+
+    std::vector<std::vector<MomentAccumulator> > slices(numSlices - 1,
+        std::vector<MomentAccumulator>(maxId, MomentAccumulator(compensated)));
+    std::vector<SketchSet> sliceSketches(useSketches ? numSlices - 1 : 0,
+        SketchSet(maxId, std::vector<TDigest>(numSketches, TDigest(compression))));
+
+    // the spatial and energy limits have been applied by the stream
+    parallelFor(numSlices, numThreads, [&](int s)
+    {
+      std::vector<MomentAccumulator> &acc = (s == 0) ? openSlice : slices[s-1];
+      double u[3];
+      for (int64_t i=bounds[s]; i<bounds[s+1]; ++i)
+      {
+        int id = chunk.species()[i] - 1; // get in line with C indexing
+        if (id < 0) continue;
+        velocity(chunk, i, id, u);
+        double weight = chunk.weight()[i];
+        acc[id].add(u[0], u[1], u[2], weight);
+        if (!useSketches) continue;
+
+        std::vector<TDigest> &sketch = (s == 0) ? openSketches[id] : sliceSketches[s-1][id];
+        double u2 = u[0]*u[0] + u[1]*u[1] + u[2]*u[2];
+        sketch[0].add(sqrt(1.0 + u2/(2.99792458e8*2.99792458e8)), weight);
+        sketch[1].add(sqrt(u2), weight);
+        sketch[2].add(u[0], weight);
+        sketch[3].add(u[1], weight);
+        sketch[4].add(u[2], weight);
+      }
+    });
+
+    for (int s=0; s<numSlices; ++s)
+    {
+      std::vector<MomentAccumulator> &acc = (s == 0) ? openSlice : slices[s-1];
+      if ((pos + bounds[s+1]) % sliceLength == 0)
+      {
+        for (int id=0; id<maxId; ++id) moments[id].merge(acc[id]);
+        if (s == 0)
+          for (int id=0; id<maxId; ++id) openSlice[id].reset();
+      }
+      else if (s > 0) openSlice.swap(acc);
+
+      if (!useSketches) continue;
+      SketchSet &sketchAcc = (s == 0) ? openSketches : sliceSketches[s-1];
+      if ((pos + bounds[s+1]) % sliceLength == 0)
+      {
+        for (int id=0; id<maxId; ++id)
+          for (int k=0; k<numSketches; ++k) sketches[id][k].merge(sketchAcc[id][k]);
+        if (s == 0)
+          for (int id=0; id<maxId; ++id)
+            openSketches[id].assign(numSketches, TDigest(compression));
       }
-      ++sp_it;
-      ++wg_it;
-      ++mesh_it;
-      ++px_it;
-      ++py_it;
-      ++pz_it;
-      ++pos;
+      else if (s > 0) openSketches.swap(sketchAcc);
     }
+
+    pos += length;
     pstream->getNextChunks();
   }
 
+  for (int id=0; id<maxId; ++id) moments[id].merge(openSlice[id]);
+  if (useSketches)
+    for (int id=0; id<maxId; ++id)
+      for (int k=0; k<numSketches; ++k) sketches[id][k].merge(openSketches[id][k]);
+
   if (smallId>0)
     std::cerr << "WARNING!\n    " << smallId << " species IDs found with values < 1\n";
 
@@ -261,24 +300,81 @@ void McfdCommand_penergy::execute(int argc, char **argv)
   }
   for (unsigned int id = 0; id<maxId; ++id)
   {
-    double Px = speciesPx[id] / speciesNumber[id];
-    double Py = speciesPy[id] / speciesNumber[id];
-    double Pz = speciesPz[id] / speciesNumber[id];
-
-    double Px2= speciesPx2[id] / speciesNumber[id];
-    double Py2= speciesPy2[id] / speciesNumber[id];
-    double Pz2= speciesPz2[id] / speciesNumber[id];
+    double Px = moments[id].getMean(0);
+    double Py = moments[id].getMean(1);
+    double Pz = moments[id].getMean(2);
 
-    double Tx = masses[id]*(Px2 - Px*Px)/kB;
-    double Ty = masses[id]*(Py2 - Py*Py)/kB;
-    double Tz = masses[id]*(Pz2 - Pz*Pz)/kB;
+    double Tx = masses[id]*moments[id].getVariance(0)/kB;
+    double Ty = masses[id]*moments[id].getVariance(1)/kB;
+    double Tz = masses[id]*moments[id].getVariance(2)/kB;
     std::cout << std::setiosflags(std::ios::right) << "  "
         << std::setw(6) << id+1  << "     "
         << std::setw(15) << Tx  << std::setw(15) << Ty  << std::setw(15) << Tz
         << std::setw(15) << (Tx+Ty+Tz)/3.0
         << std::setw(15) << Px  << std::setw(15) << Py  << std::setw(15) << Pz
-        << std::setw(15) << speciesNumber[id] << "\n";
+        << std::setw(15) << moments[id].getWeight() << "\n";
   }
+
+  if (vm.count("sketch-in")>0)
+  {
+    tokenizer inTokens(sketchInStr, sep);
+    for (tokenizer::iterator tok_iter = inTokens.begin(); tok_iter != inTokens.end(); ++tok_iter)
+      mergeSketches(*tok_iter, sketches);
+  }
+
+  if (vm.count("sketch-out")>0) writeSketches(sketchOutName, sketches);
+
+  if (quantiles.empty()) return;
+
+  if (!batch)
+  {
+    std::cout << "\n  Specied Id   Quantity";
+    for (unsigned int k=0; k<quantiles.size(); ++k)
+      std::cout << std::setw(15) << "q=" + boost::lexical_cast<std::string>(quantiles[k]);
+    std::cout << "\n";
+  }
+  for (unsigned int id = 0; id<sketches.size(); ++id)
+    for (int s=0; s<numSketches; ++s)
+    {
+      std::cout << std::setiosflags(std::ios::right) << "  "
+          << std::setw(6) << id+1 << "     " << std::setw(9) << sketchNames[s];
+      for (unsigned int k=0; k<quantiles.size(); ++k)
+        std::cout << std::setw(15) << sketches[id][s].quantile(quantiles[k]);
+      std::cout << "\n";
+    }
+}
+
+void McfdCommand_penergy::writeSketches(const std::string &fileName,
+    std::vector<std::vector<TDigest> > &sketches)
+{
+  std::ofstream out(fileName.c_str());
+  if (!out) throw msdf::GenericException("Could not open sketch file " + fileName);
+
+  out << "msdf-sketches " << sketches.size() << " " << numSketches << "\n";
+  for (unsigned int id = 0; id<sketches.size(); ++id)
+    for (int s=0; s<numSketches; ++s)
+      sketches[id][s].write(out);
+}
+
+void McfdCommand_penergy::mergeSketches(const std::string &fileName,
+    std::vector<std::vector<TDigest> > &sketches)
+{
+  std::ifstream in(fileName.c_str());
+  std::string magic;
+  size_t count;
+  int quantities;
+  if (!(in >> magic >> count >> quantities) || (magic != "msdf-sketches") || (quantities != numSketches))
+    throw msdf::GenericException("Not a sketch file: " + fileName);
+
+  if (sketches.size() < count)
+    sketches.resize(count, std::vector<TDigest>(numSketches, TDigest(compression)));
+  for (size_t id = 0; id<count; ++id)
+    for (int s=0; s<numSketches; ++s)
+    {
+      TDigest digest;
+      digest.read(in);
+      sketches[id][s].merge(digest);
+    }
 }
 
 
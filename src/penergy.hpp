@@ -12,13 +12,11 @@
 #include <boost/program_options.hpp>
 #include "commands.hpp"
 #include "particlestream.hpp"
+#include "tdigest.hpp"
 
 class McfdCommand_penergy : public MsdfCommand
 {
   private:
-    typedef DataGrid1d::const_storage_iterator GridIt1;
-    typedef DataGrid2d::const_storage_iterator GridIt2;
-
     boost::program_options::options_description option_desc;
     boost::program_options::positional_options_description option_pos;
     ParticleStreamFactory streamFact;
@@ -28,8 +26,15 @@ class McfdCommand_penergy : public MsdfCommand
     std::string xsminStr, xsmaxStr;
     std::string ysminStr, ysmaxStr;
     double minGamma;
+    std::string quantilesStr;
+    std::string sketchOutName;
+    std::string sketchInStr;
+    double compression;
+    int numThreads;
 
     void parseNumberList(std::string s, std::vector<double> &v);
+    void writeSketches(const std::string &fileName, std::vector<std::vector<TDigest> > &sketches);
+    void mergeSketches(const std::string &fileName, std::vector<std::vector<TDigest> > &sketches);
 
   public:
     McfdCommand_penergy();
@@ -9,6 +9,10 @@
 #include "phaseplot.hpp"
 #include "particlestream.hpp"
 #include "hdfstream.hpp"
+#include "histogram.hpp"
+#include "axisbinning.hpp"
+#include "tdigest.hpp"
+#include "particleaxes.hpp"
 #include <vector>
 #include <iostream>
 #include <iomanip>
@@ -35,45 +39,7 @@ inline double McfdCommand_phaseplot::getValue(int axis, double px, double py, do
       break;
   }
 
-  switch (id)
-  {
-    case  0: return x;
-    case  1: return y;
-    case  2: return px;
-    case  3: return py;
-    case  4: return pz;
-    case  5:
-    {
-      double p2 = px*px + py*py + pz*pz;
-      // Using the identity
-      // (gamma-1) = (gamma^2-1) / (gamma+1) = p^2  / (gamma+1)
-      // to avoid rounding errors for small velocities
-      return p2/(sqrt(1+p2) + 1);
-    }
-    case  6: return px*px/(sqrt(1+px*px) + 1);
-    case  7: return py*py/(sqrt(1+py*py) + 1);
-    case  8: return pz*pz/(sqrt(1+pz*pz) + 1);
-    case  9:
-    {
-      double p2 = px*px + py*py + pz*pz;
-      return sqrt(p2)/sqrt(1+p2);
-    }
-    case 10: return px/sqrt(1+px*px + py*py + pz*pz);
-    case 11: return py/sqrt(1+py*py + py*py + pz*pz);
-    case 12: return pz/sqrt(1+pz*pz + py*py + pz*pz);
-    case 13: return atan2(py,px);
-    case 14:
-    {
-      double theta = atan2(py,px);
-      return theta*theta;
-    }
-    case 15: return sqrt(py*py+pz*pz);
-    case 16: return sqrt(px*px+pz*pz);
-    case 17: return sqrt(px*px+py*py);
-    case  100: return 1;
-    default: return x;
-  }
-  
+  return ParticleAxes::value(id, px, py, pz, x, y);
 }
 
 void McfdCommand_phaseplot::parseNumberList(std::string s, std::vector<double> &v)
@@ -120,6 +86,10 @@ McfdCommand_phaseplot::McfdCommand_phaseplot()
     ("mingamma", po::value<double>(&minGamma),"minimum energy of the particles to plot (default: 0.0)")
     ("maxgamma", po::value<double>(&maxGamma),"maximum energy of the particles to plot (default: 0.0 no restriction)")
     ("posPx", "If specified, only consider particles with positive px")
+    ("xscale", po::value<std::string>(&xScaleName),"spacing of the bins in the x-direction, one of lin, log or adaptive. Adaptive bins hold equal weight (default: 'lin')")
+    ("yscale", po::value<std::string>(&yScaleName),"spacing of the bins in the y-direction, one of lin, log or adaptive (default: 'lin')")
+    ("storage", po::value<std::string>(&storageName),"storage of the histograms, one of dense, tiled, sparse or auto. Auto uses dense storage if it fits into the memory budget (default: 'auto')")
+    ("chunked", "write chunked HDF datasets that only store the non-empty blocks of the plot")
     ("output,o", po::value<std::string>(&outputName),"base name of the output file. A # in the file name will be replaced with the species number. If no # is present, the species number will be appended to the file name.")
     ("batch,b", "create output for batch processing of data.");
 
@@ -129,13 +99,16 @@ McfdCommand_phaseplot::McfdCommand_phaseplot()
 
 void McfdCommand_phaseplot::execute(int argc, char **argv)
 {
-  double minGamma2, maxGamma2;
   typedef schnek::Array<double,2> Coord;
-  std::vector<pDataGrid2d> plots;
+  std::vector<pHistogram2d> plots;
   std::vector<Coord> mins;
   std::vector<Coord> maxs;
-  std::vector<Coord> dx;
+  std::vector<Coord> minPositive;
   std::vector<bool> minMaxSet;
+  // the bins of each species and the sketches for adaptive bins
+  std::vector<AxisBinning> binning[2];
+  std::vector<TDigest> sketches[2];
+  std::vector<int64_t> counts;
   
   int maxId = 0;
   int smallId = 0;
@@ -163,8 +136,18 @@ void McfdCommand_phaseplot::execute(int argc, char **argv)
   if (vm.count("moment")<1) moment = "1";
   if (vm.count("mingamma")<1) minGamma = 0.0;
   if (vm.count("maxgamma")<1) maxGamma = 0.0;
+  if (vm.count("storage")<1) storageName = "auto";
   if (vm.count("xdim")<1) xdim = 1024;
   if (vm.count("ydim")<1) ydim = 1024;
+  if (vm.count("xscale")<1) xScaleName = "lin";
+  if (vm.count("yscale")<1) yScaleName = "lin";
+
+  AxisBinning::Scale scales[2];
+  if (!AxisBinning::parseScale(xScaleName, scales[0]))
+    throw GenericException("Unknown scale " + xScaleName);
+  if (!AxisBinning::parseScale(yScaleName, scales[1]))
+    throw GenericException("Unknown scale " + yScaleName);
+  int dims[2] = { xdim, ydim };
 
 
   std::vector<double> xrmin, xrmax;
@@ -225,55 +208,45 @@ void McfdCommand_phaseplot::execute(int argc, char **argv)
   limitX = std::max(xrmin.size(), xrmax.size());
   limitY = std::max(yrmin.size(), yrmax.size());
 
-  minGamma2 = minGamma*minGamma;
-  maxGamma2 = maxGamma*maxGamma;
-  
   xAxisId = makeAxisId(xAxis);
   yAxisId = makeAxisId(yAxis);
   momentId = makeAxisId(moment, true);
   
+  // only read the columns needed by the axes and the moment, the filter adds
+  // the columns its predicates depend on
+  int rangeColumns = pc_species
+      | particleColumnsForAxis(xAxisId)
+      | particleColumnsForAxis(yAxisId);
+  int plotColumns = rangeColumns | pc_weight | particleColumnsForAxis(momentId);
+
+  // the plot range is determined without the energy limits
+  pParticleFilter filter(new ParticleFilter());
+  filter->setSpatialLimits(xsmin, xsmax, ysmin, ysmax);
+  filter->setPositivePx(!allPx);
 
   // set up species arrays and calculate min and max values
   std::cerr << "set up species arrays and calculate min and max values\n";
+  streamFact.setColumns(rangeColumns).setFilter(filter);
   pParticleStream pstream = streamFact.getParticleStream(vm);
-  if (!pstream)
-  {
-    print_help();
-    exit(-1);
-  }
+  if (!pstream) throw GenericException("No input file given");
   pstream->getNextChunks();
 
   while (! pstream->eos() )
   {
-    GridIt1 sp_it = pstream->species->cbegin();
-    GridIt1 px_it = pstream->px->cbegin();
-    GridIt1 py_it = pstream->py->cbegin();
-    GridIt1 pz_it = pstream->pz->cbegin();
-    GridIt2 mesh_it = pstream->mesh->cbegin();
+    const ParticleChunk &chunk = pstream->getChunk();
     
     int rank = pstream->getRank();
 
-    while (sp_it != pstream->species->cend())
+    for (int64_t i=0; i<chunk.length(); ++i, ++pos)
     {
 
-      double px = *px_it;
-      double py = *py_it;
-      double pz = *pz_it;
-      double x = *mesh_it;
-      double y;
-      double z;
-      if (rank>1)
-      {
-        ++mesh_it;
-        y = *mesh_it;
-      }
-      if (rank>2)
-      {
-        ++mesh_it;
-        z = *mesh_it;
-      }
+      double px = chunk.px()[i];
+      double py = chunk.py()[i];
+      double pz = chunk.pz()[i];
+      double x = chunk.x()[i];
+      double y = (rank>1) ? chunk.y()[i] : 0.0;
 
-      int id = *sp_it;
+      int id = chunk.species()[i];
       if (id > maxId)
       {
         for (int i=maxId; i<id; ++i)
@@ -282,58 +255,56 @@ void McfdCommand_phaseplot::execute(int argc, char **argv)
 //          output_files.push_back(ofile);
           mins.push_back(Coord(0,0));
           maxs.push_back(Coord(0,0));
+          minPositive.push_back(Coord(0,0));
           minMaxSet.push_back(false);
-          pDataGrid2d pGrid(new DataGrid2d(GridIndex2d(xdim,ydim)));
-          *pGrid = 0;
-          plots.push_back(pGrid);
+          for (int a=0; a<2; ++a)
+            if (scales[a] == AxisBinning::adaptive) sketches[a].push_back(TDigest());
+          counts.push_back(0);
         }
         maxId = id;
       }
 
       id = id-1; // get in line with C indexing
 
-      if (( (id >= xsmin.size()) || (x>xsmin[id]) ) &&
-          ( (id >= xsmax.size()) || (x<xsmax[id]) ) &&
-          ( (rank<2) ||
-            ( ((id >= ysmin.size()) || (y>ysmin[id]) ) &&
-              ((id >= ysmax.size()) || (y<ysmax[id]) ))) &&
-          ( allPx || (px>0)) )
-      {
-        if (id < 0) ++smallId;
-        else {
-
-          double X = getValue(0, px, py, pz, x, y);
-          double Y = getValue(1, px, py, pz, x, y);
-
-          Coord minC = mins[id];
-          Coord maxC = maxs[id];
-          if (minMaxSet[id])
-          {
-            minC[0] = std::min(minC[0],X);
-            minC[1] = std::min(minC[1],Y);
-            maxC[0] = std::max(maxC[0],X);
-            maxC[1] = std::max(maxC[1],Y);
-          }
-          else
-          {
-            minC[0] = X;
-            minC[1] = Y;
-            maxC[0] = X;
-            maxC[1] = Y;
-            minMaxSet[id] = true;
-          }
-          mins[id] = minC;
-          maxs[id] = maxC;
-
-          maxPos = pos;
+      // spatial limits and posPx have been applied by the stream
+      if (id < 0) ++smallId;
+      else {
+
+        double X = getValue(0, px, py, pz, x, y);
+        double Y = getValue(1, px, py, pz, x, y);
+
+        Coord minC = mins[id];
+        Coord maxC = maxs[id];
+        if (minMaxSet[id])
+        {
+          minC[0] = std::min(minC[0],X);
+          minC[1] = std::min(minC[1],Y);
+          maxC[0] = std::max(maxC[0],X);
+          maxC[1] = std::max(maxC[1],Y);
+        }
+        else
+        {
+          minC[0] = X;
+          minC[1] = Y;
+          maxC[0] = X;
+          maxC[1] = Y;
+          minMaxSet[id] = true;
+        }
+        mins[id] = minC;
+        maxs[id] = maxC;
+        ++counts[id];
+
+        // the lower limit of logarithmic bins if the data isn't positive
+        double values[2] = { X, Y };
+        for (int a=0; a<2; ++a)
+        {
+          if ((values[a] > 0.0) && ((minPositive[id][a] == 0.0) || (values[a] < minPositive[id][a])))
+            minPositive[id][a] = values[a];
+          if (scales[a] == AxisBinning::adaptive) sketches[a][id].add(values[a]);
         }
+
+        maxPos = pos;
       }
-      ++sp_it;
-      ++mesh_it;
-      ++px_it;
-      ++py_it;
-      ++pz_it;
-      ++pos;
     }
   std::cerr << "+";
     pstream->getNextChunks();
@@ -348,7 +319,6 @@ void McfdCommand_phaseplot::execute(int argc, char **argv)
   }
   
   
-  dx.resize(mins.size());
   for (int i=0; i<mins.size(); ++i)
   {
     if (xrmin.size()>i) mins[i][0] = xrmin[i];
@@ -356,143 +326,145 @@ void McfdCommand_phaseplot::execute(int argc, char **argv)
     if (yrmin.size()>i) mins[i][1] = yrmin[i];
     if (yrmax.size()>i) maxs[i][1] = yrmax[i];
 
-    dx[i] = Coord( (maxs[i][0]-mins[i][0])/xdim, (maxs[i][1]-mins[i][1])/ydim );
+    for (int a=0; a<2; ++a)
+    {
+      if (scales[a] == AxisBinning::adaptive)
+      {
+        binning[a].push_back(AxisBinning(sketches[a][i], dims[a]));
+        continue;
+      }
+      if ((scales[a] == AxisBinning::logarithmic) && !(mins[i][a] > 0.0)) mins[i][a] = minPositive[i][a];
+      binning[a].push_back(AxisBinning(scales[a], mins[i][a], maxs[i][a], dims[a]));
+    }
 
     std::cerr << "Species " << i << ": min=("<<mins[i][0]<<","<<mins[i][1]
       <<") max=("<<maxs[i][0]<<","<<maxs[i][1]
-      <<") dx=("<<dx[i][0]<<","<<dx[i][1]<< ")\n";
+      <<") bins=("<<binning[0][i].size()<<","<<binning[1][i].size()<< ")\n";
   }
   
 
+  // the histograms are allocated once the number of species is known, each
+  // particle deposits into at most four bins
+  Histogram2d::Storage storage;
+  if (!Histogram2d::parseStorage(storageName, storage))
+  {
+    int64_t maxEntries = 0;
+    for (int i=0; i<maxId; ++i) maxEntries += std::min(4*counts[i], int64_t(xdim)*ydim);
+    storage = Histogram2d::chooseStorage(maxId, xdim, ydim, maxEntries);
+  }
+  // adaptive bins may have merged, so each species gets the size of its own binning
+  for (int i=0; i<maxId; ++i)
+    plots.push_back(Histogram2d::create(storage, binning[0][i].size(), binning[1][i].size()));
+
+  filter->setGammaLimits(minGamma, maxGamma);
+  streamFact.setColumns(plotColumns);
   pstream = streamFact.getParticleStream(vm);
 
+  if (!pstream) throw GenericException("No input file given");
   int rank = pstream->getRank();
 
-  if (!pstream)
-  {
-    print_help();
-    exit(-1);
-  }
   pstream->getNextChunks();
 
   while (! pstream->eos() )
   {
-    GridIt1 sp_it = pstream->species->cbegin();
-    GridIt1 wg_it = pstream->weight->cbegin();
-    GridIt1 px_it = pstream->px->cbegin();
-    GridIt1 py_it = pstream->py->cbegin();
-    GridIt1 pz_it = pstream->pz->cbegin();
-    GridIt2 mesh_it = pstream->mesh->cbegin();
+    const ParticleChunk &chunk = pstream->getChunk();
     
-    while (sp_it != pstream->species->cend())
+    for (int64_t i=0; i<chunk.length(); ++i, ++pos)
     {
 
-      double px = *px_it;
-      double py = *py_it;
-      double pz = *pz_it;
-      double x = *mesh_it;
-      double y;
-      double z;
-      if (rank>1)
-      {
-        ++mesh_it;
-        y = *mesh_it;
-      }
-      if (rank>2)
-      {
-        ++mesh_it;
-        z = *mesh_it;
-      }
+      double px = chunk.px()[i];
+      double py = chunk.py()[i];
+      double pz = chunk.pz()[i];
+      double x = chunk.x()[i];
+      double y = (rank>1) ? chunk.y()[i] : 0.0;
 
-      int id = *sp_it - 1;
-      if (( (id >= xsmin.size()) || (x>xsmin[id]) ) &&
-          ( (id >= xsmax.size()) || (x<xsmax[id]) ) &&
-          ( (rank<2) ||
-            ( ((id >= ysmin.size()) || (y>ysmin[id]) ) &&
-              ((id >= ysmax.size()) || (y<ysmax[id]) ))) &&
-          ( allPx || (px>0)) )
-      {
+      int id = chunk.species()[i] - 1;
+      // spatial limits, posPx and the energy limits have been applied by the stream
+      if (id < 0) ++smallId;
+      else {
 
-        if (id < 0) ++smallId;
-        else {
-          double gamma2 = 1 + px*px + py*py + pz*pz;
-          if ((gamma2 >= minGamma2) && ((maxGamma<1.0) || (gamma2<=maxGamma2)))
-          {
+        double X = getValue(0, px, py, pz, x, y);
+        double Y = getValue(1, px, py, pz, x, y);
+        double Mom = getValue(2, px, py, pz, x, y);
 
-            double X = getValue(0, px, py, pz, x, y);
-            double Y = getValue(1, px, py, pz, x, y);
-            double Mom = getValue(2, px, py, pz, x, y);
+        double xpic = binning[0][id].position(X);
+        double ypic = binning[1][id].position(Y);
+        int nx = binning[0][id].size();
+        int ny = binning[1][id].size();
 
-            double xpic = (X - mins[id][0])/dx[id][0];
-            double ypic = (Y - mins[id][1])/dx[id][1];
+        int xbin = floor(xpic);
+        int ybin = floor(ypic);
 
-            int xbin = floor(xpic);
-            int ybin = floor(ypic);
+        double x_frac = xpic - xbin;
+        double y_frac = ypic - ybin;
 
-            double x_frac = xpic - xbin;
-            double y_frac = ypic - ybin;
+        if (xbin<0) { xbin=0; x_frac=0;}
+        if (ybin<0) { ybin=0; y_frac=0;}
+        if (xbin>=nx-1)  { xbin=std::max(nx-2, 0); x_frac=(nx>1) ? 1 : 0;}
+        if (ybin>=ny-1)  { ybin=std::max(ny-2, 0); y_frac=(ny>1) ? 1 : 0;}
 
-            if (xbin<0) { xbin=0; x_frac=0;}
-            if (ybin<0) { ybin=0; y_frac=0;}
-            if (xbin>=xdim-1)  { xbin=xdim-2; x_frac=1;}
-            if (ybin>=ydim-1)  { ybin=ydim-2; y_frac=1;}
+        // an axis with a single bin deposits everything into it
+        int xnext = std::min(xbin+1, nx-1);
+        int ynext = std::min(ybin+1, ny-1);
 
-            DataGrid2d &grid = *plots[id];
-            grid(xbin  ,ybin)   += Mom * (*wg_it) * (1-x_frac) * (1-y_frac);
-            grid(xbin+1,ybin)   += Mom * (*wg_it) * x_frac     * (1-y_frac);
-            grid(xbin  ,ybin+1) += Mom * (*wg_it) * (1-x_frac) * y_frac;
-            grid(xbin+1,ybin+1) += Mom * (*wg_it) * x_frac     * y_frac;
+        Histogram2d &grid = *plots[id];
+        grid.add(xbin  ,ybin,   Mom * chunk.weight()[i] * (1-x_frac) * (1-y_frac));
+        grid.add(xnext ,ybin,   Mom * chunk.weight()[i] * x_frac     * (1-y_frac));
+        grid.add(xbin  ,ynext,  Mom * chunk.weight()[i] * (1-x_frac) * y_frac);
+        grid.add(xnext ,ynext,  Mom * chunk.weight()[i] * x_frac     * y_frac);
 
   /*
-            int xbin = floor(xpic + 0.5);
-            int ybin = floor(ypic + 0.5);
-
-            double x_frac = xpic - xbin;
-            double y_frac = ypic - ybin;
-
-            double gx[5], gy[5];
-            double cf2 = x_frac*x_frac;
-            double t1 = (0.5 + x_frac);
-            t1 = t1*t1;
-            gx(-2) = t1*t1;
-            gx(-1) = 4.75 + 11.0*x_frac + 4.0*cf2*(1.5 - x_frac - cf2);
-            gx( 0) = 14.375 + 6.0*cf2*(cf2 - 2.5);
-            gx( 1) = 4.75 - 11.0*x_frac + 4.0*cf2*(1.5 + x_frac - cf2);
-            t1 = (0.5_num - x_frac);
-            t1 = t1*t1;
-            gx( 2) = t1*t1;
-
-            cf2 = y_frac*y_frac;
-            t1 = (0.5 + y_frac);
-            t1 = t1*t1;
-            gy(-2) = t1*t1;
-            gy(-1) = 4.75 + 11.0*y_frac + 4.0*cf2*(1.5 - y_frac - cf2);
-            gy( 0) = 14.375 + 6.0*cf2*(cf2 - 2.5);
-            gy( 1) = 4.75 - 11.0*y_frac + 4.0*cf2*(1.5 + y_frac - cf2);
-            t1 = (0.5_num - y_frac);
-            t1 = t1*t1;
-            gy( 2) = t1*t1;
+        int xbin = floor(xpic + 0.5);
+        int ybin = floor(ypic + 0.5);
+
+        double x_frac = xpic - xbin;
+        double y_frac = ypic - ybin;
+
+        double gx[5], gy[5];
+        double cf2 = x_frac*x_frac;
+        double t1 = (0.5 + x_frac);
+        t1 = t1*t1;
+        gx(-2) = t1*t1;
+        gx(-1) = 4.75 + 11.0*x_frac + 4.0*cf2*(1.5 - x_frac - cf2);
+        gx( 0) = 14.375 + 6.0*cf2*(cf2 - 2.5);
+        gx( 1) = 4.75 - 11.0*x_frac + 4.0*cf2*(1.5 + x_frac - cf2);
+        t1 = (0.5_num - x_frac);
+        t1 = t1*t1;
+        gx( 2) = t1*t1;
+
+        cf2 = y_frac*y_frac;
+        t1 = (0.5 + y_frac);
+        t1 = t1*t1;
+        gy(-2) = t1*t1;
+        gy(-1) = 4.75 + 11.0*y_frac + 4.0*cf2*(1.5 - y_frac - cf2);
+        gy( 0) = 14.375 + 6.0*cf2*(cf2 - 2.5);
+        gy( 1) = 4.75 - 11.0*y_frac + 4.0*cf2*(1.5 + y_frac - cf2);
+        t1 = (0.5_num - y_frac);
+        t1 = t1*t1;
+        gy( 2) = t1*t1;
    */
-          }
 
-          maxPos = pos;
-        }
+        maxPos = pos;
       }
-      ++sp_it;
-      ++mesh_it;
-      ++px_it;
-      ++py_it;
-      ++pz_it;
-      ++wg_it;
-      ++pos;
     }
     pstream->getNextChunks();
   }
 
+  bool chunked = (vm.count("chunked")>0);
   for (int i=0; i<plots.size(); ++i) {
     std::string outputName = createOutputFile(i);
     HDFostream output(outputName.c_str());
-    output << *plots[i];
+    plots[i]->write(output, chunked);
+    const char *edgeNames[2] = { "xedges", "yedges" };
+    for (int a=0; a<2; ++a)
+    {
+      if (scales[a] == AxisBinning::linear) continue;
+      GridIndex1d size(binning[a][i].size()+1);
+      DataGrid1d edges(size);
+      for (int k=0; k<=binning[a][i].size(); ++k) edges(k) = binning[a][i].getEdge(k);
+      output.setBlockName(edgeNames[a]);
+      output << edges;
+    }
     output.close();
   }
 
@@ -506,35 +478,18 @@ void McfdCommand_phaseplot::execute(int argc, char **argv)
 
 char McfdCommand_phaseplot::makeAxisId(std::string axisStr, bool allowUnity)
 {
-  if ((axisStr == "1") && allowUnity) return 100;
-  if (axisStr == "x") return 0;
-  if (axisStr == "y") return 1;
-  if (axisStr == "px") return 2;
-  if (axisStr == "py") return 3;
-  if (axisStr == "pz") return 4;
-  if (axisStr == "E") return 5;
-  if (axisStr == "Ex") return 6;
-  if (axisStr == "Ey") return 7;
-  if (axisStr == "Ez") return 8;
-  if (axisStr == "v") return 9;
-  if (axisStr == "vx") return 10;
-  if (axisStr == "vy") return 11;
-  if (axisStr == "vz") return 12;
-  if (axisStr == "theta") return 13;
-  if (axisStr == "theta2") return 14;
-  if (axisStr == "pxt") return 15;
-  if (axisStr == "pyt") return 16;
-  if (axisStr == "pzt") return 17;
-
-  if (allowUnity) return 100;
-  else return 0;
+  int id = ParticleAxes::parseId(axisStr, allowUnity);
+  if (id >= 0) return id;
+  return allowUnity ? ParticleAxes::unity : 0;
 }
 
 void McfdCommand_phaseplot::print_help()
 {
   std::cout << "\n  Manipulate cfd files: creates a phase-plot for species and stores in hdf5 format\n\n  Usage:\n"
         << "    mcfd phaseplot [options] <input>\n\n"
-        << "  where <input> is the name of the cfd/raw file.\n\n";
+        << "  where <input> is the name of the cfd/raw file.\n\n"
+        << "  With log or adaptive bins the bin edges of that axis are written to the data sets\n"
+        << "  xedges and yedges next to the plot.\n\n";
 
   std::cout << option_desc;
 }
@@ -17,9 +17,6 @@
 class McfdCommand_phaseplot: public MsdfCommand
 {
   private:
-    typedef DataGrid1d::const_storage_iterator GridIt1;
-    typedef DataGrid2d::const_storage_iterator GridIt2;
-    
     boost::program_options::options_description option_desc;
     boost::program_options::positional_options_description option_pos;
     ParticleStreamFactory streamFact;
@@ -43,6 +40,8 @@ class McfdCommand_phaseplot: public MsdfCommand
     int limitY;
 
     bool batch;
+    std::string storageName;
+    std::string xScaleName, yScaleName;
 
     int64_t chunkLength;
 
@@ -0,0 +1,151 @@
+/*
+ * rawindex.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "rawindex.hpp"
+#include "parallel.hpp"
+#include "common/binaryio.hpp"
+
+#include <fstream>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+RawIndex::RawIndex(const std::vector<std::string> &pieces_, int numThreads)
+  : pieces(pieces_), totalRows(0)
+{
+  int numPieces = pieces.size();
+  std::vector<std::vector<RawSegment> > pieceSegments(numPieces);
+  std::vector<std::string> errors(numPieces);
+
+  parallelFor(numPieces, numThreads, [&](int p)
+  {
+    try
+    {
+      scanPiece(pieces[p], p, pieceSegments[p]);
+    }
+    catch (msdf::GenericException &e)
+    {
+      errors[p] = e.getMessage();
+    }
+  });
+
+  for (int p=0; p<numPieces; ++p)
+  {
+    if (!errors[p].empty()) throw msdf::GenericException(errors[p]);
+    for (size_t s=0; s<pieceSegments[p].size(); ++s) totalRows += pieceSegments[p][s].count;
+    segments.insert(segments.end(), pieceSegments[p].begin(), pieceSegments[p].end());
+  }
+}
+
+/*
+ * A piece starts with the file header, followed by the species. Each species
+ * has a header and a sequence of chunks, each preceded by its length. A chunk
+ * shorter than the nominal chunk length ends the species.
+ */
+void RawIndex::scanPiece(const std::string &fname, int32_t piece, std::vector<RawSegment> &segments)
+{
+  std::ifstream stream(fname.c_str(), std::ios::binary);
+  if (!stream) throw msdf::GenericException("Could not open raw file " + fname);
+
+  try
+  {
+    scanPiece(stream, piece, segments);
+  }
+  catch (msdf::GenericException &e)
+  {
+    throw msdf::GenericException(e.getMessage() + " " + fname);
+  }
+}
+
+void RawIndex::scanPiece(std::istream &stream, int32_t piece, std::vector<RawSegment> &segments)
+{
+  int32_t count_i, rank, n_species, chunk;
+  double x_min, x_max, y_min, y_max;
+  msdf::detail::readValue(stream, count_i);
+  msdf::detail::readValue(stream, rank);
+  msdf::detail::readValue(stream, n_species);
+  msdf::detail::readValue(stream, chunk);
+  msdf::detail::readValue(stream, x_min);
+  msdf::detail::readValue(stream, x_max);
+  msdf::detail::readValue(stream, y_min);
+  msdf::detail::readValue(stream, y_max);
+  if (!stream) throw msdf::GenericException("Could not read the header of raw file");
+
+  for (int32_t species=1; species<=n_species; ++species)
+  {
+    int32_t npleft, chunk_size;
+    double spcharge, spmass;
+    msdf::detail::readValue(stream, npleft);
+    msdf::detail::readValue(stream, spcharge);
+    msdf::detail::readValue(stream, spmass);
+    msdf::detail::readValue(stream, chunk_size);
+
+    while (true)
+    {
+      if (!stream || (chunk_size < 0))
+        throw msdf::GenericException("Corrupt species or chunk header in raw file");
+
+      if (chunk_size > 0)
+      {
+        RawSegment segment;
+        segment.piece = piece;
+        segment.species = species;
+        segment.offset = stream.tellg();
+        segment.count = chunk_size;
+        segments.push_back(segment);
+        stream.seekg(int64_t(chunk_size)*recordBytes, std::ios::cur);
+      }
+
+      if ((chunk_size == 0) || (chunk_size != chunk)) break;
+      msdf::detail::readValue(stream, chunk_size);
+    }
+  }
+}
+
+void deinterleaveRecords(const float *src, int64_t count, double *const *dst)
+{
+  double *x = dst[0], *y = dst[1], *px = dst[2], *py = dst[3], *pz = dst[4], *w = dst[5];
+  int64_t i = 0;
+
+#ifdef __SSE2__
+  // the twelve floats of two records are converted in pairs and transposed
+  for (; i+1<count; i+=2)
+  {
+    const float *rec = src + 6*i;
+    __m128 a = _mm_loadu_ps(rec);
+    __m128 b = _mm_loadu_ps(rec + 4);
+    __m128 c = _mm_loadu_ps(rec + 8);
+
+    __m128d xy0 = _mm_cvtps_pd(a);
+    __m128d pxy0 = _mm_cvtps_pd(_mm_movehl_ps(a, a));
+    __m128d pzw0 = _mm_cvtps_pd(b);
+    __m128d xy1 = _mm_cvtps_pd(_mm_movehl_ps(b, b));
+    __m128d pxy1 = _mm_cvtps_pd(c);
+    __m128d pzw1 = _mm_cvtps_pd(_mm_movehl_ps(c, c));
+
+    _mm_storeu_pd(x + i, _mm_unpacklo_pd(xy0, xy1));
+    _mm_storeu_pd(y + i, _mm_unpackhi_pd(xy0, xy1));
+    _mm_storeu_pd(px + i, _mm_unpacklo_pd(pxy0, pxy1));
+    _mm_storeu_pd(py + i, _mm_unpackhi_pd(pxy0, pxy1));
+    _mm_storeu_pd(pz + i, _mm_unpacklo_pd(pzw0, pzw1));
+    _mm_storeu_pd(w + i, _mm_unpackhi_pd(pzw0, pzw1));
+  }
+#endif
+
+  for (; i<count; ++i)
+  {
+    const float *rec = src + 6*i;
+    x[i] = rec[0];
+    y[i] = rec[1];
+    px[i] = rec[2];
+    py[i] = rec[3];
+    pz[i] = rec[4];
+    w[i] = rec[5];
+  }
+}
@@ -0,0 +1,72 @@
+/*
+ * rawindex.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef RAWINDEX_H_
+#define RAWINDEX_H_
+
+#include <stdint.h>
+#include <istream>
+#include <string>
+#include <vector>
+
+/**
+ * A contiguous run of records of one species in a piece of a raw RGE file.
+ * Each record holds x, y, px, py, pz and the weight as floats.
+ */
+struct RawSegment
+{
+    int32_t piece;
+    int32_t species;
+    int64_t offset;
+    int64_t count;
+};
+
+/**
+ * The index of the records in all pieces (file.000, file.001, ...) of a raw
+ * RGE file.
+ *
+ * The species and chunk headers of the pieces are scanned without reading
+ * the records, by seeking over them. The segments are ordered by piece, then
+ * by their position in the piece, which is the order in which the records
+ * have always been streamed.
+ */
+class RawIndex
+{
+  public:
+    /// The number of bytes of one record
+    static const int recordBytes = 6*sizeof(float);
+
+    RawIndex() : totalRows(0) {}
+
+    /// Scan the pieces in the given order, using numThreads threads
+    RawIndex(const std::vector<std::string> &pieces_, int numThreads);
+
+    const std::vector<RawSegment> &getSegments() const { return segments; }
+    const std::string &getPiece(int piece) const { return pieces[piece]; }
+    int getNumPieces() const { return pieces.size(); }
+    int64_t getTotalRows() const { return totalRows; }
+
+    /// Append the segments of one piece
+    static void scanPiece(const std::string &fname, int32_t piece, std::vector<RawSegment> &segments);
+
+    /// Append the segments of a piece read from a stream, offsets are relative to its start
+    static void scanPiece(std::istream &stream, int32_t piece, std::vector<RawSegment> &segments);
+  private:
+    std::vector<std::string> pieces;
+    std::vector<RawSegment> segments;
+    int64_t totalRows;
+};
+
+/**
+ * Convert count interleaved records into the six arrays dst[0..5] holding
+ * x, y, px, py, pz and the weight. Two records at a time are converted and
+ * transposed in SSE2 registers where available.
+ */
+void deinterleaveRecords(const float *src, int64_t count, double *const *dst);
+
+#endif /* RAWINDEX_H_ */
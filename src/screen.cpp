@@ -9,6 +9,12 @@
 
 #include "screen.hpp"
 #include "particlestream.hpp"
+#include "bufferpool.hpp"
+#include "histogram.hpp"
+#include "hdfstream.hpp"
+#include "parallel.hpp"
+#include "axisbinning.hpp"
+#include "tdigest.hpp"
 #include <fstream>
 #include <vector>
 #include <iostream>
@@ -75,41 +81,76 @@ McfdCommand_screen::McfdCommand_screen()
   option_desc.add_options()
     ("moment", po::value<std::string>(&moment),"specifies the moment to be integrated. Any of 1,x,y,px,py,pz,E,Ex,Ey,Ez (default: '1')")
     ("dim", po::value<int>(&dim),"dimensions of the output data grid in the x-direction (default: 1024)")
-    ("xscreen", po::value<double>(&xscreen),"x-position of the screen (default: 0.0)")
-    ("yrmin", po::value<std::string>(&yrminStr),"minimum of the plot's y-range (default: 0.0)")
-    ("yrmax", po::value<std::string>(&yrmaxStr),"maximum of the plot's y-range (default: 0.0)")
+    ("xscreen", po::value<std::string>(&xscreenStr),"x-positions of the screens separated by commas, first:last:count adds count equally spaced screens (default: 0.0)")
+    ("yrmin", po::value<std::string>(&yrminStr),"minimum of the plot's y-range per species, the last value is used for the remaining species (default: range of the data)")
+    ("yrmax", po::value<std::string>(&yrmaxStr),"maximum of the plot's y-range per species, the last value is used for the remaining species (default: range of the data)")
     ("xsmin", po::value<std::string>(&xsminStr),"minimum of the physical x-range from which to consider particles (default: 0.0)")
     ("xsmax", po::value<std::string>(&xsmaxStr),"maximum of the physical x-range from which to consider particles (default: 0.0)")
     ("ysmin", po::value<std::string>(&ysminStr),"minimum of the physical y-range from which to consider particles (default: 0.0)")
     ("ysmax", po::value<std::string>(&ysmaxStr),"maximum of the physical y-range from which to consider particles (default: 0.0)")
     ("mingamma", po::value<double>(&minGamma),"minimum energy of the particles to plot (default: 0.0)")
     ("maxgamma", po::value<double>(&maxGamma),"maximum energy of the particles to plot (default: no maximum energy)")
+    ("plane", "project onto the (y,z) plane of the screen with py/px and pz/px and write 2D HDF histograms")
+    ("zdim", po::value<int>(&zdim),"dimensions of the output data grid in the z-direction in plane mode (default: dim)")
+    ("zrmin", po::value<std::string>(&zrminStr),"minimum of the plot's z-range per species in plane mode")
+    ("zrmax", po::value<std::string>(&zrmaxStr),"maximum of the plot's z-range per species in plane mode")
+    ("scale", po::value<std::string>(&scaleName),"spacing of the bins, one of lin, log or adaptive. Adaptive bins hold equal weight and need a pass over the data. Not used in plane mode (default: 'lin')")
+    ("chunked", "write chunked HDF datasets that only store the non-empty blocks of the plot in plane mode")
+    ("threads,j", po::value<int>(&numThreads),"number of threads used in plane mode (default: number of cores)")
     ("all", "If specified, consider all particles, otherwise only consider those moving towards the screen")
-    ("output,o", po::value<std::string>(&outputName),"base name of the output file. A # in the file name will be replaced with the species number. If no # is present, the species number will be appended to the file name.")
+    ("output,o", po::value<std::string>(&outputName),"base name of the output file. A # in the file name will be replaced with the species number. If no # is present, the species number will be appended to the file name. With more than one screen, a @ will be replaced with the screen index, or _<index> is appended.")
     ("batch,b", "create output for batch processing of data.");
 
   option_pos.add("input", 1);
 }
 
 
+void McfdCommand_screen::parseScreenList(std::string s, std::vector<double> &screens)
+{
+  typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
+  boost::char_separator<char> sep(",");
+
+  tokenizer tokens(s, sep);
+  for (tokenizer::iterator tok_iter = tokens.begin(); tok_iter != tokens.end(); ++tok_iter)
+  {
+    std::vector<std::string> range;
+    boost::split(range, *tok_iter, boost::is_any_of(":"));
+    try {
+      if (range.size() == 1) screens.push_back(boost::lexical_cast<double>(range[0]));
+      else if (range.size() == 3)
+      {
+        double first = boost::lexical_cast<double>(range[0]);
+        double last = boost::lexical_cast<double>(range[1]);
+        int count = boost::lexical_cast<int>(range[2]);
+        for (int k=0; k<count; ++k)
+          screens.push_back((count > 1) ? first + k*(last - first)/(count - 1) : first);
+      }
+      else throw boost::bad_lexical_cast();
+    }
+    catch (boost::bad_lexical_cast &)
+    {
+      std::cerr << "ERROR: Could not convert screen position '"<< *tok_iter << "'\n";
+    }
+  }
+}
+
 void McfdCommand_screen::execute(int argc, char **argv)
 {
-  double minGamma2, maxGamma2;
-  typedef schnek::Array<double,1> Coord;
-  std::vector<pDataGrid1d> plots;
-  std::vector<Coord> mins;
-  std::vector<Coord> maxs;
-  std::vector<Coord> dx;
-  std::vector<bool> minMaxSet;
+  // the plots, ranges and bin widths are indexed by species and screen
+  std::vector<std::vector<pDataGrid1d> > plots;
+  std::vector<DoubleVector> mins;
+  std::vector<DoubleVector> maxs;
+  std::vector<DoubleVector> dx;
+  std::vector<std::vector<bool> > minMaxSet;
+  std::vector<std::vector<AxisBinning> > binning;
+  std::vector<std::vector<TDigest> > sketches;
+  std::vector<double> screens;
 
   int maxId = 0;
   int smallId = 0;
   long maxPos = 0;
   long pos = 0;
 
-//  typedef boost::shared_ptr<std::ofstream> pofstream;
-//  std::vector<pofstream> output_files;
-
   po::variables_map vm;
   po::store(po::command_line_parser(argc, argv).
             options(option_desc).positional(option_pos).run(), vm);
@@ -121,12 +162,20 @@ void McfdCommand_screen::execute(int argc, char **argv)
   limitX = false;
 
 
-  if (vm.count("output")<1) outputName = "phaseplot#.dat";
+  if (vm.count("output")<1) outputName = (vm.count("plane")>0) ? "screen#.h5" : "phaseplot#.dat";
   if (vm.count("moment")<1) moment = "1";
   if (vm.count("mingamma")<1) minGamma = 0.0;
   if (vm.count("maxgamma")<1) maxGamma = 0.0;
   if (vm.count("dim")<1) dim = 1024;
-  if (vm.count("xscreen")<1) xscreen = 0.0;
+  if (vm.count("zdim")<1) zdim = dim;
+  if (vm.count("scale")<1) scaleName = "lin";
+  if (vm.count("xscreen")<1) xscreenStr = "0.0";
+  if (vm.count("threads")<1) numThreads = defaultThreadCount();
+
+  parseScreenList(xscreenStr, screens);
+  if (screens.empty()) throw GenericException("No screen positions given in --xscreen");
+  int numScreens = screens.size();
+  if (!batch) std::cout << "Projecting onto " << numScreens << " screens\n";
 
 
   std::vector<double> yrmin, yrmax;
@@ -169,216 +218,365 @@ void McfdCommand_screen::execute(int argc, char **argv)
     parseNumberList(ysmaxStr, ysmax);
   }
 
-  std::cout <<"SIZE: "<< xsmin.size() << " " << xsmax.size() << " " << ysmin.size() << " " << ysmax.size() << " \n";
-
   limitX = std::max(yrmin.size(), yrmax.size());
 
-  minGamma2 = minGamma*minGamma;
-  maxGamma2 = maxGamma*maxGamma;
+  // with both limits of the plot range given, the range pass over the data is not needed
+  AxisBinning::Scale scale;
+  if (!AxisBinning::parseScale(scaleName, scale))
+    throw GenericException("Unknown scale " + scaleName);
+  bool adaptive = (scale == AxisBinning::adaptive);
+  bool rangePass = yrmin.empty() || yrmax.empty() || adaptive;
 
   momentId = makeAxisId(moment);
 
+  // the projection always needs the positions together with px and py
+  int rangeColumns = pc_species | pc_mesh | pc_px | pc_py;
+  int plotColumns = rangeColumns | pc_weight | particleColumnsForAxis(momentId);
 
-  // set up species arrays and calculate min and max values
+  // the screen range is determined without the energy limits
+  pParticleFilter filter(new ParticleFilter());
+  filter->setSpatialLimits(xsmin, xsmax, ysmin, ysmax);
+  streamFact.setFilter(filter);
 
-  pParticleStream pstream = streamFact.getParticleStream(vm);
-  if (!pstream)
+  if (vm.count("plane")>0)
   {
-    print_help();
-    exit(-1);
+    filter->setGammaLimits(minGamma, maxGamma);
+    projectPlane(vm, screens, yrmin, yrmax, allParticles);
+    return;
   }
-  pstream->getNextChunks();
 
-  while (! pstream->eos() )
+  auto addSpecies = [&](int id)
   {
-    GridIt1 sp_it = pstream->species->cbegin();
-    GridIt1 px_it = pstream->px->cbegin();
-    GridIt1 py_it = pstream->py->cbegin();
-    GridIt1 pz_it = pstream->pz->cbegin();
-    GridIt2 mesh_it = pstream->mesh->cbegin();
+    for (int i=maxId; i<id; ++i)
+    {
+      mins.push_back(DoubleVector(numScreens, 0.0));
+      maxs.push_back(DoubleVector(numScreens, 0.0));
+      minMaxSet.push_back(std::vector<bool>(numScreens, false));
+      binning.push_back(std::vector<AxisBinning>(numScreens));
+      if (adaptive) sketches.push_back(std::vector<TDigest>(numScreens));
+      plots.push_back(std::vector<pDataGrid1d>(numScreens));
+      for (int k=0; k<numScreens; ++k)
+      {
+        plots.back()[k] = pDataGrid1d(new DataGrid1d(GridIndex1d(dim)));
+        *plots.back()[k] = 0;
+      }
+    }
+    maxId = id;
+  };
 
-    while (sp_it != pstream->species->cend())
+  auto setBins = [&](int i)
+  {
+    dx.resize(i+1);
+    dx[i].resize(numScreens);
+    for (int k=0; k<numScreens; ++k)
     {
+      if (yrmin.size()>i) mins[i][k] = yrmin[i];
+      else if (!rangePass) mins[i][k] = yrmin.back();
+      if (yrmax.size()>i) maxs[i][k] = yrmax[i];
+      else if (!rangePass) maxs[i][k] = yrmax.back();
+
+      dx[i][k] = (maxs[i][k]-mins[i][k])/dim;
+      if (adaptive && (sketches[i][k].getWeight() > 0.0))
+        binning[i][k] = AxisBinning(sketches[i][k], dim);
+      else
+        binning[i][k] = AxisBinning(adaptive ? AxisBinning::linear : scale, mins[i][k], maxs[i][k], dim);
+
+      if (!batch)
+        std::cerr << "Species " << i << ", screen " << screens[k] << ": min=("<<mins[i][k]
+          <<") max=("<<maxs[i][k]
+          <<") dx=("<<dx[i][k]<< ")\n";
+    }
+  };
 
-      double px = *px_it;
-      double py = *py_it;
-      double pz = *pz_it;
-      double x = *mesh_it;
-      ++mesh_it;
-      double y = *mesh_it;
+  pParticleStream pstream;
+  if (rangePass)
+  {
+    // set up species arrays and calculate min and max values
+    streamFact.setColumns(rangeColumns);
+    pstream = streamFact.getParticleStream(vm);
+    if (!pstream) throw GenericException("No input file given");
+    pstream->getNextChunks();
 
-      int id = *sp_it;
-      if (id > maxId)
+    while (! pstream->eos() )
+    {
+      const ParticleChunk &chunk = pstream->getChunk();
+
+      for (int64_t i=0; i<chunk.length(); ++i, ++pos)
       {
-        for (int i=maxId; i<id; ++i)
-        {
-//          pofstream ofile = pofstream(new std::ofstream(this->createOutputFile(i).c_str()));
-//          output_files.push_back(ofile);
-          mins.push_back(Coord(0));
-          maxs.push_back(Coord(0));
-          minMaxSet.push_back(false);
-          pDataGrid1d pGrid(new DataGrid1d(GridIndex1d(dim)));
-          *pGrid = 0;
-          plots.push_back(pGrid);
-        }
-        maxId = id;
-      }
 
-      id = id-1; // get in line with C indexing
+        double px = chunk.px()[i];
+        double py = chunk.py()[i];
+        double x = chunk.x()[i];
+        double y = (chunk.getRank() > 1) ? chunk.y()[i] : 0.0;
 
-      if (( (id >= xsmin.size()) || (x>xsmin[id]) ) &&
-          ( (id >= xsmax.size()) || (x<xsmax[id]) ) &&
-          ( (id >= ysmin.size()) || (y>ysmin[id]) ) &&
-          ( (id >= ysmax.size()) || (y<ysmax[id]) ) &&
-          ( allParticles || (px*(xscreen-x)>=0)) )
-      {
-        if (id < 0) ++smallId;
-        else {
+        int id = chunk.species()[i];
+        if (id > maxId) addSpecies(id);
+
+        id = id-1; // get in line with C indexing
+
+        if (id < 0) { ++smallId; continue; }
 
-          Coord minC = mins[id];
-          Coord maxC = maxs[id];
-          if (minMaxSet[id])
+        // the spatial limits have been applied by the stream
+        for (int k=0; k<numScreens; ++k)
+        {
+          if ( !allParticles && (px*(screens[k]-x)<0) ) continue;
+          if (minMaxSet[id][k])
           {
-            minC[0] = std::min(minC[0],y);
-            maxC[0] = std::max(maxC[0],y);
+            mins[id][k] = std::min(mins[id][k],y);
+            maxs[id][k] = std::max(maxs[id][k],y);
           }
           else
           {
-            minC[0] = y;
-            maxC[0] = y;
-            minMaxSet[id] = true;
+            mins[id][k] = y;
+            maxs[id][k] = y;
+            minMaxSet[id][k] = true;
           }
-          mins[id] = minC;
-          maxs[id] = maxC;
-
+          if (adaptive) sketches[id][k].add(y + (screens[k] - x)*py/px);
           maxPos = pos;
         }
       }
-      ++sp_it;
-      ++mesh_it;
-      ++px_it;
-      ++py_it;
-      ++pz_it;
-      ++pos;
+      pstream->getNextChunks();
     }
-    pstream->getNextChunks();
-  }
 
+    if (smallId>0) {
+      std::cerr << "WARNING!\n    " << smallId << " species IDs found with values < 1\n";
+      smallId = 1;
+    }
 
-  if (smallId>0) {
-    std::cerr << "WARNING!\n    " << smallId << " species IDs found with values < 1\n";
-    smallId = 1;
+    for (int i=0; i<maxId; ++i) setBins(i);
   }
 
+  filter->setGammaLimits(minGamma, maxGamma);
+  streamFact.setColumns(plotColumns);
+  pstream = streamFact.getParticleStream(vm);
+  if (!pstream) throw GenericException("No input file given");
+  pstream->getNextChunks();
+
+  // the bins of one particle on all screens, filled in a loop without branches
+  std::vector<double> xpic(numScreens);
+  std::vector<int> xbins(numScreens);
 
-  dx.resize(mins.size());
-  for (int i=0; i<mins.size(); ++i)
+  while (! pstream->eos() )
   {
-    if (yrmin.size()>i) mins[i][0] = yrmin[i];
-    if (yrmax.size()>i) maxs[i][0] = yrmax[i];
+    const ParticleChunk &chunk = pstream->getChunk();
 
-    dx[i] = Coord((maxs[i][0]-mins[i][0])/dim );
+    for (int64_t i=0; i<chunk.length(); ++i, ++pos)
+    {
 
-    if (!batch)
-      std::cerr << "Species " << i << ": min=("<<mins[i][0]
-        <<") max=("<<maxs[i][0]
-        <<") dx=("<<dx[i][0]<< ")\n";
-  }
+      double px = chunk.px()[i];
+      double py = chunk.py()[i];
+      double pz = chunk.pz()[i];
+      double x = chunk.x()[i];
+      double y = (chunk.getRank() > 1) ? chunk.y()[i] : 0.0;
 
+      int id = chunk.species()[i];
+      if (id > maxId)
+      {
+        // without the range pass species are only discovered here
+        int first = maxId;
+        addSpecies(id);
+        for (int s=first; s<id; ++s) setBins(s);
+      }
+      id = id-1;
 
-  pstream = streamFact.getParticleStream(vm);
-  if (!pstream)
-  {
-    print_help();
-    exit(-1);
+      // the spatial limits have been applied by the stream
+      if (id < 0) { ++smallId; continue; }
+
+      double slope = py/px;
+      const AxisBinning *screenBins = binning[id].data();
+      for (int k=0; k<numScreens; ++k)
+        xpic[k] = screenBins[k].position(y + (screens[k] - x)*slope);
+
+      double value = getValue(px, py, pz, x, y) * chunk.weight()[i];
+      for (int k=0; k<numScreens; ++k)
+      {
+        if ( !allParticles && (px*(screens[k]-x)<0) ) continue;
+        int bins = screenBins[k].size();
+        if (!((xpic[k] >= 0) && (xpic[k] <= bins))) continue;
+
+        int xbin = floor(xpic[k]);
+        double x_frac = xpic[k] - xbin;
+
+        if (xbin>=bins-1)  { xbin=std::max(bins-2, 0); x_frac=(bins>1) ? 1 : 0;}
+
+        // a screen with a single bin deposits everything into it
+        DataGrid1d &grid = *plots[id][k];
+        grid(xbin) += value * (1-x_frac);
+        grid(std::min(xbin+1, bins-1)) += value * x_frac;
+        maxPos = pos;
+      }
+    }
+    pstream->getNextChunks();
   }
-  pstream->getNextChunks();
 
-  while (! pstream->eos() )
-  {
-    GridIt1 sp_it = pstream->species->cbegin();
-    GridIt1 wg_it = pstream->weight->cbegin();
-    GridIt1 px_it = pstream->px->cbegin();
-    GridIt1 py_it = pstream->py->cbegin();
-    GridIt1 pz_it = pstream->pz->cbegin();
-    GridIt2 mesh_it = pstream->mesh->cbegin();
-
-    while (sp_it != pstream->species->cend())
+  for (int i=0; i<plots.size(); ++i)
+    for (int k=0; k<numScreens; ++k)
     {
+      std::string outputName = createOutputFile(i, k, numScreens);
+      std::ofstream output(outputName.c_str());
+      DataGrid1d &grid = *plots[i][k];
+      double h = dx[i][k];
+      double m = mins[i][k];
+      const AxisBinning &bins = binning[i][k];
+      // non-linear bins are written at their centres and divided by their widths
+      if (bins.getScale() == AxisBinning::linear)
+        for (int j=0; j<dim; ++j) output << j*h + m << " " << grid[j] << "\n";
+      else
+        for (int j=0; j<bins.size(); ++j) output << bins.getCentre(j) << " " << grid[j]/bins.getWidth(j) << "\n";
+      output.close();
+    }
 
-      double px = *px_it;
-      double py = *py_it;
-      double pz = *pz_it;
-      double x = *mesh_it;
-      ++mesh_it;
-      double y = *mesh_it;
-
-      int id = *sp_it - 1;
-      if (( (id >= xsmin.size()) || (x>xsmin[id]) ) &&
-          ( (id >= xsmax.size()) || (x<xsmax[id]) ) &&
-          ( (id >= ysmin.size()) || (y>ysmin[id]) ) &&
-          ( (id >= ysmax.size()) || (y<ysmax[id]) ) &&
-          ( allParticles || (px*(xscreen-x)>=0)) )
-      {
+  if (!batch) std::cout << "Successfully written " << plots.size()*numScreens << " screen plots" << std::endl;
 
-        if (id < 0) ++smallId;
-        else {
-          double gamma2 = 1 + px*px + py*py + pz*pz;
-          double yproj = y + (xscreen - x)*py/px;
+  if (smallId>0)
+    std::cerr << "WARNING!\n    " << smallId << " species IDs found with values < 1\n";
 
-          if ((gamma2 >= minGamma2) &&
-              ((maxGamma2<1) || (gamma2<=maxGamma2)) &&
-              (yproj >= mins[id][0]) &&
-              (yproj <= maxs[id][0]))
-          {
-            double Mom = getValue(px, py, pz, x, y);
+}
 
 
-            double xpic = (yproj - mins[id][0])/dx[id][0];
+/*
+ * The particles of a chunk are first projected onto all screens in parallel.
+ * The histograms are then divided into bands of y-bins and each thread
+ * deposits the contributions that fall into its own band, so no two threads
+ * write the same bin and each bin receives its values in stream order.
+ */
+void McfdCommand_screen::projectPlane(po::variables_map &vm, const std::vector<double> &screens,
+    const std::vector<double> &yrmin, const std::vector<double> &yrmax, bool allParticles)
+{
+  std::vector<double> zrmin, zrmax;
+  if (vm.count("zrmin")>0) parseNumberList(zrminStr, zrmin);
+  if (vm.count("zrmax")>0) parseNumberList(zrmaxStr, zrmax);
+  if (yrmin.empty() || yrmax.empty() || zrmin.empty() || zrmax.empty())
+    throw GenericException("Plane mode needs --yrmin, --yrmax, --zrmin and --zrmax");
 
-            int xbin = floor(xpic);
+  int numScreens = screens.size();
+  bool chunked = (vm.count("chunked")>0);
 
-            double x_frac = xpic - xbin;
+  streamFact.setColumns(pc_species | pc_mesh | pc_momentum | pc_weight | particleColumnsForAxis(momentId));
+  pParticleStream pstream = streamFact.getParticleStream(vm);
+  if (!pstream) throw GenericException("No input file given");
 
-            if (xbin<0) { xbin=0; x_frac=0;}
-            if (xbin>=dim-1)  { xbin=dim-2; x_frac=1;}
+  // the plots are indexed by species and screen, the ranges by species and direction
+  std::vector<std::vector<pHistogram2d> > plots;
+  std::vector<double> mins[2], dx[2];
+  int smallId = 0;
+  BufferPool pool;
 
-            DataGrid1d &grid = *plots[id];
-            grid(xbin  ) += Mom * (*wg_it) * (1-x_frac);
-            grid(xbin+1) += Mom * (*wg_it) * x_frac;
-            grid(xbin  ) += Mom * (*wg_it) * (1-x_frac);
-            grid(xbin+1) += Mom * (*wg_it) * x_frac;
-          }
+  pstream->getNextChunks();
+  while (! pstream->eos() )
+  {
+    const ParticleChunk &chunk = pstream->getChunk();
+    int64_t length = chunk.length();
+    int rank = chunk.getRank();
 
-          maxPos = pos;
-        }
+    for (int64_t i=0; i<length; ++i)
+    {
+      int id = chunk.species()[i];
+      if (id < 1) { ++smallId; continue; }
+      for (int s=plots.size(); s<id; ++s)
+      {
+        plots.push_back(std::vector<pHistogram2d>(numScreens));
+        for (int k=0; k<numScreens; ++k)
+          plots.back()[k] = Histogram2d::create(Histogram2d::dense, dim, zdim);
+        double range[4] = {
+            yrmin[std::min(size_t(s), yrmin.size()-1)], yrmax[std::min(size_t(s), yrmax.size()-1)],
+            zrmin[std::min(size_t(s), zrmin.size()-1)], zrmax[std::min(size_t(s), zrmax.size()-1)] };
+        mins[0].push_back(range[0]);
+        mins[1].push_back(range[2]);
+        dx[0].push_back((range[1] - range[0])/dim);
+        dx[1].push_back((range[3] - range[2])/zdim);
       }
-      ++sp_it;
-      ++mesh_it;
-      ++px_it;
-      ++py_it;
-      ++pz_it;
-      ++wg_it;
-      ++pos;
     }
+
+    // positions on the screens in units of bins, negative if the particle misses the screen
+    double *ypic = pool.get<double>(0, length*numScreens);
+    double *zpic = pool.get<double>(1, length*numScreens);
+    double *value = pool.get<double>(2, length);
+
+    const int64_t blockLength = 4096;
+    int numBlocks = (length + blockLength - 1)/blockLength;
+    parallelFor(numBlocks, numThreads, [&](int b)
+    {
+      for (int64_t i=b*blockLength; i<std::min(length, (b+1)*blockLength); ++i)
+      {
+        int id = chunk.species()[i] - 1;
+        if (id < 0) continue;
+        double px = chunk.px()[i];
+        double py = chunk.py()[i];
+        double pz = chunk.pz()[i];
+        double x = chunk.x()[i];
+        double y = (rank > 1) ? chunk.y()[i] : 0.0;
+        double z = (rank > 2) ? chunk.z()[i] : 0.0;
+        double slopeY = py/px;
+        double slopeZ = pz/px;
+
+        value[i] = getValue(px, py, pz, x, y) * chunk.weight()[i];
+        for (int k=0; k<numScreens; ++k)
+        {
+          double distance = screens[k] - x;
+          double yp = (y + distance*slopeY - mins[0][id])/dx[0][id];
+          double zp = (z + distance*slopeZ - mins[1][id])/dx[1][id];
+          bool hit = (allParticles || (px*distance >= 0))
+              && (yp >= 0) && (yp <= dim) && (zp >= 0) && (zp <= zdim);
+          ypic[k*length + i] = hit ? yp : -1.0;
+          zpic[k*length + i] = zp;
+        }
+      }
+    });
+
+    int numBands = std::min(numThreads, dim);
+    parallelFor(numBands, numThreads, [&](int band)
+    {
+      int rowBegin = int(int64_t(band)*dim/numBands);
+      int rowEnd = int(int64_t(band+1)*dim/numBands);
+      for (int k=0; k<numScreens; ++k)
+        for (int64_t i=0; i<length; ++i)
+        {
+          int id = chunk.species()[i] - 1;
+          if ((id < 0) || !(ypic[k*length + i] >= 0.0)) continue;
+
+          double yp = ypic[k*length + i];
+          double zp = zpic[k*length + i];
+          int ybin = int(yp);
+          int zbin = int(zp);
+          double y_frac = yp - ybin;
+          double z_frac = zp - zbin;
+          if (ybin>=dim-1) { ybin=dim-2; y_frac=1; }
+          if (zbin>=zdim-1) { zbin=zdim-2; z_frac=1; }
+
+          Histogram2d &grid = *plots[id][k];
+          if ((ybin >= rowBegin) && (ybin < rowEnd))
+          {
+            grid.add(ybin, zbin,   value[i] * (1-y_frac) * (1-z_frac));
+            grid.add(ybin, zbin+1, value[i] * (1-y_frac) * z_frac);
+          }
+          if ((ybin+1 >= rowBegin) && (ybin+1 < rowEnd))
+          {
+            grid.add(ybin+1, zbin,   value[i] * y_frac * (1-z_frac));
+            grid.add(ybin+1, zbin+1, value[i] * y_frac * z_frac);
+          }
+        }
+    });
+
     pstream->getNextChunks();
   }
 
-  for (int i=0; i<plots.size(); ++i) {
-    std::string outputName = createOutputFile(i);
-    std::ofstream output(outputName.c_str());
-    DataGrid1d &grid = *plots[i];
-    double h = dx[i][0];
-    double m = mins[i][0];
-    for (int j=0; j<dim; ++j) output << j*h + m << " " << grid[j] << "\n";
+  for (size_t i=0; i<plots.size(); ++i)
+  {
+    std::string outputName = createOutputFile(i, 0, 1);
+    HDFostream output(outputName.c_str());
+    for (int k=0; k<numScreens; ++k)
+    {
+      output.setBlockName("screen" + boost::lexical_cast<std::string>(k));
+      plots[i][k]->write(output, chunked);
+    }
     output.close();
   }
 
-  if (!batch) std::cout << "Successfully written " << plots.size() << " phase space plots" << std::endl;
+  if (!batch) std::cout << "Successfully written " << plots.size()*numScreens << " screen plots" << std::endl;
 
   if (smallId>0)
     std::cerr << "WARNING!\n    " << smallId << " species IDs found with values < 1\n";
-
 }
 
 
@@ -400,17 +598,25 @@ char McfdCommand_screen::makeAxisId(std::string axisStr)
 
 void McfdCommand_screen::print_help()
 {
-  std::cout << "\n  Manipulate cfd files: creates a distribution of particles projected onto the screen at x=xscreen and writes the result into a gnuplot-readable ascii file\n\n  Usage:\n"
+  std::cout << "\n  Manipulate cfd files: creates a distribution of particles projected onto the screens at x=xscreen and writes the result into a gnuplot-readable ascii file\n\n  Usage:\n"
         << "    mcfd screen [options] <input>\n\n"
-        << "  where <input> is the name of the cfd/raw file.\n\n";
+        << "  where <input> is the name of the cfd/raw file.\n\n"
+        << "  With --plane the particles are projected onto the (y,z) plane of each screen and\n"
+        << "  deposited with CIC weights into HDF histograms of dim x zdim bins, one data set per\n"
+        << "  screen. The ranges --yrmin, --yrmax, --zrmin and --zrmax must be given.\n\n";
 
   std::cout << option_desc;
 }
 
-std::string McfdCommand_screen::createOutputFile(int speciesId)
+std::string McfdCommand_screen::createOutputFile(int speciesId, int screen, int numScreens)
 {
   std::string speciesIdStr = boost::lexical_cast<std::string>(speciesId);
   std::string result = boost::replace_first_copy(outputName,"#",speciesIdStr);
   if (result == outputName) result = outputName + speciesIdStr;
-  return result;
+  if (numScreens < 2) return result;
+
+  std::string screenStr = boost::lexical_cast<std::string>(screen);
+  std::string withScreen = boost::replace_first_copy(result,"@",screenStr);
+  if (withScreen == result) withScreen = result + "_" + screenStr;
+  return withScreen;
 }
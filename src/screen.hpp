@@ -17,9 +17,6 @@
 class McfdCommand_screen: public MsdfCommand
 {
   private:
-    typedef DataGrid1d::const_storage_iterator GridIt1;
-    typedef DataGrid2d::const_storage_iterator GridIt2;
-
     boost::program_options::options_description option_desc;
     boost::program_options::positional_options_description option_pos;
     ParticleStreamFactory streamFact;
@@ -29,20 +26,29 @@ class McfdCommand_screen: public MsdfCommand
     double minGamma;
     double maxGamma;
     int dim;
-    double xscreen;
+    int zdim;
+    int numThreads;
+    std::string xscreenStr;
+    std::string scaleName;
 
     char momentId;
     std::string yrminStr, yrmaxStr;
+    std::string zrminStr, zrmaxStr;
     std::string xsminStr, xsmaxStr;
     std::string ysminStr, ysmaxStr;
     int limitX;
 
     bool batch;
 
-    std::string createOutputFile(int speciesId);
+    std::string createOutputFile(int speciesId, int screen, int numScreens);
     char makeAxisId(std::string axisStr);
     double getValue(double px, double py, double pz, double x, double y);
     void parseNumberList(std::string s, std::vector<double> &v);
+    void parseScreenList(std::string s, std::vector<double> &screens);
+
+    /// Project onto the (y,z) planes of the screens into 2D histograms
+    void projectPlane(boost::program_options::variables_map &vm, const std::vector<double> &screens,
+        const std::vector<double> &yrmin, const std::vector<double> &yrmax, bool allParticles);
 
   public:
     McfdCommand_screen();
@@ -9,6 +9,7 @@
 #include "sdfblock.hpp"
 #include "common/sdffile.hpp"
 #include "sdfdatatypes.hpp"
+#include "chunktuner.hpp"
 
 #include <iostream>
 
@@ -94,7 +95,12 @@ pSdfBlockDataStream SdfBlockHeader::getDataStream(SdfFile &file)
 //    case mesh:
 //      return this->getMesh(cfdStream);
     case sdf_point_variable:
-      return pSdfBlockDataStream(new SdfMeshVariableStream(sdfStream, file.getHeader(), *this, 1024*1024));
+    {
+      // the values are converted to double, single precision needs a conversion buffer
+      int64_t valueBytes = sizeof(double) + ((getDataType() == sdf_real4) ? sizeof(float) : 0);
+      int64_t chunkLength = ChunkTuner::defaultLength(valueBytes, valueBytes);
+      return pSdfBlockDataStream(new SdfMeshVariableStream(sdfStream, file.getHeader(), *this, chunkLength));
+    }
 //    case snapshot:
 //      return this->getSnapshot(cfdStream);
     default:
@@ -389,59 +389,86 @@ void SdfMeshVariableStream::initStreamByPrecision(realtype)
 
 void SdfMeshVariableStream::getMeshChunk(pDataGrid1d chunk)
 {
-  int64_t chsize = chunkLength;
-  if (dataLength-activeCount < chsize) chsize = dataLength-activeCount;
+  getMeshChunk(chunk, 0, chunkLength);
+}
 
-  GridIndex1d gridSize = chunk->getDims();
-  if (gridSize[0] != chsize)
+/*
+ * Reads count values starting at position first within the next chunk and
+ * skips over the remainder of the chunk. This allows reading only the range
+ * of rows that has been selected by a filter.
+ */
+void SdfMeshVariableStream::getMeshChunk(pDataGrid1d chunk, int64_t first, int64_t count)
+{
+  int64_t chsize = std::min(chunkLength, dataLength-activeCount);
+  first = std::max(int64_t(0), std::min(first, chsize));
+  count = std::max(int64_t(0), std::min(count, chsize-first));
+
+  if (chunk)
   {
-    gridSize[0] = chsize;
-    chunk->resize(gridSize);
+    GridIndex1d gridSize = chunk->getDims();
+    if (gridSize[0] != count)
+    {
+      gridSize[0] = count;
+      chunk->resize(gridSize);
+    }
   }
 
+  getMeshChunk(chunk ? chunk->getRawData() : 0, first, count);
+}
+
+int64_t SdfMeshVariableStream::getMeshChunk(double *data, int64_t first, int64_t count)
+{
+  int64_t chsize = std::min(chunkLength, dataLength-activeCount);
+
+  if (first > chsize) first = chsize;
+  if (first+count > chsize) count = chsize-first;
+
   if (chsize>0)
   {
-    sdfStream->seekg(activeOffset);
-    if (precision==sizeof(float))
+    if ((count>0) && data)
     {
-      readChunkByPrecision(chsize, chunk, schnek::Type2Type<float>());
-    }
-    else if (precision==sizeof(double))
-    {
-      readChunkByPrecision(chsize, chunk, schnek::Type2Type<double>());
+      sdfStream->seekg(activeOffset + first*precision);
+      if (precision==sizeof(float))
+      {
+        readChunkByPrecision(count, data, schnek::Type2Type<float>());
+      }
+      else if (precision==sizeof(double))
+      {
+        readChunkByPrecision(count, data, schnek::Type2Type<double>());
+      }
     }
     activeCount += chsize;
-    activeOffset = sdfStream->tellg();
+    activeOffset += chsize*precision;
   }
   else
   {
     activeCount = dataLength+1;
+    count = 0;
   }
+  return count;
 }
 
 
 template<typename realtype>
-void SdfMeshVariableStream::readChunkByPrecision(int64_t chsize, pDataGrid1d chunk, realtype)
+void SdfMeshVariableStream::readChunkByPrecision(int64_t chsize, double *out, realtype)
 {
   typedef typename realtype::OriginalType Real;
   Real *data;
-  if (sizeof(Real)==sizeof(typename DataGrid1d::value_type))
-    data = (Real*)(chunk->getRawData());
+  if (sizeof(Real)==sizeof(double))
+    data = (Real*)out;
   else
-    data = new Real[chsize];
+    data = pool.get<Real>(0, chsize);
 
   // for reading from a character stream
   char *ch = (char*)data;
 
   sdfStream->read(ch, chsize*sizeof(Real));
 
-  // if GridType::value_type is the same as Real then we're done,
-  // otherwise we now need to copy and delete the data pointer
-  if (sizeof(Real)!=sizeof(typename DataGrid1d::value_type))
+  // if Real is double then we're done,
+  // otherwise we now need to convert from the pool buffer
+  if (sizeof(Real)!=sizeof(double))
   {
-    typename DataGrid1d::value_type *raw = chunk->getRawData();
-    for (int64_t i=0; i<chsize; ++i) raw[i] = data[i]; // type cast
-    delete[] data;
+    for (int64_t i=0; i<chsize; ++i) out[i] = data[i]; // type cast
   }
 }
 
@@ -463,6 +490,8 @@ void SdfMeshStream::initStream()
 {
   sdfStream->seekg(block.getMetaDataOffset());
   rank = block.getNDims();
+  if ((rank < 1) || (rank > 3))
+    throw msdf::GenericException("Point mesh " + block.getName() + " must have 1 to 3 dimensions");
 
   mults.resize(rank);
   labels.resize(rank);
@@ -513,72 +542,97 @@ void SdfMeshStream::initStreamByPrecision(realtype)
 
 void SdfMeshStream::getMeshChunk(pDataGrid2d chunk)
 {
-  int64_t chsize = chunkLength;
-  if (dataLength-activeCount < chsize) chsize = dataLength-activeCount;
+  getMeshChunk(chunk, 0, chunkLength);
+}
+
+/*
+ * Reads count coordinates starting at position first within the next chunk and
+ * skips over the remainder of the chunk.
+ */
+void SdfMeshStream::getMeshChunk(pDataGrid2d chunk, int64_t first, int64_t count)
+{
+  int64_t chsize = std::min(chunkLength, dataLength-activeCount);
+  first = std::max(int64_t(0), std::min(first, chsize));
+  count = std::max(int64_t(0), std::min(count, chsize-first));
+
+  if (!chunk)
+  {
+    getMeshChunk((double *const *)0, first, count);
+    return;
+  }
 
   GridIndex2d gridSize;
   gridSize[0] = chunk->getDims()[0];
   gridSize[1] = chunk->getDims()[1];
 
-  if ((gridSize[0] != rank) || (gridSize[1] != chsize))
+  if ((gridSize[0] != rank) || (gridSize[1] != count))
   {
     gridSize[0] = rank;
-    gridSize[1] = chsize;
+    gridSize[1] = count;
     chunk->resize(gridSize);
   }
 
+  // slot 0 is the conversion buffer, the rows are staged in the following slots
+  double *rows[3];
+  for (int r=0; r<rank; ++r) rows[r] = pool.get<double>(r+1, count);
+
+  count = getMeshChunk(rows, first, count);
+
+  DataGrid2d &chunkGrid = *chunk;
+  for (int r=0; r<rank; ++r)
+    for (int64_t i=0; i<count; ++i) chunkGrid(r,i) = rows[r][i];
+}
+
+int64_t SdfMeshStream::getMeshChunk(double *const *data, int64_t first, int64_t count)
+{
+  int64_t chsize = std::min(chunkLength, dataLength-activeCount);
+
+  if (first > chsize) first = chsize;
+  if (first+count > chsize) count = chsize-first;
+
   if (chsize>0)
   {
-
-    if (precision==sizeof(float))
-    {
-      readChunkByPrecision(chsize, chunk, schnek::Type2Type<float>());
-    }
-    else if (precision==sizeof(double))
+    if ((count>0) && data)
     {
-      readChunkByPrecision(chsize, chunk, schnek::Type2Type<double>());
+      if (precision==sizeof(float))
+      {
+        readChunkByPrecision(first, count, data, schnek::Type2Type<float>());
+      }
+      else if (precision==sizeof(double))
+      {
+        readChunkByPrecision(first, count, data, schnek::Type2Type<double>());
+      }
     }
+    activeOffset += chsize*precision;
     activeCount += chsize;
   }
   else
   {
     activeCount = dataLength+1;
+    count = 0;
   }
+  return count;
 }
 
 
 template<typename realtype>
-void SdfMeshStream::readChunkByPrecision(int64_t chsize, pDataGrid2d chunk, realtype)
+void SdfMeshStream::readChunkByPrecision(int64_t first, int64_t chsize, double *const *out, realtype)
 {
   typedef typename realtype::OriginalType Real;
-  Real *data = new Real[chsize];
-  DataGrid2d &chunkGrid = *chunk;
-
   int64_t blocksize = dataLength*sizeof(Real);
-  // for reading from a character stream
-  char *ch = (char*)data;
-
-//  std::cerr << "Reading Chunk:\n" <<
-//      "  chunk size:  " << chsize << "\n" <<
-//      "  data length: " << dataLength << "\n" <<
-//      "  block size:  " << blocksize << "\n" <<
-//      "  current pos: " << sdfStream->tellg() << "\n";
-
 
   for (int r=0; r<rank; ++r)
   {
-//    std::cerr << "    seeking to " << activeOffset + r*blocksize << "\n";
-    sdfStream->seekg(activeOffset + r*blocksize);
-    sdfStream->read(ch, chsize*sizeof(Real));
-
-    for (int i=0; i<chsize; ++i) chunkGrid(r,i) = data[i];
-//    std::cerr << "    new pos " << sdfStream->tellg() << "\n";
+    sdfStream->seekg(activeOffset + r*blocksize + first*sizeof(Real));
+    if (sizeof(Real)==sizeof(double))
+      sdfStream->read((char*)out[r], chsize*sizeof(Real));
+    else
+    {
+      Real *data = pool.get<Real>(0, chsize);
+      sdfStream->read((char*)data, chsize*sizeof(Real));
+      for (int64_t i=0; i<chsize; ++i) out[r][i] = data[i]; // type cast
+    }
   }
-
-  activeOffset = activeOffset + chsize*sizeof(Real);
-//  std::cerr << "  active offset: " << activeOffset << "\n";
-
-  delete[] data;
 }
 
 
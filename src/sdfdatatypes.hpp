@@ -13,6 +13,7 @@
 #include "common/sdfio.hpp"
 #include "common/sdfheader.hpp"
 #include "sdfblock.hpp"
+#include "bufferpool.hpp"
 
 using namespace msdf;
 
@@ -79,7 +80,18 @@ class SdfMeshVariableStream : public SdfBlockDataStream
     SdfMeshVariableStream(pIstream sdfStream_, pSdfFileHeader header, const SdfBlockHeader &block_, int64_t chunkLength_);
     SdfBlockType getBlockType() { return block.getBlockType(); }
     void getMeshChunk(pDataGrid1d chunk);
+    void getMeshChunk(pDataGrid1d chunk, int64_t first, int64_t count);
+
+    /**
+     * Read count values starting at position first within the next chunk into
+     * data and skip the remainder of the chunk. Returns the number of values read.
+     */
+    int64_t getMeshChunk(double *data, int64_t first, int64_t count);
+    void skipChunk() { getMeshChunk((double*)0, 0, 0); }
     bool eos() { return activeCount>dataLength; }
+    int64_t getLength() { return dataLength; }
+    int getPrecision() { return precision; }
+    void setChunkLength(int64_t chunkLength_) { chunkLength = chunkLength_; }
   private:
     pIstream sdfStream;
     pSdfFileHeader header;
@@ -97,13 +109,16 @@ class SdfMeshVariableStream : public SdfBlockDataStream
     int64_t activeOffset;
     int64_t activeCount;
 
+    /// conversion buffer for single precision data
+    BufferPool pool;
+
     void initStream();
 
     template<typename realtype>
     void initStreamByPrecision(realtype);
 
     template<typename realtype>
-    void readChunkByPrecision(int64_t chsize, pDataGrid1d chunk, realtype);
+    void readChunkByPrecision(int64_t chsize, double *out, realtype);
 };
 
 typedef boost::shared_ptr<SdfMeshVariableStream> pSdfMeshVariableStream;
@@ -116,7 +131,18 @@ class SdfMeshStream : public SdfBlockDataStream
     SdfMeshStream(pIstream sdfStream_, pSdfFileHeader header, const SdfBlockHeader &block_, int64_t chunkLength_);
     SdfBlockType getBlockType() { return block.getBlockType(); }
     void getMeshChunk(pDataGrid2d chunk);
+    void getMeshChunk(pDataGrid2d chunk, int64_t first, int64_t count);
+
+    /**
+     * Read count coordinates starting at position first within the next chunk.
+     * data holds one pointer per dimension. Returns the number of values read.
+     */
+    int64_t getMeshChunk(double *const *data, int64_t first, int64_t count);
+    void skipChunk() { getMeshChunk((double *const *)0, 0, 0); }
     bool eos() { return activeCount>dataLength; }
+    int64_t getLength() { return dataLength; }
+    int getPrecision() { return precision; }
+    void setChunkLength(int64_t chunkLength_) { chunkLength = chunkLength_; }
   private:
     pIstream sdfStream;
     pSdfFileHeader header;
@@ -137,13 +163,16 @@ class SdfMeshStream : public SdfBlockDataStream
     int64_t activeOffset;
     int64_t activeCount;
 
+    /// conversion buffer for single precision data and staging rows for grid output
+    BufferPool pool;
+
     void initStream();
 
     template<typename realtype>
     void initStreamByPrecision(realtype);
 
     template<typename realtype>
-    void readChunkByPrecision(int64_t chsize, pDataGrid2d chunk, realtype);
+    void readChunkByPrecision(int64_t first, int64_t chsize, double *const *out, realtype);
   public:
 
     int getRank() { return rank; }
@@ -0,0 +1,108 @@
+/*
+ * spheregrid.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "spheregrid.hpp"
+#include "common/binaryio.hpp"
+
+#include <cmath>
+
+namespace {
+  int64_t modulo(int64_t a, int64_t b)
+  {
+    int64_t r = a % b;
+    return (r < 0) ? r + b : r;
+  }
+
+  int64_t isqrt(int64_t a)
+  {
+    int64_t r = int64_t(std::sqrt(double(a) + 0.5));
+    while (r*r > a) --r;
+    while ((r+1)*(r+1) <= a) ++r;
+    return r;
+  }
+}
+
+SphereGrid::SphereGrid(int nside_)
+  : nside(nside_), npix(12*int64_t(nside_)*nside_), ncap(2*int64_t(nside_)*(nside_-1))
+{
+  if (nside_ < 1)
+    throw msdf::GenericException("The sphere needs at least one pixel per side");
+}
+
+double SphereGrid::getPixelArea() const
+{
+  return 4.0*M_PI/npix;
+}
+
+int64_t SphereGrid::pixel(double z, double phi) const
+{
+  double za = std::fabs(z);
+  // the azimuth in units of pi/2, between 0 and 4
+  double tt = std::fmod(phi, 2.0*M_PI);
+  if (tt < 0.0) tt += 2.0*M_PI;
+  tt *= 2.0/M_PI;
+  if (tt >= 4.0) tt = 0.0;
+
+  if (za <= 2.0/3.0)
+  {
+    // equatorial belt
+    double temp1 = nside*(0.5 + tt);
+    double temp2 = nside*z*0.75;
+    int64_t jp = int64_t(temp1 - temp2);
+    int64_t jm = int64_t(temp1 + temp2);
+    int64_t ir = nside + 1 + jp - jm;
+    int64_t kshift = 1 - (ir & 1);
+    int64_t ip = modulo((jp + jm - nside + kshift + 1)/2, 4*nside);
+    return ncap + (ir - 1)*4*nside + ip;
+  }
+
+  // polar caps
+  double tp = tt - int64_t(tt);
+  double tmp = nside*std::sqrt(3.0*(1.0 - za));
+  int64_t jp = int64_t(tp*tmp);
+  int64_t jm = int64_t((1.0 - tp)*tmp);
+  int64_t ir = jp + jm + 1;
+  int64_t ip = modulo(int64_t(tt*ir), 4*ir);
+  return (z > 0.0) ? 2*ir*(ir - 1) + ip : npix - 2*ir*(ir + 1) + ip;
+}
+
+int64_t SphereGrid::direction(double a, double b, double c) const
+{
+  double r = std::sqrt(a*a + b*b + c*c);
+  if (!(r > 0.0)) return pixel(1.0, 0.0);
+  return pixel(a/r, std::atan2(c, b));
+}
+
+void SphereGrid::centre(int64_t pix, double &z, double &phi) const
+{
+  double fact2 = 4.0/npix;
+  if (pix < ncap)
+  {
+    int64_t iring = (1 + isqrt(1 + 2*pix)) >> 1;
+    int64_t iphi = pix + 1 - 2*iring*(iring - 1);
+    z = 1.0 - iring*iring*fact2;
+    phi = (iphi - 0.5)*M_PI/(2.0*iring);
+  }
+  else if (pix < npix - ncap)
+  {
+    int64_t ip = pix - ncap;
+    int64_t iring = ip/(4*nside) + nside;
+    int64_t iphi = ip % (4*nside) + 1;
+    double fodd = ((iring + nside) & 1) ? 1.0 : 0.5;
+    z = (2*nside - iring)*2.0/(3.0*nside);
+    phi = (iphi - fodd)*M_PI/(2.0*nside);
+  }
+  else
+  {
+    int64_t ip = npix - pix;
+    int64_t iring = (1 + isqrt(2*ip - 1)) >> 1;
+    int64_t iphi = 4*iring + 1 - (ip - 2*iring*(iring - 1));
+    z = -1.0 + iring*iring*fact2;
+    phi = (iphi - 0.5)*M_PI/(2.0*iring);
+  }
+}
@@ -0,0 +1,50 @@
+/*
+ * spheregrid.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef SPHEREGRID_H_
+#define SPHEREGRID_H_
+
+#include <boost/cstdint.hpp>
+
+/**
+ * An equal-area pixelisation of the unit sphere following the HEALPix ring
+ * scheme.
+ *
+ * The sphere is divided into 12*nside^2 pixels of identical solid angle that
+ * are arranged on rings of constant latitude. Pixels are numbered ring by
+ * ring from the north pole, so neighbouring pixel numbers are close on the
+ * sphere. The polar angle is measured from the polar axis, z = cos(theta).
+ */
+class SphereGrid
+{
+  public:
+    SphereGrid(int nside_);
+
+    int getNside() const { return nside; }
+    int64_t getNumPixels() const { return npix; }
+
+    /// The solid angle of one pixel
+    double getPixelArea() const;
+
+    /// The pixel containing the direction with z = cos(theta) and azimuth phi
+    int64_t pixel(double z, double phi) const;
+
+    /// The pixel containing the direction (a,b,c) where a is along the polar axis
+    int64_t direction(double a, double b, double c) const;
+
+    /// The centre of a pixel, with z = cos(theta) and 0 <= phi < 2*pi
+    void centre(int64_t pix, double &z, double &phi) const;
+
+  private:
+    int64_t nside;
+    int64_t npix;
+    /// The number of pixels in the polar caps
+    int64_t ncap;
+};
+
+#endif /* SPHEREGRID_H_ */
@@ -0,0 +1,145 @@
+/*
+ * tdigest.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "tdigest.hpp"
+#include "common/binaryio.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <string>
+
+namespace {
+  /// The scale function k1 that maps a quantile to the index of a centroid
+  double scaleK(double q, double compression)
+  {
+    return compression/(2.0*M_PI)*std::asin(2.0*q - 1.0);
+  }
+
+  double scaleKInverse(double k, double compression)
+  {
+    if (k >= compression/4.0) return 1.0;
+    return 0.5*(std::sin(2.0*M_PI*k/compression) + 1.0);
+  }
+}
+
+TDigest::TDigest(double compression_)
+  : compression(compression_),
+    bufferSize(size_t(5*compression_)),
+    totalWeight(0.0),
+    min(std::numeric_limits<double>::max()),
+    max(-std::numeric_limits<double>::max())
+{
+  buffer.reserve(bufferSize);
+}
+
+double TDigest::bufferWeight() const
+{
+  double weight = 0.0;
+  for (size_t i=0; i<buffer.size(); ++i) weight += buffer[i].weight;
+  return weight;
+}
+
+void TDigest::compress()
+{
+  if (buffer.empty()) return;
+
+  buffer.insert(buffer.end(), centroids.begin(), centroids.end());
+  std::sort(buffer.begin(), buffer.end(),
+      [](const Centroid &a, const Centroid &b) { return a.mean < b.mean; });
+
+  totalWeight = 0.0;
+  for (size_t i=0; i<buffer.size(); ++i) totalWeight += buffer[i].weight;
+
+  // merge neighbouring values as long as the merged centroid spans less
+  // than one unit of the scale function
+  centroids.clear();
+  Centroid current = buffer[0];
+  double weightSoFar = 0.0;
+  double qLimit = scaleKInverse(scaleK(0.0, compression) + 1.0, compression);
+
+  for (size_t i=1; i<buffer.size(); ++i)
+  {
+    double q = (weightSoFar + current.weight + buffer[i].weight)/totalWeight;
+    if (q <= qLimit)
+    {
+      current.weight += buffer[i].weight;
+      current.mean += (buffer[i].mean - current.mean)*buffer[i].weight/current.weight;
+    }
+    else
+    {
+      weightSoFar += current.weight;
+      centroids.push_back(current);
+      qLimit = scaleKInverse(scaleK(weightSoFar/totalWeight, compression) + 1.0, compression);
+      current = buffer[i];
+    }
+  }
+  centroids.push_back(current);
+  buffer.clear();
+}
+
+void TDigest::merge(const TDigest &other)
+{
+  buffer.insert(buffer.end(), other.centroids.begin(), other.centroids.end());
+  buffer.insert(buffer.end(), other.buffer.begin(), other.buffer.end());
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+  compress();
+}
+
+double TDigest::quantile(double q)
+{
+  compress();
+  if (centroids.empty()) return 0.0;
+  if (centroids.size() == 1) return centroids[0].mean;
+
+  q = std::max(0.0, std::min(1.0, q));
+  double target = q*totalWeight;
+
+  // the tails are interpolated between the extreme values and the outermost centroids
+  double position = 0.5*centroids[0].weight;
+  if (target < position)
+    return min + (centroids[0].mean - min)*target/position;
+
+  for (size_t i=1; i<centroids.size(); ++i)
+  {
+    double next = position + 0.5*(centroids[i-1].weight + centroids[i].weight);
+    if (target < next)
+      return centroids[i-1].mean
+          + (centroids[i].mean - centroids[i-1].mean)*(target - position)/(next - position);
+    position = next;
+  }
+
+  double tail = totalWeight - position;
+  if (tail <= 0.0) return max;
+  return centroids.back().mean + (max - centroids.back().mean)*(target - position)/tail;
+}
+
+void TDigest::write(std::ostream &out)
+{
+  compress();
+  out << std::setprecision(17) << compression << " " << totalWeight << " "
+      << min << " " << max << " " << centroids.size() << "\n";
+  for (size_t i=0; i<centroids.size(); ++i)
+    out << centroids[i].mean << " " << centroids[i].weight << "\n";
+}
+
+void TDigest::read(std::istream &in)
+{
+  size_t count;
+  if (!(in >> compression >> totalWeight >> min >> max >> count))
+    throw msdf::GenericException("Could not read t-digest");
+
+  bufferSize = size_t(5*compression);
+  buffer.clear();
+  centroids.resize(count);
+  for (size_t i=0; i<count; ++i)
+    if (!(in >> centroids[i].mean >> centroids[i].weight))
+      throw msdf::GenericException("Could not read t-digest");
+}
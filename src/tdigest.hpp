@@ -0,0 +1,77 @@
+/*
+ * tdigest.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef TDIGEST_H_
+#define TDIGEST_H_
+
+#include <boost/shared_ptr.hpp>
+#include <iostream>
+#include <vector>
+
+/**
+ * A mergeable sketch of a weighted distribution for estimating quantiles in
+ * a single pass (Dunning's merging t-digest).
+ *
+ * Values are collected in a buffer and merged into a sorted list of
+ * centroids when the buffer is full. The centroids are small near the tails,
+ * so extreme quantiles such as cut-off energies are estimated accurately.
+ * The size of the sketch is bounded by a small multiple of the compression,
+ * independent of the number of values added. Digests of separate threads
+ * or files can be merged into one.
+ */
+class TDigest
+{
+  public:
+    TDigest(double compression_ = 100.0);
+
+    void add(double value, double weight = 1.0)
+    {
+      if (!(weight > 0.0)) return;
+      if (value < min) min = value;
+      if (value > max) max = value;
+      Centroid c = { value, weight };
+      buffer.push_back(c);
+      if (buffer.size() >= bufferSize) compress();
+    }
+
+    /// Add all values of another digest
+    void merge(const TDigest &other);
+
+    /// The value below which a fraction q of the total weight lies
+    double quantile(double q);
+
+    double getWeight() const { return totalWeight + bufferWeight(); }
+    double getMin() const { return min; }
+    double getMax() const { return max; }
+
+    /// The number of centroids after compression
+    size_t size() { compress(); return centroids.size(); }
+
+    void write(std::ostream &out);
+    void read(std::istream &in);
+  private:
+    struct Centroid
+    {
+      double mean;
+      double weight;
+    };
+
+    double compression;
+    size_t bufferSize;
+    std::vector<Centroid> centroids;
+    std::vector<Centroid> buffer;
+    double totalWeight;
+    double min, max;
+
+    void compress();
+    double bufferWeight() const;
+};
+
+typedef boost::shared_ptr<TDigest> pTDigest;
+
+#endif /* TDIGEST_H_ */
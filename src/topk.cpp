@@ -0,0 +1,42 @@
+/*
+ * topk.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "topk.hpp"
+
+#include <algorithm>
+
+TopK::TopK(int64_t capacity_)
+  : capacity(std::max(int64_t(0), capacity_)),
+    reservation(capacity*sizeof(TopKRecord), "top-k particle records")
+{}
+
+void TopK::insert(const TopKRecord &record)
+{
+  // the heap is ordered with the smallest record at the front
+  heap.push_back(record);
+  std::push_heap(heap.begin(), heap.end(), before);
+}
+
+void TopK::replace(const TopKRecord &record)
+{
+  std::pop_heap(heap.begin(), heap.end(), before);
+  heap.back() = record;
+  std::push_heap(heap.begin(), heap.end(), before);
+}
+
+void TopK::merge(const TopK &other)
+{
+  for (size_t i=0; i<other.heap.size(); ++i) push(other.heap[i]);
+}
+
+std::vector<TopKRecord> TopK::sorted() const
+{
+  std::vector<TopKRecord> result(heap);
+  std::sort(result.begin(), result.end(), before);
+  return result;
+}
@@ -0,0 +1,87 @@
+/*
+ * topk.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef TOPK_H_
+#define TOPK_H_
+
+#include "memorybudget.hpp"
+
+#include <boost/shared_ptr.hpp>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * The full record of a particle selected by its key
+ *
+ * The index is the position of the particle in the stream and breaks ties
+ * between equal keys, so the selection is unique.
+ */
+struct TopKRecord
+{
+    double key;
+    int64_t index;
+    int32_t species;
+    double pos[3];
+    double p[3];
+    double weight;
+};
+
+/**
+ * Keeps the records with the k largest keys in a bounded heap.
+ *
+ * Records are ordered by key and, for equal keys, by the smaller index.
+ * Because this order is total, the records kept after merging several
+ * instances don't depend on how the particles were divided between them.
+ * The MemoryBudget for a full heap is reserved when the heap is created, so
+ * that pushing records, for example on worker threads, never throws.
+ */
+class TopK
+{
+  public:
+    /// Throws if the budget can't hold capacity records
+    TopK(int64_t capacity_);
+
+    /// Offer a record, it replaces the smallest record if the heap is full
+    void push(const TopKRecord &record)
+    {
+      if (int64_t(heap.size()) < capacity) insert(record);
+      else if ((capacity > 0) && before(record, heap.front())) replace(record);
+    }
+
+    /// True if a record with this key can't enter the full heap
+    bool rejects(double key) const
+    {
+      return (int64_t(heap.size()) >= capacity) && ((capacity == 0) || (key < heap.front().key));
+    }
+
+    /// Push all records of another heap
+    void merge(const TopK &other);
+
+    /// The records ordered from the largest key downwards
+    std::vector<TopKRecord> sorted() const;
+
+    int64_t size() const { return heap.size(); }
+    int64_t getCapacity() const { return capacity; }
+
+    /// The order of the records, true if a comes before b
+    static bool before(const TopKRecord &a, const TopKRecord &b)
+    {
+      return (a.key > b.key) || ((a.key == b.key) && (a.index < b.index));
+    }
+  private:
+    int64_t capacity;
+    std::vector<TopKRecord> heap;
+    BudgetReservation reservation;
+
+    void insert(const TopKRecord &record);
+    void replace(const TopKRecord &record);
+};
+
+typedef boost::shared_ptr<TopK> pTopK;
+
+#endif /* TOPK_H_ */
@@ -0,0 +1,231 @@
+/*
+ * zonemap.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#include "zonemap.hpp"
+#include "common/binaryio.hpp"
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+
+namespace fs = boost::filesystem;
+
+namespace {
+  const char zoneMapMagic[8] = { 'M', 'S', 'D', 'F', 'Z', 'M', 'A', 'P' };
+  const int32_t zoneMapVersion = 1;
+
+  template<typename T>
+  inline void writeValue(std::ostream &out, const T &data)
+  {
+    out.write((const char*)&data, sizeof(T));
+  }
+}
+
+ZoneMap::ZoneMap(int64_t zoneLength_)
+  : zoneLength(zoneLength_), sourceSize(0), sourceTime(0)
+{
+  if (zoneLength < 1)
+    throw msdf::GenericException("Zone length must be positive");
+}
+
+bool ZoneMap::hasColumn(const std::string &name) const
+{
+  return columns.count(name) > 0;
+}
+
+const ZoneColumn &ZoneMap::getColumn(const std::string &name) const
+{
+  std::map<std::string, ZoneColumn>::const_iterator it = columns.find(name);
+  if (it == columns.end())
+    throw msdf::GenericException("Zone map has no column " + name);
+  return it->second;
+}
+
+ZoneColumn &ZoneMap::addColumn(const std::string &name, int64_t length)
+{
+  int64_t zones = (length + zoneLength - 1)/zoneLength;
+  ZoneColumn &column = columns[name];
+  column.minval.assign(zones, 0.0);
+  column.maxval.assign(zones, 0.0);
+  return column;
+}
+
+void ZoneMap::accumulate(ZoneColumn &column, int64_t first, const double *data, int64_t count)
+{
+  for (int64_t i=0; i<count; ++i)
+  {
+    int64_t row = first + i;
+    int64_t zone = row/zoneLength;
+    if (row % zoneLength == 0)
+    {
+      column.minval[zone] = data[i];
+      column.maxval[zone] = data[i];
+    }
+    else
+    {
+      column.minval[zone] = std::min(column.minval[zone], data[i]);
+      column.maxval[zone] = std::max(column.maxval[zone], data[i]);
+    }
+  }
+}
+
+bool ZoneMap::findCandidateRows(const ParticleZones &zones, const ParticleFilter &filter, int rank,
+                                int64_t chunkStart, int64_t chsize, int64_t &first, int64_t &count) const
+{
+  int64_t firstZone = chunkStart/zoneLength;
+  int64_t lastZone = (chunkStart + chsize - 1)/zoneLength;
+  int64_t firstCandidate = -1;
+  int64_t lastCandidate = -1;
+
+  for (int64_t z=firstZone; z<=lastZone; ++z)
+  {
+    ParticleBounds bounds;
+    if (zones.x)
+    {
+      bounds.columns |= pc_mesh;
+      bounds.xmin = zones.x->minval[z];
+      bounds.xmax = zones.x->maxval[z];
+      if (zones.y)
+      {
+        bounds.ymin = zones.y->minval[z];
+        bounds.ymax = zones.y->maxval[z];
+      }
+    }
+    if (zones.px)
+    {
+      bounds.columns |= pc_px;
+      bounds.pxmin = zones.px->minval[z];
+      bounds.pxmax = zones.px->maxval[z];
+    }
+    if (zones.py)
+    {
+      bounds.columns |= pc_py;
+      bounds.pymin = zones.py->minval[z];
+      bounds.pymax = zones.py->maxval[z];
+    }
+    if (zones.pz)
+    {
+      bounds.columns |= pc_pz;
+      bounds.pzmin = zones.pz->minval[z];
+      bounds.pzmax = zones.pz->maxval[z];
+    }
+
+    if (filter.mayAccept(0, rank, bounds))
+    {
+      if (firstCandidate < 0) firstCandidate = z;
+      lastCandidate = z;
+    }
+  }
+
+  if (firstCandidate < 0) return false;
+
+  first = std::max(firstCandidate*zoneLength, chunkStart) - chunkStart;
+  count = std::min((lastCandidate + 1)*zoneLength, chunkStart + chsize) - chunkStart - first;
+  return true;
+}
+
+void ZoneMap::setSource(const std::string &sourceName)
+{
+  sourceSize = fs::file_size(sourceName);
+  sourceTime = fs::last_write_time(sourceName);
+}
+
+void ZoneMap::write(const std::string &fileName) const
+{
+  std::ofstream out(fileName.c_str(), std::ios::binary);
+  if (!out)
+    throw msdf::GenericException("Could not open zone map " + fileName + " for writing");
+
+  out.write(zoneMapMagic, sizeof(zoneMapMagic));
+  writeValue(out, zoneMapVersion);
+  writeValue(out, zoneLength);
+  writeValue(out, sourceSize);
+  writeValue(out, sourceTime);
+  writeValue(out, int32_t(columns.size()));
+
+  for (std::map<std::string, ZoneColumn>::const_iterator it = columns.begin(); it != columns.end(); ++it)
+  {
+    const ZoneColumn &column = it->second;
+    int64_t zones = column.getZoneCount();
+    writeValue(out, int32_t(it->first.length()));
+    out.write(it->first.c_str(), it->first.length());
+    writeValue(out, zones);
+    if (zones > 0)
+    {
+      out.write((const char*)&column.minval[0], zones*sizeof(double));
+      out.write((const char*)&column.maxval[0], zones*sizeof(double));
+    }
+  }
+
+  if (!out)
+    throw msdf::GenericException("Error writing zone map " + fileName);
+}
+
+pZoneMap ZoneMap::read(const std::string &fileName, const std::string &sourceName)
+{
+  if (!fs::exists(fileName)) return pZoneMap();
+
+  std::ifstream in(fileName.c_str(), std::ios::binary);
+  char magic[8];
+  in.read(magic, sizeof(magic));
+
+  int32_t version = 0;
+  msdf::detail::readValue(in, version);
+  if (!in || (std::memcmp(magic, zoneMapMagic, sizeof(magic)) != 0) || (version != zoneMapVersion))
+    throw msdf::GenericException("File " + fileName + " is not a zone map");
+
+  int64_t zoneLength, sourceSize, sourceTime;
+  msdf::detail::readValue(in, zoneLength);
+  msdf::detail::readValue(in, sourceSize);
+  msdf::detail::readValue(in, sourceTime);
+
+  if ((sourceSize != int64_t(fs::file_size(sourceName))) ||
+      (sourceTime != int64_t(fs::last_write_time(sourceName))))
+  {
+    std::cerr << "Zone map " << fileName << " is out of date and will be ignored\n";
+    return pZoneMap();
+  }
+
+  pZoneMap zoneMap(new ZoneMap(zoneLength));
+  zoneMap->sourceSize = sourceSize;
+  zoneMap->sourceTime = sourceTime;
+
+  int32_t numColumns;
+  msdf::detail::readValue(in, numColumns);
+  for (int32_t c=0; c<numColumns; ++c)
+  {
+    int32_t nameLength;
+    msdf::detail::readValue(in, nameLength);
+    std::string name;
+    msdf::detail::readString(in, name, nameLength);
+
+    int64_t zones;
+    msdf::detail::readValue(in, zones);
+    ZoneColumn &column = zoneMap->columns[name];
+    column.minval.resize(zones);
+    column.maxval.resize(zones);
+    if (zones > 0)
+    {
+      in.read((char*)&column.minval[0], zones*sizeof(double));
+      in.read((char*)&column.maxval[0], zones*sizeof(double));
+    }
+  }
+
+  if (!in)
+    throw msdf::GenericException("Error reading zone map " + fileName);
+
+  return zoneMap;
+}
+
+std::string ZoneMap::meshColumnName(const std::string &blockName, int dim)
+{
+  std::ostringstream name;
+  name << blockName << "/" << dim;
+  return name.str();
+}
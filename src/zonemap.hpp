@@ -0,0 +1,105 @@
+/*
+ * zonemap.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ *       Email: h.schmitz@imperial.ac.uk
+ */
+
+#ifndef ZONEMAP_H_
+#define ZONEMAP_H_
+
+#include "particlefilter.hpp"
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * The minimum and maximum of one particle column over consecutive zones of
+ * a fixed number of rows. The last zone may be shorter.
+ */
+struct ZoneColumn
+{
+    std::vector<double> minval;
+    std::vector<double> maxval;
+
+    int64_t getZoneCount() const { return minval.size(); }
+};
+
+/**
+ * The zone columns of the filter columns of a particle block, null where the
+ * zone map cannot be used. In two or more dimensions x and y are either both
+ * set or both null.
+ */
+struct ParticleZones
+{
+    const ZoneColumn *x, *y, *px, *py, *pz;
+
+    ParticleZones() : x(0), y(0), px(0), py(0), pz(0) {}
+};
+
+/**
+ * Chunk-level zone maps for the particle blocks of an SDF file.
+ *
+ * The zone map is stored in a sidecar file next to the SDF file and is built
+ * once by the 'index' command. Particle streams use it to skip zones that
+ * cannot contain any particle accepted by a ParticleFilter. Columns are named
+ * after the SDF block id, the dimensions of a point mesh are stored as
+ * separate columns (see meshColumnName).
+ */
+class ZoneMap
+{
+  private:
+    int64_t zoneLength;
+    int64_t sourceSize;
+    int64_t sourceTime;
+    std::map<std::string, ZoneColumn> columns;
+  public:
+    ZoneMap(int64_t zoneLength_);
+
+    int64_t getZoneLength() const { return zoneLength; }
+
+    bool hasColumn(const std::string &name) const;
+    const ZoneColumn &getColumn(const std::string &name) const;
+
+    /// Add an empty column for a block of the given length
+    ZoneColumn &addColumn(const std::string &name, int64_t length);
+
+    /**
+     * Update the zone statistics of a column with count values that start
+     * at row first of the block
+     */
+    void accumulate(ZoneColumn &column, int64_t first, const double *data, int64_t count);
+
+    /**
+     * Determine the range of rows [first, first+count) of the chunk of chsize
+     * rows starting at chunkStart that spans all zones which may contain
+     * particles accepted by the filter. first is relative to chunkStart.
+     * Returns false if no zone of the chunk can contain an accepted particle.
+     */
+    bool findCandidateRows(const ParticleZones &zones, const ParticleFilter &filter, int rank,
+                           int64_t chunkStart, int64_t chsize, int64_t &first, int64_t &count) const;
+
+    /// Record size and modification time of the SDF file the map describes
+    void setSource(const std::string &sourceName);
+
+    void write(const std::string &fileName) const;
+
+    /**
+     * Read the zone map from fileName. A null pointer is returned when the
+     * file does not exist or the SDF file has changed since the map was built.
+     */
+    static boost::shared_ptr<ZoneMap> read(const std::string &fileName, const std::string &sourceName);
+
+    /// The default name of the sidecar file for an SDF file
+    static std::string sidecarName(const std::string &sourceName) { return sourceName + ".zmap"; }
+
+    /// The column name of one dimension of a point mesh
+    static std::string meshColumnName(const std::string &blockName, int dim);
+};
+
+typedef boost::shared_ptr<ZoneMap> pZoneMap;
+
+#endif /* ZONEMAP_H_ */
@@ -0,0 +1,107 @@
+/*
+ * axisbinning_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <axisbinning.hpp>
+#include <tdigest.hpp>
+#include <common/binaryio.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE( axisbinning )
+
+BOOST_AUTO_TEST_CASE( linear_bins )
+{
+  AxisBinning axis(AxisBinning::linear, -1.0, 3.0, 8);
+  BOOST_CHECK_EQUAL(axis.size(), 8);
+  BOOST_CHECK_CLOSE(axis.position(0.0), 2.0, 1e-12);
+  BOOST_CHECK_CLOSE(axis.position(3.0), 8.0, 1e-12);
+  BOOST_CHECK(axis.position(-2.0) < 0.0);
+  BOOST_CHECK_CLOSE(axis.getEdge(3), 0.5, 1e-12);
+  BOOST_CHECK_CLOSE(axis.getCentre(0), -0.75, 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE( logarithmic_bins )
+{
+  AxisBinning axis(AxisBinning::logarithmic, 1e-3, 1e3, 6);
+  BOOST_CHECK_CLOSE(axis.position(1.0), 3.0, 1e-10);
+  BOOST_CHECK_CLOSE(axis.position(1e2), 5.0, 1e-10);
+  BOOST_CHECK(axis.position(0.0) < 0.0);
+  BOOST_CHECK(axis.position(-5.0) < 0.0);
+  BOOST_CHECK_CLOSE(axis.getEdge(4), 10.0, 1e-10);
+  BOOST_CHECK_CLOSE(axis.getCentre(3), std::sqrt(10.0), 1e-10);
+
+  BOOST_CHECK_THROW(AxisBinning(AxisBinning::logarithmic, 0.0, 1.0, 10), msdf::GenericException);
+}
+
+BOOST_AUTO_TEST_CASE( adaptive_bins_hold_equal_weight )
+{
+  // an exponential spectrum spanning many decades
+  TDigest sketch(200);
+  std::vector<double> values;
+  for (int i=0; i<100000; ++i)
+  {
+    double value = -std::log(1.0 - (i*7919 % 100000 + 0.5)/100000.0);
+    values.push_back(value);
+    sketch.add(value);
+  }
+  AxisBinning axis(sketch, 20);
+  BOOST_CHECK_EQUAL(axis.size(), 20);
+
+  std::vector<int> count(axis.size(), 0);
+  for (size_t i=0; i<values.size(); ++i)
+  {
+    double pos = axis.position(values[i]);
+    BOOST_REQUIRE(pos >= 0.0 && pos <= axis.size());
+    ++count[std::min(int(pos), axis.size()-1)];
+  }
+  for (int k=0; k<axis.size(); ++k)
+    BOOST_CHECK_SMALL(count[k]/5000.0 - 1.0, 0.05);
+  BOOST_CHECK(axis.getWidth(19) > 10*axis.getWidth(0));
+}
+
+BOOST_AUTO_TEST_CASE( adaptive_bins_merge_repeated_values )
+{
+  TDigest sketch;
+  for (int i=0; i<1000; ++i) sketch.add((i < 900) ? 1.0 : 2.0 + i*1e-3);
+  AxisBinning axis(sketch, 10);
+  BOOST_CHECK(axis.size() < 10);
+  BOOST_CHECK_EQUAL(axis.getEdge(0), 1.0);
+  for (int k=0; k<axis.size(); ++k) BOOST_CHECK(axis.getWidth(k) > 0.0);
+}
+
+BOOST_AUTO_TEST_CASE( adaptive_bins_of_constant_data )
+{
+  TDigest sketch;
+  for (int i=0; i<100; ++i) sketch.add(3.0);
+  AxisBinning axis(sketch, 10);
+  BOOST_REQUIRE_EQUAL(axis.size(), 2);
+  BOOST_CHECK_EQUAL(axis.getEdge(0), 3.0);
+  for (int k=0; k<axis.size(); ++k) BOOST_CHECK(axis.getWidth(k) > 0.0);
+
+  double pos = axis.position(3.0);
+  BOOST_CHECK(pos >= 0.0 && pos <= axis.size());
+}
+
+BOOST_AUTO_TEST_CASE( adaptive_bins_of_a_single_sample )
+{
+  TDigest sketch;
+  sketch.add(-2.5, 0.5);
+  AxisBinning axis(sketch, 50);
+  BOOST_REQUIRE_EQUAL(axis.size(), 2);
+  BOOST_CHECK_EQUAL(axis.getEdge(0), -2.5);
+  BOOST_CHECK(axis.getEdge(2) > axis.getEdge(1));
+  BOOST_CHECK_EQUAL(axis.position(-2.5), 0.0);
+
+  // a single requested bin is not split
+  AxisBinning single(sketch, 1);
+  BOOST_CHECK_EQUAL(single.size(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,60 @@
+/*
+ * energybands_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <energybands.hpp>
+#include <common/binaryio.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE( energybands )
+
+BOOST_AUTO_TEST_CASE( single_band )
+{
+  EnergyBands all;
+  BOOST_CHECK_EQUAL(all.size(), 1);
+  BOOST_CHECK_EQUAL(all.find(1.0), 0);
+  BOOST_CHECK_EQUAL(all.find(1e9), 0);
+
+  EnergyBands window(2.0, 5.0);
+  BOOST_CHECK_EQUAL(window.find(1.5), -1);
+  BOOST_CHECK_EQUAL(window.find(2.0), 0);
+  BOOST_CHECK_EQUAL(window.find(5.0), 0);
+  BOOST_CHECK_EQUAL(window.find(5.1), -1);
+}
+
+BOOST_AUTO_TEST_CASE( explicit_edges )
+{
+  EnergyBands bands;
+  bands.parse("1, 1.5,3,10");
+  BOOST_CHECK_EQUAL(bands.size(), 3);
+  BOOST_CHECK_EQUAL(bands.find(0.5), -1);
+  BOOST_CHECK_EQUAL(bands.find(1.2), 0);
+  BOOST_CHECK_EQUAL(bands.find(1.5), 1);
+  BOOST_CHECK_EQUAL(bands.find(9.0), 2);
+  BOOST_CHECK_EQUAL(bands.find(10.0), 2);
+  BOOST_CHECK_EQUAL(bands.find(11.0), -1);
+
+  BOOST_CHECK_THROW(bands.parse("1,3,2"), msdf::GenericException);
+  BOOST_CHECK_THROW(bands.parse("1"), msdf::GenericException);
+  BOOST_CHECK_THROW(bands.parse("1,a"), msdf::GenericException);
+}
+
+BOOST_AUTO_TEST_CASE( log_range )
+{
+  EnergyBands bands;
+  bands.parse("log:1:1000:3");
+  BOOST_CHECK_EQUAL(bands.size(), 3);
+  BOOST_CHECK_CLOSE(bands.getUpper(0), 10.0, 1e-10);
+  BOOST_CHECK_CLOSE(bands.getLower(2), 100.0, 1e-10);
+  BOOST_CHECK_EQUAL(bands.getUpper(2), 1000.0);
+  BOOST_CHECK_EQUAL(bands.find(50.0), 1);
+
+  BOOST_CHECK_THROW(bands.parse("log:0:10:4"), msdf::GenericException);
+  BOOST_CHECK_THROW(bands.parse("log:1:10"), msdf::GenericException);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
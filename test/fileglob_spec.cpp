@@ -0,0 +1,37 @@
+/*
+ * fileglob_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <fileglob.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE( fileglob )
+
+BOOST_AUTO_TEST_CASE( wildcards )
+{
+  BOOST_CHECK(globMatch("*.sdf", "0001.sdf"));
+  BOOST_CHECK(!globMatch("*.sdf", "0001.sdf.zmap"));
+  BOOST_CHECK(globMatch("run_??.sdf", "run_12.sdf"));
+  BOOST_CHECK(!globMatch("run_??.sdf", "run_123.sdf"));
+  BOOST_CHECK(globMatch("*", ""));
+  BOOST_CHECK(globMatch("a*b*c", "aXXbYYbc"));
+  BOOST_CHECK(!globMatch("a*b*c", "aXXbYYb"));
+  BOOST_CHECK(globMatch("exact.h5", "exact.h5"));
+  BOOST_CHECK(!globMatch("exact.h5", "exact.h"));
+}
+
+BOOST_AUTO_TEST_CASE( classes )
+{
+  BOOST_CHECK(globMatch("[0-9][0-9].sdf", "42.sdf"));
+  BOOST_CHECK(!globMatch("[0-9][0-9].sdf", "4a.sdf"));
+  BOOST_CHECK(globMatch("[!a]*", "b.sdf"));
+  BOOST_CHECK(!globMatch("[!a]*", "a.sdf"));
+  BOOST_CHECK(globMatch("slice[]x]", "slice]"));
+  BOOST_CHECK(globMatch("open[", "open["));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,107 @@
+/*
+ * histogram3d_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <histogram3d.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+namespace {
+  struct Positions
+  {
+    std::vector<double> x, y, z, value;
+
+    void add(double x_, double y_, double z_, double value_)
+    {
+      x.push_back(x_); y.push_back(y_); z.push_back(z_);
+      value.push_back(value_);
+    }
+
+    void deposit(Histogram3d &histogram, int numThreads)
+    {
+      const double *pos[3] = { x.data(), y.data(), z.data() };
+      histogram.deposit(x.size(), pos, value.data(), numThreads);
+    }
+  };
+
+  double total(const Histogram3d &histogram)
+  {
+    double sum = 0.0;
+    for (int i=0; i<histogram.getDim(0); ++i)
+      for (int j=0; j<histogram.getDim(1); ++j)
+        for (int k=0; k<histogram.getDim(2); ++k)
+          sum += histogram.get(i, j, k);
+    return sum;
+  }
+}
+
+BOOST_AUTO_TEST_SUITE( histogram3d )
+
+BOOST_AUTO_TEST_CASE( storages_conserve_weight )
+{
+  Histogram3d::Storage storages[2] = { Histogram3d::tiled, Histogram3d::sparse };
+  for (int s=0; s<2; ++s)
+  {
+    Histogram3d histogram(storages[s], 40, 20, 33);
+    Positions positions;
+    for (int i=0; i<3000; ++i)
+      positions.add((i*37 % 4000)/100.0, (i*11 % 2000)/100.0, (i*7 % 3300)/100.0, 1.0 + i % 4);
+    positions.add(-0.5, 1.0, 1.0, 100.0); // outside of the histogram
+    positions.add(40.0, 20.0, 33.0, 2.0); // on the upper edge
+    positions.deposit(histogram, 3);
+
+    double expected = 2.0;
+    for (int i=0; i<3000; ++i) expected += 1.0 + i % 4;
+    BOOST_CHECK_CLOSE(total(histogram), expected, 1e-10);
+    BOOST_CHECK_CLOSE(histogram.get(39, 19, 32), 2.0, 1e-10);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( linear_weights_across_bricks )
+{
+  Histogram3d histogram(Histogram3d::sparse, 32, 32, 32);
+  Positions positions;
+  positions.add(15.25, 3.0, 16.5, 8.0);
+  positions.deposit(histogram, 2);
+
+  BOOST_CHECK_CLOSE(histogram.get(15, 3, 16), 3.0, 1e-12);
+  BOOST_CHECK_CLOSE(histogram.get(16, 3, 16), 1.0, 1e-12);
+  BOOST_CHECK_CLOSE(histogram.get(15, 3, 17), 3.0, 1e-12);
+  BOOST_CHECK_CLOSE(histogram.get(16, 3, 17), 1.0, 1e-12);
+  BOOST_CHECK_EQUAL(histogram.get(15, 4, 16), 0.0);
+  BOOST_CHECK_EQUAL(histogram.getStoredCount(), 4);
+}
+
+BOOST_AUTO_TEST_CASE( tiled_allocates_touched_bricks )
+{
+  Histogram3d histogram(Histogram3d::tiled, 64, 64, 64);
+  Positions positions;
+  positions.add(1.5, 1.5, 1.5, 1.0);
+  positions.add(50.5, 50.5, 50.5, 1.0);
+  positions.deposit(histogram, 4);
+  BOOST_CHECK_EQUAL(histogram.getStoredCount(), 2);
+}
+
+BOOST_AUTO_TEST_CASE( independent_of_threads )
+{
+  Histogram3d single(Histogram3d::tiled, 50, 50, 50);
+  Histogram3d multi(Histogram3d::tiled, 50, 50, 50);
+  Positions positions;
+  for (int i=0; i<20000; ++i)
+    positions.add((i*7919 % 10007)/200.14, (i*104729 % 10009)/200.18, (i*31 % 997)/19.94, 0.3 + i % 7);
+  positions.deposit(single, 1);
+  positions.deposit(multi, 8);
+
+  for (int i=0; i<50; ++i)
+    for (int j=0; j<50; ++j)
+      for (int k=0; k<50; ++k)
+        if (single.get(i, j, k) != multi.get(i, j, k))
+          BOOST_FAIL("bin differs between thread counts");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
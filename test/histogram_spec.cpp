@@ -0,0 +1,132 @@
+/*
+ * histogram_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <histogram.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+namespace {
+  /// Deposit the same values into a histogram and into a plain reference array
+  void depositPattern(Histogram2d &histogram, std::vector<double> &reference)
+  {
+    int xdim = histogram.getXDim();
+    int ydim = histogram.getYDim();
+    reference.assign(int64_t(xdim)*ydim, 0.0);
+
+    uint64_t state = 42;
+    for (int n=0; n<2000; ++n)
+    {
+      state = state*6364136223846793005ULL + 1442695040888963407ULL;
+      int i = int((state >> 33) % xdim);
+      int j = int((state >> 13) % ydim);
+      double value = 0.25*(n % 7) + 0.5;
+      histogram.add(i, j, value);
+      reference[int64_t(i)*ydim + j] += value;
+    }
+
+    // the bins of the corners lie in the partial edge tiles
+    const int corners[4][2] = { { 0, 0 }, { xdim-1, 0 }, { 0, ydim-1 }, { xdim-1, ydim-1 } };
+    for (int c=0; c<4; ++c)
+    {
+      histogram.add(corners[c][0], corners[c][1], 1.0 + c);
+      reference[int64_t(corners[c][0])*ydim + corners[c][1]] += 1.0 + c;
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE( histogram )
+
+BOOST_AUTO_TEST_CASE( storages_agree )
+{
+  // neither dimension is a multiple of the tile size
+  const int dims[3][2] = { { 130, 70 }, { 64, 65 }, { 1, 200 } };
+  const Histogram2d::Storage storages[3] =
+    { Histogram2d::dense, Histogram2d::tiled, Histogram2d::sparse };
+
+  for (int d=0; d<3; ++d)
+  {
+    int xdim = dims[d][0];
+    int ydim = dims[d][1];
+    for (int s=0; s<3; ++s)
+    {
+      pHistogram2d histogram = Histogram2d::create(storages[s], xdim, ydim);
+      BOOST_CHECK_EQUAL(histogram->getXDim(), xdim);
+      BOOST_CHECK_EQUAL(histogram->getYDim(), ydim);
+
+      std::vector<double> reference;
+      depositPattern(*histogram, reference);
+      for (int i=0; i<xdim; ++i)
+        for (int j=0; j<ydim; ++j)
+          BOOST_REQUIRE_EQUAL(histogram->get(i, j), reference[int64_t(i)*ydim + j]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( tiles_are_allocated_when_touched )
+{
+  TiledHistogram2d histogram(130, 70);
+  BOOST_CHECK_EQUAL(histogram.getTileCount(), 0);
+  BOOST_CHECK_EQUAL(histogram.get(129, 69), 0.0);
+
+  histogram.add(129, 69, 2.0);
+  histogram.add(128, 64, 1.0);
+  BOOST_CHECK_EQUAL(histogram.getTileCount(), 1);
+  histogram.add(0, 0, 1.0);
+  BOOST_CHECK_EQUAL(histogram.getTileCount(), 2);
+  BOOST_CHECK_EQUAL(histogram.get(129, 69), 2.0);
+  BOOST_CHECK_EQUAL(histogram.get(127, 69), 0.0);
+
+  SparseHistogram2d sparse(130, 70);
+  sparse.add(129, 69, 2.0);
+  sparse.add(129, 69, 1.0);
+  BOOST_CHECK_EQUAL(sparse.getEntryCount(), 1);
+  BOOST_CHECK_EQUAL(sparse.get(129, 69), 3.0);
+  BOOST_CHECK_EQUAL(sparse.get(69, 129), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE( storage_is_chosen_by_the_budget )
+{
+  const int64_t MB = 1024*1024;
+
+  // a 1024x1024 histogram needs 8 MB in dense storage
+  BOOST_CHECK_EQUAL(Histogram2d::chooseStorage(1, 1024, 1024, 100), Histogram2d::dense);
+
+  MemoryBudget::setLimit(MemoryBudget::getUsed() + 16*MB);
+  BOOST_CHECK_EQUAL(Histogram2d::chooseStorage(1, 1024, 1024, 100), Histogram2d::dense);
+
+  MemoryBudget::setLimit(MemoryBudget::getUsed() + 4*MB);
+  // few deposits fit best into a hash map
+  BOOST_CHECK_EQUAL(Histogram2d::chooseStorage(1, 1024, 1024, 100), Histogram2d::sparse);
+  // many deposits can't fill more tiles than the dense grid holds
+  BOOST_CHECK_EQUAL(Histogram2d::chooseStorage(1, 1024, 1024, 1000000), Histogram2d::tiled);
+
+  // not even the tile index and one tile fit
+  MemoryBudget::setLimit(MemoryBudget::getUsed() + 1024);
+  BOOST_CHECK_THROW(Histogram2d::chooseStorage(1, 1024, 1024, 1000000), msdf::GenericException);
+
+  MemoryBudget::setLimit(0);
+}
+
+BOOST_AUTO_TEST_CASE( storages_account_for_their_bytes )
+{
+  int64_t used = MemoryBudget::getUsed();
+  {
+    pHistogram2d dense = Histogram2d::create(Histogram2d::dense, 100, 100);
+    BOOST_CHECK_EQUAL(MemoryBudget::getUsed() - used, 100*100*int64_t(sizeof(double)));
+
+    pHistogram2d tiled = Histogram2d::create(Histogram2d::tiled, 100, 100);
+    int64_t tiledBytes = tiled->getBytes();
+    tiled->add(99, 99, 1.0);
+    BOOST_CHECK_EQUAL(tiled->getBytes(),
+        tiledBytes + Histogram2d::blockSize*Histogram2d::blockSize*int64_t(sizeof(double)));
+  }
+  BOOST_CHECK_EQUAL(MemoryBudget::getUsed(), used);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,144 @@
+/*
+ * meshslice_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <meshslice.hpp>
+#include <common/binaryio.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <vector>
+
+namespace {
+  /// The value stored at (i,j,k) in the test meshes
+  double meshValue(int i, int j, int k)
+  {
+    return i + 10*j + 100*k;
+  }
+
+  /// Write a header of headerBytes bytes followed by an nx*ny*nz mesh with x running fastest
+  template<typename T>
+  std::string writeMesh(int headerBytes, int nx, int ny, int nz)
+  {
+    std::ostringstream out;
+    for (int b=0; b<headerBytes; ++b) out.put('h');
+    for (int k=0; k<nz; ++k)
+      for (int j=0; j<ny; ++j)
+        for (int i=0; i<nx; ++i)
+        {
+          T value = meshValue(i, j, k);
+          out.write((const char*)&value, sizeof(T));
+        }
+    return out.str();
+  }
+
+  /// Read a slice of a 3d mesh stored in data
+  std::vector<double> slice3d(const std::string &data, int precision, const int64_t dims[3], int x, int y, int z)
+  {
+    const int slice[3] = {x, y, z};
+    MeshSlice meshSlice("mesh.sdf", 16, precision, 3, dims, slice);
+    std::vector<double> result(meshSlice.getLength());
+    std::istringstream in(data);
+    MeshSlice::readSlice(in, 16, precision, dims, slice, &result[0]);
+    return result;
+  }
+}
+
+BOOST_AUTO_TEST_SUITE( meshslice )
+
+BOOST_AUTO_TEST_CASE( dims_drop_sliced_axes )
+{
+  const int64_t dims[3] = {4, 5, 6};
+  const int zslice[3] = {-1, -1, 2};
+  MeshSlice plane("mesh.sdf", 0, 8, 3, dims, zslice);
+  BOOST_REQUIRE_EQUAL(plane.getRank(), 2);
+  BOOST_CHECK_EQUAL(plane.getDims()[0], 5);
+  BOOST_CHECK_EQUAL(plane.getDims()[1], 4);
+  BOOST_CHECK_EQUAL(plane.getLength(), 20);
+
+  const int xyslice[3] = {1, 3, -1};
+  MeshSlice line("mesh.sdf", 0, 8, 3, dims, xyslice);
+  BOOST_REQUIRE_EQUAL(line.getRank(), 1);
+  BOOST_CHECK_EQUAL(line.getDims()[0], 6);
+
+  const int noslice[3] = {-1, -1, -1};
+  MeshSlice mesh2d("mesh.sdf", 0, 8, 2, dims, noslice);
+  BOOST_CHECK_EQUAL(mesh2d.getRank(), 2);
+  BOOST_CHECK_EQUAL(mesh2d.getLength(), 20);
+}
+
+BOOST_AUTO_TEST_CASE( rejects_invalid_slices )
+{
+  const int64_t dims[3] = {4, 5, 6};
+  const int outside[3] = {-1, 5, -1};
+  BOOST_CHECK_THROW(MeshSlice("mesh.sdf", 0, 8, 3, dims, outside), msdf::GenericException);
+
+  const int missingAxis[3] = {-1, -1, 1};
+  BOOST_CHECK_THROW(MeshSlice("mesh.sdf", 0, 8, 2, dims, missingAxis), msdf::GenericException);
+
+  const int noslice[3] = {-1, -1, -1};
+  BOOST_CHECK_THROW(MeshSlice("mesh.sdf", 0, 2, 3, dims, noslice), msdf::GenericException);
+}
+
+BOOST_AUTO_TEST_CASE( reads_planes_of_each_axis )
+{
+  const int64_t dims[3] = {4, 5, 6};
+  std::string data = writeMesh<double>(16, 4, 5, 6);
+
+  std::vector<double> zplane = slice3d(data, 8, dims, -1, -1, 2);
+  for (int j=0; j<5; ++j)
+    for (int i=0; i<4; ++i)
+      BOOST_CHECK_EQUAL(zplane[j*4 + i], meshValue(i, j, 2));
+
+  std::vector<double> yplane = slice3d(data, 8, dims, -1, 3, -1);
+  for (int k=0; k<6; ++k)
+    for (int i=0; i<4; ++i)
+      BOOST_CHECK_EQUAL(yplane[k*4 + i], meshValue(i, 3, k));
+
+  std::vector<double> xplane = slice3d(data, 8, dims, 1, -1, -1);
+  for (int k=0; k<6; ++k)
+    for (int j=0; j<5; ++j)
+      BOOST_CHECK_EQUAL(xplane[k*5 + j], meshValue(1, j, k));
+}
+
+BOOST_AUTO_TEST_CASE( reads_long_rows_value_by_value )
+{
+  // rows longer than rowReadBytes are not read whole
+  const int nx = MeshSlice::rowReadBytes/4 + 3;
+  const int64_t dims[3] = {nx, 3, 2};
+  std::string data = writeMesh<float>(16, nx, 3, 2);
+
+  std::vector<double> xplane = slice3d(data, 4, dims, nx - 2, -1, -1);
+  BOOST_REQUIRE_EQUAL(xplane.size(), 6u);
+  for (int k=0; k<2; ++k)
+    for (int j=0; j<3; ++j)
+      BOOST_CHECK_EQUAL(xplane[k*3 + j], meshValue(nx - 2, j, k));
+
+  std::vector<double> line = slice3d(data, 4, dims, -1, 2, 1);
+  BOOST_REQUIRE_EQUAL(line.size(), size_t(nx));
+  for (int i=0; i<nx; ++i)
+    BOOST_CHECK_EQUAL(line[i], meshValue(i, 2, 1));
+}
+
+BOOST_AUTO_TEST_CASE( reads_the_whole_mesh_without_slices )
+{
+  const int64_t dims[3] = {3, 2, 2};
+  std::string data = writeMesh<float>(16, 3, 2, 2);
+
+  std::vector<double> all = slice3d(data, 4, dims, -1, -1, -1);
+  BOOST_REQUIRE_EQUAL(all.size(), 12u);
+  for (int k=0; k<2; ++k)
+    for (int j=0; j<2; ++j)
+      for (int i=0; i<3; ++i)
+        BOOST_CHECK_EQUAL(all[(k*2 + j)*3 + i], meshValue(i, j, k));
+
+  std::istringstream truncated(data.substr(0, data.size() - 4));
+  const int noslice[3] = {-1, -1, -1};
+  BOOST_CHECK_THROW(MeshSlice::readSlice(truncated, 16, 4, dims, noslice, &all[0]), msdf::GenericException);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
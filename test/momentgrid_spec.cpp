@@ -0,0 +1,147 @@
+/*
+ * momentgrid_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <momentgrid.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+namespace {
+  struct Particles
+  {
+    std::vector<double> x, y, ux, uy, uz, w;
+
+    void add(double x_, double y_, double ux_, double w_)
+    {
+      x.push_back(x_); y.push_back(y_);
+      ux.push_back(ux_); uy.push_back(0.0); uz.push_back(-ux_);
+      w.push_back(w_);
+    }
+
+    void deposit(MomentGrid &grid, int numThreads)
+    {
+      const double *position[2] = { x.data(), y.data() };
+      const double *u[3] = { ux.data(), uy.data(), uz.data() };
+      grid.deposit(x.size(), position, u, w.data(), numThreads);
+    }
+  };
+
+  double totalWeight(const MomentGrid &grid)
+  {
+    double sum = 0.0;
+    int index[3] = { 0, 0, 0 };
+    for (index[0]=0; index[0]<grid.getDim(0); ++index[0])
+      for (index[1]=0; index[1]<grid.getDim(1); ++index[1])
+      {
+        const CellMoments *cell = grid.getCell(index);
+        if (cell) sum += cell->weight;
+      }
+    return sum;
+  }
+}
+
+BOOST_AUTO_TEST_SUITE( momentgrid )
+
+BOOST_AUTO_TEST_CASE( shapes_conserve_weight )
+{
+  int dims[2] = { 100, 70 };
+  double lo[2] = { 0.0, -1.0 };
+  double hi[2] = { 10.0, 6.0 };
+
+  MomentGrid::Shape shapes[3] = { MomentGrid::ngp, MomentGrid::cic, MomentGrid::tsc };
+  for (int s=0; s<3; ++s)
+  {
+    Particles particles;
+    for (int i=0; i<5000; ++i)
+      particles.add(0.5 + (i*0.0137 - int(i*0.0137/9.0)*9.0), 0.0 + (i % 53)*0.1, i*1e3, 1.0 + i % 3);
+    particles.add(20.0, 0.0, 0.0, 1.0); // outside of the grid
+
+    MomentGrid grid(2, dims, lo, hi, shapes[s]);
+    particles.deposit(grid, 3);
+    grid.reduce();
+
+    double expected = 0.0;
+    for (size_t i=0; i+1<particles.w.size(); ++i) expected += particles.w[i];
+    BOOST_CHECK_CLOSE(totalWeight(grid), expected, 1e-10);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( tsc_across_tile_boundary )
+{
+  // the tiles of a 1d grid are 1024 cells long, the particle sits at the centre of cell 1024
+  int dims[1] = { 2048 };
+  double lo[1] = { 0.0 };
+  double hi[1] = { 2048.0 };
+  MomentGrid grid(1, dims, lo, hi, MomentGrid::tsc);
+
+  Particles particles;
+  particles.add(1024.5, 0.0, 0.0, 2.0);
+  particles.deposit(grid, 2);
+  grid.reduce();
+
+  int index[1] = { 1023 };
+  BOOST_CHECK_CLOSE(grid.getCell(index)->weight, 0.25, 1e-12);
+  index[0] = 1024;
+  BOOST_CHECK_CLOSE(grid.getCell(index)->weight, 1.5, 1e-12);
+  index[0] = 1025;
+  BOOST_CHECK_CLOSE(grid.getCell(index)->weight, 0.25, 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE( cell_moments )
+{
+  int dims[2] = { 4, 4 };
+  double lo[2] = { 0.0, 0.0 };
+  double hi[2] = { 4.0, 4.0 };
+  MomentGrid grid(2, dims, lo, hi, MomentGrid::ngp);
+
+  Particles particles;
+  particles.add(1.5, 2.5, 1e5, 1.0);
+  particles.add(1.2, 2.1, 3e5, 1.0);
+  particles.deposit(grid, 1);
+  grid.reduce();
+
+  int index[2] = { 1, 2 };
+  const CellMoments *cell = grid.getCell(index);
+  BOOST_REQUIRE(cell);
+  BOOST_CHECK_CLOSE(cell->weight, 2.0, 1e-12);
+  BOOST_CHECK_CLOSE(cell->mean[0], 2e5, 1e-12);
+  BOOST_CHECK_CLOSE(cell->cov[0]/cell->weight, 1e10, 1e-10);
+  BOOST_CHECK_CLOSE(cell->cov[2]/cell->weight, -1e10, 1e-10);
+  BOOST_CHECK_SMALL(cell->cov[3], 1e-20);
+  BOOST_CHECK_CLOSE(cell->vsum[0], 4e5, 1e-3);
+}
+
+BOOST_AUTO_TEST_CASE( independent_of_threads )
+{
+  int dims[2] = { 200, 200 };
+  double lo[2] = { 0.0, 0.0 };
+  double hi[2] = { 1.0, 1.0 };
+  MomentGrid single(2, dims, lo, hi, MomentGrid::cic);
+  MomentGrid multi(2, dims, lo, hi, MomentGrid::cic);
+
+  Particles particles;
+  for (int i=0; i<20000; ++i)
+    particles.add((i*7919 % 10007)/10007.0, (i*104729 % 10009)/10009.0, 1e6 + (i % 101)*13.0, 0.5 + i % 7);
+  particles.deposit(single, 1);
+  particles.deposit(multi, 8);
+  single.reduce();
+  multi.reduce();
+
+  int index[3] = { 0, 0, 0 };
+  for (index[0]=0; index[0]<200; ++index[0])
+    for (index[1]=0; index[1]<200; ++index[1])
+    {
+      const CellMoments *a = single.getCell(index);
+      const CellMoments *b = multi.getCell(index);
+      BOOST_REQUIRE(a && b);
+      if ((a->weight != b->weight) || (a->cov[0] != b->cov[0]))
+        BOOST_FAIL("cell differs between thread counts");
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
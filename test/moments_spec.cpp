@@ -0,0 +1,79 @@
+/*
+ * moments_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <moments.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE( moments )
+
+BOOST_AUTO_TEST_CASE( weighted_mean_and_variance )
+{
+  MomentAccumulator acc;
+  acc.add(1.0, 0.0, -2.0, 1.0);
+  acc.add(3.0, 0.0, -2.0, 3.0);
+
+  BOOST_CHECK_EQUAL(acc.getCount(), 2);
+  BOOST_CHECK_CLOSE(acc.getWeight(), 4.0, 1e-12);
+  BOOST_CHECK_CLOSE(acc.getMean(0), 2.5, 1e-12);
+  BOOST_CHECK_CLOSE(acc.getVariance(0), 0.75, 1e-12);
+  BOOST_CHECK_SMALL(acc.getVariance(1), 1e-30);
+  BOOST_CHECK_CLOSE(acc.getMean(2), -2.0, 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE( cold_beam_with_drift )
+{
+  // a spread of 1e-3 on top of a drift of 1e8, the naive <p^2>-<p>^2 is dominated by rounding
+  MomentAccumulator plain, compensated(true);
+  for (int i=0; i<1000000; ++i)
+  {
+    double p = 1e8 + ((i % 2) ? 1e-3 : -1e-3);
+    plain.add(p, p, p, 0.5);
+    compensated.add(p, p, p, 0.5);
+  }
+  BOOST_CHECK_CLOSE(plain.getVariance(0), 1e-6, 1e-2);
+  BOOST_CHECK_CLOSE(compensated.getVariance(0), 1e-6, 1e-2);
+  BOOST_CHECK_CLOSE(compensated.getMean(0), 1e8, 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE( merge_matches_single_pass )
+{
+  for (int c=0; c<2; ++c)
+  {
+    MomentAccumulator all(c), first(c), second(c);
+    for (int i=0; i<10000; ++i)
+    {
+      double x = 1000.0 + (i % 17)*0.25;
+      double w = 1.0 + (i % 3);
+      all.add(x, -x, 2*x, w);
+      if (i < 3000) first.add(x, -x, 2*x, w);
+      else second.add(x, -x, 2*x, w);
+    }
+    first.merge(second);
+
+    BOOST_CHECK_EQUAL(first.getCount(), all.getCount());
+    BOOST_CHECK_CLOSE(first.getWeight(), all.getWeight(), 1e-12);
+    for (int d=0; d<3; ++d)
+    {
+      BOOST_CHECK_CLOSE(first.getMean(d), all.getMean(d), 1e-10);
+      BOOST_CHECK_CLOSE(first.getVariance(d), all.getVariance(d), 1e-8);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( merge_with_empty )
+{
+  MomentAccumulator acc, empty;
+  acc.add(1.0, 2.0, 3.0, 1.0);
+  acc.merge(empty);
+  empty.merge(acc);
+
+  BOOST_CHECK_CLOSE(empty.getMean(1), 2.0, 1e-12);
+  BOOST_CHECK_EQUAL(empty.getCount(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,53 @@
+/*
+ * particleaxes_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <particleaxes.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+
+BOOST_AUTO_TEST_SUITE( particleaxes )
+
+BOOST_AUTO_TEST_CASE( parses_the_axis_names )
+{
+  BOOST_CHECK_EQUAL(ParticleAxes::parseId("x"), 0);
+  BOOST_CHECK_EQUAL(ParticleAxes::parseId("E"), 5);
+  BOOST_CHECK_EQUAL(ParticleAxes::parseId("vz"), 12);
+  BOOST_CHECK_EQUAL(ParticleAxes::parseId("pzt"), 17);
+  BOOST_CHECK_EQUAL(ParticleAxes::parseId("w"), -1);
+  BOOST_CHECK_EQUAL(ParticleAxes::parseId("1"), -1);
+  BOOST_CHECK_EQUAL(ParticleAxes::parseId("1", true), ParticleAxes::unity);
+}
+
+BOOST_AUTO_TEST_CASE( velocities_use_the_full_gamma )
+{
+  double px = 0.3, py = -1.2, pz = 2.5;
+  double gamma = std::sqrt(1 + px*px + py*py + pz*pz);
+
+  BOOST_CHECK_CLOSE(ParticleAxes::value(10, px, py, pz, 0.0, 0.0), px/gamma, 1e-12);
+  BOOST_CHECK_CLOSE(ParticleAxes::value(11, px, py, pz, 0.0, 0.0), py/gamma, 1e-12);
+  BOOST_CHECK_CLOSE(ParticleAxes::value(12, px, py, pz, 0.0, 0.0), pz/gamma, 1e-12);
+  BOOST_CHECK_CLOSE(ParticleAxes::value(9, px, py, pz, 0.0, 0.0),
+      std::sqrt(gamma*gamma - 1)/gamma, 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE( both_forms_agree )
+{
+  double px = 0.01, py = 0.2, pz = -0.03, x = 1.5, y = -4.0;
+  double p2 = px*px + py*py + pz*pz;
+  double gamma = std::sqrt(1 + p2);
+
+  for (int id=0; id<18; ++id)
+    BOOST_CHECK_CLOSE(ParticleAxes::value(id, px, py, pz, x, y),
+        ParticleAxes::value(id, px, py, pz, x, y, p2, gamma), 1e-12);
+
+  BOOST_CHECK_CLOSE(ParticleAxes::value(5, px, py, pz, x, y), gamma - 1, 1e-9);
+  BOOST_CHECK_EQUAL(ParticleAxes::value(ParticleAxes::unity, px, py, pz, x, y), 1.0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,183 @@
+/*
+ * particlecache_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <particlecache.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <sstream>
+
+namespace {
+  typedef std::vector<std::pair<int64_t, int64_t> > RangeList;
+
+  /// A 4x4 cache over [0,4]^2 with ten rows in every cell
+  void initFullGrid(ParticleCache &cache)
+  {
+    const double lo[2] = { 0.0, 0.0 };
+    const double hi[2] = { 4.0, 4.0 };
+    cache.init(2, 2, lo, hi, false);
+
+    std::vector<ParticleCache::Cell> cells(16);
+    for (int k=0; k<16; ++k)
+    {
+      cells[k].key = k;
+      cells[k].first = 10*k;
+    }
+    std::ostringstream out;
+    cache.writeHeader(out, 160, 1, cells);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE( particlecache )
+
+BOOST_AUTO_TEST_CASE( keys_round_trip )
+{
+  const double lo[3] = { -1.0, 0.0, 10.0 };
+  const double hi[3] = { 1.0, 2.0, 30.0 };
+  const int bits = 4;
+  const int cellsPerDim = 1 << bits;
+
+  for (int rank=1; rank<=3; ++rank)
+  {
+    ParticleCache cache;
+    cache.init(rank, bits, lo, hi, false);
+
+    int total = 1;
+    for (int d=0; d<rank; ++d) total *= cellsPerDim;
+
+    std::vector<bool> seen(total, false);
+    for (int n=0; n<total; ++n)
+    {
+      uint32_t coords[3], decoded[3];
+      double pos[3];
+      int rest = n;
+      for (int d=0; d<rank; ++d)
+      {
+        coords[d] = rest % cellsPerDim;
+        rest /= cellsPerDim;
+        pos[d] = lo[d] + (coords[d] + 0.5)*(hi[d] - lo[d])/cellsPerDim;
+      }
+
+      uint64_t key = cache.cellKey(pos);
+      BOOST_REQUIRE(key < uint64_t(total));
+      BOOST_CHECK(!seen[key]);
+      seen[key] = true;
+
+      cache.decodeKey(key, decoded);
+      for (int d=0; d<rank; ++d) BOOST_CHECK_EQUAL(decoded[d], coords[d]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( keys_interleave_the_bits )
+{
+  const double lo[3] = { 0.0, 0.0, 0.0 };
+  const double hi[3] = { 4.0, 4.0, 4.0 };
+  ParticleCache cache;
+  cache.init(3, 2, lo, hi, false);
+
+  const double px[3] = { 1.5, 0.5, 0.5 };
+  const double py[3] = { 0.5, 1.5, 0.5 };
+  const double pz[3] = { 0.5, 0.5, 1.5 };
+  const double far[3] = { 2.5, 0.5, 0.5 };
+  BOOST_CHECK_EQUAL(cache.cellKey(px), 1u);
+  BOOST_CHECK_EQUAL(cache.cellKey(py), 2u);
+  BOOST_CHECK_EQUAL(cache.cellKey(pz), 4u);
+  BOOST_CHECK_EQUAL(cache.cellKey(far), 8u);
+
+  // positions outside the grid are clamped to the boundary cells
+  const double outside[3] = { -HUGE_VAL, 100.0, 4.0 };
+  uint32_t coords[3];
+  cache.decodeKey(cache.cellKey(outside), coords);
+  BOOST_CHECK_EQUAL(coords[0], 0u);
+  BOOST_CHECK_EQUAL(coords[1], 3u);
+  BOOST_CHECK_EQUAL(coords[2], 3u);
+}
+
+BOOST_AUTO_TEST_CASE( ranges_of_adjacent_cells_are_merged )
+{
+  ParticleCache cache;
+  initFullGrid(cache);
+  RangeList ranges;
+
+  // the four cells of the lower left quadrant are consecutive keys
+  const double lo[2] = { 0.2, 0.2 };
+  const double hi[2] = { 1.5, 1.5 };
+  cache.findRanges(lo, hi, ranges);
+  BOOST_REQUIRE_EQUAL(ranges.size(), 1u);
+  BOOST_CHECK_EQUAL(ranges[0].first, 0);
+  BOOST_CHECK_EQUAL(ranges[0].second, 40);
+
+  // a column of cells has the keys 0, 2, 8 and 10
+  const double columnLo[2] = { 0.0, 0.0 };
+  const double columnHi[2] = { 0.5, 3.9 };
+  cache.findRanges(columnLo, columnHi, ranges);
+  BOOST_REQUIRE_EQUAL(ranges.size(), 4u);
+  BOOST_CHECK_EQUAL(ranges[0].first, 0);
+  BOOST_CHECK_EQUAL(ranges[0].second, 10);
+  BOOST_CHECK_EQUAL(ranges[1].first, 20);
+  BOOST_CHECK_EQUAL(ranges[1].second, 30);
+  BOOST_CHECK_EQUAL(ranges[2].first, 80);
+  BOOST_CHECK_EQUAL(ranges[2].second, 90);
+  BOOST_CHECK_EQUAL(ranges[3].first, 100);
+  BOOST_CHECK_EQUAL(ranges[3].second, 110);
+}
+
+BOOST_AUTO_TEST_CASE( ranges_of_boxes_outside_the_grid_are_clamped )
+{
+  ParticleCache cache;
+  initFullGrid(cache);
+  RangeList ranges;
+
+  const double allLo[2] = { -HUGE_VAL, -100.0 };
+  const double allHi[2] = { 100.0, HUGE_VAL };
+  cache.findRanges(allLo, allHi, ranges);
+  BOOST_REQUIRE_EQUAL(ranges.size(), 1u);
+  BOOST_CHECK_EQUAL(ranges[0].first, 0);
+  BOOST_CHECK_EQUAL(ranges[0].second, 160);
+
+  // a box beyond the upper corner only touches the corner cell
+  const double beyondLo[2] = { 10.0, 10.0 };
+  const double beyondHi[2] = { 20.0, 20.0 };
+  cache.findRanges(beyondLo, beyondHi, ranges);
+  BOOST_REQUIRE_EQUAL(ranges.size(), 1u);
+  BOOST_CHECK_EQUAL(ranges[0].first, 150);
+  BOOST_CHECK_EQUAL(ranges[0].second, 160);
+}
+
+BOOST_AUTO_TEST_CASE( ranges_skip_empty_cells )
+{
+  const double lo[1] = { 0.0 };
+  const double hi[1] = { 8.0 };
+  ParticleCache cache;
+  cache.init(1, 3, lo, hi, true);
+
+  // only the cells 1, 2 and 6 hold particles
+  std::vector<ParticleCache::Cell> cells(3);
+  cells[0].key = 1; cells[0].first = 0;
+  cells[1].key = 2; cells[1].first = 4;
+  cells[2].key = 6; cells[2].first = 7;
+  std::ostringstream out;
+  cache.writeHeader(out, 9, 2, cells);
+
+  // the rows of cell 2 and cell 6 follow each other in the file
+  RangeList ranges;
+  const double boxLo[1] = { 2.5 };
+  const double boxHi[1] = { 6.5 };
+  cache.findRanges(boxLo, boxHi, ranges);
+  BOOST_REQUIRE_EQUAL(ranges.size(), 1u);
+  BOOST_CHECK_EQUAL(ranges[0].first, 4);
+  BOOST_CHECK_EQUAL(ranges[0].second, 9);
+
+  const double emptyLo[1] = { 3.0 };
+  const double emptyHi[1] = { 5.5 };
+  cache.findRanges(emptyLo, emptyHi, ranges);
+  BOOST_CHECK(ranges.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,120 @@
+/*
+ * particlechunk_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <particlechunk.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE( particlechunk )
+
+BOOST_AUTO_TEST_CASE( arrays_are_aligned )
+{
+  ParticleChunk chunk;
+  chunk.resize(37);
+
+  BOOST_CHECK_EQUAL(chunk.length(), 37);
+  for (int c=0; c<ParticleChunk::numComponents; ++c)
+  {
+    BOOST_CHECK_EQUAL(chunk.component(c).size(), 37);
+    BOOST_CHECK_EQUAL(reinterpret_cast<size_t>(chunk.component(c).data()) % 64, 0u);
+  }
+  BOOST_CHECK_EQUAL(reinterpret_cast<size_t>(chunk.species().data()) % 64, 0u);
+}
+
+BOOST_AUTO_TEST_CASE( resize_keeps_content )
+{
+  ParticleChunk chunk;
+  chunk.resize(10);
+  for (int64_t i=0; i<10; ++i)
+  {
+    chunk.px()[i] = double(i);
+    chunk.species()[i] = int32_t(i);
+  }
+
+  chunk.resize(5000);
+  BOOST_CHECK_EQUAL(chunk.px().size(), 5000);
+  for (int64_t i=0; i<10; ++i)
+  {
+    BOOST_CHECK_EQUAL(chunk.px()[i], double(i));
+    BOOST_CHECK_EQUAL(chunk.species()[i], int32_t(i));
+  }
+
+  chunk.resize(3);
+  BOOST_CHECK_EQUAL(chunk.px().size(), 3);
+  BOOST_CHECK_EQUAL(chunk.px()[2], 2.0);
+}
+
+BOOST_AUTO_TEST_CASE( positions_are_separate_arrays )
+{
+  ParticleChunk chunk;
+  chunk.setRank(2);
+  chunk.resize(4);
+  chunk.fill(ParticleChunk::X, 1.0);
+  chunk.fill(ParticleChunk::Y, 2.0);
+
+  const ParticleChunk &view = chunk;
+  BOOST_CHECK_EQUAL(view.getRank(), 2);
+  for (int64_t i=0; i<4; ++i)
+  {
+    BOOST_CHECK_EQUAL(view.position(0)[i], 1.0);
+    BOOST_CHECK_EQUAL(view.y()[i], 2.0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( moveRow_compacts )
+{
+  ParticleChunk chunk;
+  chunk.resize(3);
+  for (int64_t i=0; i<3; ++i)
+  {
+    for (int c=0; c<ParticleChunk::numComponents; ++c) chunk.component(c)[i] = 10.0*i + c;
+    chunk.species()[i] = int32_t(i + 1);
+  }
+
+  chunk.moveRow(2, 0);
+  chunk.resize(1);
+  for (int c=0; c<ParticleChunk::numComponents; ++c)
+    BOOST_CHECK_EQUAL(chunk.component(c)[0], 20.0 + c);
+  BOOST_CHECK_EQUAL(chunk.species()[0], 3);
+}
+
+BOOST_AUTO_TEST_CASE( steady_state_does_not_allocate )
+{
+  ParticleChunk chunk;
+  BufferPool pool;
+  chunk.resize(1000);
+  pool.get<float>(0, 1000);
+
+  int64_t allocations = AllocationStats::getAllocations();
+  for (int n=0; n<10; ++n)
+  {
+    chunk.resize(1000 - n);
+    pool.get<float>(0, 1000 - n);
+  }
+  BOOST_CHECK_EQUAL(AllocationStats::getAllocations(), allocations);
+
+  chunk.resize(2000);
+  BOOST_CHECK(AllocationStats::getAllocations() > allocations);
+}
+
+BOOST_AUTO_TEST_CASE( chunk_buffers_are_budgeted )
+{
+  int64_t used = MemoryBudget::getUsed();
+  {
+    ParticleChunk chunk;
+    chunk.resize(1000);
+    BOOST_CHECK(MemoryBudget::getUsed() >= used + 1000*int64_t(ParticleChunk::numComponents*sizeof(double)));
+
+    MemoryBudget::setLimit(MemoryBudget::getUsed() + 1024);
+    BOOST_CHECK_THROW(chunk.resize(2000), msdf::GenericException);
+    chunk.resize(1000);
+    MemoryBudget::setLimit(0);
+  }
+  BOOST_CHECK_EQUAL(MemoryBudget::getUsed(), used);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,196 @@
+/*
+ * particlefilter_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <particlefilter.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  ParticleBounds momentumBounds(double pxmin, double pxmax, double pymin, double pymax,
+                                double pzmin, double pzmax)
+  {
+    ParticleBounds bounds;
+    bounds.columns = pc_momentum;
+    bounds.pxmin = pxmin; bounds.pxmax = pxmax;
+    bounds.pymin = pymin; bounds.pymax = pymax;
+    bounds.pzmin = pzmin; bounds.pzmax = pzmax;
+    return bounds;
+  }
+}
+
+BOOST_AUTO_TEST_SUITE( particlefilter )
+
+BOOST_AUTO_TEST_CASE( spatial_limits_are_strict )
+{
+  ParticleFilter filter;
+  filter.setSpatialLimits(std::vector<double>(1, 1.0), std::vector<double>(1, 2.0),
+                          std::vector<double>(1, -1.0), std::vector<double>(1, 1.0));
+
+  BOOST_CHECK(filter.accept(0, 1.5, 0.0, 2, 0, 0, 0));
+  BOOST_CHECK(!filter.accept(0, 1.0, 0.0, 2, 0, 0, 0));
+  BOOST_CHECK(!filter.accept(0, 2.0, 0.0, 2, 0, 0, 0));
+  BOOST_CHECK(!filter.accept(0, 1.5, 1.0, 2, 0, 0, 0));
+  BOOST_CHECK(!filter.accept(0, 1.5, -1.0, 2, 0, 0, 0));
+
+  // y is ignored in one dimension
+  BOOST_CHECK(filter.accept(0, 1.5, 5.0, 1, 0, 0, 0));
+
+  // species without limits and ids less than 0 are not restricted
+  BOOST_CHECK(filter.accept(1, 5.0, 5.0, 2, 0, 0, 0));
+  BOOST_CHECK(filter.accept(-1, 5.0, 5.0, 2, 0, 0, 0));
+
+  BOOST_CHECK(filter.isActive());
+  BOOST_CHECK_EQUAL(filter.getColumns(), int(pc_mesh));
+}
+
+BOOST_AUTO_TEST_CASE( gamma_limits )
+{
+  ParticleFilter filter;
+  filter.setGammaLimits(2.0, 3.0);
+  BOOST_CHECK_EQUAL(filter.getColumns(), int(pc_momentum));
+
+  // gamma2 = 1 + 3 = 4 lies on the lower limit and is kept
+  BOOST_CHECK(filter.accept(0, 0, 0, 1, 1.0, 1.0, -1.0));
+  BOOST_CHECK(!filter.accept(0, 0, 0, 1, 1.0, 1.0, 0.0));
+  BOOST_CHECK(filter.accept(0, 0, 0, 1, 0.0, 0.0, -2.5));
+  BOOST_CHECK(!filter.accept(0, 0, 0, 1, 3.0, 0.0, 0.0));
+}
+
+BOOST_AUTO_TEST_CASE( max_gamma_below_one_is_no_limit )
+{
+  ParticleFilter filter;
+  filter.setGammaLimits(1.0, 0.5);
+  BOOST_CHECK(!filter.isActive());
+  BOOST_CHECK_EQUAL(filter.getColumns(), int(pc_none));
+  BOOST_CHECK(filter.accept(0, 0, 0, 1, 1e6, 0, 0));
+
+  filter.setGammaLimits(2.0, 0.5);
+  BOOST_CHECK(filter.accept(0, 0, 0, 1, 1e6, 0, 0));
+  BOOST_CHECK(!filter.accept(0, 0, 0, 1, 1.0, 0, 0));
+  BOOST_CHECK(filter.mayAccept(0, 1, momentumBounds(1e5, 1e6, 0, 0, 0, 0)));
+  BOOST_CHECK(!filter.mayAccept(0, 1, momentumBounds(-1.0, 1.0, -1.0, 1.0, -0.5, 0.5)));
+}
+
+BOOST_AUTO_TEST_CASE( momentum_ranges_straddling_zero )
+{
+  ParticleFilter filter;
+  filter.setGammaLimits(0.0, 1.1);
+
+  // the smallest px2 in [-3, 3] is 0, so a particle at rest may be inside
+  BOOST_CHECK(filter.mayAccept(0, 1, momentumBounds(-3.0, 3.0, 0, 0, 0, 0)));
+  BOOST_CHECK(!filter.mayAccept(0, 1, momentumBounds(2.0, 3.0, 0, 0, 0, 0)));
+  BOOST_CHECK(!filter.mayAccept(0, 1, momentumBounds(-3.0, -2.0, 0, 0, 0, 0)));
+
+  filter.setGammaLimits(1.5, 0.0);
+  // the largest px2 in [-1.2, 0.5] comes from the negative end
+  BOOST_CHECK(filter.mayAccept(0, 1, momentumBounds(-1.2, 0.5, 0, 0, 0, 0)));
+  BOOST_CHECK(!filter.mayAccept(0, 1, momentumBounds(-1.0, 1.0, 0, 0, 0, 0)));
+
+  // without all momentum columns the gamma limits cannot be evaluated
+  ParticleBounds partial = momentumBounds(-1.0, 1.0, 0, 0, 0, 0);
+  partial.columns = pc_px;
+  BOOST_CHECK(filter.mayAccept(0, 1, partial));
+}
+
+BOOST_AUTO_TEST_CASE( may_accept_never_rejects_an_accepted_particle )
+{
+  ParticleFilter filter;
+  filter.setSpatialLimits(std::vector<double>(2, 0.1), std::vector<double>(2, 0.9),
+                          std::vector<double>(2, 0.2), std::vector<double>(2, 0.8));
+  filter.setPositivePx(true);
+
+  const double gammaLimits[3][2] = { { 1.3, 0.0 }, { 0.0, 1.7 }, { 1.2, 2.1 } };
+  uint64_t state = 12345;
+  auto uniform = [&](double lo, double hi)
+  {
+    state = state*6364136223846793005ULL + 1442695040888963407ULL;
+    return lo + (hi - lo)*double(state >> 11)/double(1ULL << 53);
+  };
+
+  for (int g=0; g<3; ++g)
+  {
+    filter.setGammaLimits(gammaLimits[g][0], gammaLimits[g][1]);
+    for (int group=0; group<2000; ++group)
+    {
+      double x[4], y[4], px[4], py[4], pz[4];
+      double width = uniform(0.0, 2.0);
+      for (int i=0; i<4; ++i)
+      {
+        x[i] = uniform(0.0, 1.0);
+        y[i] = uniform(0.0, 1.0);
+        px[i] = uniform(-width, width);
+        py[i] = uniform(-width, width);
+        pz[i] = uniform(-width, width);
+      }
+
+      ParticleBounds bounds;
+      bounds.columns = pc_mesh | pc_momentum;
+      bounds.xmin = *std::min_element(x, x+4);   bounds.xmax = *std::max_element(x, x+4);
+      bounds.ymin = *std::min_element(y, y+4);   bounds.ymax = *std::max_element(y, y+4);
+      bounds.pxmin = *std::min_element(px, px+4); bounds.pxmax = *std::max_element(px, px+4);
+      bounds.pymin = *std::min_element(py, py+4); bounds.pymax = *std::max_element(py, py+4);
+      bounds.pzmin = *std::min_element(pz, pz+4); bounds.pzmax = *std::max_element(pz, pz+4);
+
+      bool anyAccepted = false;
+      for (int i=0; i<4; ++i)
+        anyAccepted = anyAccepted || filter.accept(1, x[i], y[i], 2, px[i], py[i], pz[i]);
+      if (anyAccepted) BOOST_REQUIRE(filter.mayAccept(1, 2, bounds));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( select_returns_accepted_indices )
+{
+  ParticleFilter filter;
+  filter.setSpatialLimits(std::vector<double>(1, 0.0), std::vector<double>(),
+                          std::vector<double>(), std::vector<double>());
+
+  const double x[5] = { -1.0, 0.5, 0.0, 2.0, -0.5 };
+  std::vector<int64_t> selection(3, 7);
+  filter.select(0, 5, 1, x, 0, 0, 0, 0, selection);
+
+  BOOST_REQUIRE_EQUAL(selection.size(), 2u);
+  BOOST_CHECK_EQUAL(selection[0], 1);
+  BOOST_CHECK_EQUAL(selection[1], 3);
+
+  filter.select(1, 5, 1, x, 0, 0, 0, 0, selection);
+  BOOST_CHECK_EQUAL(selection.size(), 5u);
+}
+
+BOOST_AUTO_TEST_CASE( spatial_box_covers_all_species )
+{
+  ParticleFilter filter;
+  std::vector<double> xsmin, xsmax;
+  xsmin.push_back(1.0); xsmin.push_back(-2.0);
+  xsmax.push_back(3.0); xsmax.push_back(4.0);
+  filter.setSpatialLimits(xsmin, xsmax, std::vector<double>(), std::vector<double>());
+
+  double lo[3], hi[3];
+  BOOST_CHECK(filter.getSpatialBox(2, 3, lo, hi));
+  BOOST_CHECK_EQUAL(lo[0], -2.0);
+  BOOST_CHECK_EQUAL(hi[0], 4.0);
+  BOOST_CHECK_EQUAL(lo[1], -HUGE_VAL);
+  BOOST_CHECK_EQUAL(hi[1], HUGE_VAL);
+  BOOST_CHECK_EQUAL(lo[2], -HUGE_VAL);
+  BOOST_CHECK_EQUAL(hi[2], HUGE_VAL);
+
+  BOOST_CHECK(filter.getSpatialBox(1, 1, lo, hi));
+  BOOST_CHECK_EQUAL(lo[0], 1.0);
+  BOOST_CHECK_EQUAL(hi[0], 3.0);
+
+  // the third species has no limits, so the box is unrestricted
+  BOOST_CHECK(!filter.getSpatialBox(3, 2, lo, hi));
+  BOOST_CHECK_EQUAL(lo[0], -HUGE_VAL);
+  BOOST_CHECK_EQUAL(hi[0], HUGE_VAL);
+
+  BOOST_CHECK(!filter.getSpatialBox(0, 2, lo, hi));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,156 @@
+/*
+ * particlesampler_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <particlesampler.hpp>
+#include <particlechunk.hpp>
+#include <common/binaryio.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <set>
+
+namespace {
+  /// The value of the filtered quantity in a source row
+  double rowValue(int64_t row)
+  {
+    return (row*37 % 1000)/1000.0;
+  }
+
+  /**
+   * Sample a source of count rows that was filtered to lo <= value < hi,
+   * in chunks of chunkLength source rows, and return the rows that are kept.
+   */
+  std::set<int64_t> samplePass(const ParticleSampler &sampler, int64_t count, int64_t chunkLength,
+      double lo, double hi)
+  {
+    std::set<int64_t> kept;
+    ParticleChunk chunk, sample;
+    for (int64_t first=0; first<count; first += chunkLength)
+    {
+      int64_t end = std::min(count, first + chunkLength);
+      chunk.resize(end - first);
+      int64_t accepted = 0;
+      for (int64_t row=first; row<end; ++row)
+      {
+        if ((rowValue(row) < lo) || (rowValue(row) >= hi)) continue;
+        chunk.x()[accepted] = rowValue(row);
+        chunk.weight()[accepted] = 2.0;
+        chunk.species()[accepted] = 1;
+        chunk.rows()[accepted] = row;
+        ++accepted;
+      }
+      chunk.resize(accepted);
+
+      sampler.sample(chunk, sample);
+      for (int64_t i=0; i<sample.length(); ++i)
+      {
+        BOOST_CHECK_EQUAL(sample.x()[i], rowValue(sample.rows()[i]));
+        BOOST_CHECK_CLOSE(sample.weight()[i], 2.0*sampler.getWeightFactor(), 1e-12);
+        kept.insert(sample.rows()[i]);
+      }
+    }
+    return kept;
+  }
+}
+
+BOOST_AUTO_TEST_SUITE( particlesampler )
+
+BOOST_AUTO_TEST_CASE( keeps_fraction )
+{
+  ParticleSampler sampler(0.1, 0, 42);
+  const int64_t count = 200000;
+  int64_t kept = 0;
+  for (int64_t row=0; row<count; ++row)
+    if (sampler.keepRow(row)) ++kept;
+
+  BOOST_CHECK_CLOSE(double(kept)/count, 0.1, 3.0);
+  BOOST_CHECK_CLOSE(sampler.getWeightFactor(), 10.0, 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE( decisions_are_reproducible )
+{
+  ParticleSampler a(0.5, 0, 7);
+  ParticleSampler b(0.5, 0, 7);
+  ParticleSampler c(0.5, 0, 8);
+  int differences = 0;
+  for (int64_t row=0; row<1000; ++row)
+  {
+    BOOST_CHECK_EQUAL(a.keepRow(row), b.keepRow(row));
+    if (a.keepRow(row) != c.keepRow(row)) ++differences;
+  }
+  BOOST_CHECK(differences > 100);
+}
+
+BOOST_AUTO_TEST_CASE( stretches_are_independent_of_rows )
+{
+  ParticleSampler sampler(0.25, 4096, 3);
+  int64_t kept = 0;
+  for (int64_t s=0; s<40000; ++s)
+    if (sampler.keepStretch(s)) ++kept;
+  BOOST_CHECK_CLOSE(kept/40000.0, 0.25, 5.0);
+}
+
+BOOST_AUTO_TEST_CASE( poisson_weights )
+{
+  const int64_t count = 100000;
+  double sum = 0.0, sum2 = 0.0;
+  for (int64_t key=0; key<count; ++key)
+  {
+    int k = ParticleSampler::poissonWeight(11, key, 3);
+    BOOST_REQUIRE(k >= 0);
+    sum += k;
+    sum2 += k*k;
+  }
+  double mean = sum/count;
+  BOOST_CHECK_CLOSE(mean, 1.0, 2.0);
+  BOOST_CHECK_CLOSE(sum2/count - mean*mean, 1.0, 3.0);
+
+  BOOST_CHECK_EQUAL(ParticleSampler::poissonWeight(11, 5, 0), ParticleSampler::poissonWeight(11, 5, 0));
+}
+
+BOOST_AUTO_TEST_CASE( invalid_fraction )
+{
+  BOOST_CHECK_THROW(ParticleSampler(0.0, 0, 1), msdf::GenericException);
+  BOOST_CHECK_THROW(ParticleSampler(1.5, 0, 1), msdf::GenericException);
+}
+
+BOOST_AUTO_TEST_CASE( passes_with_different_filters_keep_the_same_rows )
+{
+  ParticleSampler sampler(0.2, 0, 11);
+  const int64_t count = 20000;
+
+  // like the range pass without and the plot pass with energy limits
+  std::set<int64_t> all = samplePass(sampler, count, 4096, 0.0, 1.0);
+  std::set<int64_t> limited = samplePass(sampler, count, 1000, 0.25, 0.75);
+  BOOST_CHECK(!limited.empty());
+
+  for (int64_t row=0; row<count; ++row)
+  {
+    bool passes = (rowValue(row) >= 0.25) && (rowValue(row) < 0.75);
+    BOOST_CHECK_EQUAL(all.count(row) > 0, sampler.keepRow(row));
+    BOOST_CHECK_EQUAL(limited.count(row) > 0, passes && sampler.keepRow(row));
+  }
+}
+
+BOOST_AUTO_TEST_CASE( source_sampled_rows_are_only_reweighted )
+{
+  ParticleSampler sampler(0.25, 4096, 3);
+  ParticleChunk chunk, sample;
+  chunk.resize(100);
+  for (int64_t i=0; i<100; ++i)
+  {
+    chunk.weight()[i] = 1.0;
+    chunk.species()[i] = 2;
+    chunk.rows()[i] = 5000 + i;
+  }
+  BOOST_CHECK_EQUAL(sampler.sample(chunk, sample, true), 100);
+  BOOST_CHECK_EQUAL(sample.rows()[99], 5099);
+  BOOST_CHECK_EQUAL(sample.species()[0], 2);
+  BOOST_CHECK_CLOSE(sample.weight()[50], 4.0, 1e-12);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
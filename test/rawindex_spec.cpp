@@ -0,0 +1,118 @@
+/*
+ * rawindex_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <rawindex.hpp>
+#include <common/binaryio.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <vector>
+
+namespace {
+  template<typename T>
+  void put(std::ostream &out, T value)
+  {
+    out.write((const char*)&value, sizeof(T));
+  }
+
+  /// Write a piece with the given number of particles per species and chunk length
+  void writePiece(std::ostream &out, const std::vector<int> &counts, int32_t chunk)
+  {
+    put<int32_t>(out, 0);
+    put<int32_t>(out, 2);
+    put<int32_t>(out, counts.size());
+    put<int32_t>(out, chunk);
+    for (int k=0; k<4; ++k) put<double>(out, k);
+
+    float value = 0.0f;
+    for (size_t s=0; s<counts.size(); ++s)
+    {
+      put<int32_t>(out, counts[s]);
+      put<double>(out, 1.0);
+      put<double>(out, 1.0);
+      int left = counts[s];
+      while (true)
+      {
+        int32_t size = std::min(left, chunk);
+        put<int32_t>(out, size);
+        for (int i=0; i<6*size; ++i) put<float>(out, value++);
+        left -= size;
+        if (size < chunk) break;
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE( rawindex )
+
+BOOST_AUTO_TEST_CASE( segments_of_piece )
+{
+  std::stringstream buffer;
+  std::vector<int> counts;
+  counts.push_back(25);
+  counts.push_back(0);
+  counts.push_back(20);
+  writePiece(buffer, counts, 10);
+
+  std::vector<RawSegment> segments;
+  RawIndex::scanPiece(buffer, 3, segments);
+
+  // 10+10+5 for the first species, nothing for the second, 10+10 and an empty chunk for the third
+  BOOST_REQUIRE_EQUAL(segments.size(), 5u);
+  int64_t total = 0;
+  for (size_t s=0; s<segments.size(); ++s)
+  {
+    BOOST_CHECK_EQUAL(segments[s].piece, 3);
+    total += segments[s].count;
+  }
+  BOOST_CHECK_EQUAL(total, 45);
+  BOOST_CHECK_EQUAL(segments[2].count, 5);
+  BOOST_CHECK_EQUAL(segments[2].species, 1);
+  BOOST_CHECK_EQUAL(segments[3].species, 3);
+
+  // the offsets point at the records, the first value of the third species follows 25 records
+  float first;
+  buffer.clear();
+  buffer.seekg(segments[3].offset);
+  msdf::detail::readValue(buffer, first);
+  BOOST_CHECK_EQUAL(first, 6.0f*25);
+}
+
+BOOST_AUTO_TEST_CASE( corrupt_header )
+{
+  std::stringstream buffer;
+  put<int32_t>(buffer, 0);
+  put<int32_t>(buffer, 2);
+
+  std::vector<RawSegment> segments;
+  BOOST_CHECK_THROW(RawIndex::scanPiece(buffer, 0, segments), msdf::GenericException);
+}
+
+BOOST_AUTO_TEST_CASE( deinterleave )
+{
+  for (int count=0; count<8; ++count)
+  {
+    std::vector<float> records(6*count);
+    for (int i=0; i<6*count; ++i) records[i] = 0.5f*i;
+
+    std::vector<double> columns[6];
+    double *dst[6];
+    for (int c=0; c<6; ++c)
+    {
+      columns[c].resize(count);
+      dst[c] = columns[c].data();
+    }
+
+    deinterleaveRecords(records.data(), count, dst);
+    for (int i=0; i<count; ++i)
+      for (int c=0; c<6; ++c)
+        BOOST_CHECK_EQUAL(columns[c][i], 0.5*(6*i + c));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
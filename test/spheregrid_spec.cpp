@@ -0,0 +1,60 @@
+/*
+ * spheregrid_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <spheregrid.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE( spheregrid )
+
+BOOST_AUTO_TEST_CASE( centres_map_to_their_pixel )
+{
+  int nsides[4] = { 1, 2, 5, 16 };
+  for (int n=0; n<4; ++n)
+  {
+    SphereGrid sphere(nsides[n]);
+    BOOST_CHECK_EQUAL(sphere.getNumPixels(), 12*nsides[n]*nsides[n]);
+    for (int64_t pix=0; pix<sphere.getNumPixels(); ++pix)
+    {
+      double z, phi;
+      sphere.centre(pix, z, phi);
+      BOOST_REQUIRE(std::fabs(z) < 1.0);
+      BOOST_REQUIRE_EQUAL(sphere.pixel(z, phi), pix);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( pixels_have_equal_area )
+{
+  // directions on a fine grid that is uniform in cos(theta) and phi
+  SphereGrid sphere(4);
+  std::vector<int> count(sphere.getNumPixels(), 0);
+  const int nz = 2000, nphi = 2000;
+  for (int i=0; i<nz; ++i)
+    for (int j=0; j<nphi; ++j)
+      ++count[sphere.pixel(-1.0 + (i + 0.5)*2.0/nz, (j + 0.5)*2.0*M_PI/nphi)];
+
+  double expected = double(nz)*nphi/sphere.getNumPixels();
+  for (size_t pix=0; pix<count.size(); ++pix)
+    BOOST_CHECK_SMALL(count[pix]/expected - 1.0, 0.02);
+  BOOST_CHECK_CLOSE(sphere.getPixelArea()*sphere.getNumPixels(), 4.0*M_PI, 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE( directions )
+{
+  SphereGrid sphere(8);
+  BOOST_CHECK_EQUAL(sphere.direction(1.0, 0.0, 0.0), sphere.pixel(1.0, 0.0));
+  BOOST_CHECK_EQUAL(sphere.direction(-2.0, 0.0, 0.0), sphere.pixel(-1.0, 0.0));
+  BOOST_CHECK_EQUAL(sphere.direction(0.0, 0.0, 3.0), sphere.pixel(0.0, 0.5*M_PI));
+  BOOST_CHECK_EQUAL(sphere.direction(0.0, -1.0, 0.5), sphere.pixel(0.0, std::atan2(0.5, -1.0)));
+  BOOST_CHECK(sphere.direction(1.0, 1.0, 0.0) < sphere.getNumPixels()/2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
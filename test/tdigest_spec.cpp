@@ -0,0 +1,74 @@
+/*
+ * tdigest_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <tdigest.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <sstream>
+
+BOOST_AUTO_TEST_SUITE( tdigest )
+
+BOOST_AUTO_TEST_CASE( uniform_quantiles )
+{
+  TDigest digest;
+  for (int i=0; i<100000; ++i) digest.add((i*7919 % 100000)/100000.0);
+
+  BOOST_CHECK_CLOSE(digest.getWeight(), 100000.0, 1e-9);
+  BOOST_CHECK_SMALL(digest.quantile(0.5) - 0.5, 0.01);
+  BOOST_CHECK_SMALL(digest.quantile(0.1) - 0.1, 0.01);
+  BOOST_CHECK_SMALL(digest.quantile(0.999) - 0.999, 0.001);
+  BOOST_CHECK_EQUAL(digest.quantile(0.0), 0.0);
+  BOOST_CHECK(digest.size() < 500);
+}
+
+BOOST_AUTO_TEST_CASE( weights_shift_quantiles )
+{
+  TDigest digest;
+  for (int i=0; i<1000; ++i)
+  {
+    digest.add(1.0, 1.0);
+    digest.add(2.0, 3.0);
+  }
+  BOOST_CHECK_CLOSE(digest.quantile(0.9), 2.0, 1e-9);
+  BOOST_CHECK_CLOSE(digest.quantile(0.1), 1.0, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE( merge_matches_single_digest )
+{
+  TDigest all, first, second;
+  for (int i=0; i<50000; ++i)
+  {
+    double value = std::exp(-(i % 1000)/100.0);
+    all.add(value);
+    if (i % 2) first.add(value);
+    else second.add(value);
+  }
+  first.merge(second);
+
+  BOOST_CHECK_CLOSE(first.getWeight(), all.getWeight(), 1e-9);
+  for (int k=1; k<10; ++k)
+    BOOST_CHECK_SMALL(first.quantile(k/10.0) - all.quantile(k/10.0), 0.01);
+}
+
+BOOST_AUTO_TEST_CASE( write_and_read )
+{
+  TDigest digest;
+  for (int i=0; i<10000; ++i) digest.add(i, 0.5);
+
+  std::stringstream stream;
+  digest.write(stream);
+  TDigest copy;
+  copy.read(stream);
+
+  BOOST_CHECK_CLOSE(copy.getWeight(), digest.getWeight(), 1e-12);
+  BOOST_CHECK_EQUAL(copy.getMax(), 9999.0);
+  BOOST_CHECK_CLOSE(copy.quantile(0.25), digest.quantile(0.25), 1e-9);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
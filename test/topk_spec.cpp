@@ -0,0 +1,109 @@
+/*
+ * topk_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <topk.hpp>
+#include <memorybudget.hpp>
+#include <common/binaryio.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+namespace {
+  TopKRecord makeRecord(double key, int64_t index)
+  {
+    TopKRecord record = TopKRecord();
+    record.key = key;
+    record.index = index;
+    record.species = 1;
+    record.weight = 1.0;
+    return record;
+  }
+
+  double keyOf(int64_t i)
+  {
+    return double((i*7919) % 1000);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE( topk )
+
+BOOST_AUTO_TEST_CASE( keeps_largest )
+{
+  TopK top(3);
+  double keys[] = { 5.0, 1.0, 9.0, 3.0, 7.0, 2.0 };
+  for (int i=0; i<6; ++i) top.push(makeRecord(keys[i], i));
+
+  std::vector<TopKRecord> result = top.sorted();
+  BOOST_REQUIRE_EQUAL(result.size(), 3u);
+  BOOST_CHECK_EQUAL(result[0].key, 9.0);
+  BOOST_CHECK_EQUAL(result[1].key, 7.0);
+  BOOST_CHECK_EQUAL(result[2].key, 5.0);
+  BOOST_CHECK(top.rejects(4.0));
+  BOOST_CHECK(!top.rejects(6.0));
+}
+
+BOOST_AUTO_TEST_CASE( ties_prefer_earlier )
+{
+  TopK top(2);
+  for (int i=0; i<5; ++i) top.push(makeRecord(1.0, 4-i));
+
+  std::vector<TopKRecord> result = top.sorted();
+  BOOST_REQUIRE_EQUAL(result.size(), 2u);
+  BOOST_CHECK_EQUAL(result[0].index, 0);
+  BOOST_CHECK_EQUAL(result[1].index, 1);
+}
+
+BOOST_AUTO_TEST_CASE( merge_is_partition_independent )
+{
+  const int64_t count = 5000;
+  TopK single(50);
+  for (int64_t i=0; i<count; ++i) single.push(makeRecord(keyOf(i), i));
+
+  std::vector<pTopK> parts;
+  for (int t=0; t<7; ++t) parts.push_back(pTopK(new TopK(50)));
+  for (int64_t i=0; i<count; ++i) parts[(i*13) % 7]->push(makeRecord(keyOf(i), i));
+
+  TopK merged(50);
+  for (int t=6; t>=0; --t) merged.merge(*parts[t]);
+
+  std::vector<TopKRecord> a = single.sorted();
+  std::vector<TopKRecord> b = merged.sorted();
+  BOOST_REQUIRE_EQUAL(a.size(), b.size());
+  for (size_t i=0; i<a.size(); ++i)
+  {
+    BOOST_CHECK_EQUAL(a[i].key, b[i].key);
+    BOOST_CHECK_EQUAL(a[i].index, b[i].index);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( zero_capacity )
+{
+  TopK top(0);
+  top.push(makeRecord(1.0, 0));
+  BOOST_CHECK_EQUAL(top.size(), 0);
+  BOOST_CHECK(top.rejects(100.0));
+}
+
+BOOST_AUTO_TEST_CASE( budget_is_reserved_when_created )
+{
+  MemoryBudget::setLimit(100*sizeof(TopKRecord));
+  {
+    TopK top(60);
+    BOOST_CHECK_EQUAL(MemoryBudget::getUsed(), int64_t(60*sizeof(TopKRecord)));
+    BOOST_CHECK_THROW(TopK(60), msdf::GenericException);
+
+    // filling the heap doesn't touch the budget
+    for (int i=0; i<1000; ++i) top.push(makeRecord(i % 97, i));
+    BOOST_CHECK_EQUAL(top.size(), 60);
+    BOOST_CHECK_EQUAL(MemoryBudget::getUsed(), int64_t(60*sizeof(TopKRecord)));
+  }
+  BOOST_CHECK_EQUAL(MemoryBudget::getUsed(), 0);
+  MemoryBudget::setLimit(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
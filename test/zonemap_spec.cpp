@@ -0,0 +1,181 @@
+/*
+ * zonemap_spec.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: Holger Schmitz
+ */
+
+#include <zonemap.hpp>
+#include <common/binaryio.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+namespace fs = boost::filesystem;
+
+namespace {
+  /// A temporary source file and the name of its sidecar, both removed on destruction
+  struct TempSource
+  {
+      std::string name;
+      std::string mapName;
+
+      TempSource()
+      {
+        name = (fs::temp_directory_path() / fs::unique_path("zonemap-%%%%-%%%%.sdf")).string();
+        mapName = ZoneMap::sidecarName(name);
+        std::ofstream out(name.c_str(), std::ios::binary);
+        out << "not really an sdf file";
+      }
+
+      ~TempSource()
+      {
+        fs::remove(name);
+        fs::remove(mapName);
+      }
+  };
+}
+
+BOOST_AUTO_TEST_SUITE( zonemap )
+
+BOOST_AUTO_TEST_CASE( zones_cut_by_chunks )
+{
+  const double data[10] = { 3.0, -1.0, 4.0, 1.0, 5.0, -9.0, 2.0, 6.0, 5.0, -3.0 };
+  ZoneMap zoneMap(4);
+  ZoneColumn &column = zoneMap.addColumn("px", 10);
+
+  // the last zone only holds two rows
+  BOOST_REQUIRE_EQUAL(column.getZoneCount(), 3);
+
+  // chunks of three rows start in the middle of the zones
+  for (int64_t first=0; first<10; first+=3)
+    zoneMap.accumulate(column, first, data + first, std::min<int64_t>(3, 10 - first));
+
+  for (int64_t z=0; z<3; ++z)
+  {
+    const double *begin = data + 4*z;
+    const double *end = data + std::min<int64_t>(4*z + 4, 10);
+    BOOST_CHECK_EQUAL(column.minval[z], *std::min_element(begin, end));
+    BOOST_CHECK_EQUAL(column.maxval[z], *std::max_element(begin, end));
+  }
+}
+
+BOOST_AUTO_TEST_CASE( write_read_round_trip )
+{
+  TempSource source;
+  const double data[5] = { 0.5, 0.25, -2.0, 8.0, 1.0 };
+
+  ZoneMap zoneMap(2);
+  zoneMap.accumulate(zoneMap.addColumn(ZoneMap::meshColumnName("grid", 0), 5), 0, data, 5);
+  zoneMap.addColumn("empty", 0);
+  zoneMap.setSource(source.name);
+  zoneMap.write(source.mapName);
+
+  pZoneMap copy = ZoneMap::read(source.mapName, source.name);
+  BOOST_REQUIRE(copy);
+  BOOST_CHECK_EQUAL(copy->getZoneLength(), 2);
+  BOOST_CHECK(copy->hasColumn("grid/0"));
+  BOOST_CHECK(!copy->hasColumn("grid/1"));
+  BOOST_CHECK_EQUAL(copy->getColumn("empty").getZoneCount(), 0);
+
+  const ZoneColumn &original = zoneMap.getColumn("grid/0");
+  const ZoneColumn &column = copy->getColumn("grid/0");
+  BOOST_REQUIRE_EQUAL(column.getZoneCount(), 3);
+  for (int64_t z=0; z<3; ++z)
+  {
+    BOOST_CHECK_EQUAL(column.minval[z], original.minval[z]);
+    BOOST_CHECK_EQUAL(column.maxval[z], original.maxval[z]);
+  }
+  BOOST_CHECK_THROW(copy->getColumn("grid/1"), msdf::GenericException);
+}
+
+BOOST_AUTO_TEST_CASE( stale_sidecar_is_rejected )
+{
+  TempSource source;
+  ZoneMap zoneMap(16);
+  zoneMap.addColumn("px", 100);
+  zoneMap.setSource(source.name);
+  zoneMap.write(source.mapName);
+  BOOST_CHECK(ZoneMap::read(source.mapName, source.name));
+
+  {
+    std::ofstream out(source.name.c_str(), std::ios::binary | std::ios::app);
+    out << "appended";
+  }
+  BOOST_CHECK(!ZoneMap::read(source.mapName, source.name));
+
+  // a missing sidecar is not an error, but a file that isn't a zone map is
+  fs::remove(source.mapName);
+  BOOST_CHECK(!ZoneMap::read(source.mapName, source.name));
+  {
+    std::ofstream out(source.mapName.c_str(), std::ios::binary);
+    out << "something else entirely";
+  }
+  BOOST_CHECK_THROW(ZoneMap::read(source.mapName, source.name), msdf::GenericException);
+}
+
+BOOST_AUTO_TEST_CASE( candidate_rows_of_a_chunk )
+{
+  // zones of four rows, the first and last zone only have negative px
+  const double px[10] = { -1.0, -0.5, -0.7, -0.6, 0.1, 2.0, -1.0, 0.5, -3.0, -1.0 };
+  ZoneMap zoneMap(4);
+  ParticleZones zones;
+  ZoneColumn &column = zoneMap.addColumn("px", 10);
+  zoneMap.accumulate(column, 0, px, 10);
+  zones.px = &column;
+
+  ParticleFilter filter;
+  filter.setPositivePx(true);
+
+  int64_t first, count;
+  BOOST_CHECK(zoneMap.findCandidateRows(zones, filter, 1, 0, 10, first, count));
+  BOOST_CHECK_EQUAL(first, 4);
+  BOOST_CHECK_EQUAL(count, 4);
+
+  // a chunk of rows 2 to 6 only reads the rows of the second zone
+  BOOST_CHECK(zoneMap.findCandidateRows(zones, filter, 1, 2, 5, first, count));
+  BOOST_CHECK_EQUAL(first, 2);
+  BOOST_CHECK_EQUAL(count, 3);
+
+  BOOST_CHECK(!zoneMap.findCandidateRows(zones, filter, 1, 0, 4, first, count));
+  BOOST_CHECK(!zoneMap.findCandidateRows(zones, filter, 1, 8, 2, first, count));
+
+  // the short last zone is clipped to the end of the block
+  column.maxval[2] = 1.0;
+  BOOST_CHECK(zoneMap.findCandidateRows(zones, filter, 1, 6, 4, first, count));
+  BOOST_CHECK_EQUAL(first, 0);
+  BOOST_CHECK_EQUAL(count, 4);
+  BOOST_CHECK(zoneMap.findCandidateRows(zones, filter, 1, 8, 2, first, count));
+  BOOST_CHECK_EQUAL(first, 0);
+  BOOST_CHECK_EQUAL(count, 2);
+
+  // without a zone column of the filter all rows are candidates
+  ParticleZones positions;
+  BOOST_CHECK(zoneMap.findCandidateRows(positions, filter, 1, 0, 4, first, count));
+  BOOST_CHECK_EQUAL(first, 0);
+  BOOST_CHECK_EQUAL(count, 4);
+}
+
+BOOST_AUTO_TEST_CASE( candidate_rows_use_the_spatial_limits )
+{
+  const double x[8] = { 0.0, 0.1, 0.2, 0.3, 0.4, 0.5, 0.6, 0.7 };
+  ZoneMap zoneMap(2);
+  ParticleZones zones;
+  ZoneColumn &column = zoneMap.addColumn(ZoneMap::meshColumnName("grid", 0), 8);
+  zoneMap.accumulate(column, 0, x, 8);
+  zones.x = &column;
+
+  ParticleFilter filter;
+  filter.setSpatialLimits(std::vector<double>(1, 0.25), std::vector<double>(1, 0.45),
+                          std::vector<double>(), std::vector<double>());
+
+  int64_t first, count;
+  BOOST_CHECK(zoneMap.findCandidateRows(zones, filter, 1, 0, 8, first, count));
+  BOOST_CHECK_EQUAL(first, 2);
+  BOOST_CHECK_EQUAL(count, 4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()